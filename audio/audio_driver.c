@@ -40,6 +40,7 @@
 #include "../driver.h"
 #include "../configuration.h"
 #include "../retroarch.h"
+#include "../performance_counters.h"
 #include "../runloop.h"
 #include "../verbosity.h"
 #include "../list_special.h"
@@ -504,6 +505,8 @@ void audio_driver_set_nonblocking_state(bool enable)
  **/
 static bool audio_driver_flush(const int16_t *data, size_t samples)
 {
+   static struct retro_perf_counter resampler_proc = {0};
+   static struct retro_perf_counter audio_dsp      = {0};
    struct resampler_data src_data;
    bool is_perfcnt_enable                               = false;
    bool is_paused                                       = false;
@@ -549,7 +552,10 @@ static bool audio_driver_flush(const int16_t *data, size_t samples)
       dsp_data.input                 = audio_driver_input_data;
       dsp_data.input_frames          = (unsigned)(samples >> 1);
 
+      performance_counter_init(audio_dsp, "audio_dsp");
+      performance_counter_start_plus(is_perfcnt_enable, audio_dsp);
       retro_dsp_filter_process(audio_driver_dsp, &dsp_data);
+      performance_counter_stop_plus(is_perfcnt_enable, audio_dsp);
 
       if (dsp_data.output)
       {
@@ -593,7 +599,10 @@ static bool audio_driver_flush(const int16_t *data, size_t samples)
    if (is_slowmotion)
       src_data.ratio *= settings->floats.slowmotion_ratio;
 
+   performance_counter_init(resampler_proc, "resampler_proc");
+   performance_counter_start_plus(is_perfcnt_enable, resampler_proc);
    audio_driver_resampler->process(audio_driver_resampler_data, &src_data);
+   performance_counter_stop_plus(is_perfcnt_enable, resampler_proc);
 
    output_data   = audio_driver_output_samples_buf;
    output_frames = (unsigned)src_data.output_frames;
@@ -740,6 +749,11 @@ error:
       RARCH_ERR("[DSP]: Failed to initialize DSP filter \"%s\".\n", device);
 }
 
+bool audio_driver_dsp_filter_alive(void)
+{
+   return !!audio_driver_dsp;
+}
+
 void audio_driver_set_buffer_size(size_t bufsize)
 {
    audio_driver_buffer_size = bufsize;
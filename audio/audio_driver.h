@@ -178,6 +178,8 @@ void audio_driver_dsp_filter_free(void);
 
 void audio_driver_dsp_filter_init(const char *device);
 
+bool audio_driver_dsp_filter_alive(void);
+
 void audio_driver_set_buffer_size(size_t bufsize);
 
 bool audio_driver_get_devices_list(void **ptr);
@@ -0,0 +1,761 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && (defined(__unix__) || defined(__APPLE__))
+#include <sys/resource.h>
+#define HAVE_BENCHMARK_RUSAGE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+#include <lists/string_list.h>
+#include <retro_miscellaneous.h>
+#include <string/stdstring.h>
+
+#include "benchmark.h"
+
+#include "audio/audio_driver.h"
+#include "configuration.h"
+#include "core_info.h"
+#include "gfx/video_driver.h"
+#include "input/input_driver.h"
+#include "managers/state_manager.h"
+#include "paths.h"
+#include "performance_counters.h"
+#include "record/record_driver.h"
+#include "runloop.h"
+#include "verbosity.h"
+
+#ifdef HAVE_MENU
+#include "menu/menu_driver.h"
+#include "menu/menu_displaylist.h"
+#endif
+
+#ifdef HAVE_NETWORKING
+#include "network/netplay/netplay.h"
+#endif
+
+#define BENCHMARK_SUITES_MAX       8
+#define BENCHMARK_SUITE_RESULT_SIZE 256
+
+/* input_state() lookups timed by the input suite */
+#define BENCHMARK_INPUT_CALLS 1000000
+
+/* Core info lists built by the core_info suite, per pass */
+#define BENCHMARK_CORE_INFO_LISTS 20
+
+/* Passes over every settings list made by the menu suite */
+#define BENCHMARK_MENU_PASSES 100
+
+typedef struct benchmark_state
+{
+   retro_perf_tick_t *frame_ticks;
+   retro_perf_tick_t first_tick;
+   retro_perf_tick_t last_tick;
+   retro_time_t first_usec;
+   retro_time_t last_usec;
+   unsigned frames;
+   unsigned count;
+   unsigned suites;
+   bool enabled;
+   char report_path[PATH_MAX_LENGTH];
+   char suite_results[BENCHMARK_SUITES_MAX][BENCHMARK_SUITE_RESULT_SIZE];
+} benchmark_state_t;
+
+typedef struct benchmark_suite
+{
+   const char *ident;
+   /* Writes its results as a JSON object */
+   void (*run)(char *s, size_t len);
+} benchmark_suite_t;
+
+static benchmark_state_t benchmark_st;
+
+/* Times input_state() lookups spread over every joypad button and
+ * analog axis of every user, once through the per-frame snapshot and
+ * once straight through the input driver, and checks that both paths
+ * agree on every input. */
+static void benchmark_suite_input(char *s, size_t len)
+{
+   unsigned i, pass;
+   double rate[2];
+   unsigned mismatches   = 0;
+   volatile int16_t sink = 0;
+   const unsigned slots  = RARCH_FIRST_CUSTOM_BIND + 4;
+   settings_t *settings  = config_get_ptr();
+   unsigned max_users    = MIN(settings->input.max_users, MAX_USERS);
+
+   if (!max_users)
+   {
+      strlcpy(s, "null", len);
+      return;
+   }
+
+   for (i = 0; i < max_users * slots; i++)
+   {
+      unsigned port   = i / slots;
+      unsigned slot   = i % slots;
+      unsigned device = slot < RARCH_FIRST_CUSTOM_BIND
+         ? RETRO_DEVICE_JOYPAD : RETRO_DEVICE_ANALOG;
+      unsigned idx    = slot < RARCH_FIRST_CUSTOM_BIND
+         ? 0 : (slot - RARCH_FIRST_CUSTOM_BIND) >> 1;
+      unsigned id     = slot < RARCH_FIRST_CUSTOM_BIND ? slot : slot & 1;
+      int16_t cached;
+
+      input_driver_unset_snapshot_bypass();
+      cached = input_state(port, device, idx, id);
+      input_driver_set_snapshot_bypass();
+      if (cached != input_state(port, device, idx, id))
+         mismatches++;
+   }
+
+   for (pass = 0; pass < 2; pass++)
+   {
+      retro_time_t start, elapsed;
+
+      if (pass)
+         input_driver_set_snapshot_bypass();
+      else
+         input_driver_unset_snapshot_bypass();
+
+      start = cpu_features_get_time_usec();
+
+      for (i = 0; i < BENCHMARK_INPUT_CALLS; i++)
+      {
+         unsigned port = i % max_users;
+         unsigned slot = (i / max_users) % slots;
+
+         if (slot < RARCH_FIRST_CUSTOM_BIND)
+            sink |= input_state(port, RETRO_DEVICE_JOYPAD, 0, slot);
+         else
+            sink |= input_state(port, RETRO_DEVICE_ANALOG,
+                  (slot - RARCH_FIRST_CUSTOM_BIND) >> 1, slot & 1);
+      }
+
+      elapsed    = cpu_features_get_time_usec() - start;
+      rate[pass] = BENCHMARK_INPUT_CALLS * 1000000.0
+         / (elapsed ? elapsed : 1);
+   }
+
+   input_driver_unset_snapshot_bypass();
+
+   snprintf(s, len, "{ \"calls\": %u, \"snapshot_calls_per_s\": %.0f, "
+         "\"driver_calls_per_s\": %.0f, \"mismatches\": %u }",
+         BENCHMARK_INPUT_CALLS, rate[0], rate[1], mismatches);
+}
+
+/* Like string_is_equal, but two NULL strings are equal. */
+static bool benchmark_string_equal(const char *a, const char *b)
+{
+   if (!a || !b)
+      return a == b;
+   return string_is_equal(a, b);
+}
+
+static bool benchmark_core_info_equal(const core_info_t *a,
+      const core_info_t *b)
+{
+   size_t i;
+
+   if (     !benchmark_string_equal(a->path, b->path)
+         || !benchmark_string_equal(a->display_name, b->display_name)
+         || !benchmark_string_equal(a->core_name, b->core_name)
+         || !benchmark_string_equal(a->systemname, b->systemname)
+         || !benchmark_string_equal(a->system_manufacturer, b->system_manufacturer)
+         || !benchmark_string_equal(a->supported_extensions, b->supported_extensions)
+         || !benchmark_string_equal(a->authors, b->authors)
+         || !benchmark_string_equal(a->permissions, b->permissions)
+         || !benchmark_string_equal(a->licenses, b->licenses)
+         || !benchmark_string_equal(a->categories, b->categories)
+         || !benchmark_string_equal(a->databases, b->databases)
+         || !benchmark_string_equal(a->notes, b->notes)
+         || a->has_info         != b->has_info
+         || a->supports_no_game != b->supports_no_game
+         || a->firmware_count   != b->firmware_count)
+      return false;
+
+   for (i = 0; i < a->firmware_count; i++)
+      if (     !benchmark_string_equal(a->firmware[i].path, b->firmware[i].path)
+            || !benchmark_string_equal(a->firmware[i].desc, b->firmware[i].desc)
+            || a->firmware[i].optional != b->firmware[i].optional)
+         return false;
+
+   return true;
+}
+
+/* Times building the core info list of the cores directory by
+ * parsing every .info file and from the core info cache, and
+ * checks that both hold the same core info. */
+static void benchmark_suite_core_info(char *s, size_t len)
+{
+   unsigned pass, i;
+   double ms[2];
+   size_t mismatches     = 0;
+   settings_t *settings  = config_get_ptr();
+   const char *dir       = settings->directory.libretro;
+   core_info_list_t *lists[2];
+
+   /* The first cached list brings the cache up to date, so the
+    * second one is served from it */
+   lists[0] = core_info_list_new(dir, false);
+   core_info_list_free(core_info_list_new(dir, true));
+   lists[1] = core_info_list_new(dir, true);
+
+   if (!lists[0] || !lists[1])
+   {
+      core_info_list_free(lists[0]);
+      core_info_list_free(lists[1]);
+      strlcpy(s, "null", len);
+      return;
+   }
+
+   if (lists[0]->count == lists[1]->count)
+   {
+      for (i = 0; i < lists[0]->count; i++)
+         mismatches += !benchmark_core_info_equal(
+               &lists[0]->list[i], &lists[1]->list[i]);
+   }
+   else
+      mismatches = MAX(lists[0]->count, lists[1]->count);
+
+   for (pass = 0; pass < 2; pass++)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+
+      for (i = 0; i < BENCHMARK_CORE_INFO_LISTS; i++)
+         core_info_list_free(core_info_list_new(dir, pass == 1));
+
+      ms[pass] = (cpu_features_get_time_usec() - start)
+         / 1000.0 / BENCHMARK_CORE_INFO_LISTS;
+   }
+
+   snprintf(s, len, "{ \"cores\": %u, \"lists\": %u, "
+         "\"parse_ms_per_list\": %.3f, \"cache_ms_per_list\": %.3f, "
+         "\"mismatches\": %u }",
+         (unsigned)lists[0]->count, BENCHMARK_CORE_INFO_LISTS,
+         ms[0], ms[1], (unsigned)mismatches);
+
+   core_info_list_free(lists[0]);
+   core_info_list_free(lists[1]);
+}
+
+#ifdef HAVE_MENU
+/* Populates every settings displaylist with advanced settings
+ * shown, once with setting lookups going through the settings
+ * index and once with them scanning the settings list, and checks
+ * that both bind the same setting to every entry. */
+static void benchmark_suite_menu(char *s, size_t len)
+{
+   static const enum menu_displaylist_ctl_state types[] = {
+      DISPLAYLIST_SETTINGS_ALL,
+      DISPLAYLIST_DRIVER_SETTINGS_LIST,
+      DISPLAYLIST_VIDEO_SETTINGS_LIST,
+      DISPLAYLIST_CONFIGURATION_SETTINGS_LIST,
+      DISPLAYLIST_SAVING_SETTINGS_LIST,
+      DISPLAYLIST_LOGGING_SETTINGS_LIST,
+      DISPLAYLIST_FRAME_THROTTLE_SETTINGS_LIST,
+      DISPLAYLIST_REWIND_SETTINGS_LIST,
+      DISPLAYLIST_AUDIO_SETTINGS_LIST,
+      DISPLAYLIST_CORE_SETTINGS_LIST,
+      DISPLAYLIST_INPUT_SETTINGS_LIST,
+      DISPLAYLIST_INPUT_HOTKEY_BINDS_LIST,
+      DISPLAYLIST_ONSCREEN_OVERLAY_SETTINGS_LIST,
+      DISPLAYLIST_ONSCREEN_DISPLAY_SETTINGS_LIST,
+      DISPLAYLIST_ONSCREEN_NOTIFICATIONS_SETTINGS_LIST,
+      DISPLAYLIST_MENU_FILE_BROWSER_SETTINGS_LIST,
+      DISPLAYLIST_MENU_SETTINGS_LIST,
+      DISPLAYLIST_USER_INTERFACE_SETTINGS_LIST,
+      DISPLAYLIST_RETRO_ACHIEVEMENTS_SETTINGS_LIST,
+      DISPLAYLIST_UPDATER_SETTINGS_LIST,
+      DISPLAYLIST_NETWORK_SETTINGS_LIST,
+      DISPLAYLIST_USER_SETTINGS_LIST,
+      DISPLAYLIST_DIRECTORY_SETTINGS_LIST,
+      DISPLAYLIST_PRIVACY_SETTINGS_LIST,
+      DISPLAYLIST_RECORDING_SETTINGS_LIST,
+      DISPLAYLIST_PLAYLIST_SETTINGS_LIST
+   };
+   unsigned pass, iter, i;
+   bool show_advanced;
+   double ms[2];
+   uint64_t checksum[2] = {0};
+   size_t entries[2]    = {0};
+   settings_t *settings = config_get_ptr();
+   file_list_t *list    = (file_list_t*)calloc(1, sizeof(*list));
+
+   if (!list)
+   {
+      strlcpy(s, "null", len);
+      return;
+   }
+
+   show_advanced = settings->bools.menu_show_advanced_settings;
+   settings->bools.menu_show_advanced_settings = true;
+
+   for (pass = 0; pass < 2; pass++)
+   {
+      retro_time_t start;
+
+      menu_setting_ctl(pass
+            ? MENU_SETTING_CTL_INDEX_DISABLE
+            : MENU_SETTING_CTL_INDEX_ENABLE, NULL);
+
+      start = cpu_features_get_time_usec();
+
+      for (iter = 0; iter < BENCHMARK_MENU_PASSES; iter++)
+      {
+         for (i = 0; i < ARRAY_SIZE(types); i++)
+         {
+            menu_displaylist_info_t info = {0};
+
+            info.list = list;
+            menu_displaylist_ctl(types[i], &info);
+
+            if (iter == 0)
+            {
+               size_t j;
+
+               for (j = 0; j < list->size; j++)
+               {
+                  menu_file_list_cbs_t *cbs =
+                     menu_entries_get_actiondata_at_offset(list, j);
+
+                  checksum[pass] = checksum[pass] * 31
+                     + (uintptr_t)(cbs ? cbs->setting : NULL);
+               }
+
+               entries[pass] += list->size;
+            }
+
+            menu_entries_ctl(MENU_ENTRIES_CTL_CLEAR, list);
+         }
+      }
+
+      ms[pass] = (cpu_features_get_time_usec() - start)
+         / 1000.0 / BENCHMARK_MENU_PASSES;
+   }
+
+   menu_setting_ctl(MENU_SETTING_CTL_INDEX_ENABLE, NULL);
+   settings->bools.menu_show_advanced_settings = show_advanced;
+   file_list_free(list);
+
+   snprintf(s, len, "{ \"lists\": %u, \"entries\": %u, \"passes\": %u, "
+         "\"indexed_ms_per_pass\": %.3f, \"scan_ms_per_pass\": %.3f, "
+         "\"same_settings\": %s }",
+         (unsigned)ARRAY_SIZE(types), (unsigned)entries[0],
+         BENCHMARK_MENU_PASSES, ms[0], ms[1],
+         (checksum[0] == checksum[1] && entries[0] == entries[1])
+         ? "true" : "false");
+}
+#endif
+
+static const benchmark_suite_t benchmark_suites[] = {
+   { "input", benchmark_suite_input },
+   { "core_info", benchmark_suite_core_info },
+#ifdef HAVE_MENU
+   { "menu", benchmark_suite_menu },
+#endif
+};
+
+static bool benchmark_parse_suites(const char *suites)
+{
+   size_t i;
+   unsigned j;
+   struct string_list *list = string_split(suites, ",");
+
+   if (!list)
+      return false;
+
+   for (i = 0; i < list->size; i++)
+   {
+      for (j = 0; j < ARRAY_SIZE(benchmark_suites); j++)
+         if (string_is_equal(list->elems[i].data, benchmark_suites[j].ident))
+            break;
+
+      if (j == ARRAY_SIZE(benchmark_suites))
+      {
+         RARCH_ERR("[Benchmark]: Unknown suite \"%s\".\n",
+               list->elems[i].data);
+         string_list_free(list);
+         return false;
+      }
+
+      benchmark_st.suites |= 1 << j;
+   }
+
+   string_list_free(list);
+   return true;
+}
+
+/* Runs right after the last frame, while the input and menu
+ * state are still those of a running frame. */
+static void benchmark_run_suites(void)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(benchmark_suites); i++)
+   {
+      if (!(benchmark_st.suites & (1 << i)))
+         continue;
+
+      RARCH_LOG("[Benchmark]: Running the %s suite.\n",
+            benchmark_suites[i].ident);
+      benchmark_suites[i].run(benchmark_st.suite_results[i],
+            sizeof(benchmark_st.suite_results[i]));
+   }
+}
+
+bool benchmark_init(unsigned frames, const char *report_path,
+      const char *suites)
+{
+   benchmark_deinit();
+
+   if (frames == 0)
+      return false;
+
+   if (!string_is_empty(suites) && !benchmark_parse_suites(suites))
+      return false;
+
+   benchmark_st.frame_ticks = (retro_perf_tick_t*)
+      calloc(frames, sizeof(*benchmark_st.frame_ticks));
+   if (!benchmark_st.frame_ticks)
+      return false;
+
+   if (!string_is_empty(report_path))
+      strlcpy(benchmark_st.report_path, report_path,
+            sizeof(benchmark_st.report_path));
+
+   benchmark_st.frames  = frames;
+   benchmark_st.enabled = true;
+
+   runloop_ctl(RUNLOOP_CTL_SET_MAX_FRAMES, &frames);
+
+   return true;
+}
+
+void benchmark_deinit(void)
+{
+   free(benchmark_st.frame_ticks);
+   memset(&benchmark_st, 0, sizeof(benchmark_st));
+}
+
+bool benchmark_is_enabled(void)
+{
+   return benchmark_st.enabled;
+}
+
+void benchmark_override_settings(void)
+{
+   settings_t *settings = config_get_ptr();
+
+   if (!benchmark_st.enabled || !settings)
+      return;
+
+   strlcpy(settings->video.driver, "null", sizeof(settings->video.driver));
+   strlcpy(settings->audio.driver, "null", sizeof(settings->audio.driver));
+   strlcpy(settings->input.driver, "null", sizeof(settings->input.driver));
+
+   settings->bools.video_vsync            = false;
+   settings->bools.video_frame_delay_auto = false;
+   settings->bools.audio_sync             = false;
+   settings->bools.pause_nonactive        = false;
+   settings->bools.config_save_on_exit    = false;
+   settings->video.frame_delay            = 0;
+   settings->floats.fastforward_ratio     = 0.0f;
+
+   runloop_ctl(RUNLOOP_CTL_SET_PERFCNT_ENABLE, NULL);
+}
+
+retro_perf_tick_t benchmark_frame_begin(void)
+{
+   retro_perf_tick_t start;
+
+   if (!benchmark_st.enabled)
+      return 0;
+
+   start = cpu_features_get_perf_counter();
+
+   /* Both clocks start at the beginning of the first frame,
+    * so that they cover the same interval for calibration. */
+   if (benchmark_st.count == 0)
+   {
+      benchmark_st.first_tick = start;
+      benchmark_st.first_usec = cpu_features_get_time_usec();
+   }
+
+   return start;
+}
+
+void benchmark_frame_end(retro_perf_tick_t start)
+{
+   retro_perf_tick_t now = cpu_features_get_perf_counter();
+   retro_time_t now_usec = cpu_features_get_time_usec();
+
+   if (benchmark_st.count >= benchmark_st.frames)
+      return;
+
+   benchmark_st.frame_ticks[benchmark_st.count++] = now - start;
+   benchmark_st.last_tick                         = now;
+   benchmark_st.last_usec                         = now_usec;
+
+   if (benchmark_st.count == benchmark_st.frames)
+      benchmark_run_suites();
+}
+
+static int benchmark_tick_cmp(const void *a, const void *b)
+{
+   retro_perf_tick_t x = *(const retro_perf_tick_t*)a;
+   retro_perf_tick_t y = *(const retro_perf_tick_t*)b;
+
+   return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile over the sorted frame times. */
+static retro_perf_tick_t benchmark_percentile(
+      const retro_perf_tick_t *sorted, unsigned count, unsigned pct)
+{
+   unsigned rank = (unsigned)(((uint64_t)count * pct + 99) / 100);
+
+   if (rank == 0)
+      rank = 1;
+   return sorted[rank - 1];
+}
+
+static void benchmark_write_string(FILE *file, const char *s)
+{
+   fputc('"', file);
+
+   for (; s && *s; s++)
+   {
+      unsigned char c = (unsigned char)*s;
+
+      if (c == '"' || c == '\\')
+         fprintf(file, "\\%c", c);
+      else if (c < 0x20)
+         fprintf(file, "\\u%04x", c);
+      else
+         fputc(c, file);
+   }
+
+   fputc('"', file);
+}
+
+static void benchmark_write_counters(FILE *file,
+      struct retro_perf_counter **counters, unsigned num,
+      double ticks_per_usec)
+{
+   unsigned i;
+   bool first = true;
+
+   fputc('[', file);
+
+   for (i = 0; i < num; i++)
+   {
+      const struct retro_perf_counter *counter = counters[i];
+
+      if (!counter || !counter->call_cnt)
+         continue;
+
+      fprintf(file, "%s\n      { \"ident\": ", first ? "" : ",");
+      benchmark_write_string(file, counter->ident);
+      fprintf(file, ", \"calls\": %llu, \"total_ticks\": %llu, "
+            "\"avg_ticks\": %llu, \"avg_us\": %.3f }",
+            (unsigned long long)counter->call_cnt,
+            (unsigned long long)counter->total,
+            (unsigned long long)(counter->total / counter->call_cnt),
+            (double)counter->total / counter->call_cnt / ticks_per_usec);
+      first = false;
+   }
+
+   fprintf(file, "%s]", first ? "" : "\n    ");
+}
+
+/* Perf counter ticks per microsecond, measured over a short sleep. */
+static double benchmark_calibrate(void)
+{
+   retro_perf_tick_t first_tick = cpu_features_get_perf_counter();
+   retro_time_t first_usec      = cpu_features_get_time_usec();
+   retro_perf_tick_t last_tick;
+   retro_time_t last_usec;
+
+   retro_sleep(10);
+
+   last_tick = cpu_features_get_perf_counter();
+   last_usec = cpu_features_get_time_usec();
+
+   if (last_usec <= first_usec || last_tick <= first_tick)
+      return 1.0;
+   return (double)(last_tick - first_tick) / (last_usec - first_usec);
+}
+
+bool benchmark_report(void)
+{
+   unsigned i;
+   FILE *file                   = NULL;
+   retro_perf_tick_t *sorted    = NULL;
+   retro_perf_tick_t sum        = 0;
+   double ticks_per_usec        = 1.0;
+   double wall_usec             = 0.0;
+   long peak_rss_kb             = -1;
+   bool netplay                 = false;
+   unsigned count               = benchmark_st.count;
+   settings_t *settings         = config_get_ptr();
+   rarch_system_info_t *system  = runloop_get_system_info();
+#ifdef HAVE_BENCHMARK_RUSAGE
+   struct rusage usage;
+#endif
+
+   if (!benchmark_st.enabled)
+      return false;
+
+   if (count == 0)
+   {
+      RARCH_ERR("[Benchmark]: No frames were run.\n");
+      return false;
+   }
+
+   sorted = (retro_perf_tick_t*)malloc(count * sizeof(*sorted));
+   if (!sorted)
+      return false;
+
+   memcpy(sorted, benchmark_st.frame_ticks, count * sizeof(*sorted));
+   qsort(sorted, count, sizeof(*sorted), benchmark_tick_cmp);
+
+   for (i = 0; i < count; i++)
+      sum += sorted[i];
+
+   /* Perf counter ticks are not a fixed unit across platforms,
+    * so calibrate them against the wall clock of the whole run. */
+   wall_usec = (double)(benchmark_st.last_usec - benchmark_st.first_usec);
+   if (wall_usec > 0.0 && benchmark_st.last_tick > benchmark_st.first_tick)
+      ticks_per_usec = (double)(benchmark_st.last_tick
+            - benchmark_st.first_tick) / wall_usec;
+   else
+   {
+      /* The run was too short for the wall clock to tell */
+      ticks_per_usec = benchmark_calibrate();
+      wall_usec      = sum / ticks_per_usec;
+   }
+
+#ifdef HAVE_BENCHMARK_RUSAGE
+   if (getrusage(RUSAGE_SELF, &usage) == 0)
+   {
+#ifdef __APPLE__
+      peak_rss_kb = (long)(usage.ru_maxrss / 1024);
+#else
+      peak_rss_kb = (long)usage.ru_maxrss;
+#endif
+   }
+#endif
+
+#ifdef HAVE_NETWORKING
+   netplay = netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_DATA_INITED, NULL);
+#endif
+
+   if (!string_is_empty(benchmark_st.report_path))
+   {
+      file = fopen(benchmark_st.report_path, "w");
+      if (!file)
+      {
+         RARCH_ERR("[Benchmark]: Could not open \"%s\" for writing.\n",
+               benchmark_st.report_path);
+         free(sorted);
+         return false;
+      }
+   }
+   else
+      file = stdout;
+
+   fprintf(file, "{\n  \"core\": ");
+   benchmark_write_string(file, system ? system->info.library_name : NULL);
+   fprintf(file, ",\n  \"core_version\": ");
+   benchmark_write_string(file, system ? system->info.library_version : NULL);
+   fprintf(file, ",\n  \"content\": ");
+   benchmark_write_string(file, path_get(RARCH_PATH_CONTENT));
+   fprintf(file, ",\n  \"frames\": %u,\n", count);
+   fprintf(file, "  \"wall_time_ms\": %.3f,\n", wall_usec / 1000.0);
+   fprintf(file, "  \"fps\": %.2f,\n",
+         wall_usec > 0.0 ? count * 1000000.0 / wall_usec : 0.0);
+   fprintf(file, "  \"frame_time_us\": { \"min\": %.3f, \"mean\": %.3f, "
+         "\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+         sorted[0] / ticks_per_usec,
+         (double)sum / count / ticks_per_usec,
+         benchmark_percentile(sorted, count, 50) / ticks_per_usec,
+         benchmark_percentile(sorted, count, 90) / ticks_per_usec,
+         benchmark_percentile(sorted, count, 99) / ticks_per_usec,
+         sorted[count - 1] / ticks_per_usec);
+
+   if (peak_rss_kb >= 0)
+      fprintf(file, "  \"peak_rss_kb\": %ld,\n", peak_rss_kb);
+   else
+      fprintf(file, "  \"peak_rss_kb\": null,\n");
+
+   fprintf(file, "  \"features\": { \"rewind\": %s, \"netplay\": %s, "
+         "\"recording\": %s, \"video_filter\": %s, \"audio_filter\": %s, "
+         "\"run_ahead\": %s },\n",
+         state_manager_is_active()         ? "true" : "false",
+         netplay                           ? "true" : "false",
+         recording_data                    ? "true" : "false",
+         video_driver_frame_filter_alive() ? "true" : "false",
+         audio_driver_dsp_filter_alive()   ? "true" : "false",
+         settings && settings->bools.run_ahead_enabled ? "true" : "false");
+
+   fprintf(file, "  \"perf_counters\": {\n    \"frontend\": ");
+   benchmark_write_counters(file, retro_get_perf_counter_rarch(),
+         retro_get_perf_count_rarch(), ticks_per_usec);
+   fprintf(file, ",\n    \"core\": ");
+   benchmark_write_counters(file, retro_get_perf_counter_libretro(),
+         retro_get_perf_count_libretro(), ticks_per_usec);
+   fprintf(file, "\n  }");
+
+   if (benchmark_st.suites)
+   {
+      bool first = true;
+
+      fprintf(file, ",\n  \"suites\": {");
+
+      for (i = 0; i < ARRAY_SIZE(benchmark_suites); i++)
+      {
+         const char *result = benchmark_st.suite_results[i];
+
+         if (!(benchmark_st.suites & (1 << i)))
+            continue;
+
+         fprintf(file, "%s\n    \"%s\": %s", first ? "" : ",",
+               benchmark_suites[i].ident,
+               string_is_empty(result) ? "null" : result);
+         first = false;
+      }
+
+      fprintf(file, "\n  }");
+   }
+
+   fprintf(file, "\n}\n");
+
+   if (file != stdout)
+      fclose(file);
+   else
+      fflush(file);
+
+   free(sorted);
+   return true;
+}
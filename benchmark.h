@@ -0,0 +1,86 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_BENCHMARK_H
+#define __RARCH_BENCHMARK_H
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * benchmark_init:
+ * @frames               : Number of frames to run before exiting.
+ * @report_path          : File the JSON report is written to,
+ *                         or NULL/empty for stdout.
+ * @suites               : Comma separated frontend subsystems
+ *                         ("input", "core_info", "menu") to
+ *                         also time once the frames have run, or
+ *                         NULL/empty for none.
+ *
+ * Enables headless benchmark mode. Must be called before
+ * the configuration is loaded.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool benchmark_init(unsigned frames, const char *report_path,
+      const char *suites);
+
+void benchmark_deinit(void);
+
+bool benchmark_is_enabled(void);
+
+/**
+ * benchmark_override_settings:
+ *
+ * Forces the null video, audio and input drivers, disables
+ * every form of throttling and enables performance counters.
+ * Called right after the configuration has been loaded.
+ **/
+void benchmark_override_settings(void);
+
+/**
+ * benchmark_frame_begin:
+ *
+ * Returns: start tick of the current runloop iteration,
+ * or 0 if benchmark mode is not enabled.
+ **/
+retro_perf_tick_t benchmark_frame_begin(void);
+
+/**
+ * benchmark_frame_end:
+ * @start                : Value returned by benchmark_frame_begin().
+ *
+ * Records the duration of a runloop iteration which ran the core.
+ **/
+void benchmark_frame_end(retro_perf_tick_t start);
+
+/**
+ * benchmark_report:
+ *
+ * Writes frame-time percentiles, performance counters,
+ * peak memory usage and the active features as JSON,
+ * followed by the results of the requested suites.
+ * Must be called before the core is unloaded.
+ *
+ * Returns: true (1) if the report was written, otherwise false (0).
+ **/
+bool benchmark_report(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -34,6 +34,7 @@
 #include "cheevos.h"
 
 #include "../command.h"
+#include "../content.h"
 #include "../dynamic.h"
 #include "../configuration.h"
 #include "../performance_counters.h"
@@ -319,6 +320,10 @@ typedef struct
    char token[32];
 
    retro_ctx_memory_info_t meminfo[4];
+
+   MD5_CTX content_md5;        /* Unfinalized MD5 of the whole content */
+   size_t content_size;
+   bool content_md5_valid;
 } cheevos_locals_t;
 
 static cheevos_locals_t cheevos_locals =
@@ -335,7 +340,10 @@ static cheevos_locals_t cheevos_locals =
    /* meminfo[1]          */ {NULL, 0, 0},
    /* meminfo[2]          */ {NULL, 0, 0},
    /* meminfo[3]          */ {NULL, 0, 0}
-   }
+   },
+   /* content_md5         */ {0},
+   /* content_size        */ 0,
+   /* content_md5_valid   */ false
 };
 
 bool cheevos_loaded      = false;
@@ -2707,12 +2715,54 @@ static INLINE unsigned cheevos_next_power_of_2(unsigned n)
    return n + 1;
 }
 
+/* The SNES, Genesis and generic finders all start from the MD5 of the
+ * whole content. It's taken from the hashes computed while the content
+ * was loaded if possible, else hashed here once for all of them. */
+static size_t cheevos_eval_content_md5(
+      const struct retro_game_info *info,
+      MD5_CTX *ctx)
+{
+   if (!cheevos_locals.content_md5_valid)
+   {
+      rhash_multi_t hash;
+      const rhash_multi_t *loaded = NULL;
+
+      if (     info->data
+            && content_get_hash(&loaded)
+            && (loaded->types & RHASH_MD5)
+            && loaded->size == info->size)
+         hash = *loaded;
+      else
+      {
+         rhash_multi_init(&hash, RHASH_MD5);
+
+         if (info->data)
+            rhash_multi_update(&hash, info->data, info->size);
+         else if (!rhash_multi_file(&hash, info->path))
+         {
+            MD5_Init(ctx);
+            return 0;
+         }
+      }
+
+      cheevos_locals.content_md5       = hash.md5;
+      cheevos_locals.content_size      = (size_t)hash.size;
+      cheevos_locals.content_md5_valid = true;
+   }
+
+   *ctx = cheevos_locals.content_md5;
+   return cheevos_locals.content_size;
+}
+
 static size_t cheevos_eval_md5(
       const struct retro_game_info *info,
       size_t offset,
       size_t max_size,
       MD5_CTX *ctx)
 {
+   if (offset == 0 && max_size == 0)
+      return cheevos_eval_content_md5(info, ctx);
+
    MD5_Init(ctx);
 
    if (info->data)
@@ -2980,7 +3030,8 @@ bool cheevos_load(const void *data)
 
    url[0]                = '\0';
 
-   cheevos_loaded        = 0;
+   cheevos_loaded                   = 0;
+   cheevos_locals.content_md5_valid = false;
 
    /* Just return OK if the core doesn't support cheevos, or info is NULL. */
    if (!cheevos_locals.core_supports || !info)
@@ -80,6 +80,7 @@
 #include "msg_hash.h"
 #include "retroarch.h"
 #include "managers/cheat_manager.h"
+#include "managers/cheat_search.h"
 #include "managers/state_manager.h"
 #include "ui/ui_companion_driver.h"
 #include "tasks/tasks_internal.h"
@@ -126,7 +127,7 @@ static struct sockaddr_storage lastcmd_net_source;
 static socklen_t lastcmd_net_source_len;
 #endif
 
-#ifdef HAVE_CHEEVOS
+#ifdef HAVE_COMMAND
 #if defined(HAVE_STDIN_CMD) || defined(HAVE_NETWORK_CMD) && defined(HAVE_NETWORKING)
 static bool command_reply(const char * data, size_t len)
 {
@@ -260,8 +261,125 @@ static bool command_write_ram(const char *arg)
 }
 #endif
 
+static bool command_movie_seek(const char *arg)
+{
+   uint64_t frame = strtoul(arg, NULL, 10);
+   return bsv_movie_ctl(BSV_MOVIE_CTL_SEEK, &frame);
+}
+
+static enum cheat_search_endian command_cheat_endian(const char *arg)
+{
+   while (*arg == ' ')
+      arg++;
+
+   if (strncmp(arg, "BE", 2) == 0)
+      return CHEAT_SEARCH_ENDIAN_BIG;
+   if (strncmp(arg, "LE", 2) == 0)
+      return CHEAT_SEARCH_ENDIAN_LITTLE;
+   return CHEAT_SEARCH_ENDIAN_AUTO;
+}
+
+static bool command_cheat_search_start(const char *arg)
+{
+   char reply[64];
+   unsigned bits = strtoul(arg, (char**)&arg, 10);
+
+   if (cheat_search_start(bits ? bits / 8 : 1, command_cheat_endian(arg)))
+      snprintf(reply, sizeof(reply), "CHEAT_SEARCH_START %u\n",
+            (unsigned)cheat_search_count());
+   else
+      strlcpy(reply, "CHEAT_SEARCH_START -1\n", sizeof(reply));
+
+   command_reply(reply, strlen(reply));
+   return true;
+}
+
+static bool command_cheat_search(const char *arg)
+{
+   static const char *ops[] = { "EQ", "NE", "LT", "GT", "LE", "GE" };
+   char reply[64];
+   unsigned op;
+   char *end      = NULL;
+   uint32_t value = 0;
+
+   while (*arg == ' ')
+      arg++;
+
+   for (op = 0; op < ARRAY_SIZE(ops); op++)
+      if (strncmp(arg, ops[op], 2) == 0)
+         break;
+
+   if (op == ARRAY_SIZE(ops))
+      return false;
+
+   /* Without a value, compare with the previous pass */
+   value = strtoul(arg + 2, &end, 0);
+
+   if (cheat_search_filter((enum cheat_search_op)op, end == arg + 2, value))
+      snprintf(reply, sizeof(reply), "CHEAT_SEARCH %u\n",
+            (unsigned)cheat_search_count());
+   else
+      strlcpy(reply, "CHEAT_SEARCH -1\n", sizeof(reply));
+
+   command_reply(reply, strlen(reply));
+   return true;
+}
+
+static bool command_cheat_search_list(const char *arg)
+{
+   size_t addresses[32];
+   uint32_t values[32];
+   char reply[1024];
+   size_t i, count;
+   size_t len   = 0;
+   unsigned max = strtoul(arg, NULL, 10);
+
+   if (!max || max > ARRAY_SIZE(addresses))
+      max = ARRAY_SIZE(addresses);
+
+   count = cheat_search_results(addresses, values, max);
+   len   = snprintf(reply, sizeof(reply), "CHEAT_SEARCH_LIST %u",
+         (unsigned)cheat_search_count());
+
+   for (i = 0; i < count; i++)
+      len += snprintf(reply + len, sizeof(reply) - len, " %X=%u",
+            (unsigned)addresses[i], (unsigned)values[i]);
+
+   strlcpy(reply + len, "\n", sizeof(reply) - len);
+   command_reply(reply, strlen(reply));
+   return true;
+}
+
+static bool command_cheat_patch_add(const char *arg)
+{
+   size_t address = strtoul(arg, (char**)&arg, 16);
+   uint32_t value = strtoul(arg, (char**)&arg, 0);
+   unsigned bits  = strtoul(arg, (char**)&arg, 10);
+
+   return cheat_search_patch_add(address, value, bits / 8,
+         command_cheat_endian(arg));
+}
+
+static bool command_cheat_patch_remove(const char *arg)
+{
+   return cheat_search_patch_remove(strtoul(arg, NULL, 16));
+}
+
+static bool command_cheat_patch_clear(const char *arg)
+{
+   cheat_search_patch_clear();
+   return true;
+}
+
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER", command_set_shader, "<shader path>" },
+   { "MOVIE_SEEK", command_movie_seek, "<frame>" },
+   { "CHEAT_SEARCH_START", command_cheat_search_start, "<8|16|32> [LE|BE]" },
+   { "CHEAT_SEARCH", command_cheat_search, "<EQ|NE|LT|GT|LE|GE> [value]" },
+   { "CHEAT_SEARCH_LIST", command_cheat_search_list, "[max results]" },
+   { "CHEAT_PATCH_ADD", command_cheat_patch_add, "<address> <value> [8|16|32] [LE|BE]" },
+   { "CHEAT_PATCH_REMOVE", command_cheat_patch_remove, "<address>" },
+   { "CHEAT_PATCH_CLEAR", command_cheat_patch_clear, "" },
 #ifdef HAVE_CHEEVOS
    { "READ_CORE_RAM", command_read_ram, "<address> <number of bytes>" },
    { "WRITE_CORE_RAM", command_write_ram, "<address> <byte1> <byte2> ..." },
@@ -336,11 +454,15 @@ static bool command_get_arg(const char *tok,
       if (str == tok)
       {
          const char *argument = str + strlen(action_map[i].str);
-         if (*argument != ' ')
-            return false;
+
+         /* Another action this one is a prefix of */
+         if (*argument == ' ')
+            argument++;
+         else if (*argument != '\0')
+            continue;
 
          if (arg)
-            *arg = argument + 1;
+            *arg = argument;
 
          if (index)
             *index = i;
@@ -1194,6 +1316,8 @@ static void command_event_deinit_core(bool reinit)
    cheevos_unload();
 #endif
 
+   cheat_search_free();
+
    core_unload_game();
    core_unload();
    core_uninit_symbols();
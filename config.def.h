@@ -491,6 +491,11 @@ static const bool load_dummy_on_core_shutdown = false;
 static const bool load_dummy_on_core_shutdown = true;
 #endif
 static const bool check_firmware_before_loading = false;
+
+/* Keep the parsed core info of every installed core in a binary
+ * cache in the core info directory, and load it from there while
+ * no core or .info file has changed. */
+static const bool core_info_cache_enable = true;
 /* Forcibly disable composition.
  * Only valid on Windows Vista/7/8 for now. */
 static const bool disable_composition = false;
@@ -516,6 +521,12 @@ static const unsigned hard_sync_frames = 0;
  */
 static const unsigned frame_delay = 0;
 
+/* Picks the frame delay automatically from the measured time the core
+ * takes to run a frame, backing off when a VSync deadline is missed.
+ * A non-zero frame_delay is then used as the upper limit.
+ */
+static const bool frame_delay_auto = false;
+
 /* Inserts a black frame inbetween frames.
  * Useful for 120 Hz monitors who want to play 60 Hz material with eliminated
  * ghosting. video_refresh_rate should still be configured as if it
@@ -808,6 +819,24 @@ static const unsigned rewind_buffer_size = 20 << 20; /* 20MiB */
 /* How many frames to rewind at a time. */
 static const unsigned rewind_granularity = 1;
 
+/* Frames between savestate keyframes embedded in recorded movies.
+ * Seeking replays at most this many frames. 0 records the legacy
+ * BSV1 format, which cannot seek. */
+static const unsigned movie_keyframe_interval = 600;
+
+/* Run-ahead hides input lag built into a game by running
+ * run_ahead_frames frames ahead of the one that is presented,
+ * loading a savestate every frame. Only works with cores that
+ * support savestates. */
+static const bool run_ahead_enabled = false;
+
+static const unsigned run_ahead_frames = 1;
+
+/* Runs the frames ahead on a second instance of the core, so the
+ * main instance never has its state reloaded. Needs the content
+ * to be reloaded after being enabled. */
+static const bool run_ahead_secondary_instance = false;
+
 /* Pause gameplay when gameplay loses focus. */
 #ifdef EMSCRIPTEN
 static const bool pause_nonactive = false;
@@ -819,6 +848,14 @@ static const bool pause_nonactive = true;
  * It is measured in seconds. A value of 0 disables autosave. */
 static const unsigned autosave_interval = 0;
 
+/* Autosave writes SRAM to a temporary file and renames it over the
+ * old one, so a crash never leaves a torn save. When disabled, only
+ * the changed blocks are patched into the existing file. */
+static const bool autosave_atomic_write = true;
+
+/* Wait for autosaved SRAM to reach the disk before continuing. */
+static const bool autosave_fsync = true;
+
 /* Publicly announce netplay */
 static const bool netplay_public_announce = true;
 
@@ -846,6 +883,11 @@ static const int netplay_check_frames = 30;
 
 static const bool netplay_use_mitm_server = false;
 
+/* As a host, send to spectators from a relay thread, which
+ * builds a single stream for all of them and buffers the
+ * ones that fall behind. */
+static const bool netplay_spectator_relay = false;
+
 /* On save state load, block SRAM from being overwritten.
  * This could potentially lead to buggy games. */
 static const bool block_sram_overwrite = false;
@@ -865,6 +907,10 @@ static const bool savestate_auto_load = false;
 
 static const bool savestate_thumbnail_enable = false;
 
+/* Write savestates as chunked LZ4 streams. Raw savestates can
+ * still be loaded either way. */
+static const bool savestate_file_compression = false;
+
 /* Slowmotion ratio. */
 static const float slowmotion_ratio = 3.0;
 
@@ -918,6 +964,15 @@ static const unsigned turbo_duty_cycle = 3;
  * gamepads, plug-and-play style. */
 static const bool input_autodetect_enable = true;
 
+/* Read udev input events on their own thread, which keeps every
+ * event and its kernel timestamp until the next poll. */
+static const bool input_udev_thread = false;
+
+/* Collect input-to-core and input-to-present latency histograms
+ * from input event timestamps, logged when the input driver is
+ * deinitialized. */
+static const bool input_latency_stats = false;
+
 /* Show the input descriptors set by the core instead
  * of the default ones. */
 static const bool input_descriptor_label_show = true;
@@ -932,6 +987,10 @@ static const unsigned input_bind_timeout = 5;
 
 static const unsigned menu_thumbnails_default = 3;
 
+/* Size limit of the downscaled thumbnail cache, in megabytes.
+ * 0 disables the cache. */
+static const unsigned menu_thumbnail_cache_size = 64;
+
 #ifdef IOS
 static const bool ui_companion_start_on_boot = false;
 #else
@@ -51,6 +51,7 @@ typedef struct settings
       bool video_windowed_fullscreen;
       bool video_vsync;
       bool video_hard_sync;
+      bool video_frame_delay_auto;
       bool video_black_frame_insertion;
 #ifdef GEKKO
       bool video_vfilter;
@@ -86,6 +87,8 @@ typedef struct settings
       bool input_swap_override;
       bool input_remap_binds_enable;
       bool input_autodetect_enable;
+      bool input_udev_thread;
+      bool input_latency_stats;
       bool input_overlay_enable;
       bool input_overlay_enable_autopreferred;
       bool input_overlay_hide_in_menu;
@@ -140,6 +143,7 @@ typedef struct settings
       bool netplay_swap_input;
       bool netplay_nat_traversal;
       bool netplay_use_mitm_server;
+      bool netplay_spectator_relay;
 #endif
 
       /* Network */
@@ -184,18 +188,24 @@ typedef struct settings
       bool history_list_enable;
       bool playlist_entry_remove;
       bool rewind_enable;
+      bool run_ahead_enabled;
+      bool run_ahead_secondary_instance;
       bool pause_nonactive;
       bool block_sram_overwrite;
+      bool autosave_atomic_write;
+      bool autosave_fsync;
       bool savestate_auto_index;
       bool savestate_auto_save;
       bool savestate_auto_load;
       bool savestate_thumbnail_enable;
+      bool savestate_file_compression;
       bool network_cmd_enable;
       bool stdin_cmd_enable;
       bool network_remote_enable;
       bool network_remote_enable_user[MAX_USERS];
       bool load_dummy_on_core_shutdown;
       bool check_firmware_before_loading;
+      bool core_info_cache_enable;
 
       bool game_specific_options;
       bool auto_overrides_enable;
@@ -290,6 +300,7 @@ typedef struct settings
       char driver[32];
 
       unsigned thumbnails;
+      unsigned thumbnail_cache_size;
 
       struct
       {
@@ -465,6 +476,8 @@ typedef struct settings
    unsigned content_history_size;
    unsigned libretro_log_level;
    unsigned rewind_granularity;
+   unsigned movie_keyframe_interval;
+   unsigned run_ahead_frames;
    unsigned autosave_interval;
    unsigned network_cmd_port;
    unsigned network_remote_base_port;
@@ -25,6 +25,7 @@
 
 #include <boolean.h>
 #include <retro_common_api.h>
+#include <rhash.h>
 
 #include "frontend/frontend_driver.h"
 
@@ -68,6 +69,10 @@ void content_unset_does_not_need_content(void);
 
 bool content_get_crc(uint32_t **content_crc_ptr);
 
+/* Hash state of the first content file, if it was loaded into memory.
+ * Read its digests with rhash_multi_final(). */
+bool content_get_hash(const rhash_multi_t **content_hash_ptr);
+
 void content_deinit(void);
 
 /* Initializes and loads a content file for the currently
@@ -166,6 +166,8 @@ bool core_set_default_callbacks(void *data);
 
 bool core_set_rewind_callbacks(void);
 
+bool core_set_hidden_frame_callbacks(bool hide_video, bool hide_audio);
+
 #ifdef HAVE_NETWORKING
 bool core_set_netplay_callbacks(void);
 
@@ -177,6 +179,10 @@ bool core_set_poll_type(unsigned *type);
 /* Runs the core for one frame. */
 bool core_run(void);
 
+bool core_run_ahead(unsigned frames, bool use_instance);
+
+void core_run_ahead_deinit(void);
+
 bool core_init(void);
 
 bool core_deinit(void *data);
@@ -23,7 +23,10 @@
 #include <errno.h>
 
 #include <boolean.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
 #include <lists/string_list.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 #include <libretro.h>
 
@@ -36,9 +39,13 @@
 #endif
 
 #include "core.h"
+#include "configuration.h"
 #include "content.h"
 #include "dynamic.h"
 #include "msg_hash.h"
+#include "paths.h"
+#include "performance_counters.h"
+#include "runloop.h"
 #include "managers/state_manager.h"
 #include "verbosity.h"
 #include "gfx/video_driver.h"
@@ -55,6 +62,23 @@ static uint64_t            core_serialization_quirks_v    = 0;
 static struct              retro_callbacks retro_ctx;
 static struct              retro_core_t core;
 
+/* Run-ahead: state of the real frame while hidden frames run,
+ * and an optional second instance that runs them instead. */
+static uint8_t            *core_runahead_state            = NULL;
+static size_t              core_runahead_state_size       = 0;
+static bool                core_runahead_unsupported      = false;
+static bool                core_runahead_instance_failed  = false;
+static bool                core_game_info_valid           = false;
+static bool                core_game_info_contentless     = false;
+static struct              retro_game_info core_game_info;
+static unsigned            core_port_devices[MAX_USERS];
+static uint32_t            core_port_devices_set          = 0;
+#ifdef HAVE_DYNAMIC
+static struct              retro_core_t core_runahead;
+static dylib_t             core_runahead_lib              = NULL;
+static char                core_runahead_lib_path[PATH_MAX_LENGTH];
+#endif
+
 static void core_input_state_poll_maybe(void)
 {
    if (core_poll_type == POLL_TYPE_NORMAL)
@@ -178,6 +202,42 @@ bool core_set_rewind_callbacks(void)
    return true;
 }
 
+static void core_video_refresh_hidden(const void *data, unsigned width,
+      unsigned height, size_t pitch)
+{
+}
+
+static void core_audio_sample_silent(int16_t left, int16_t right)
+{
+}
+
+static size_t core_audio_sample_batch_silent(const int16_t *data,
+      size_t frames)
+{
+   return frames;
+}
+
+/**
+ * core_set_hidden_frame_callbacks:
+ * @hide_video        : discard the video frames of the core.
+ * @hide_audio        : discard the audio of the core.
+ *
+ * Used for frames that are run without being presented.
+ * Passing false for both restores the regular callbacks.
+ **/
+bool core_set_hidden_frame_callbacks(bool hide_video, bool hide_audio)
+{
+   core.retro_set_video_refresh(hide_video
+         ? core_video_refresh_hidden : video_driver_frame);
+
+   if (!hide_audio)
+      return core_set_rewind_callbacks();
+
+   core.retro_set_audio_sample(core_audio_sample_silent);
+   core.retro_set_audio_sample_batch(core_audio_sample_batch_silent);
+   return true;
+}
+
 #ifdef HAVE_NETWORKING
 /**
  * core_set_netplay_callbacks:
@@ -267,6 +327,11 @@ bool core_set_controller_port_device(retro_ctx_controller_info_t *pad)
    if (!pad)
       return false;
    core.retro_set_controller_port_device(pad->port, pad->device);
+   if (pad->port < MAX_USERS)
+   {
+      core_port_devices[pad->port] = pad->device;
+      core_port_devices_set       |= 1 << pad->port;
+   }
    return true;
 }
 
@@ -279,6 +344,35 @@ bool core_get_memory(retro_ctx_memory_info_t *info)
    return true;
 }
 
+static void core_free_game_info(void)
+{
+   free((void*)core_game_info.path);
+   free((void*)core_game_info.data);
+   memset(&core_game_info, 0, sizeof(core_game_info));
+   core_game_info_valid       = false;
+   core_game_info_contentless = false;
+}
+
+static bool core_copy_game_info(const struct retro_game_info *info)
+{
+   if (info->path)
+      core_game_info.path = strdup(info->path);
+
+   if (info->data && info->size)
+   {
+      void *data = malloc(info->size);
+
+      if (!data)
+         return false;
+
+      memcpy(data, info->data, info->size);
+      core_game_info.data = data;
+      core_game_info.size = info->size;
+   }
+
+   return true;
+}
+
 bool core_load_game(retro_ctx_load_content_info_t *load_info)
 {
    bool contentless = false;
@@ -296,6 +390,21 @@ bool core_load_game(retro_ctx_load_content_info_t *load_info)
    else
       core_game_loaded = false;
 
+   core_free_game_info();
+   core_runahead_unsupported     = false;
+   core_runahead_instance_failed = false;
+
+   /* Kept to load the same content into a run-ahead instance. */
+   if (core_game_loaded && !(load_info && load_info->special))
+   {
+      settings_t *settings = config_get_ptr();
+
+      if (!load_info || string_is_empty(load_info->content->elems[0].data))
+         core_game_info_valid = core_game_info_contentless = true;
+      else if (settings->bools.run_ahead_secondary_instance)
+         core_game_info_valid = core_copy_game_info(load_info->info);
+   }
+
    return core_game_loaded;
 }
 
@@ -401,6 +510,9 @@ bool core_unload(void)
 
 bool core_unload_game(void)
 {
+   core_run_ahead_deinit();
+   core_free_game_info();
+   core_port_devices_set = 0;
    video_driver_free_hw_context();
    audio_driver_stop();
    core.retro_unload_game();
@@ -411,7 +523,17 @@ bool core_unload_game(void)
 bool core_run(void)
 {
 #ifdef HAVE_NETWORKING
-   if (!netplay_driver_ctl(RARCH_NETPLAY_CTL_PRE_FRAME, NULL))
+   static struct retro_perf_counter netplay_pre_frame  = {0};
+   static struct retro_perf_counter netplay_post_frame = {0};
+   bool is_perfcnt_enable = runloop_ctl(RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL);
+   bool netplay_running;
+
+   performance_counter_init(netplay_pre_frame, "netplay_pre_frame");
+   performance_counter_start_plus(is_perfcnt_enable, netplay_pre_frame);
+   netplay_running = netplay_driver_ctl(RARCH_NETPLAY_CTL_PRE_FRAME, NULL);
+   performance_counter_stop_plus(is_perfcnt_enable, netplay_pre_frame);
+
+   if (!netplay_running)
    {
       /* Paused due to netplay. We must poll and display something so that a
        * netplay peer pausing doesn't just hang. */
@@ -439,12 +561,256 @@ bool core_run(void)
       input_poll();
 
 #ifdef HAVE_NETWORKING
+   performance_counter_init(netplay_post_frame, "netplay_post_frame");
+   performance_counter_start_plus(is_perfcnt_enable, netplay_post_frame);
    netplay_driver_ctl(RARCH_NETPLAY_CTL_POST_FRAME, NULL);
+   performance_counter_stop_plus(is_perfcnt_enable, netplay_post_frame);
 #endif
 
    return true;
 }
 
+#ifdef HAVE_DYNAMIC
+static void core_runahead_instance_free(void)
+{
+   if (!core_runahead_lib)
+      return;
+
+   core_runahead.retro_unload_game();
+   core_runahead.retro_deinit();
+   libretro_instance_free(core_runahead_lib, &core_runahead);
+   core_runahead_lib = NULL;
+
+   remove(core_runahead_lib_path);
+}
+
+/* Loads a copy of the running core library as a second instance
+ * with the same content, for run-ahead frames to run on. */
+static bool core_runahead_instance_init(void)
+{
+   unsigned i;
+   const char *ext                       = NULL;
+   void *buf                             = NULL;
+   ssize_t len                           = 0;
+   const char *core_path                 = path_get(RARCH_PATH_CORE);
+   settings_t *settings                  = config_get_ptr();
+   struct retro_hw_render_callback *hwr  = video_driver_get_hw_context();
+   char name[PATH_MAX_LENGTH];
+
+   if (!core_game_info_valid)
+   {
+      RARCH_WARN("Run-ahead instance needs the content to be reloaded.\n");
+      return false;
+   }
+
+   if (hwr && hwr->context_type != RETRO_HW_CONTEXT_NONE)
+   {
+      RARCH_WARN("Run-ahead instance is not supported for "
+            "hardware rendered cores.\n");
+      return false;
+   }
+
+   if (string_is_empty(core_path))
+      return false;
+
+   strlcpy(name, path_basename(core_path), sizeof(name));
+   path_remove_extension(name);
+   strlcat(name, "_runahead", sizeof(name));
+   if ((ext = path_get_extension(core_path)) && *ext)
+   {
+      strlcat(name, ".", sizeof(name));
+      strlcat(name, ext, sizeof(name));
+   }
+
+   if (!string_is_empty(settings->directory.cache))
+      fill_pathname_join(core_runahead_lib_path, settings->directory.cache,
+            name, sizeof(core_runahead_lib_path));
+   else
+      fill_pathname_resolve_relative(core_runahead_lib_path, core_path,
+            name, sizeof(core_runahead_lib_path));
+
+   if (!filestream_read_file(core_path, &buf, &len)
+         || !filestream_write_file(core_runahead_lib_path, buf, len))
+   {
+      free(buf);
+      RARCH_ERR("Could not copy core to \"%s\".\n", core_runahead_lib_path);
+      return false;
+   }
+   free(buf);
+
+   if (!(core_runahead_lib = libretro_instance_load(core_runahead_lib_path,
+               &core_runahead)))
+   {
+      remove(core_runahead_lib_path);
+      return false;
+   }
+
+   core_runahead.retro_init();
+   core_runahead.retro_set_video_refresh(core_video_refresh_hidden);
+   core_runahead.retro_set_audio_sample(core_audio_sample_silent);
+   core_runahead.retro_set_audio_sample_batch(core_audio_sample_batch_silent);
+   core_runahead.retro_set_input_state(core_input_state_poll);
+   core_runahead.retro_set_input_poll(core_input_state_poll_maybe);
+
+   if (!core_runahead.retro_load_game(
+            core_game_info_contentless ? NULL : &core_game_info))
+   {
+      core_runahead.retro_deinit();
+      libretro_instance_free(core_runahead_lib, &core_runahead);
+      core_runahead_lib = NULL;
+      remove(core_runahead_lib_path);
+      RARCH_ERR("Run-ahead instance failed to load the content.\n");
+      return false;
+   }
+
+   for (i = 0; i < MAX_USERS; i++)
+      if (core_port_devices_set & (1 << i))
+         core_runahead.retro_set_controller_port_device(i,
+               core_port_devices[i]);
+
+   if (core_runahead.retro_serialize_size() != core.retro_serialize_size())
+   {
+      core_runahead_instance_free();
+      RARCH_ERR("Run-ahead instance has a different savestate size.\n");
+      return false;
+   }
+
+   RARCH_LOG("Running ahead on a second core instance.\n");
+   return true;
+}
+#endif
+
+/**
+ * core_run_ahead_deinit:
+ *
+ * Frees the run-ahead savestate buffer and second core instance.
+ **/
+void core_run_ahead_deinit(void)
+{
+#ifdef HAVE_DYNAMIC
+   core_runahead_instance_free();
+#endif
+   free(core_runahead_state);
+   core_runahead_state      = NULL;
+   core_runahead_state_size = 0;
+}
+
+/**
+ * core_run_ahead:
+ * @frames             : number of frames to run ahead.
+ * @use_instance       : run the hidden frames on a second instance
+ *                       of the core.
+ *
+ * Runs one real frame with its video hidden, then @frames more
+ * frames with the same input, presenting only the last one. The core
+ * is then returned to the state after the real frame, by loading it
+ * back, or with @use_instance by never leaving it: the state is
+ * copied to the second instance instead, which runs the hidden
+ * frames. Falls back to core_run() if the core can't serialize.
+ *
+ * Returns: true on success.
+ **/
+bool core_run_ahead(unsigned frames, bool use_instance)
+{
+   unsigned i;
+   static struct retro_perf_counter runahead_state = {0};
+   bool is_paused             = false;
+   bool is_idle               = false;
+   bool is_slowmotion         = false;
+   bool is_perfcnt_enable     = false;
+   size_t size                = core_runahead_unsupported
+      ? 0 : core.retro_serialize_size();
+
+   if (!size)
+   {
+      if (!core_runahead_unsupported)
+         RARCH_WARN("Core does not support savestates, "
+               "run-ahead is disabled.\n");
+      core_runahead_unsupported = true;
+      return core_run();
+   }
+
+   if (size != core_runahead_state_size)
+   {
+      uint8_t *state = (uint8_t*)realloc(core_runahead_state, size);
+
+      if (!state)
+         return core_run();
+
+      core_runahead_state      = state;
+      core_runahead_state_size = size;
+   }
+
+#ifdef HAVE_DYNAMIC
+   if (!use_instance)
+      core_runahead_instance_free();
+   else if (!core_runahead_lib && !core_runahead_instance_failed)
+      core_runahead_instance_failed = !core_runahead_instance_init();
+#endif
+
+   runloop_get_status(&is_paused, &is_idle, &is_slowmotion,
+         &is_perfcnt_enable);
+   performance_counter_init(runahead_state, "runahead_state");
+
+   core_set_hidden_frame_callbacks(true, false);
+   core_run();
+
+   performance_counter_start_plus(is_perfcnt_enable, runahead_state);
+
+   if (!core.retro_serialize(core_runahead_state, size))
+   {
+      performance_counter_stop_plus(is_perfcnt_enable, runahead_state);
+      RARCH_WARN("Savestate failed, run-ahead is disabled.\n");
+      core_runahead_unsupported = true;
+      core_set_hidden_frame_callbacks(false, false);
+      video_driver_cached_frame();
+      return true;
+   }
+
+#ifdef HAVE_DYNAMIC
+   if (core_runahead_lib)
+   {
+      bool ret = core_runahead.retro_unserialize(core_runahead_state, size);
+
+      performance_counter_stop_plus(is_perfcnt_enable, runahead_state);
+
+      if (ret)
+      {
+         for (i = 1; i <= frames; i++)
+         {
+            core_runahead.retro_set_video_refresh(i == frames
+                  ? video_driver_frame : core_video_refresh_hidden);
+            core_runahead.retro_run();
+         }
+
+         core_set_hidden_frame_callbacks(false, false);
+         return true;
+      }
+
+      RARCH_WARN("Run-ahead instance could not load the savestate, "
+            "running ahead on the main instance.\n");
+      core_runahead_instance_free();
+      core_runahead_instance_failed = true;
+      performance_counter_start_plus(is_perfcnt_enable, runahead_state);
+   }
+#endif
+
+   performance_counter_stop_plus(is_perfcnt_enable, runahead_state);
+
+   for (i = 1; i <= frames; i++)
+   {
+      core_set_hidden_frame_callbacks(i < frames, true);
+      core_run();
+   }
+
+   performance_counter_start_plus(is_perfcnt_enable, runahead_state);
+   core.retro_unserialize(core_runahead_state, size);
+   performance_counter_stop_plus(is_perfcnt_enable, runahead_state);
+
+   core_set_hidden_frame_callbacks(false, false);
+   return true;
+}
+
 bool core_load(unsigned poll_type_behavior)
 {
    core_poll_type = poll_type_behavior;
@@ -15,13 +15,17 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
+
 #include <compat/strl.h>
+#include <encodings/crc32.h>
 #include <string/stdstring.h>
 #include <file/file_path.h>
 #include <lists/dir_list.h>
 #include <file/archive_file.h>
 
 #include <retro_stat.h>
+#include <streams/file_stream.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -36,6 +40,50 @@
 #include "file_path_special.h"
 #include "list_special.h"
 
+#define CORE_INFO_CACHE_MAGIC             0x43494352 /* "RCIC" */
+#define CORE_INFO_CACHE_VERSION           1
+#define CORE_INFO_CACHE_FILE              "core_info.cache"
+
+#define CORE_INFO_CACHE_HAS_INFO          (1 << 0)
+#define CORE_INFO_CACHE_SUPPORTS_NO_GAME  (1 << 1)
+
+/* The cache is this header followed by a stream of fields of
+ * @size bytes with a CRC32 of @crc. Integers are in native byte
+ * order, strings are a uint32_t length that includes the
+ * terminator (0 for NULL) followed by the string. */
+struct core_info_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t count;
+   uint32_t size;
+   uint32_t crc;
+};
+
+/* Modification time and size of a core's .info file,
+ * both -1 if it has none. */
+typedef struct
+{
+   int64_t mtime;
+   int64_t size;
+} core_info_stamp_t;
+
+typedef struct
+{
+   uint8_t *data;
+   size_t len;
+   size_t cap;
+   bool failed;
+} core_info_cache_writer_t;
+
+typedef struct
+{
+   const uint8_t *data;
+   size_t len;
+   size_t pos;
+   bool failed;
+} core_info_cache_reader_t;
+
 static const char *core_info_tmp_path               = NULL;
 static const struct string_list *core_info_tmp_list = NULL;
 static core_info_t *core_info_current               = NULL;
@@ -85,64 +133,78 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
+static void core_info_resolve_firmware(core_info_t *info,
+      config_file_t *config)
 {
-   size_t i;
    unsigned c;
+   unsigned count                  = 0;
+   core_info_firmware_t *firmware  = NULL;
 
-   for (i = 0; i < core_info_list->count; i++)
-   {
-      unsigned count                  = 0;
-      core_info_firmware_t *firmware  = NULL;
-      core_info_t *info               = (core_info_t*)&core_info_list->list[i];
-      config_file_t *config           = (config_file_t*)info->config_data;
-
-      if (!config || !config_get_uint(config, "firmware_count", &count))
-         continue;
+   if (!config_get_uint(config, "firmware_count", &count) || !count)
+      return;
 
-      firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+   firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
 
-      if (!firmware)
-         continue;
+   if (!firmware)
+      return;
 
-      info->firmware = firmware;
+   info->firmware       = firmware;
+   info->firmware_count = count;
 
-      for (c = 0; c < count; c++)
+   for (c = 0; c < count; c++)
+   {
+      char path_key[64];
+      char desc_key[64];
+      char opt_key[64];
+      bool tmp_bool     = false;
+      char *tmp         = NULL;
+      path_key[0]       = desc_key[0] = opt_key[0] = '\0';
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
+      snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
+
+      if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
       {
-         char path_key[64];
-         char desc_key[64];
-         char opt_key[64];
-         bool tmp_bool     = false;
-         char *tmp         = NULL;
-         path_key[0]       = desc_key[0] = opt_key[0] = '\0';
-
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
-
-         if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].path = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].desc = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (tmp)
-            free(tmp);
+         info->firmware[c].path = strdup(tmp);
+         free(tmp);
+         tmp = NULL;
+      }
+      if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
+      {
+         info->firmware[c].desc = strdup(tmp);
+         free(tmp);
          tmp = NULL;
-         if (config_get_bool(config, opt_key , &tmp_bool))
-            info->firmware[c].optional = tmp_bool;
       }
+      if (tmp)
+         free(tmp);
+      tmp = NULL;
+      if (config_get_bool(config, opt_key , &tmp_bool))
+         info->firmware[c].optional = tmp_bool;
    }
 }
 
-static void core_info_list_free(core_info_list_t *core_info_list)
+/* Splits the '|' separated fields of @info into their lists. */
+static void core_info_split_lists(core_info_t *info)
+{
+   if (info->supported_extensions)
+      info->supported_extensions_list =
+         string_split(info->supported_extensions, "|");
+   if (info->authors)
+      info->authors_list     = string_split(info->authors, "|");
+   if (info->permissions)
+      info->permissions_list = string_split(info->permissions, "|");
+   if (info->licenses)
+      info->licenses_list    = string_split(info->licenses, "|");
+   if (info->categories)
+      info->categories_list  = string_split(info->categories, "|");
+   if (info->databases)
+      info->databases_list   = string_split(info->databases, "|");
+   if (info->notes)
+      info->note_list        = string_split(info->notes, "|");
+}
+
+void core_info_list_free(core_info_list_t *core_info_list)
 {
    size_t i, j;
 
@@ -172,7 +234,6 @@ static void core_info_list_free(core_info_list_t *core_info_list)
       string_list_free(info->licenses_list);
       string_list_free(info->categories_list);
       string_list_free(info->databases_list);
-      config_file_free((config_file_t*)info->config_data);
 
       for (j = 0; j < info->firmware_count; j++)
       {
@@ -187,6 +248,14 @@ static void core_info_list_free(core_info_list_t *core_info_list)
    free(core_info_list);
 }
 
+static const char *core_info_dir(void)
+{
+   settings_t *settings = config_get_ptr();
+
+   return (!string_is_empty(settings->path.libretro_info)) ?
+         settings->path.libretro_info : settings->directory.libretro;
+}
+
 static bool core_info_list_iterate(
       char *s, size_t len,
       struct string_list *contents, size_t i)
@@ -195,7 +264,6 @@ static bool core_info_list_iterate(
 #if defined(RARCH_MOBILE) || (defined(RARCH_CONSOLE) && !defined(PSP) && !defined(_3DS) && !defined(VITA))
    char                       *substr   = NULL;
 #endif
-   settings_t                 *settings = config_get_ptr();
 
    if (!contents || !contents->elems[i].data)
       return false;
@@ -215,17 +283,358 @@ static bool core_info_list_iterate(
          file_path_str(FILE_PATH_CORE_INFO_EXTENSION),
          sizeof(info_path_base));
 
-   fill_pathname_join(s,
-         (!string_is_empty(settings->path.libretro_info)) ?
-         settings->path.libretro_info : settings->directory.libretro,
-         info_path_base, len);
+   fill_pathname_join(s, core_info_dir(), info_path_base, len);
 
    return true;
 }
 
-static core_info_list_t *core_info_list_new(const char *path)
+static void core_info_cache_put(core_info_cache_writer_t *w,
+      const void *data, size_t len)
+{
+   if (w->failed)
+      return;
+
+   if (w->len + len > w->cap)
+   {
+      uint8_t *resized = NULL;
+      size_t cap       = w->cap ? w->cap : 16384;
+
+      while (cap < w->len + len)
+         cap *= 2;
+
+      resized = (uint8_t*)realloc(w->data, cap);
+
+      if (!resized)
+      {
+         w->failed = true;
+         return;
+      }
+
+      w->data = resized;
+      w->cap  = cap;
+   }
+
+   memcpy(w->data + w->len, data, len);
+   w->len += len;
+}
+
+static void core_info_cache_put_u32(core_info_cache_writer_t *w,
+      uint32_t value)
+{
+   core_info_cache_put(w, &value, sizeof(value));
+}
+
+static void core_info_cache_put_i64(core_info_cache_writer_t *w,
+      int64_t value)
+{
+   core_info_cache_put(w, &value, sizeof(value));
+}
+
+static void core_info_cache_put_string(core_info_cache_writer_t *w,
+      const char *s)
+{
+   uint32_t len = s ? (uint32_t)strlen(s) + 1 : 0;
+
+   core_info_cache_put_u32(w, len);
+   if (len)
+      core_info_cache_put(w, s, len);
+}
+
+static const void *core_info_cache_get(core_info_cache_reader_t *r,
+      size_t len)
+{
+   const uint8_t *data = NULL;
+
+   if (r->failed || r->len - r->pos < len)
+   {
+      r->failed = true;
+      return NULL;
+   }
+
+   data    = r->data + r->pos;
+   r->pos += len;
+   return data;
+}
+
+static uint32_t core_info_cache_get_u32(core_info_cache_reader_t *r)
+{
+   uint32_t value   = 0;
+   const void *data = core_info_cache_get(r, sizeof(value));
+
+   if (data)
+      memcpy(&value, data, sizeof(value));
+   return value;
+}
+
+static int64_t core_info_cache_get_i64(core_info_cache_reader_t *r)
+{
+   int64_t value    = 0;
+   const void *data = core_info_cache_get(r, sizeof(value));
+
+   if (data)
+      memcpy(&value, data, sizeof(value));
+   return value;
+}
+
+/* Returns the next string of @r in place, or NULL. */
+static const char *core_info_cache_get_string(core_info_cache_reader_t *r)
+{
+   uint32_t len  = core_info_cache_get_u32(r);
+   const char *s = NULL;
+
+   if (!len)
+      return NULL;
+
+   s = (const char*)core_info_cache_get(r, len);
+
+   if (s && s[len - 1] != '\0')
+   {
+      r->failed = true;
+      return NULL;
+   }
+
+   return s;
+}
+
+static char *core_info_cache_dup_string(core_info_cache_reader_t *r)
+{
+   const char *s = core_info_cache_get_string(r);
+   return s ? strdup(s) : NULL;
+}
+
+/**
+ * core_info_cache_write:
+ * @path               : path of the cache file.
+ * @cores_dir          : directory @list was built from.
+ * @list               : freshly parsed core info list.
+ * @stamps             : .info file stamps, in @list order.
+ *
+ * Serializes @list into a temporary file next to @path and moves
+ * it into place.
+ **/
+static void core_info_cache_write(const char *path,
+      const char *cores_dir, const core_info_list_t *list,
+      const core_info_stamp_t *stamps)
+{
+   size_t i, j;
+   char tmp_path[PATH_MAX_LENGTH];
+   struct core_info_cache_header header;
+   core_info_cache_writer_t w = {0};
+   RFILE *file                = NULL;
+   bool ret                   = false;
+
+   core_info_cache_put_string(&w, cores_dir);
+   core_info_cache_put_string(&w, core_info_dir());
+
+   for (i = 0; i < list->count; i++)
+   {
+      const core_info_t *info = &list->list[i];
+
+      core_info_cache_put_string(&w, info->path);
+      core_info_cache_put_i64(&w, stamps[i].mtime);
+      core_info_cache_put_i64(&w, stamps[i].size);
+      core_info_cache_put_u32(&w,
+              (info->has_info         ? CORE_INFO_CACHE_HAS_INFO         : 0)
+            | (info->supports_no_game ? CORE_INFO_CACHE_SUPPORTS_NO_GAME : 0));
+      core_info_cache_put_string(&w, info->display_name);
+      core_info_cache_put_string(&w, info->core_name);
+      core_info_cache_put_string(&w, info->systemname);
+      core_info_cache_put_string(&w, info->system_manufacturer);
+      core_info_cache_put_string(&w, info->supported_extensions);
+      core_info_cache_put_string(&w, info->authors);
+      core_info_cache_put_string(&w, info->permissions);
+      core_info_cache_put_string(&w, info->licenses);
+      core_info_cache_put_string(&w, info->categories);
+      core_info_cache_put_string(&w, info->databases);
+      core_info_cache_put_string(&w, info->notes);
+      core_info_cache_put_u32(&w, (uint32_t)info->firmware_count);
+
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         core_info_cache_put_string(&w, info->firmware[j].path);
+         core_info_cache_put_string(&w, info->firmware[j].desc);
+         core_info_cache_put_u32(&w, info->firmware[j].optional);
+      }
+   }
+
+   if (w.failed)
+      goto end;
+
+   header.magic   = CORE_INFO_CACHE_MAGIC;
+   header.version = CORE_INFO_CACHE_VERSION;
+   header.count   = (uint32_t)list->count;
+   header.size    = (uint32_t)w.len;
+   header.crc     = encoding_crc32(0, w.data, w.len);
+
+   strlcpy(tmp_path, path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   file = filestream_open(tmp_path, RFILE_MODE_WRITE, -1);
+
+   if (!file)
+      goto end;
+
+   ret = filestream_write(file, &header, sizeof(header))
+         == (ssize_t)sizeof(header)
+      && filestream_write(file, w.data, w.len) == (ssize_t)w.len;
+
+   filestream_close(file);
+
+   if (ret)
+      ret = path_replace_file(tmp_path, path);
+
+   if (!ret)
+      remove(tmp_path);
+
+end:
+   if (!ret)
+      RARCH_LOG("[Core Info]: Could not write cache %s.\n", path);
+   free(w.data);
+}
+
+/**
+ * core_info_cache_read:
+ * @path               : path of the cache file.
+ * @cores_dir          : directory @contents was listed from.
+ * @contents           : cores currently in @cores_dir.
+ * @stamps             : current .info file stamps, in @contents order.
+ *
+ * Loads the core info list from the cache at @path with a single
+ * read. The cache is only used if it describes exactly the cores
+ * in @contents, from the same cores and info directories, with
+ * every .info file unchanged since it was written.
+ *
+ * Returns: core info list on a cache hit, otherwise NULL.
+ **/
+static core_info_list_t *core_info_cache_read(const char *path,
+      const char *cores_dir, const struct string_list *contents,
+      const core_info_stamp_t *stamps)
+{
+   size_t i, j;
+   struct core_info_cache_header header;
+   core_info_cache_reader_t r;
+   void *buf                        = NULL;
+   ssize_t len                      = 0;
+   core_info_list_t *core_info_list = NULL;
+
+   if (     !path_is_valid(path)
+         || !filestream_read_file(path, &buf, &len)
+         || len < (ssize_t)sizeof(header))
+      goto error;
+
+   memcpy(&header, buf, sizeof(header));
+
+   if (     header.magic   != CORE_INFO_CACHE_MAGIC
+         || header.version != CORE_INFO_CACHE_VERSION
+         || header.count   != contents->size
+         || header.size    != (size_t)len - sizeof(header))
+      goto error;
+
+   r.data   = (const uint8_t*)buf + sizeof(header);
+   r.len    = header.size;
+   r.pos    = 0;
+   r.failed = false;
+
+   if (encoding_crc32(0, r.data, r.len) != header.crc)
+      goto error;
+
+   if (     !string_is_equal(core_info_cache_get_string(&r), cores_dir)
+         || !string_is_equal(core_info_cache_get_string(&r), core_info_dir()))
+      goto error;
+
+   core_info_list = (core_info_list_t*)calloc(1, sizeof(*core_info_list));
+   if (!core_info_list)
+      goto error;
+
+   core_info_list->list  = (core_info_t*)
+      calloc(contents->size, sizeof(*core_info_list->list));
+   if (!core_info_list->list)
+      goto error;
+   core_info_list->count = contents->size;
+
+   for (i = 0; i < contents->size; i++)
+   {
+      uint32_t flags, count;
+      core_info_t *info = &core_info_list->list[i];
+
+      if (     !string_is_equal(core_info_cache_get_string(&r),
+                  contents->elems[i].data)
+            || core_info_cache_get_i64(&r) != stamps[i].mtime
+            || core_info_cache_get_i64(&r) != stamps[i].size)
+         goto error;
+
+      flags                      = core_info_cache_get_u32(&r);
+      info->has_info             = !!(flags & CORE_INFO_CACHE_HAS_INFO);
+      info->supports_no_game     = !!(flags & CORE_INFO_CACHE_SUPPORTS_NO_GAME);
+      info->path                 = strdup(contents->elems[i].data);
+      info->display_name         = core_info_cache_dup_string(&r);
+      info->core_name            = core_info_cache_dup_string(&r);
+      info->systemname           = core_info_cache_dup_string(&r);
+      info->system_manufacturer  = core_info_cache_dup_string(&r);
+      info->supported_extensions = core_info_cache_dup_string(&r);
+      info->authors              = core_info_cache_dup_string(&r);
+      info->permissions          = core_info_cache_dup_string(&r);
+      info->licenses             = core_info_cache_dup_string(&r);
+      info->categories           = core_info_cache_dup_string(&r);
+      info->databases            = core_info_cache_dup_string(&r);
+      info->notes                = core_info_cache_dup_string(&r);
+      count                      = core_info_cache_get_u32(&r);
+
+      /* Every firmware entry takes at least three words */
+      if (r.failed || count > (r.len - r.pos) / (3 * sizeof(uint32_t)))
+         goto error;
+
+      if (count)
+      {
+         info->firmware = (core_info_firmware_t*)
+            calloc(count, sizeof(*info->firmware));
+         if (!info->firmware)
+            goto error;
+         info->firmware_count = count;
+      }
+
+      for (j = 0; j < count; j++)
+      {
+         info->firmware[j].path     = core_info_cache_dup_string(&r);
+         info->firmware[j].desc     = core_info_cache_dup_string(&r);
+         info->firmware[j].optional = !!core_info_cache_get_u32(&r);
+      }
+
+      if (r.failed)
+         goto error;
+
+      core_info_split_lists(info);
+   }
+
+   if (r.pos != r.len)
+      goto error;
+
+   free(buf);
+   return core_info_list;
+
+error:
+   free(buf);
+   core_info_list_free(core_info_list);
+   return NULL;
+}
+
+/**
+ * core_info_list_new:
+ * @path               : cores directory.
+ * @use_cache          : load from and update the core info cache.
+ *
+ * Builds the core info list for every core in @path, from the
+ * core info cache if it is up to date, otherwise by parsing each
+ * core's .info file.
+ *
+ * Returns: core info list, or NULL if @path could not be listed.
+ **/
+core_info_list_t *core_info_list_new(const char *path,
+      bool use_cache)
 {
    size_t i;
+   char cache_path[PATH_MAX_LENGTH];
+   core_info_stamp_t *stamps        = NULL;
    core_info_t *core_info           = NULL;
    core_info_list_t *core_info_list = NULL;
    struct string_list *contents     = dir_list_new_special(
@@ -234,6 +643,36 @@ static core_info_list_t *core_info_list_new(const char *path)
    if (!contents)
       return NULL;
 
+   stamps = (core_info_stamp_t*)calloc(contents->size + 1, sizeof(*stamps));
+   if (!stamps)
+      goto error;
+
+   for (i = 0; i < contents->size; i++)
+   {
+      char info_path[PATH_MAX_LENGTH];
+
+      info_path[0]    = '\0';
+      stamps[i].mtime = -1;
+      stamps[i].size  = -1;
+
+      if (     core_info_list_iterate(info_path, sizeof(info_path),
+               contents, i)
+            && path_get_mtime(info_path, &stamps[i].mtime))
+         stamps[i].size = path_get_size(info_path);
+   }
+
+   fill_pathname_join(cache_path, core_info_dir(),
+         CORE_INFO_CACHE_FILE, sizeof(cache_path));
+
+   if (use_cache)
+   {
+      core_info_list = core_info_cache_read(cache_path, path,
+            contents, stamps);
+
+      if (core_info_list)
+         goto end;
+   }
+
    core_info_list = (core_info_list_t*)calloc(1, sizeof(*core_info_list));
    if (!core_info_list)
       goto error;
@@ -252,13 +691,12 @@ static core_info_list_t *core_info_list_new(const char *path)
       info_path[0]        = '\0';
 
       if ( 
-            core_info_list_iterate(info_path, sizeof(info_path),
-            contents, i) 
-            && path_is_valid(info_path))
+            stamps[i].size >= 0
+            && core_info_list_iterate(info_path, sizeof(info_path),
+            contents, i))
       {
          char *tmp           = NULL;
          bool tmp_bool       = false;
-         unsigned count      = 0;
          config_file_t *conf = config_file_new(info_path);
 
          if (!conf)
@@ -291,75 +729,51 @@ static core_info_list_t *core_info_list_new(const char *path)
             tmp = NULL;
          }
 
-         config_get_uint(conf, "firmware_count", &count);
-
-         core_info[i].firmware_count = count;
-
          if (config_get_string(conf, "supported_extensions", &tmp) && !string_is_empty(tmp))
          {
-            core_info[i].supported_extensions      = strdup(tmp);
-            core_info[i].supported_extensions_list =
-               string_split(core_info[i].supported_extensions, "|");
-
+            core_info[i].supported_extensions = strdup(tmp);
             free(tmp);
             tmp = NULL;
          }
 
          if (config_get_string(conf, "authors", &tmp) && !string_is_empty(tmp))
          {
-            core_info[i].authors      = strdup(tmp);
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
-
+            core_info[i].authors = strdup(tmp);
             free(tmp);
             tmp = NULL;
          }
 
          if (config_get_string(conf, "permissions", &tmp) && !string_is_empty(tmp))
          {
-            core_info[i].permissions      = strdup(tmp);
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
-
+            core_info[i].permissions = strdup(tmp);
             free(tmp);
             tmp = NULL;
          }
 
          if (config_get_string(conf, "license", &tmp) && !string_is_empty(tmp))
          {
-            core_info[i].licenses      = strdup(tmp);
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
-
+            core_info[i].licenses = strdup(tmp);
             free(tmp);
             tmp = NULL;
          }
 
          if (config_get_string(conf, "categories", &tmp) && !string_is_empty(tmp))
          {
-            core_info[i].categories      = strdup(tmp);
-            core_info[i].categories_list =
-               string_split(core_info[i].categories, "|");
-
+            core_info[i].categories = strdup(tmp);
             free(tmp);
             tmp = NULL;
          }
 
          if (config_get_string(conf, "database", &tmp) && !string_is_empty(tmp))
          {
-            core_info[i].databases      = strdup(tmp);
-            core_info[i].databases_list =
-               string_split(core_info[i].databases, "|");
-
+            core_info[i].databases = strdup(tmp);
             free(tmp);
             tmp = NULL;
          }
 
          if (config_get_string(conf, "notes", &tmp) && !string_is_empty(tmp))
          {
-            core_info[i].notes     = strdup(tmp);
-            core_info[i].note_list = string_split(core_info[i].notes, "|");
-
+            core_info[i].notes = strdup(tmp);
             free(tmp);
             tmp = NULL;
          }
@@ -372,7 +786,11 @@ static core_info_list_t *core_info_list_new(const char *path)
                &tmp_bool))
             core_info[i].supports_no_game = tmp_bool;
 
-         core_info[i].config_data = conf;
+         core_info_resolve_firmware(&core_info[i], conf);
+         core_info_split_lists(&core_info[i]);
+
+         core_info[i].has_info = true;
+         config_file_free(conf);
       }
 
       if (!string_is_empty(contents->elems[i].data))
@@ -383,15 +801,18 @@ static core_info_list_t *core_info_list_new(const char *path)
             strdup(path_basename(core_info[i].path));
    }
 
-   core_info_list_resolve_all_extensions(core_info_list);
+   if (use_cache)
+      core_info_cache_write(cache_path, path, core_info_list, stamps);
 
-   if (core_info_list)
-      core_info_list_resolve_all_firmware(core_info_list);
+end:
+   core_info_list_resolve_all_extensions(core_info_list);
 
+   free(stamps);
    dir_list_free(contents);
    return core_info_list;
 
 error:
+   free(stamps);
    if (contents)
       dir_list_free(contents);
    core_info_list_free(core_info_list);
@@ -610,7 +1031,8 @@ bool core_info_init_list(void)
    settings_t *settings = config_get_ptr();
 
    if (settings)
-      core_info_curr_list = core_info_list_new(settings->directory.libretro);
+      core_info_curr_list = core_info_list_new(settings->directory.libretro,
+            settings->bools.core_info_cache_enable);
 
    if (!core_info_curr_list)
       return false;
@@ -777,11 +1199,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
       return 0;
 
    for (i = 0; i < core_info_list->count; i++)
-   {
-      config_file_t *conf = (config_file_t*)
-         core_info_list->list[i].config_data;
-      num += !!conf;
-   }
+      num += core_info_list->list[i].has_info;
 
    return num;
 }
@@ -38,7 +38,6 @@ typedef struct
 typedef struct
 {
    char *path;
-   void *config_data;
    char *display_name;
    char *core_name;
    char *system_manufacturer;
@@ -60,6 +59,7 @@ typedef struct
 
    core_info_firmware_t *firmware;
    size_t firmware_count;
+   bool has_info;
    bool supports_no_game;
    void *userdata;
 } core_info_t;
@@ -86,6 +86,21 @@ typedef struct core_info_ctx_find
    const char *path;
 } core_info_ctx_find_t;
 
+/**
+ * core_info_list_new:
+ * @path               : cores directory.
+ * @use_cache          : load from and update the core info cache.
+ *
+ * Builds the core info list for every core in @path, from the
+ * core info cache if it is up to date, otherwise by parsing each
+ * core's .info file.
+ *
+ * Returns: core info list, or NULL if @path could not be listed.
+ **/
+core_info_list_t *core_info_list_new(const char *path, bool use_cache);
+
+void core_info_list_free(core_info_list_t *list);
+
 size_t core_info_list_num_info_files(core_info_list_t *list);
 
 /* Non-reentrant, does not allocate. Returns pointer to internal state. */
@@ -0,0 +1,54 @@
+#!/bin/sh
+
+# Plays each file headless through the built-in FFmpeg core and
+# reports the decode rate and the number of dropped video frames.
+#
+# Usage: benchmark.sh [-f frames] [-r retroarch] file...
+
+FRAMES=3600
+RETROARCH=retroarch
+
+while getopts "f:r:" opt; do
+   case $opt in
+      f) FRAMES=$OPTARG ;;
+      r) RETROARCH=$OPTARG ;;
+      *) echo "Usage: $0 [-f frames] [-r retroarch] file..." >&2; exit 1 ;;
+   esac
+done
+shift `expr $OPTIND - 1`
+
+if [ $# -eq 0 ]; then
+   echo "Usage: $0 [-f frames] [-r retroarch] file..." >&2
+   exit 1
+fi
+
+REPORT=`mktemp` || exit 1
+trap 'rm -f "$REPORT"' EXIT INT TERM
+
+counter_calls() {
+   sed -n "s/.*\"ident\": \"$1\", \"calls\": \([0-9]*\).*/\1/p" "$REPORT"
+}
+
+printf "%-40s %8s %10s %10s %10s\n" "file" "frames" "fps" "decode_us" "dropped"
+
+status=0
+for file in "$@"; do
+   rm -f "$REPORT"
+
+   if ! "$RETROARCH" --benchmark="$FRAMES" --benchmark-report="$REPORT" \
+         "$file" >/dev/null 2>&1 || [ ! -s "$REPORT" ]; then
+      printf "%-40s failed\n" "`basename "$file"`"
+      status=1
+      continue
+   fi
+
+   frames=`sed -n 's/.*"frames": \([0-9]*\).*/\1/p' "$REPORT"`
+   fps=`sed -n 's/.*"fps": \([0-9.]*\).*/\1/p' "$REPORT"`
+   decode=`sed -n 's/.*"ident": "ffmpeg_video_decode".*"avg_us": \([0-9.]*\).*/\1/p' "$REPORT"`
+   dropped=`counter_calls ffmpeg_video_dropped`
+
+   printf "%-40s %8s %10s %10s %10s\n" "`basename "$file"`" \
+      "${frames:-0}" "${fps:-0}" "${decode:--}" "${dropped:-0}"
+done
+
+exit $status
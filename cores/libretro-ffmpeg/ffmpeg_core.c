@@ -21,6 +21,8 @@ extern "C" {
 #include <libavutil/imgutils.h>
 #include <libavutil/time.h>
 #include <libavutil/opt.h>
+#include <libavutil/cpu.h>
+#include <libavutil/pixdesc.h>
 #include <libavdevice/avdevice.h>
 #ifdef HAVE_SWRESAMPLE
 #include <libswresample/swresample.h>
@@ -101,6 +103,7 @@ static int subtitle_streams_ptr;
 
 static ASS_Library *ass;
 static ASS_Renderer *ass_render;
+static slock_t *ass_lock;
 static ASS_Track *ass_track[MAX_STREAMS];
 static uint8_t *ass_extra_data[MAX_STREAMS];
 static size_t ass_extra_data_size[MAX_STREAMS];
@@ -128,7 +131,6 @@ static double pts_bias;
 
 /* Threaded FIFOs. */
 static volatile bool decode_thread_dead;
-static fifo_buffer_t *video_decode_fifo;
 static fifo_buffer_t *audio_decode_fifo;
 static scond_t *fifo_cond;
 static scond_t *fifo_decode_cond;
@@ -138,9 +140,82 @@ static sthread_t *decode_thread_handle;
 static double decode_last_video_time;
 static double decode_last_audio_time;
 
-static uint32_t *video_frame_temp_buffer;
-
 static bool main_sleeping;
+static size_t main_audio_wanted;
+static bool main_waiting_video;
+static bool video_thread_idle;
+
+/* Video pipeline.
+ * The demux thread queues video packets for the video decode thread,
+ * which converts decoded frames straight into a pool of RGB32 buffers
+ * read by the main thread. All indices are guarded by fifo_lock,
+ * frame data is never copied while holding it. */
+#define VIDEO_BUFFERS 8
+#define VIDEO_PACKETS 256
+
+struct video_buffer
+{
+   uint32_t *data;
+   int64_t pts;
+};
+
+static struct video_buffer video_buffers[VIDEO_BUFFERS];
+static unsigned video_buffers_read;
+static unsigned video_buffers_count;
+static AVPacket *video_packets;
+static unsigned video_packets_cap;
+static unsigned video_packets_read;
+static unsigned video_packets_count;
+static unsigned video_serial;
+static bool demux_eof;
+static scond_t *video_decode_cond;
+static sthread_t *video_thread_handle;
+static uint32_t *video_frame_current;
+static bool video_frame_primed;
+static unsigned video_frames_decoded;
+static unsigned video_frames_dropped;
+
+/* Sliced RGB conversion. */
+#define MAX_SWS_SLICES 8
+#define SWS_SLICE_ALIGN 16
+
+struct sws_slice
+{
+   struct SwsContext *sws;
+   sthread_t *thread;
+   unsigned y;
+   unsigned height;
+};
+
+static struct sws_slice sws_slices[MAX_SWS_SLICES];
+static unsigned sws_slices_num;
+static unsigned sws_slice_threads;
+static unsigned sws_slice_chroma_shift;
+static unsigned sws_slice_generation;
+static unsigned sws_slice_pending;
+static bool sws_slice_quit;
+static const AVFrame *sws_slice_src;
+static uint32_t *sws_slice_dst;
+static slock_t *sws_slice_lock;
+static scond_t *sws_slice_cond;
+static scond_t *sws_slice_done_cond;
+
+/* Performance counters, reported through the frontend's perf interface. */
+static struct retro_perf_callback perf_cb;
+static struct retro_perf_counter perf_video_decode;
+static struct retro_perf_counter perf_video_convert;
+static struct retro_perf_counter perf_video_wait;
+static struct retro_perf_counter perf_video_dropped;
+
+#define PERF_START(counter) do { \
+   if (perf_cb.perf_start) \
+      perf_cb.perf_start(&(counter)); \
+} while(0)
+
+#define PERF_STOP(counter) do { \
+   if (perf_cb.perf_stop) \
+      perf_cb.perf_stop(&(counter)); \
+} while(0)
 
 /* Seeking. */
 static bool do_seek;
@@ -387,6 +462,113 @@ static void check_variables(void)
    }
 }
 
+static bool video_packets_grow(void)
+{
+   unsigned i;
+   unsigned cap      = video_packets_cap ? video_packets_cap * 2 : VIDEO_PACKETS;
+   AVPacket *packets = (AVPacket*)av_malloc(cap * sizeof(*packets));
+
+   if (!packets)
+      return false;
+
+   for (i = 0; i < video_packets_count; i++)
+      packets[i] = video_packets[(video_packets_read + i) % video_packets_cap];
+
+   av_free(video_packets);
+   video_packets      = packets;
+   video_packets_cap  = cap;
+   video_packets_read = 0;
+
+   return true;
+}
+
+/* Drops every queued packet and decoded frame.
+ * The serial bump makes the video thread flush its codec before
+ * the next packet and discard the frame it may be converting.
+ * Must be called with fifo_lock held. */
+static void video_queue_flush(void)
+{
+   while (video_packets_count)
+   {
+      av_free_packet(&video_packets[video_packets_read]);
+      video_packets_read = (video_packets_read + 1) % video_packets_cap;
+      video_packets_count--;
+   }
+
+   video_buffers_count = 0;
+   video_serial++;
+   scond_signal(video_decode_cond);
+}
+
+/* Whether the main thread is blocked on data which only the demux
+ * thread can provide. Called with fifo_lock held. The wait flags stay
+ * set until the main thread is scheduled again, so also check that
+ * what it waits for is really missing. */
+static bool main_thread_starved(void)
+{
+   if (main_sleeping &&
+         fifo_read_avail(audio_decode_fifo) < main_audio_wanted)
+      return true;
+
+   return main_waiting_video && video_thread_idle
+      && !video_packets_count && !video_buffers_count;
+}
+
+/* Takes the oldest decoded frame from the pool.
+ * The buffer is not reused by the video thread before the next call,
+ * so it can be handed to the frontend without copying it. */
+static uint32_t *video_frame_take(int64_t *pts)
+{
+   uint32_t *data = NULL;
+
+   slock_lock(fifo_lock);
+
+   if (!decode_thread_dead && !video_buffers_count)
+   {
+      int64_t wait_start      = av_gettime();
+      retro_perf_tick_t ticks = perf_cb.get_perf_counter ?
+         perf_cb.get_perf_counter() : 0;
+
+      PERF_START(perf_video_wait);
+      while (!decode_thread_dead && !video_buffers_count)
+      {
+         main_waiting_video = true;
+         scond_signal(fifo_decode_cond);
+         scond_wait(fifo_cond, fifo_lock);
+         main_waiting_video = false;
+      }
+      PERF_STOP(perf_video_wait);
+
+      /* Waiting for longer than a frame period means the decoder
+       * fell behind and this frame would have missed its vsync.
+       * The first frame after loading or seeking is not counted. */
+      if (video_frame_primed &&
+            av_gettime() - wait_start > 1000000.0 / media.interpolate_fps)
+      {
+         video_frames_dropped++;
+         perf_video_dropped.call_cnt++;
+         if (perf_cb.get_perf_counter)
+            perf_video_dropped.total += perf_cb.get_perf_counter() - ticks;
+      }
+   }
+
+   if (!decode_thread_dead)
+   {
+      struct video_buffer *buf = &video_buffers[video_buffers_read];
+
+      data                = buf->data;
+      *pts                = buf->pts;
+      video_buffers_read  = (video_buffers_read + 1) % VIDEO_BUFFERS;
+      video_buffers_count--;
+      video_frame_primed  = true;
+      scond_signal(video_decode_cond);
+   }
+
+   slock_unlock(fifo_lock);
+
+   return data;
+}
+
 static void seek_frame(int seek_frames)
 {
    char msg[256];
@@ -415,8 +597,9 @@ static void seek_frame(int seek_frames)
    }
    audio_frames = frame_cnt * media.sample_rate / media.interpolate_fps;
 
-   if (video_decode_fifo)
-      fifo_clear(video_decode_fifo);
+   if (video_packets)
+      video_queue_flush();
+   video_frame_primed = false;
    if (audio_decode_fifo)
       fifo_clear(audio_decode_fifo);
    scond_signal(fifo_decode_cond);
@@ -564,6 +747,7 @@ void CORE_PREFIX(retro_run)(void)
       to_read_bytes = to_read_frames * sizeof(int16_t) * 2;
 
       slock_lock(fifo_lock);
+      main_audio_wanted = to_read_bytes;
       while (!decode_thread_dead && fifo_read_avail(audio_decode_fifo) < to_read_bytes)
       {
          main_sleeping = true;
@@ -609,66 +793,49 @@ void CORE_PREFIX(retro_run)(void)
 
       while (!decode_thread_dead && min_pts > frames[1].pts)
       {
-         size_t to_read_frame_bytes;
-         int64_t pts = 0;
-
-         slock_lock(fifo_lock);
-         to_read_frame_bytes = media.width * media.height * sizeof(uint32_t) + sizeof(int64_t);
+         int64_t pts    = 0;
+         uint32_t *data = video_frame_take(&pts);
 
-         while (!decode_thread_dead && fifo_read_avail(video_decode_fifo) < to_read_frame_bytes)
-         {
-            main_sleeping = true;
-            scond_signal(fifo_decode_cond);
-            scond_wait(fifo_cond, fifo_lock);
-            main_sleeping = false;
-         }
+         if (!data)
+            break;
 
-         if (!decode_thread_dead)
-         {
-            uint32_t *data = video_frame_temp_buffer;
-            fifo_read(video_decode_fifo, &pts, sizeof(int64_t));
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
-            if (use_gl)
-            {
+         if (use_gl)
+         {
 #ifndef HAVE_OPENGLES
-               glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frames[1].pbo);
+            uint32_t *pbo_data = NULL;
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frames[1].pbo);
 #ifdef __MACH__
-               data = (uint32_t*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+            pbo_data = (uint32_t*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
 #else
-               data = (uint32_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
-                     0, media.width * media.height * sizeof(uint32_t), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-#endif
+            pbo_data = (uint32_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                  0, media.width * media.height * sizeof(uint32_t), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
 #endif
-
-               fifo_read(video_decode_fifo, data, media.width * media.height * sizeof(uint32_t));
-
-#ifndef HAVE_OPENGLES
-               glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            if (pbo_data)
+               memcpy(pbo_data, data, media.width * media.height * sizeof(uint32_t));
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
 #endif
-               glBindTexture(GL_TEXTURE_2D, frames[1].tex);
+            glBindTexture(GL_TEXTURE_2D, frames[1].tex);
 #if defined(HAVE_OPENGLES)
-               glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                     media.width, media.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                  media.width, media.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
 #else
-               glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                     media.width, media.height, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+                  media.width, media.height, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
 #endif
-               glBindTexture(GL_TEXTURE_2D, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
 #ifndef HAVE_OPENGLES
-               glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 #endif
-            }
-            else
+         }
+         else
 #endif
-            {
-               fifo_read(video_decode_fifo, data, media.width * media.height * sizeof(uint32_t));
-               dupe = false;
-            }
+         {
+            video_frame_current = data;
+            dupe                = false;
          }
 
-         scond_signal(fifo_decode_cond);
-         slock_unlock(fifo_lock);
-
          frames[1].pts = av_q2d(fctx->streams[video_stream]->time_base) * pts;
       }
 
@@ -718,7 +885,7 @@ void CORE_PREFIX(retro_run)(void)
       else
 #endif
       {
-         CORE_PREFIX(video_cb)(dupe ? NULL : video_frame_temp_buffer,
+         CORE_PREFIX(video_cb)(dupe ? NULL : video_frame_current,
                media.width, media.height, media.width * sizeof(uint32_t));
       }
    }
@@ -764,6 +931,15 @@ static bool open_codec(AVCodecContext **ctx, unsigned index)
    }
 
    *ctx = fctx->streams[index]->codec;
+
+   /* Let libavcodec pick the thread count, using frame
+    * and slice threading where the codec supports it. */
+   if ((*ctx)->codec_type == AVMEDIA_TYPE_VIDEO)
+   {
+      (*ctx)->thread_count = 0;
+      (*ctx)->thread_type  = FF_THREAD_FRAME | FF_THREAD_SLICE;
+   }
+
    if (avcodec_open2(*ctx, codec, NULL) < 0)
       return false;
 
@@ -994,26 +1170,219 @@ static void set_colorspace(struct SwsContext *sws,
    }
 }
 
-static bool decode_video(AVPacket *pkt, AVFrame *frame,
-      AVFrame *conv, struct SwsContext *sws)
+static void sws_slice_scale(const struct sws_slice *slice,
+      const AVFrame *src, uint32_t *dst)
 {
-   int got_ptr = 0;
-   int ret     = avcodec_decode_video2(vctx, frame, &got_ptr, pkt);
+   unsigned i;
+   const uint8_t *src_data[4];
+   uint8_t *dst_data[4] = {NULL};
+   int dst_linesize[4]  = {0};
 
-   if (ret < 0)
-      return false;
+   for (i = 0; i < 4; i++)
+   {
+      unsigned y = slice->y;
+
+      /* Chroma planes are subsampled vertically. */
+      if (i == 1 || i == 2)
+         y >>= sws_slice_chroma_shift;
+
+      src_data[i] = src->data[i] ?
+         src->data[i] + (ptrdiff_t)y * src->linesize[i] : NULL;
+   }
+
+   dst_data[0]     = (uint8_t*)(dst + (size_t)slice->y * media.width);
+   dst_linesize[0] = media.width * sizeof(uint32_t);
+
+   set_colorspace(slice->sws, media.width, media.height,
+         av_frame_get_colorspace(src), av_frame_get_color_range(src));
+   sws_scale(slice->sws, src_data, src->linesize, 0, slice->height,
+         dst_data, dst_linesize);
+}
+
+static void sws_slice_thread(void *data)
+{
+   const struct sws_slice *slice = (const struct sws_slice*)data;
+   unsigned generation           = 0;
+
+   slock_lock(sws_slice_lock);
+
+   for (;;)
+   {
+      while (!sws_slice_quit && generation == sws_slice_generation)
+         scond_wait(sws_slice_cond, sws_slice_lock);
+
+      if (sws_slice_quit)
+         break;
+
+      generation = sws_slice_generation;
+      slock_unlock(sws_slice_lock);
+
+      sws_slice_scale(slice, sws_slice_src, sws_slice_dst);
+
+      slock_lock(sws_slice_lock);
+      if (--sws_slice_pending == 0)
+         scond_signal(sws_slice_done_cond);
+   }
+
+   slock_unlock(sws_slice_lock);
+}
 
-   if (got_ptr)
+static void sws_slices_deinit(void)
+{
+   unsigned i;
+
+   if (sws_slice_lock)
    {
-      set_colorspace(sws, media.width, media.height,
-            av_frame_get_colorspace(frame), av_frame_get_color_range(frame));
-      sws_scale(sws, (const uint8_t * const*)frame->data,
-            frame->linesize, 0, media.height,
-            conv->data, conv->linesize);
-      return true;
+      slock_lock(sws_slice_lock);
+      sws_slice_quit = true;
+      scond_broadcast(sws_slice_cond);
+      slock_unlock(sws_slice_lock);
    }
 
-   return false;
+   for (i = 0; i < sws_slices_num; i++)
+   {
+      if (sws_slices[i].thread)
+         sthread_join(sws_slices[i].thread);
+      if (sws_slices[i].sws)
+         sws_freeContext(sws_slices[i].sws);
+      sws_slices[i].thread = NULL;
+      sws_slices[i].sws    = NULL;
+   }
+
+   if (sws_slice_cond)
+      scond_free(sws_slice_cond);
+   if (sws_slice_done_cond)
+      scond_free(sws_slice_done_cond);
+   if (sws_slice_lock)
+      slock_free(sws_slice_lock);
+
+   sws_slice_cond      = NULL;
+   sws_slice_done_cond = NULL;
+   sws_slice_lock      = NULL;
+   sws_slices_num      = 0;
+   sws_slice_threads   = 0;
+}
+
+static bool sws_slices_create(unsigned num)
+{
+   unsigned i;
+   unsigned height = (media.height + num - 1) / num;
+
+   height = (height + SWS_SLICE_ALIGN - 1) & ~(SWS_SLICE_ALIGN - 1);
+
+   for (i = 0; i < num; i++)
+   {
+      struct sws_slice *slice = &sws_slices[sws_slices_num];
+      unsigned y              = i * height;
+
+      if (y >= media.height)
+         break;
+
+      slice->y      = y;
+      slice->height = media.height - y < height ? media.height - y : height;
+      slice->thread = NULL;
+      slice->sws    = sws_getCachedContext(NULL,
+            media.width, slice->height, vctx->pix_fmt,
+            media.width, slice->height, PIX_FMT_RGB32,
+            SWS_POINT, NULL, NULL, NULL);
+
+      if (!slice->sws)
+         return false;
+
+      sws_slices_num++;
+   }
+
+   return true;
+}
+
+/* A same-size conversion with point sampling does no vertical
+ * filtering, so each horizontal band of a large frame can be
+ * converted by its own context on its own thread. */
+static void sws_slices_init(void)
+{
+   unsigned i;
+   unsigned num                   = 1;
+   const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(vctx->pix_fmt);
+
+   if (     desc
+         && !(desc->flags & (AV_PIX_FMT_FLAG_PAL
+               | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))
+         && media.width * media.height >= 1280 * 720)
+   {
+      num = av_cpu_count();
+      if (num > MAX_SWS_SLICES)
+         num = MAX_SWS_SLICES;
+      if (num < 1)
+         num = 1;
+   }
+
+   sws_slice_chroma_shift = desc ? desc->log2_chroma_h : 0;
+   sws_slice_generation   = 0;
+   sws_slice_pending      = 0;
+   sws_slice_quit         = false;
+
+   if (!sws_slices_create(num) && num > 1)
+   {
+      sws_slices_deinit();
+      sws_slices_create(1);
+   }
+
+   if (sws_slices_num < 2)
+      return;
+
+   sws_slice_lock      = slock_new();
+   sws_slice_cond      = scond_new();
+   sws_slice_done_cond = scond_new();
+
+   /* Slices without a thread are converted on the calling thread. */
+   for (i = 1; i < sws_slices_num; i++)
+   {
+      sws_slices[i].thread = sthread_create(sws_slice_thread, &sws_slices[i]);
+      if (sws_slices[i].thread)
+         sws_slice_threads++;
+   }
+}
+
+static void convert_frame(const AVFrame *src, uint32_t *dst)
+{
+   unsigned i;
+
+   if (sws_slice_threads)
+   {
+      slock_lock(sws_slice_lock);
+      sws_slice_src     = src;
+      sws_slice_dst     = dst;
+      sws_slice_pending = sws_slice_threads;
+      sws_slice_generation++;
+      scond_broadcast(sws_slice_cond);
+      slock_unlock(sws_slice_lock);
+   }
+
+   for (i = 0; i < sws_slices_num; i++)
+   {
+      if (!sws_slices[i].thread)
+         sws_slice_scale(&sws_slices[i], src, dst);
+   }
+
+   if (sws_slice_threads)
+   {
+      slock_lock(sws_slice_lock);
+      while (sws_slice_pending)
+         scond_wait(sws_slice_done_cond, sws_slice_lock);
+      slock_unlock(sws_slice_lock);
+   }
+}
+
+static bool decode_video(AVPacket *pkt, AVFrame *frame)
+{
+   int ret;
+   int got_ptr = 0;
+
+   PERF_START(perf_video_decode);
+   ret = avcodec_decode_video2(vctx, frame, &got_ptr, pkt);
+   PERF_STOP(perf_video_decode);
+
+   return ret >= 0 && got_ptr;
 }
 
 static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
@@ -1056,7 +1425,7 @@ static int16_t *decode_audio(AVCodecContext *ctx, AVPacket *pkt,
 
       while (!decode_thread_dead && fifo_write_avail(audio_decode_fifo) < required_buffer)
       {
-         if (!main_sleeping)
+         if (!main_thread_starved())
             scond_wait(fifo_decode_cond, fifo_lock);
          else
          {
@@ -1094,26 +1463,24 @@ static void decode_thread_seek(double time)
    if (ret < 0)
       log_cb(RETRO_LOG_ERROR, "av_seek_frame() failed.\n");
 
+   /* The video codec is flushed by the video thread. */
    if (actx[audio_streams_ptr])
       avcodec_flush_buffers(actx[audio_streams_ptr]);
-   if (vctx)
-      avcodec_flush_buffers(vctx);
    if (sctx[subtitle_streams_ptr])
       avcodec_flush_buffers(sctx[subtitle_streams_ptr]);
 #ifdef HAVE_SSA
+   slock_lock(ass_lock);
    if (ass_track[subtitle_streams_ptr])
       ass_flush_events(ass_track[subtitle_streams_ptr]);
+   slock_unlock(ass_lock);
 #endif
 }
 
 #ifdef HAVE_SSA
 /* Straight CPU alpha blending.
  * Should probably do in GL. */
-static void render_ass_img(AVFrame *conv_frame, ASS_Image *img)
+static void render_ass_img(uint32_t *frame, int stride, ASS_Image *img)
 {
-   uint32_t *frame = (uint32_t*)conv_frame->data[0];
-   int      stride = conv_frame->linesize[0] / sizeof(uint32_t);
-
    for (; img; img = img->next)
    {
       int x, y;
@@ -1157,26 +1524,170 @@ static void render_ass_img(AVFrame *conv_frame, ASS_Image *img)
 }
 #endif
 
+static void video_output_frame(AVFrame *frame, unsigned serial)
+{
+   struct video_buffer *buf = NULL;
+   int64_t pts              = av_frame_get_best_effort_timestamp(frame);
+   double video_time        = pts *
+      av_q2d(fctx->streams[video_stream]->time_base);
+
+   /* One buffer stays reserved for the frame the main thread shows. */
+   slock_lock(fifo_lock);
+   while (!decode_thread_dead && serial == video_serial
+         && video_buffers_count + 1 >= VIDEO_BUFFERS)
+      scond_wait(video_decode_cond, fifo_lock);
+
+   if (!decode_thread_dead && serial == video_serial)
+      buf = &video_buffers[(video_buffers_read + video_buffers_count)
+         % VIDEO_BUFFERS];
+   slock_unlock(fifo_lock);
+
+   if (!buf)
+      return;
+
+   PERF_START(perf_video_convert);
+   convert_frame(frame, buf->data);
+
+#ifdef HAVE_SSA
+   slock_lock(ass_lock);
+   if (ass_render)
+   {
+      ASS_Track *track = NULL;
+
+      slock_lock(decode_thread_lock);
+      track = ass_track[subtitle_streams_ptr];
+      slock_unlock(decode_thread_lock);
+
+      /* Do it on CPU for now.
+       * We're in a thread anyways, so shouldn't really matter. */
+      if (track)
+      {
+         int change     = 0;
+         ASS_Image *img = ass_render_frame(ass_render, track,
+               1000 * video_time, &change);
+         render_ass_img(buf->data, media.width, img);
+      }
+   }
+   slock_unlock(ass_lock);
+#endif
+   PERF_STOP(perf_video_convert);
+
+   slock_lock(fifo_lock);
+   if (serial == video_serial)
+   {
+      buf->pts               = pts;
+      decode_last_video_time = video_time;
+      video_buffers_count++;
+      video_frames_decoded++;
+      scond_signal(fifo_cond);
+   }
+   slock_unlock(fifo_lock);
+}
+
+static void video_decode_thread(void *data)
+{
+   AVPacket pkt;
+   unsigned serial = 0;
+   AVFrame *frame  = av_frame_alloc();
+
+   (void)data;
+
+   sws_slices_init();
+
+   slock_lock(fifo_lock);
+   serial = video_serial;
+   slock_unlock(fifo_lock);
+
+   for (;;)
+   {
+      unsigned pkt_serial;
+      bool have_pkt = false;
+
+      slock_lock(fifo_lock);
+      while (!decode_thread_dead && !demux_eof && !video_packets_count)
+      {
+         video_thread_idle = true;
+         scond_signal(fifo_decode_cond);
+         scond_wait(video_decode_cond, fifo_lock);
+         video_thread_idle = false;
+      }
+
+      if (!decode_thread_dead && video_packets_count)
+      {
+         pkt                 = video_packets[video_packets_read];
+         video_packets_read  = (video_packets_read + 1) % video_packets_cap;
+         video_packets_count--;
+         have_pkt            = true;
+         scond_signal(fifo_decode_cond);
+      }
+      pkt_serial = video_serial;
+      slock_unlock(fifo_lock);
+
+      if (!have_pkt)
+         break;
+
+      /* A seek happened since the last packet. */
+      if (pkt_serial != serial)
+      {
+         avcodec_flush_buffers(vctx);
+         serial = pkt_serial;
+      }
+
+      if (decode_video(&pkt, frame))
+         video_output_frame(frame, serial);
+
+      av_free_packet(&pkt);
+   }
+
+   /* Drain the frames still held back by frame threading. */
+   av_init_packet(&pkt);
+   pkt.data = NULL;
+   pkt.size = 0;
+
+   while (!decode_thread_dead && decode_video(&pkt, frame))
+      video_output_frame(frame, serial);
+
+   sws_slices_deinit();
+   av_frame_free(&frame);
+}
+
+/* Hands a demuxed video packet over to the video thread. */
+static void video_packet_push(AVPacket *pkt)
+{
+   /* The packet may point into demuxer-owned memory. */
+   if (av_dup_packet(pkt) < 0)
+      return;
+
+   slock_lock(fifo_lock);
+
+   while (!decode_thread_dead && !main_thread_starved()
+         && video_packets_count == video_packets_cap)
+      scond_wait(fifo_decode_cond, fifo_lock);
+
+   /* If the main thread is starved of audio further ahead in the
+    * stream, grow the queue instead of waiting on the video thread. */
+   if (!decode_thread_dead && (video_packets_count < video_packets_cap
+            || video_packets_grow()))
+   {
+      video_packets[(video_packets_read + video_packets_count)
+         % video_packets_cap] = *pkt;
+      video_packets_count++;
+      memset(pkt, 0, sizeof(*pkt));
+      scond_signal(video_decode_cond);
+   }
+
+   slock_unlock(fifo_lock);
+}
+
 static void decode_thread(void *data)
 {
    unsigned i;
    SwrContext *swr[audio_streams_num];
    AVFrame *aud_frame      = NULL;
-   AVFrame *vid_frame      = NULL;
-   void *conv_frame_buf    = NULL;
-   size_t frame_size       = 0;
    int16_t *audio_buffer   = NULL;
    size_t audio_buffer_cap = 0;
-   AVFrame *conv_frame     = NULL;
-   struct SwsContext *sws  = NULL;
 
    (void)data;
-   
-   if (video_stream >= 0)
-      sws = sws_getCachedContext(NULL,
-            media.width, media.height, vctx->pix_fmt,
-            media.width, media.height, PIX_FMT_RGB32,
-            SWS_POINT, NULL, NULL, NULL);
 
    for (i = 0; (int)i < audio_streams_num; i++)
    {
@@ -1192,16 +1703,9 @@ static void decode_thread(void *data)
    }
 
    aud_frame = av_frame_alloc();
-   vid_frame = av_frame_alloc();
 
    if (video_stream >= 0)
-   {
-      frame_size = avpicture_get_size(PIX_FMT_RGB32, media.width, media.height);
-      conv_frame = av_frame_alloc();
-      conv_frame_buf = av_malloc(frame_size);
-      avpicture_fill((AVPicture*)conv_frame, (const uint8_t*)conv_frame_buf,
-            PIX_FMT_RGB32, media.width, media.height);
-   }
+      video_thread_handle = sthread_create(video_decode_thread, NULL);
 
    while (!decode_thread_dead)
    {
@@ -1229,8 +1733,8 @@ static void decode_thread(void *data)
          do_seek = false;
          seek_time = 0.0;
 
-         if (video_decode_fifo)
-            fifo_clear(video_decode_fifo);
+         if (video_packets)
+            video_queue_flush();
          if (audio_decode_fifo)
             fifo_clear(audio_decode_fifo);
 
@@ -1254,59 +1758,7 @@ static void decode_thread(void *data)
       slock_unlock(decode_thread_lock);
 
       if (pkt.stream_index == video_stream)
-      {
-         if (decode_video(&pkt, vid_frame, conv_frame, sws))
-         {
-            size_t decoded_size;
-            int64_t pts       = av_frame_get_best_effort_timestamp(vid_frame);
-            double video_time = pts * av_q2d(fctx->streams[video_stream]->time_base);
-
-#ifdef HAVE_SSA
-            if (ass_render && ass_track_active)
-            {
-               int change     = 0;
-               ASS_Image *img = ass_render_frame(ass_render, ass_track_active,
-                     1000 * video_time, &change);
-
-               /* Do it on CPU for now.
-                * We're in a thread anyways, so shouldn't really matter. */
-               render_ass_img(conv_frame, img);
-            }
-#endif
-
-            decoded_size = frame_size + sizeof(pts);
-            slock_lock(fifo_lock);
-
-            while (!decode_thread_dead  && (video_decode_fifo != NULL)
-                  && fifo_write_avail(video_decode_fifo) < decoded_size)
-            {
-               if (!main_sleeping)
-                  scond_wait(fifo_decode_cond, fifo_lock);
-               else
-               {
-                  fifo_clear(video_decode_fifo);
-                  break;
-               }
-            }
-
-            decode_last_video_time = video_time;
-            if (!decode_thread_dead)
-            {
-               int stride;
-               unsigned y;
-               const uint8_t *src = NULL;
-               
-               fifo_write(video_decode_fifo, &pts, sizeof(pts));
-               src    = conv_frame->data[0];
-               stride = conv_frame->linesize[0];
-
-               for (y = 0; y < media.height; y++, src += stride)
-                  fifo_write(video_decode_fifo, src, media.width * sizeof(uint32_t));
-            }
-            scond_signal(fifo_cond);
-            slock_unlock(fifo_lock);
-         }
-      }
+         video_packet_push(&pkt);
       else if (pkt.stream_index == audio_stream && actx_active)
       {
          audio_buffer = decode_audio(actx_active, &pkt, aud_frame,
@@ -1330,12 +1782,14 @@ static void decode_thread(void *data)
          }
 
 #ifdef HAVE_SSA
+         slock_lock(ass_lock);
          for (i = 0; i < sub.num_rects; i++)
          {
             if (sub.rects[i]->ass && ass_track_active)
                ass_process_data(ass_track_active,
                      sub.rects[i]->ass, strlen(sub.rects[i]->ass));
          }
+         slock_unlock(ass_lock);
 #endif
 
          avsubtitle_free(&sub);
@@ -1344,17 +1798,20 @@ static void decode_thread(void *data)
       av_free_packet(&pkt);
    }
 
-   if (sws)
-      sws_freeContext(sws);
-   sws = NULL;
+   /* Let the video thread finish the packets already queued. */
+   slock_lock(fifo_lock);
+   demux_eof = true;
+   scond_signal(video_decode_cond);
+   slock_unlock(fifo_lock);
+
+   if (video_thread_handle)
+      sthread_join(video_thread_handle);
+   video_thread_handle = NULL;
 
    for (i = 0; (int)i < audio_streams_num; i++)
       swr_free(&swr[i]);
 
    av_frame_free(&aud_frame);
-   av_frame_free(&vid_frame);
-   av_frame_free(&conv_frame);
-   av_freep(&conv_frame_buf);
    av_freep(&audio_buffer);
 
    slock_lock(fifo_lock);
@@ -1465,37 +1922,69 @@ void CORE_PREFIX(retro_unload_game)(void)
 {
    unsigned i;
 
+   /* The decode thread joins the video thread on its way out. */
    if (decode_thread_handle)
    {
       slock_lock(fifo_lock);
       decode_thread_dead = true;
       scond_signal(fifo_decode_cond);
+      scond_signal(video_decode_cond);
       slock_unlock(fifo_lock);
       sthread_join(decode_thread_handle);
    }
    decode_thread_handle = NULL;
 
+   if (vctx)
+      log_cb(RETRO_LOG_INFO, "[FFmpeg]: %u video frames decoded, %u dropped.\n",
+            video_frames_decoded, video_frames_dropped);
+
+   if (video_packets)
+   {
+      video_queue_flush();
+      av_freep(&video_packets);
+   }
+
+   for (i = 0; i < VIDEO_BUFFERS; i++)
+      av_freep(&video_buffers[i].data);
+
    if (fifo_cond)
       scond_free(fifo_cond);
    if (fifo_decode_cond)
       scond_free(fifo_decode_cond);
+   if (video_decode_cond)
+      scond_free(video_decode_cond);
    if (fifo_lock)
       slock_free(fifo_lock);
    if (decode_thread_lock)
       slock_free(decode_thread_lock);
+#ifdef HAVE_SSA
+   if (ass_lock)
+      slock_free(ass_lock);
+   ass_lock = NULL;
+#endif
 
-   if (video_decode_fifo)
-      fifo_free(video_decode_fifo);
    if (audio_decode_fifo)
       fifo_free(audio_decode_fifo);
 
    fifo_cond = NULL;
    fifo_decode_cond = NULL;
+   video_decode_cond = NULL;
    fifo_lock = NULL;
    decode_thread_lock = NULL;
-   video_decode_fifo = NULL;
    audio_decode_fifo = NULL;
 
+   video_packets_cap    = 0;
+   video_packets_read   = 0;
+   video_buffers_read   = 0;
+   video_buffers_count  = 0;
+   video_serial         = 0;
+   demux_eof            = false;
+   video_frame_current  = NULL;
+   video_frame_primed   = false;
+   video_thread_idle    = false;
+   video_frames_decoded = 0;
+   video_frames_dropped = 0;
+
    decode_last_video_time = 0.0;
    decode_last_audio_time = 0.0;
 
@@ -1549,12 +2038,40 @@ void CORE_PREFIX(retro_unload_game)(void)
    ass_render = NULL;
    ass = NULL;
 #endif
+}
+
+static void perf_counters_init(void)
+{
+   unsigned i;
+   struct retro_perf_counter *counters[] = {
+      &perf_video_decode,
+      &perf_video_convert,
+      &perf_video_wait,
+      &perf_video_dropped,
+   };
+   static const char *idents[] = {
+      "ffmpeg_video_decode",
+      "ffmpeg_video_convert",
+      "ffmpeg_video_wait",
+      "ffmpeg_video_dropped",
+   };
+
+   memset(&perf_cb, 0, sizeof(perf_cb));
+   if (!CORE_PREFIX(environ_cb)(RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &perf_cb))
+      memset(&perf_cb, 0, sizeof(perf_cb));
 
-   av_freep(&video_frame_temp_buffer);
+   for (i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+   {
+      memset(counters[i], 0, sizeof(*counters[i]));
+      counters[i]->ident = idents[i];
+      if (perf_cb.perf_register)
+         perf_cb.perf_register(counters[i]);
+   }
 }
 
 bool CORE_PREFIX(retro_load_game)(const struct retro_game_info *info)
 {
+   unsigned i;
    bool is_glfft = false;
    enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_XRGB8888;
    struct retro_input_descriptor desc[] = {
@@ -1609,11 +2126,28 @@ bool CORE_PREFIX(retro_load_game)(const struct retro_game_info *info)
    is_glfft = video_stream < 0 && audio_streams_num > 0;
 #endif
 
-   if (video_stream >= 0 || is_glfft)
+   if (video_stream >= 0)
    {
-      video_decode_fifo = fifo_new(media.width 
-            * media.height * sizeof(uint32_t) * 32);
+      for (i = 0; i < VIDEO_BUFFERS; i++)
+      {
+         video_buffers[i].data = (uint32_t*)
+            av_malloc(media.width * media.height * sizeof(uint32_t));
+         if (!video_buffers[i].data)
+         {
+            LOG_ERR("Failed to allocate video buffers.");
+            goto error;
+         }
+      }
 
+      if (!video_packets_grow())
+      {
+         LOG_ERR("Failed to allocate video packet queue.");
+         goto error;
+      }
+   }
+
+   if (video_stream >= 0 || is_glfft)
+   {
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
       use_gl = true;
       hw_render.context_reset = context_reset;
@@ -1639,21 +2173,23 @@ bool CORE_PREFIX(retro_load_game)(const struct retro_game_info *info)
       audio_decode_fifo = fifo_new(buffer_seconds * media.sample_rate * sizeof(int16_t) * 2);
    }
 
-   fifo_cond        = scond_new();
-   fifo_decode_cond = scond_new();
-   fifo_lock        = slock_new();
+   fifo_cond         = scond_new();
+   fifo_decode_cond  = scond_new();
+   video_decode_cond = scond_new();
+   fifo_lock         = slock_new();
+#ifdef HAVE_SSA
+   ass_lock          = slock_new();
+#endif
 
    slock_lock(fifo_lock);
    decode_thread_dead = false;
    slock_unlock(fifo_lock);
 
    check_variables();
+   perf_counters_init();
 
    decode_thread_handle = sthread_create(decode_thread, NULL);
 
-   video_frame_temp_buffer = (uint32_t*)
-      av_malloc(media.width * media.height * sizeof(uint32_t));
-
    pts_bias = 0.0;
 
    return true;
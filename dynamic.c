@@ -682,6 +682,130 @@ void uninit_libretro_sym(struct retro_core_t *current_core)
    performance_counters_clear();
 }
 
+#ifdef HAVE_DYNAMIC
+#define INSTANCE_SYMBOL(x) do { \
+   function_t func = dylib_proc(handle, #x); \
+   memcpy(&current_core->x, &func, sizeof(func)); \
+   if (current_core->x == NULL) goto error; \
+} while (0)
+
+/* Environment callback of a second instance of the running core.
+ * Queries are answered as for the primary instance, requests that
+ * would replace frontend state owned by the primary are accepted
+ * and ignored. */
+static bool libretro_instance_environment_cb(unsigned cmd, void *data)
+{
+   switch (cmd)
+   {
+      case RETRO_ENVIRONMENT_SET_HW_RENDER:
+      case RETRO_ENVIRONMENT_SET_HW_RENDER_CONTEXT_NEGOTIATION_INTERFACE:
+         return false;
+      case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+         /* The primary instance consumes option updates. */
+         *(bool*)data = false;
+         return true;
+      case RETRO_ENVIRONMENT_SET_ROTATION:
+      case RETRO_ENVIRONMENT_SET_MESSAGE:
+      case RETRO_ENVIRONMENT_SHUTDOWN:
+      case RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL:
+      case RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS:
+      case RETRO_ENVIRONMENT_SET_KEYBOARD_CALLBACK:
+      case RETRO_ENVIRONMENT_SET_DISK_CONTROL_INTERFACE:
+      case RETRO_ENVIRONMENT_SET_VARIABLES:
+      case RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME:
+      case RETRO_ENVIRONMENT_SET_AUDIO_CALLBACK:
+      case RETRO_ENVIRONMENT_SET_FRAME_TIME_CALLBACK:
+      case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO:
+      case RETRO_ENVIRONMENT_SET_PROC_ADDRESS_CALLBACK:
+      case RETRO_ENVIRONMENT_SET_SUBSYSTEM_INFO:
+      case RETRO_ENVIRONMENT_SET_CONTROLLER_INFO:
+      case RETRO_ENVIRONMENT_SET_MEMORY_MAPS:
+      case RETRO_ENVIRONMENT_SET_GEOMETRY:
+      case RETRO_ENVIRONMENT_SET_SUPPORT_ACHIEVEMENTS:
+      case RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS:
+         return true;
+      default:
+         break;
+   }
+
+   return rarch_environment_cb(cmd, data);
+}
+
+/**
+ * libretro_instance_load:
+ * @path                        : Path to a copy of the running core.
+ * @current_core                : Symbols of the new instance.
+ *
+ * Loads a second instance of the running core next to the primary
+ * one. The dynamic linker shares a library opened twice under the
+ * same path, hence @path has to point to a copy.
+ *
+ * Returns: library handle on success, otherwise NULL.
+ **/
+dylib_t libretro_instance_load(const char *path,
+      struct retro_core_t *current_core)
+{
+   dylib_t handle = dylib_load(path);
+
+   if (!handle)
+   {
+      RARCH_ERR("Failed to open core instance: \"%s\": %s\n",
+            path, dylib_error());
+      return NULL;
+   }
+
+   INSTANCE_SYMBOL(retro_init);
+   INSTANCE_SYMBOL(retro_deinit);
+   INSTANCE_SYMBOL(retro_api_version);
+   INSTANCE_SYMBOL(retro_get_system_info);
+   INSTANCE_SYMBOL(retro_get_system_av_info);
+   INSTANCE_SYMBOL(retro_set_environment);
+   INSTANCE_SYMBOL(retro_set_video_refresh);
+   INSTANCE_SYMBOL(retro_set_audio_sample);
+   INSTANCE_SYMBOL(retro_set_audio_sample_batch);
+   INSTANCE_SYMBOL(retro_set_input_poll);
+   INSTANCE_SYMBOL(retro_set_input_state);
+   INSTANCE_SYMBOL(retro_set_controller_port_device);
+   INSTANCE_SYMBOL(retro_reset);
+   INSTANCE_SYMBOL(retro_run);
+   INSTANCE_SYMBOL(retro_serialize_size);
+   INSTANCE_SYMBOL(retro_serialize);
+   INSTANCE_SYMBOL(retro_unserialize);
+   INSTANCE_SYMBOL(retro_cheat_reset);
+   INSTANCE_SYMBOL(retro_cheat_set);
+   INSTANCE_SYMBOL(retro_load_game);
+   INSTANCE_SYMBOL(retro_load_game_special);
+   INSTANCE_SYMBOL(retro_unload_game);
+   INSTANCE_SYMBOL(retro_get_region);
+   INSTANCE_SYMBOL(retro_get_memory_data);
+   INSTANCE_SYMBOL(retro_get_memory_size);
+
+   current_core->retro_set_environment(libretro_instance_environment_cb);
+   return handle;
+
+error:
+   RARCH_ERR("Core instance \"%s\" is missing symbols.\n", path);
+   dylib_close(handle);
+   memset(current_core, 0, sizeof(*current_core));
+   return NULL;
+}
+
+/**
+ * libretro_instance_free:
+ * @handle                      : Library handle of the instance.
+ * @current_core                : Symbols of the instance.
+ *
+ * Unloads an instance loaded with libretro_instance_load().
+ **/
+void libretro_instance_free(dylib_t handle,
+      struct retro_core_t *current_core)
+{
+   if (handle)
+      dylib_close(handle);
+   memset(current_core, 0, sizeof(*current_core));
+}
+#endif
+
 static void rarch_log_libretro(enum retro_log_level level,
       const char *fmt, ...)
 {
@@ -20,6 +20,7 @@
 #include <boolean.h>
 #include <retro_common_api.h>
 #include <libretro.h>
+#include <dynamic/dylib.h>
 
 #include "core_type.h"
 
@@ -133,6 +134,13 @@ bool init_libretro_sym(enum rarch_core_type type,
  **/
 void uninit_libretro_sym(struct retro_core_t *core);
 
+#ifdef HAVE_DYNAMIC
+dylib_t libretro_instance_load(const char *path,
+      struct retro_core_t *core);
+
+void libretro_instance_free(dylib_t handle, struct retro_core_t *core);
+#endif
+
 RETRO_END_DECLS
 
 #endif
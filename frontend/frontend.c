@@ -33,6 +33,7 @@
 
 #include "../driver.h"
 #include "../paths.h"
+#include "../benchmark.h"
 #include "../retroarch.h"
 
 #ifndef HAVE_MAIN
@@ -51,6 +52,9 @@ void main_exit(void *args)
 {
    settings_t *settings = config_get_ptr();
 
+   if (benchmark_is_enabled())
+      benchmark_report();
+
    if (settings->bools.config_save_on_exit)
       command_event(CMD_EVENT_MENU_SAVE_CURRENT_CONFIG, NULL);
 
@@ -62,6 +66,8 @@ void main_exit(void *args)
 
    command_event(CMD_EVENT_PERFCNT_REPORT_FRONTEND_LOG, NULL);
 
+   benchmark_deinit();
+
 #if defined(HAVE_LOGGER) && !defined(ANDROID)
    logger_shutdown();
 #endif
@@ -52,8 +52,10 @@
 #include "../configuration.h"
 #include "../driver.h"
 #include "../retroarch.h"
+#include "../performance_counters.h"
 #include "../runloop.h"
 #include "../list_special.h"
+#include "../input/input_latency.h"
 #include "../core.h"
 #include "../command.h"
 #include "../msg_hash.h"
@@ -143,6 +145,7 @@ static bool video_driver_window_title_update             = true;
 static retro_time_t video_driver_frame_time_samples[MEASURE_FRAME_TIME_SAMPLES_COUNT];
 static uint64_t video_driver_frame_time_count            = 0;
 static uint64_t video_driver_frame_count                 = 0;
+static retro_time_t video_driver_frame_present_time      = 0;
 
 void *video_driver_data                                  = NULL;
 video_driver_t *current_video                            = NULL;
@@ -1096,14 +1099,21 @@ static bool video_driver_frame_filter(
       unsigned *output_width, unsigned *output_height,
       unsigned *output_pitch)
 {
+   static struct retro_perf_counter softfilter_process = {0};
+
    rarch_softfilter_get_output_size(video_driver_state_filter,
          output_width, output_height, width, height);
 
    *output_pitch = (*output_width) * video_driver_state_out_bpp;
 
+   performance_counter_init(softfilter_process, "softfilter_process");
+   performance_counter_start_plus(video_info->is_perfcnt_enable,
+         softfilter_process);
    rarch_softfilter_process(video_driver_state_filter,
          video_driver_state_buffer, *output_pitch,
          data, width, height, pitch);
+   performance_counter_stop_plus(video_info->is_perfcnt_enable,
+         softfilter_process);
 
    if (video_info->post_filter_record && recording_data)
       recording_dump_frame(video_driver_state_buffer,
@@ -1828,6 +1838,13 @@ bool video_driver_is_active(void)
    return video_driver_active;
 }
 
+/* Time the last frame spent in the driver's frame callback,
+ * which includes any wait for VSync. */
+retro_time_t video_driver_get_frame_present_time(void)
+{
+   return video_driver_frame_present_time;
+}
+
 void video_driver_get_record_status(
       bool *has_gpu_record, 
       uint8_t **gpu_buf)
@@ -2022,6 +2039,7 @@ void video_driver_frame(const void *data, unsigned width,
       unsigned height, size_t pitch)
 {
    static char video_driver_msg[256];
+   static struct retro_perf_counter video_frame_present = {0};
    video_frame_info_t video_info;
    static retro_time_t curr_time;
    static retro_time_t fps_time;
@@ -2114,6 +2132,19 @@ void video_driver_frame(const void *data, unsigned width,
                last_fps,
                msg_hash_to_str(MSG_FRAMES),
                (unsigned long long)video_driver_frame_count);
+
+      if (video_info.fps_show && video_info.frame_delay_auto)
+      {
+         unsigned frame_delay = 0;
+         unsigned missed      = 0;
+         char delay_text[64];
+
+         runloop_get_frame_delay_status(&frame_delay, &missed);
+         snprintf(delay_text, sizeof(delay_text),
+               " || Delay: %u ms, %u missed", frame_delay, missed);
+         strlcat(video_info.fps_text, delay_text,
+               sizeof(video_info.fps_text));
+      }
    }
    else
    {
@@ -2163,11 +2194,22 @@ void video_driver_frame(const void *data, unsigned width,
          && msg)
       strlcpy(video_driver_msg, msg, sizeof(video_driver_msg));
 
+   new_time = cpu_features_get_time_usec();
+
+   performance_counter_init(video_frame_present, "video_frame_present");
+   performance_counter_start_plus(video_info.is_perfcnt_enable,
+         video_frame_present);
    if (!current_video || !current_video->frame(
             video_driver_data, data, width, height,
             video_driver_frame_count,
             (unsigned)pitch, video_driver_msg, &video_info))
       video_driver_active = false;
+   performance_counter_stop_plus(video_info.is_perfcnt_enable,
+         video_frame_present);
+
+   video_driver_frame_present_time = cpu_features_get_time_usec() - new_time;
+
+   input_latency_frame_presented();
 
    video_driver_frame_count++;
 
@@ -2244,6 +2286,7 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->hard_sync             = settings->bools.video_hard_sync;
    video_info->hard_sync_frames      = settings->video.hard_sync_frames;
    video_info->fps_show              = settings->bools.video_fps_show;
+   video_info->frame_delay_auto      = settings->bools.video_frame_delay_auto;
    video_info->scale_integer         = settings->bools.video_scale_integer;
    video_info->aspect_ratio_idx      = settings->video.aspect_ratio_idx;
    video_info->post_filter_record    = settings->bools.video_post_filter_record;
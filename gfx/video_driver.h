@@ -119,6 +119,7 @@ typedef struct video_frame_info
    bool hard_sync;
    unsigned hard_sync_frames;
    bool fps_show;
+   bool frame_delay_auto;
    bool scale_integer;
    unsigned aspect_ratio_idx;
    bool post_filter_record;
@@ -367,6 +368,7 @@ void video_driver_set_video_cache_context_ack(void);
 bool video_driver_is_video_cache_context_ack(void);
 void video_driver_set_active(void);
 bool video_driver_is_active(void);
+retro_time_t video_driver_get_frame_present_time(void);
 bool video_driver_gpu_record_init(unsigned size);
 void video_driver_gpu_record_deinit(void);
 bool video_driver_get_current_software_framebuffer(struct 
@@ -67,6 +67,7 @@ COMPRESSION
 ============================================================ */
 #include "../libretro-common/streams/trans_stream.c"
 #include "../libretro-common/streams/trans_stream_pipe.c"
+#include "../libretro-common/streams/trans_stream_lz4.c"
 
 #ifdef HAVE_ZLIB
 #include "../libretro-common/streams/trans_stream_zlib.c"
@@ -83,6 +84,7 @@ PERFORMANCE
 ============================================================ */
 #include "../libretro-common/features/features_cpu.c"
 #include "../performance_counters.c"
+#include "../benchmark.c"
 
 /*============================================================
 COMPATIBILITY
@@ -140,15 +142,15 @@ ACHIEVEMENTS
 /*============================================================
 MD5
 ============================================================ */
-#if (defined(HAVE_CHEEVOS) && defined(HAVE_THREADS)) || (defined(HAVE_HTTPSERVER) && defined(HAVE_ZLIB))
 #include "../libretro-common/utils/md5.c"
-#endif
 
 /*============================================================
 CHEATS
 ============================================================ */
 #include "../managers/cheat_manager.c"
+#include "../managers/cheat_search.c"
 #include "../libretro-common/hash/rhash.c"
+#include "../libretro-common/hash/rhash_multi.c"
 
 /*============================================================
 VIDEO CONTEXT
@@ -669,6 +671,7 @@ DRIVERS
 #include "../gfx/video_driver.c"
 #include "../gfx/video_coord_array.c"
 #include "../input/input_driver.c"
+#include "../input/input_latency.c"
 #include "../audio/audio_driver.c"
 #include "../libretro-common/audio/audio_mixer.c"
 #include "../camera/camera_driver.c"
@@ -743,7 +746,9 @@ FILE
 #include "../libretro-common/file/retro_stat.c"
 #include "../list_special.c"
 #include "../libretro-common/string/stdstring.c"
+#include "../libretro-common/file/nbio/nbio_intf.c"
 #include "../libretro-common/file/nbio/nbio_stdio.c"
+#include "../libretro-common/file/nbio/nbio_unix.c"
 
 /*============================================================
 MESSAGE
@@ -901,6 +906,7 @@ NETPLAY
 #include "../network/netplay/netplay_handshake.c"
 #include "../network/netplay/netplay_init.c"
 #include "../network/netplay/netplay_io.c"
+#include "../network/netplay/netplay_relay.c"
 #include "../network/netplay/netplay_sync.c"
 #include "../network/netplay/netplay_discovery.c"
 #include "../network/netplay/netplay_buf.c"
@@ -927,6 +933,7 @@ DATA RUNLOOP
 #include "../tasks/task_content.c"
 #include "../tasks/task_save.c"
 #include "../tasks/task_image.c"
+#include "../tasks/task_dir_list.c"
 #include "../tasks/task_file_transfer.c"
 #ifdef HAVE_ZLIB
 #include "../tasks/task_decompress.c"
@@ -19,6 +19,10 @@
 #include <libudev.h>
 
 #include <sys/poll.h>
+#include <sys/ioctl.h>
+#include <time.h>
+
+#include <features/features_cpu.h>
 
 #include "udev_common.h"
 
@@ -32,3 +36,26 @@ bool udev_hotplug_available(void *dev)
 
    return (poll(&fds, 1, 0) == 1) && (fds.revents & POLLIN);
 }
+
+/* Asks evdev to stamp the device's events with the monotonic
+ * clock that cpu_features_get_time_usec() reads. */
+bool udev_event_clock_set_monotonic(int fd)
+{
+#ifdef EVIOCSCLOCKID
+   int clock_id = CLOCK_MONOTONIC;
+   return ioctl(fd, EVIOCSCLOCKID, &clock_id) == 0;
+#else
+   return false;
+#endif
+}
+
+/* Time of an input event, or the current time if the
+ * device's events are not on the monotonic clock. */
+retro_time_t udev_event_time(const struct input_event *event,
+      bool monotonic)
+{
+   if (!monotonic)
+      return cpu_features_get_time_usec();
+   return (retro_time_t)event->time.tv_sec * 1000000
+      + event->time.tv_usec;
+}
@@ -17,7 +17,15 @@
 #define _UDEV_COMMON_H
 
 #include <boolean.h>
+#include <libretro.h>
+
+#include <linux/input.h>
 
 bool udev_hotplug_available(void *dev);
 
+bool udev_event_clock_set_monotonic(int fd);
+
+retro_time_t udev_event_time(const struct input_event *event,
+      bool monotonic);
+
 #endif
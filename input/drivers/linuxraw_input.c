@@ -24,6 +24,7 @@
 #include <signal.h>
 
 #include <boolean.h>
+#include <features/features_cpu.h>
 
 #include "../../verbosity.h"
 
@@ -32,6 +33,7 @@
 #include "../input_keymaps.h"
 #include "../input_driver.h"
 #include "../input_joypad_driver.h"
+#include "../input_latency.h"
 
 typedef struct linuxraw_input
 {
@@ -187,7 +189,13 @@ static void linuxraw_input_poll(void *data)
       if (!c)
          read(STDIN_FILENO, &t, 2);
       else
+      {
+         /* The terminal doesn't timestamp scancodes, so their
+          * age is counted from when they are read. */
+         if (linuxraw->state[c] != pressed && input_latency_is_enabled())
+            input_latency_event(cpu_features_get_time_usec());
          linuxraw->state[c] = pressed;
+      }
    }
 
    if (linuxraw->joypad)
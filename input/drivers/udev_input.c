@@ -39,11 +39,17 @@
 #include <file/file_path.h>
 #include <compat/strl.h>
 #include <string/stdstring.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "../input_config.h"
 #include "../input_driver.h"
 #include "../input_joypad_driver.h"
 #include "../input_keymaps.h"
+#include "../input_latency.h"
 
 #include "../drivers_keyboard/keyboard_event_udev.h"
 #include "../../gfx/video_driver.h"
@@ -51,8 +57,12 @@
 #include "../common/udev_common.h"
 #include "../common/epoll_common.h"
 
+#include "../../configuration.h"
 #include "../../verbosity.h"
 
+/* Events the input thread can hold between two polls. */
+#define UDEV_INPUT_QUEUE_SIZE 1024
+
 typedef struct udev_input udev_input_t;
 
 typedef void (*device_handle_cb)(void *data,
@@ -62,6 +72,7 @@ struct udev_input_device
 {
    int fd;
    dev_t dev;
+   bool monotonic;
    device_handle_cb handle_cb;
    char devnode[PATH_MAX_LENGTH];
 
@@ -98,6 +109,25 @@ struct udev_input
    int16_t mouse_x;
    int16_t mouse_y;
    bool mouse_l, mouse_r, mouse_m, mouse_wu, mouse_wd, mouse_whu, mouse_whd;
+
+#ifdef HAVE_THREADS
+   /* The input thread blocks on the epoll FD and queues events
+    * for the poll. The queue has a single producer (the thread)
+    * and a single consumer (the poll), so it needs no lock.
+    * thread_lock only guards the device list while the thread
+    * reads from the devices. */
+   sthread_t *thread;
+   slock_t *thread_lock;
+   int thread_wake[2];
+   volatile bool thread_quit;
+   volatile unsigned queue_read;
+   volatile unsigned queue_write;
+   struct
+   {
+      udev_input_device_t *device;
+      struct input_event event;
+   } queue[UDEV_INPUT_QUEUE_SIZE];
+#endif
 };
 
 #ifdef HAVE_XKBCOMMON
@@ -250,6 +280,7 @@ static bool udev_input_add_device(udev_input_t *udev,
 
    device->fd        = fd;
    device->dev       = st.st_dev;
+   device->monotonic = udev_event_clock_set_monotonic(fd);
    device->handle_cb = cb;
 
    strlcpy(device->devnode, devnode, sizeof(device->devnode));
@@ -281,10 +312,63 @@ error:
    return false;
 }
 
+static void udev_input_handle_event(udev_input_t *udev,
+      udev_input_device_t *device, const struct input_event *event)
+{
+   device->handle_cb(udev, event, device);
+
+   if (!input_latency_is_enabled())
+      return;
+
+   switch (event->type)
+   {
+      case EV_KEY:
+         /* Key repeats are not new input. */
+         if (event->value == 2)
+            break;
+         /* fall-through */
+      case EV_REL:
+      case EV_ABS:
+         input_latency_event(udev_event_time(event, device->monotonic));
+         break;
+      default:
+         break;
+   }
+}
+
+#ifdef HAVE_THREADS
+static void udev_input_drain_queue(udev_input_t *udev)
+{
+   unsigned read_index  = udev->queue_read;
+   unsigned write_index = udev->queue_write;
+
+   /* Don't read queued events before the thread's writes to them
+    * are visible. */
+   __sync_synchronize();
+
+   for (; read_index != write_index; read_index++)
+   {
+      unsigned i = read_index & (UDEV_INPUT_QUEUE_SIZE - 1);
+      udev_input_handle_event(udev,
+            udev->queue[i].device, &udev->queue[i].event);
+   }
+
+   /* Hand the slots back only once we are done with them. */
+   __sync_synchronize();
+   udev->queue_read = read_index;
+}
+#endif
+
 static void udev_input_remove_device(udev_input_t *udev, const char *devnode)
 {
    unsigned i;
 
+#ifdef HAVE_THREADS
+   /* Apply queued events while their devices still exist. */
+   if (udev->thread)
+      udev_input_drain_queue(udev);
+#endif
+
    for (i = 0; i < udev->num_devices; i++)
    {
       if (!string_is_equal(devnode, udev->devices[i]->devnode))
@@ -352,6 +436,153 @@ end:
    udev_device_unref(dev);
 }
 
+#ifdef HAVE_THREADS
+static bool udev_input_device_is_open(udev_input_t *udev,
+      udev_input_device_t *device)
+{
+   unsigned i;
+
+   for (i = 0; i < udev->num_devices; i++)
+      if (udev->devices[i] == device)
+         return true;
+
+   return false;
+}
+
+/* Moves a device's pending events into the queue.
+ * Returns false if the queue filled up first. */
+static bool udev_input_thread_read(udev_input_t *udev,
+      udev_input_device_t *device)
+{
+   for (;;)
+   {
+      int i, len;
+      struct input_event events[32];
+      unsigned write_index = udev->queue_write;
+      unsigned space       = UDEV_INPUT_QUEUE_SIZE
+         - (write_index - udev->queue_read);
+
+      if (!space)
+         return false;
+      if (space > ARRAY_SIZE(events))
+         space = ARRAY_SIZE(events);
+
+      len = read(device->fd, events, space * sizeof(*events));
+      if (len <= 0)
+         return true;
+
+      len /= sizeof(*events);
+      for (i = 0; i < len; i++)
+      {
+         unsigned slot = (write_index + i) & (UDEV_INPUT_QUEUE_SIZE - 1);
+         udev->queue[slot].device = device;
+         udev->queue[slot].event  = events[i];
+      }
+
+      /* Publish the events before the index that covers them. */
+      __sync_synchronize();
+      udev->queue_write = write_index + len;
+   }
+}
+
+static void udev_input_thread(void *data)
+{
+   udev_input_t *udev = (udev_input_t*)data;
+
+   while (!udev->thread_quit)
+   {
+      int i, ret;
+      bool full = false;
+      struct epoll_event events[32];
+
+      ret = epoll_waiting(&udev->epfd, events, ARRAY_SIZE(events), -1);
+      if (ret < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         RARCH_ERR("[udev]: Input thread failed to wait for events (%s).\n",
+               strerror(errno));
+         break;
+      }
+
+      slock_lock(udev->thread_lock);
+
+      for (i = 0; i < ret; i++)
+      {
+         udev_input_device_t *device = (udev_input_device_t*)
+            events[i].data.ptr;
+
+         /* The wake pipe has no device, and devices removed
+          * since the wait are gone. */
+         if (!device || !(events[i].events & EPOLLIN)
+               || !udev_input_device_is_open(udev, device))
+            continue;
+
+         if (!udev_input_thread_read(udev, device))
+            full = true;
+      }
+
+      slock_unlock(udev->thread_lock);
+
+      /* Leave the rest with the kernel until the poll catches up. */
+      if (full)
+         retro_sleep(1);
+   }
+}
+
+static void udev_input_thread_deinit(udev_input_t *udev)
+{
+   if (udev->thread)
+   {
+      char wake = 0;
+
+      udev->thread_quit = true;
+      if (write(udev->thread_wake[1], &wake, 1) != 1)
+         RARCH_WARN("[udev]: Failed to wake the input thread.\n");
+      sthread_join(udev->thread);
+      udev->thread = NULL;
+   }
+
+   if (udev->thread_lock)
+      slock_free(udev->thread_lock);
+   udev->thread_lock = NULL;
+
+   if (udev->thread_wake[0] >= 0)
+      close(udev->thread_wake[0]);
+   if (udev->thread_wake[1] >= 0)
+      close(udev->thread_wake[1]);
+   udev->thread_wake[0] = udev->thread_wake[1] = -1;
+}
+
+static bool udev_input_thread_init(udev_input_t *udev)
+{
+   if (pipe(udev->thread_wake) < 0)
+   {
+      udev->thread_wake[0] = udev->thread_wake[1] = -1;
+      return false;
+   }
+
+   if (!epoll_add(&udev->epfd, udev->thread_wake[0], NULL))
+      goto error;
+
+   udev->thread_lock = slock_new();
+   if (!udev->thread_lock)
+      goto error;
+
+   udev->thread = sthread_create(udev_input_thread, udev);
+   if (!udev->thread)
+      goto error;
+
+   RARCH_LOG("[udev]: Reading input events on a separate thread.\n");
+   return true;
+
+error:
+   RARCH_ERR("[udev]: Failed to start the input thread.\n");
+   udev_input_thread_deinit(udev);
+   return false;
+}
+#endif
+
 static void udev_input_poll(void *data)
 {
    int i, ret;
@@ -365,6 +596,22 @@ static void udev_input_poll(void *data)
    udev->mouse_wu  = udev->mouse_wd  = 0;
    udev->mouse_whu = udev->mouse_whd = 0;
 
+#ifdef HAVE_THREADS
+   if (udev->thread)
+   {
+      slock_lock(udev->thread_lock);
+      while (udev->monitor && udev_hotplug_available(udev->monitor))
+         udev_input_handle_hotplug(udev);
+      slock_unlock(udev->thread_lock);
+
+      udev_input_drain_queue(udev);
+
+      if (udev->joypad)
+         udev->joypad->poll();
+      return;
+   }
+#endif
+
    while (udev->monitor && udev_hotplug_available(udev->monitor))
       udev_input_handle_hotplug(udev);
 
@@ -382,7 +629,7 @@ static void udev_input_poll(void *data)
          {
             len /= sizeof(*input_events);
             for (j = 0; j < len; j++)
-               device->handle_cb(udev, &input_events[j], device);
+               udev_input_handle_event(udev, device, &input_events[j]);
          }
       }
    }
@@ -556,6 +803,10 @@ static void udev_input_free(void *data)
    if (!data || !udev)
       return;
 
+#ifdef HAVE_THREADS
+   udev_input_thread_deinit(udev);
+#endif
+
    if (udev->joypad)
       udev->joypad->destroy();
 
@@ -624,6 +875,10 @@ static void *udev_input_init(const char *joypad_driver)
    if (!udev)
       return NULL;
 
+#ifdef HAVE_THREADS
+   udev->thread_wake[0] = udev->thread_wake[1] = -1;
+#endif
+
    udev->udev = udev_new();
    if (!udev->udev)
    {
@@ -672,6 +927,11 @@ static void *udev_input_init(const char *joypad_driver)
    if (!udev->num_devices)
       RARCH_WARN("[udev]: Couldn't open any keyboard, mouse or touchpad. Are permissions set correctly for /dev/input/event*?\n");
 
+#ifdef HAVE_THREADS
+   if (config_get_ptr()->bools.input_udev_thread)
+      udev_input_thread_init(udev);
+#endif
+
    udev->joypad = input_joypad_init_driver(joypad_driver, udev);
    input_keymaps_init_keyboard_lut(rarch_key_map_linux);
 
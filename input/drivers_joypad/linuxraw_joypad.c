@@ -29,9 +29,11 @@
 
 #include <compat/strl.h>
 #include <string/stdstring.h>
+#include <features/features_cpu.h>
 
 #include "../input_config.h"
 #include "../input_driver.h"
+#include "../input_latency.h"
 
 #include "../common/epoll_common.h"
 #include "../../verbosity.h"
@@ -62,6 +64,11 @@ static void linuxraw_poll_pad(struct linuxraw_joypad *pad)
    {
       unsigned type = event.type & ~JS_EVENT_INIT;
 
+      /* js_event times are not on a clock we can compare with,
+       * so events are aged from when they are read. */
+      if (!(event.type & JS_EVENT_INIT) && input_latency_is_enabled())
+         input_latency_event(cpu_features_get_time_usec());
+
       switch (type)
       {
          case JS_EVENT_BUTTON:
@@ -33,6 +33,7 @@
 
 #include "../input_config.h"
 #include "../input_driver.h"
+#include "../input_latency.h"
 
 #include "../../tasks/tasks_internal.h"
 
@@ -61,6 +62,7 @@ struct udev_joypad
 {
    int fd;
    dev_t device;
+   bool monotonic;
 
    /* Input state polled. */
    uint64_t buttons;
@@ -158,6 +160,10 @@ static void udev_poll_pad(struct udev_joypad *pad, unsigned p)
             default:
                break;
          }
+
+         if (     (events[i].type == EV_KEY || events[i].type == EV_ABS)
+               && input_latency_is_enabled())
+            input_latency_event(udev_event_time(&events[i], pad->monotonic));
       }
    }
 }
@@ -283,9 +289,10 @@ static int udev_add_pad(struct udev_device *dev, unsigned p, int fd, const char
       }
    }
 
-   pad->device = st.st_rdev;
-   pad->fd     = fd;
-   pad->path   = strdup(path);
+   pad->device    = st.st_rdev;
+   pad->fd        = fd;
+   pad->monotonic = udev_event_clock_set_monotonic(fd);
+   pad->path      = strdup(path);
 
    if (!string_is_empty(pad->ident))
    {
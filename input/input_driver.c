@@ -28,6 +28,7 @@
 #include "input_config.h"
 #include "input_keyboard.h"
 #include "input_remapping.h"
+#include "input_latency.h"
 
 #ifdef HAVE_MENU
 #include "../menu/menu_driver.h"
@@ -110,6 +111,20 @@ struct turbo_buttons
 };
 
 static turbo_buttons_t input_driver_turbo_btns;
+
+/* Joypad buttons and analog axes of each user, captured on their first
+ * lookup after a poll, so that input_state calls for the rest of the
+ * frame become table lookups. */
+typedef struct input_snapshot
+{
+   uint16_t joypad[MAX_USERS];
+   int16_t analog[MAX_USERS][4];
+   uint32_t joypad_captured;
+   uint32_t analog_captured;
+} input_snapshot_t;
+
+static input_snapshot_t input_driver_snapshot;
+static bool input_driver_snapshot_disable         = false;
 #ifdef HAVE_COMMAND
 static command_t *input_driver_command            = NULL;
 #endif
@@ -275,6 +290,9 @@ void input_poll(void)
    
    current_input->poll(current_input_data);
 
+   input_driver_snapshot.joypad_captured = 0;
+   input_driver_snapshot.analog_captured = 0;
+
    input_driver_turbo_btns.count++;
 
    for (i = 0; i < max_users; i++)
@@ -318,6 +336,151 @@ void input_poll(void)
 #endif
 }
 
+/* Reads one input through remapping, the input driver, the overlay
+ * and the network gamepad. */
+static int16_t input_state_device(settings_t *settings,
+      unsigned port, unsigned device, unsigned idx, unsigned id)
+{
+   int16_t res = 0;
+
+   if (settings->bools.input_remap_binds_enable)
+   {
+      switch (device)
+      {
+         case RETRO_DEVICE_JOYPAD:
+            if (id < RARCH_FIRST_CUSTOM_BIND)
+               id = settings->input.remap_ids[port][id];
+            break;
+         case RETRO_DEVICE_ANALOG:
+            if (idx < 2 && id < 2)
+            {
+               unsigned new_id = RARCH_FIRST_CUSTOM_BIND + (idx * 2 + id);
+
+               new_id = settings->input.remap_ids[port][new_id];
+               idx   = (new_id & 2) >> 1;
+               id    = new_id & 1;
+            }
+            break;
+      }
+   }
+
+   if (((id < RARCH_FIRST_META_KEY) || (device == RETRO_DEVICE_KEYBOARD)))
+   {
+      bool bind_valid = libretro_input_binds[port] && libretro_input_binds[port][id].valid;
+
+      if (bind_valid || device == RETRO_DEVICE_KEYBOARD)
+      {
+         rarch_joypad_info_t joypad_info;
+
+         joypad_info.axis_threshold = settings->floats.input_axis_threshold;
+         joypad_info.joy_idx        = settings->input.joypad_map[port];
+         joypad_info.auto_binds     = input_autoconf_binds[joypad_info.joy_idx];
+
+         res = current_input->input_state(
+               current_input_data, joypad_info, libretro_input_binds, port, device, idx, id);
+      }
+   }
+
+#ifdef HAVE_OVERLAY
+   if (overlay_ptr)
+      input_state_overlay(overlay_ptr, &res, port, device, idx, id);
+#endif
+
+#ifdef HAVE_NETWORKGAMEPAD
+   if (input_driver_remote)
+      input_remote_state(&res, port, device, idx, id);
+#endif
+
+   return res;
+}
+
+static int16_t input_state_snapshot(settings_t *settings,
+      unsigned port, unsigned device, unsigned idx, unsigned id)
+{
+   if (port < MAX_USERS && !input_driver_snapshot_disable)
+   {
+      uint32_t port_bit = 1 << port;
+
+      if (device == RETRO_DEVICE_JOYPAD && id < RARCH_FIRST_CUSTOM_BIND)
+      {
+         if (!(input_driver_snapshot.joypad_captured & port_bit))
+         {
+            unsigned i;
+            uint16_t buttons = 0;
+
+            for (i = 0; i < RARCH_FIRST_CUSTOM_BIND; i++)
+               if (input_state_device(settings, port,
+                        RETRO_DEVICE_JOYPAD, 0, i))
+                  buttons |= (1 << i);
+
+            input_driver_snapshot.joypad[port]     = buttons;
+            input_driver_snapshot.joypad_captured |= port_bit;
+         }
+
+         return (input_driver_snapshot.joypad[port] >> id) & 1;
+      }
+
+      if (device == RETRO_DEVICE_ANALOG && idx < 2 && id < 2)
+      {
+         if (!(input_driver_snapshot.analog_captured & port_bit))
+         {
+            unsigned i;
+
+            for (i = 0; i < 4; i++)
+               input_driver_snapshot.analog[port][i] = input_state_device(
+                     settings, port, RETRO_DEVICE_ANALOG, i >> 1, i & 1);
+
+            input_driver_snapshot.analog_captured |= port_bit;
+         }
+
+         return input_driver_snapshot.analog[port][idx * 2 + id];
+      }
+   }
+
+   return input_state_device(settings, port, device, idx, id);
+}
+
+static int16_t input_state_internal(unsigned port, unsigned device,
+      unsigned idx, unsigned id)
+{
+   int16_t res          = 0;
+   settings_t *settings = NULL;
+
+   if (input_driver_flushing_input || input_driver_block_libretro_input)
+      return 0;
+
+   settings = config_get_ptr();
+   res      = input_state_snapshot(settings, port, device, idx, id);
+
+   /* Don't allow turbo for D-pad. */
+   if (device == RETRO_DEVICE_JOYPAD && (id < RETRO_DEVICE_ID_JOYPAD_UP ||
+            id > RETRO_DEVICE_ID_JOYPAD_RIGHT))
+   {
+      /*
+       * Apply turbo button if activated.
+       *
+       * If turbo button is held, all buttons pressed except
+       * for D-pad will go into a turbo mode. Until the button is
+       * released again, the input state will be modulated by a 
+       * periodic pulse defined by the configured duty cycle. 
+       */
+      if (res && input_driver_turbo_btns.frame_enable[port])
+         input_driver_turbo_btns.enable[port] |= (1 << id);
+      else if (!res)
+         input_driver_turbo_btns.enable[port] &= ~(1 << id);
+
+      if (input_driver_turbo_btns.enable[port] & (1 << id))
+      {
+         /* if turbo button is enabled for this key ID */
+         res = res && ((input_driver_turbo_btns.count 
+                  % settings->input.turbo_period)
+               < settings->input.turbo_duty_cycle);
+      }
+   }
+
+   return res;
+}
+
 /**
  * input_state:
  * @port                 : user number.
@@ -346,85 +509,7 @@ int16_t input_state(unsigned port, unsigned device,
       bsv_movie_ctl(BSV_MOVIE_CTL_SET_END, NULL);
    }
 
-   if (     !input_driver_flushing_input 
-         && !input_driver_block_libretro_input)
-   {
-      settings_t *settings = config_get_ptr();
-
-      if (settings->bools.input_remap_binds_enable)
-      {
-         switch (device)
-         {
-            case RETRO_DEVICE_JOYPAD:
-               if (id < RARCH_FIRST_CUSTOM_BIND)
-                  id = settings->input.remap_ids[port][id];
-               break;
-            case RETRO_DEVICE_ANALOG:
-               if (idx < 2 && id < 2)
-               {
-                  unsigned new_id = RARCH_FIRST_CUSTOM_BIND + (idx * 2 + id);
-
-                  new_id = settings->input.remap_ids[port][new_id];
-                  idx   = (new_id & 2) >> 1;
-                  id    = new_id & 1;
-               }
-               break;
-         }
-      }
-
-      if (((id < RARCH_FIRST_META_KEY) || (device == RETRO_DEVICE_KEYBOARD)))
-      {
-         bool bind_valid = libretro_input_binds[port] && libretro_input_binds[port][id].valid;
-
-         if (bind_valid || device == RETRO_DEVICE_KEYBOARD)
-         {
-            rarch_joypad_info_t joypad_info;
-
-            joypad_info.axis_threshold = settings->floats.input_axis_threshold;
-            joypad_info.joy_idx        = settings->input.joypad_map[port];
-            joypad_info.auto_binds     = input_autoconf_binds[joypad_info.joy_idx];
-
-            res = current_input->input_state(
-                  current_input_data, joypad_info, libretro_input_binds, port, device, idx, id);
-         }
-      }
-
-#ifdef HAVE_OVERLAY
-      if (overlay_ptr)
-         input_state_overlay(overlay_ptr, &res, port, device, idx, id);
-#endif
-
-#ifdef HAVE_NETWORKGAMEPAD
-      if (input_driver_remote)
-         input_remote_state(&res, port, device, idx, id);
-#endif
-
-      /* Don't allow turbo for D-pad. */
-      if (device == RETRO_DEVICE_JOYPAD && (id < RETRO_DEVICE_ID_JOYPAD_UP ||
-               id > RETRO_DEVICE_ID_JOYPAD_RIGHT))
-      {
-         /*
-          * Apply turbo button if activated.
-          *
-          * If turbo button is held, all buttons pressed except
-          * for D-pad will go into a turbo mode. Until the button is
-          * released again, the input state will be modulated by a 
-          * periodic pulse defined by the configured duty cycle. 
-          */
-         if (res && input_driver_turbo_btns.frame_enable[port])
-            input_driver_turbo_btns.enable[port] |= (1 << id);
-         else if (!res)
-            input_driver_turbo_btns.enable[port] &= ~(1 << id);
-
-         if (input_driver_turbo_btns.enable[port] & (1 << id))
-         {
-            /* if turbo button is enabled for this key ID */
-            res = res && ((input_driver_turbo_btns.count 
-                     % settings->input.turbo_period)
-                  < settings->input.turbo_duty_cycle);
-         }
-      }
-   }
+   res = input_state_internal(port, device, idx, id);
 
    if (bsv_movie_is_playback_off())
       bsv_movie_ctl(BSV_MOVIE_CTL_SET_INPUT, &res);
@@ -1008,6 +1093,9 @@ bool input_driver_has_capabilities(void)
 void input_driver_poll(void)
 {
    current_input->poll(current_input_data);
+
+   input_driver_snapshot.joypad_captured = 0;
+   input_driver_snapshot.analog_captured = 0;
 }
 
 bool input_driver_init(void)
@@ -1027,6 +1115,10 @@ void input_driver_deinit(void)
    if (current_input && current_input->free)
       current_input->free(current_input_data);
    current_input_data = NULL;
+
+   if (input_latency_is_enabled())
+      input_latency_report();
+   input_latency_reset();
 }
 
 void input_driver_destroy_data(void)
@@ -1102,6 +1194,22 @@ void input_driver_set_flushing_input(void)
    input_driver_flushing_input = true;
 }
 
+/* Has input_state() go through the driver on every call,
+ * so that the snapshot can be compared against it. */
+void input_driver_set_snapshot_bypass(void)
+{
+   input_driver_snapshot_disable         = true;
+   input_driver_snapshot.joypad_captured = 0;
+   input_driver_snapshot.analog_captured = 0;
+}
+
+void input_driver_unset_snapshot_bypass(void)
+{
+   input_driver_snapshot_disable         = false;
+   input_driver_snapshot.joypad_captured = 0;
+   input_driver_snapshot.analog_captured = 0;
+}
+
 void input_driver_unset_hotkey_block(void)
 {
    input_driver_block_hotkey = true;
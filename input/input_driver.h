@@ -300,6 +300,10 @@ bool input_driver_find_driver(void);
 
 void input_driver_set_flushing_input(void);
 
+void input_driver_set_snapshot_bypass(void);
+
+void input_driver_unset_snapshot_bypass(void);
+
 void input_driver_unset_hotkey_block(void);
 
 void input_driver_set_hotkey_block(void);
@@ -0,0 +1,172 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <compat/strl.h>
+#include <features/features_cpu.h>
+
+#include "input_latency.h"
+
+#include "../configuration.h"
+#include "../verbosity.h"
+
+/* Events applied in one frame beyond this many are not
+ * tracked to the present; the oldest ones are kept. */
+#define INPUT_LATENCY_PENDING_MAX 64
+
+typedef struct input_latency_histogram
+{
+   uint32_t buckets[INPUT_LATENCY_BUCKETS];
+   uint64_t count;
+   retro_time_t total;
+   retro_time_t max;
+} input_latency_histogram_t;
+
+static input_latency_histogram_t input_latency_core;
+static input_latency_histogram_t input_latency_present;
+static retro_time_t input_latency_pending[INPUT_LATENCY_PENDING_MAX];
+static unsigned input_latency_pending_count = 0;
+
+static void input_latency_add(input_latency_histogram_t *histogram,
+      retro_time_t age)
+{
+   retro_time_t bucket;
+
+   if (age < 0)
+      age = 0;
+
+   bucket = age / 1000;
+   if (bucket >= INPUT_LATENCY_BUCKETS)
+      bucket = INPUT_LATENCY_BUCKETS - 1;
+
+   histogram->buckets[bucket]++;
+   histogram->count++;
+   histogram->total += age;
+   if (age > histogram->max)
+      histogram->max = age;
+}
+
+/* Upper edge in milliseconds of the bucket holding the
+ * given percentile. */
+static unsigned input_latency_percentile(
+      const input_latency_histogram_t *histogram, unsigned percent)
+{
+   unsigned i;
+   uint64_t seen   = 0;
+   uint64_t target = (histogram->count * percent + 99) / 100;
+
+   for (i = 0; i < INPUT_LATENCY_BUCKETS; i++)
+   {
+      seen += histogram->buckets[i];
+      if (seen >= target)
+         return i + 1;
+   }
+
+   return INPUT_LATENCY_BUCKETS;
+}
+
+static void input_latency_log(const char *name,
+      const input_latency_histogram_t *histogram)
+{
+   unsigned i;
+   char buckets[1024];
+
+   if (!histogram->count)
+      return;
+
+   RARCH_LOG("[Input]: Latency %s: %llu events, mean %.2f ms, "
+         "p50 %u ms, p90 %u ms, p99 %u ms, max %.2f ms.\n",
+         name, (unsigned long long)histogram->count,
+         histogram->total / 1000.0 / histogram->count,
+         input_latency_percentile(histogram, 50),
+         input_latency_percentile(histogram, 90),
+         input_latency_percentile(histogram, 99),
+         histogram->max / 1000.0);
+
+   buckets[0] = '\0';
+
+   for (i = 0; i < INPUT_LATENCY_BUCKETS; i++)
+   {
+      char bucket[32];
+
+      if (!histogram->buckets[i])
+         continue;
+
+      snprintf(bucket, sizeof(bucket), " %s%u:%u",
+            i == INPUT_LATENCY_BUCKETS - 1 ? ">" : "<",
+            i == INPUT_LATENCY_BUCKETS - 1 ? i : i + 1,
+            (unsigned)histogram->buckets[i]);
+      strlcat(buckets, bucket, sizeof(buckets));
+   }
+
+   RARCH_LOG("[Input]: Latency %s histogram (ms:events):%s\n",
+         name, buckets);
+}
+
+bool input_latency_is_enabled(void)
+{
+   settings_t *settings = config_get_ptr();
+   return settings && settings->bools.input_latency_stats;
+}
+
+void input_latency_event(retro_time_t event_time)
+{
+   if (!input_latency_is_enabled())
+      return;
+
+   input_latency_add(&input_latency_core,
+         cpu_features_get_time_usec() - event_time);
+
+   if (input_latency_pending_count < INPUT_LATENCY_PENDING_MAX)
+      input_latency_pending[input_latency_pending_count++] = event_time;
+}
+
+void input_latency_frame_presented(void)
+{
+   unsigned i;
+   retro_time_t now;
+
+   if (!input_latency_pending_count)
+      return;
+
+   now = cpu_features_get_time_usec();
+
+   for (i = 0; i < input_latency_pending_count; i++)
+      input_latency_add(&input_latency_present,
+            now - input_latency_pending[i]);
+
+   input_latency_pending_count = 0;
+}
+
+/**
+ * input_latency_report:
+ *
+ * Logs the input-to-core and input-to-present latency
+ * histograms collected so far.
+ **/
+void input_latency_report(void)
+{
+   input_latency_log("input to core", &input_latency_core);
+   input_latency_log("input to present", &input_latency_present);
+}
+
+void input_latency_reset(void)
+{
+   memset(&input_latency_core, 0, sizeof(input_latency_core));
+   memset(&input_latency_present, 0, sizeof(input_latency_present));
+   input_latency_pending_count = 0;
+}
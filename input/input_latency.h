@@ -0,0 +1,60 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INPUT_LATENCY_H__
+#define INPUT_LATENCY_H__
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Histogram buckets are one millisecond wide,
+ * the last one holds everything slower. */
+#define INPUT_LATENCY_BUCKETS 64
+
+bool input_latency_is_enabled(void);
+
+/**
+ * input_latency_event:
+ * @event_time           : time the input event happened, on the
+ *                         cpu_features_get_time_usec() clock.
+ *
+ * Called by input drivers when they apply an input event during
+ * their poll. The age of the event at that point goes into the
+ * input-to-core histogram, and the event is held until the next
+ * presented frame for the input-to-present histogram.
+ **/
+void input_latency_event(retro_time_t event_time);
+
+/**
+ * input_latency_frame_presented:
+ *
+ * Called once the video driver has presented a frame. Ages every
+ * event applied since the last frame into the input-to-present
+ * histogram.
+ **/
+void input_latency_frame_presented(void);
+
+void input_latency_report(void);
+
+void input_latency_reset(void);
+
+RETRO_END_DECLS
+
+#endif
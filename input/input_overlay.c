@@ -20,6 +20,7 @@
 #include <math.h>
 
 #include <clamping.h>
+#include <retro_inline.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
@@ -65,8 +66,19 @@ struct input_overlay
 
    unsigned next_index;
    enum overlay_status state;
+
+   /* Descs pressed at this poll and at the previous one, so that
+    * only those need their hitbox and alpha restored afterwards. */
+   unsigned *pressed;
+   unsigned *was_pressed;
+   unsigned pressed_size;
+   unsigned was_pressed_size;
+   float opacity;
 };
 
+/* Upper bound on the columns and rows of an overlay's grid */
+#define OVERLAY_GRID_MAX 32
+
 input_overlay_t *overlay_ptr = NULL;
 
 /**
@@ -165,6 +177,12 @@ void input_overlay_free_overlay(struct overlay *overlay)
    if (overlay->load_images)
       free(overlay->load_images);
    overlay->load_images = NULL;
+   free(overlay->grid.cells);
+   free(overlay->grid.descs);
+   free(overlay->movable);
+   overlay->grid.cells  = NULL;
+   overlay->grid.descs  = NULL;
+   overlay->movable     = NULL;
    if (overlay->descs)
       free(overlay->descs);
    overlay->descs       = NULL;
@@ -256,6 +274,212 @@ static bool inside_hitbox(const struct overlay_desc *desc, float x, float y)
    return false;
 }
 
+/**
+ * input_overlay_desc_bounds:
+ * @desc                  : Overlay descriptor handle.
+ *
+ * Gets the box containing the hitbox of @desc, pressed or not.
+ **/
+static void input_overlay_desc_bounds(const struct overlay_desc *desc,
+      float *x0, float *y0, float *x1, float *y1)
+{
+   float mod = desc->range_mod > 1.0f ? desc->range_mod : 1.0f;
+   /* With some slack, so that rounding can't put a point that
+    * inside_hitbox() accepts outside the box */
+   float rx  = (float)fabs(desc->range_x * mod) * 1.001f + 0.0001f;
+   float ry  = (float)fabs(desc->range_y * mod) * 1.001f + 0.0001f;
+
+   *x0       = desc->x - rx;
+   *x1       = desc->x + rx;
+   *y0       = desc->y - ry;
+   *y1       = desc->y + ry;
+}
+
+static INLINE unsigned input_overlay_grid_cell(float v,
+      float origin, float size, unsigned cells)
+{
+   int cell = (int)((v - origin) / size * cells);
+
+   if (cell < 0)
+      return 0;
+   if (cell >= (int)cells)
+      return cells - 1;
+   return (unsigned)cell;
+}
+
+bool input_overlay_build_index(struct overlay *ol)
+{
+   size_t i;
+   unsigned side, cell, total;
+   unsigned *fill  = NULL;
+   float x0        = 0.0f;
+   float y0        = 0.0f;
+   float x1        = 0.0f;
+   float y1        = 0.0f;
+
+   if (!ol)
+      return false;
+
+   free(ol->grid.cells);
+   free(ol->grid.descs);
+   free(ol->movable);
+   memset(&ol->grid, 0, sizeof(ol->grid));
+   ol->movable      = NULL;
+   ol->movable_size = 0;
+
+   if (!ol->size)
+      return true;
+
+   ol->movable = (unsigned*)malloc(ol->size * sizeof(*ol->movable));
+   if (!ol->movable)
+      return false;
+
+   for (i = 0; i < ol->size; i++)
+   {
+      float dx0, dy0, dx1, dy1;
+      const struct overlay_desc *desc = &ol->descs[i];
+
+      if (desc->movable)
+         ol->movable[ol->movable_size++] = (unsigned)i;
+
+      input_overlay_desc_bounds(desc, &dx0, &dy0, &dx1, &dy1);
+
+      if (i == 0 || dx0 < x0)
+         x0 = dx0;
+      if (i == 0 || dy0 < y0)
+         y0 = dy0;
+      if (i == 0 || dx1 > x1)
+         x1 = dx1;
+      if (i == 0 || dy1 > y1)
+         y1 = dy1;
+   }
+
+   /* About one desc per cell */
+   side = (unsigned)ceil(sqrt((double)ol->size));
+   if (side > OVERLAY_GRID_MAX)
+      side = OVERLAY_GRID_MAX;
+
+   ol->grid.x     = x0;
+   ol->grid.y     = y0;
+   ol->grid.w     = x1 - x0;
+   ol->grid.h     = y1 - y0;
+   ol->grid.cols  = side;
+   ol->grid.rows  = side;
+   ol->grid.cells = (unsigned*)calloc(side * side + 1, sizeof(unsigned));
+   fill           = (unsigned*)malloc(side * side * sizeof(unsigned));
+
+   if (!ol->grid.cells || !fill)
+      goto error;
+
+   /* Count the descs of each cell, then place them in desc order,
+    * which is the order they are polled in. */
+   for (i = 0; i < ol->size; i++)
+   {
+      unsigned cx, cy;
+      float dx0, dy0, dx1, dy1;
+      input_overlay_desc_bounds(&ol->descs[i], &dx0, &dy0, &dx1, &dy1);
+
+      for (cy = input_overlay_grid_cell(dy0, y0, ol->grid.h, side);
+            cy <= input_overlay_grid_cell(dy1, y0, ol->grid.h, side); cy++)
+         for (cx = input_overlay_grid_cell(dx0, x0, ol->grid.w, side);
+               cx <= input_overlay_grid_cell(dx1, x0, ol->grid.w, side); cx++)
+            ol->grid.cells[cy * side + cx + 1]++;
+   }
+
+   for (cell = 0; cell < side * side; cell++)
+   {
+      fill[cell]                 = ol->grid.cells[cell];
+      ol->grid.cells[cell + 1]  += ol->grid.cells[cell];
+   }
+
+   total          = ol->grid.cells[side * side];
+   ol->grid.descs = (unsigned*)malloc((total ? total : 1) * sizeof(unsigned));
+
+   if (!ol->grid.descs)
+      goto error;
+
+   for (i = 0; i < ol->size; i++)
+   {
+      unsigned cx, cy;
+      float dx0, dy0, dx1, dy1;
+      input_overlay_desc_bounds(&ol->descs[i], &dx0, &dy0, &dx1, &dy1);
+
+      for (cy = input_overlay_grid_cell(dy0, y0, ol->grid.h, side);
+            cy <= input_overlay_grid_cell(dy1, y0, ol->grid.h, side); cy++)
+         for (cx = input_overlay_grid_cell(dx0, x0, ol->grid.w, side);
+               cx <= input_overlay_grid_cell(dx1, x0, ol->grid.w, side); cx++)
+            ol->grid.descs[fill[cy * side + cx]++] = (unsigned)i;
+   }
+
+   free(fill);
+   return true;
+
+error:
+   free(fill);
+   free(ol->grid.cells);
+   free(ol->grid.descs);
+   memset(&ol->grid, 0, sizeof(ol->grid));
+   return false;
+}
+
+static void input_overlay_poll_desc(input_overlay_t *ol,
+      input_overlay_state_t *out, unsigned idx, float x, float y)
+{
+   float x_dist, y_dist;
+   struct overlay_desc *desc = &ol->active->descs[idx];
+
+   if (!inside_hitbox(desc, x, y))
+      return;
+
+   if (!desc->updated)
+   {
+      desc->updated                   = true;
+      ol->pressed[ol->pressed_size++] = idx;
+   }
+
+   x_dist        = x - desc->x;
+   y_dist        = y - desc->y;
+
+   switch (desc->type)
+   {
+      case OVERLAY_TYPE_BUTTONS:
+         {
+            uint64_t mask = desc->key_mask;
+
+            out->buttons |= mask;
+
+            if (mask & (UINT64_C(1) << RARCH_OVERLAY_NEXT))
+               ol->next_index = desc->next_index;
+         }
+         break;
+      case OVERLAY_TYPE_KEYBOARD:
+         if (desc->key_mask < RETROK_LAST)
+            OVERLAY_SET_KEY(out, desc->key_mask);
+         break;
+      default:
+         {
+            float x_val       = x_dist / desc->range_x;
+            float y_val       = y_dist / desc->range_y;
+            float x_val_sat   = x_val / desc->analog_saturate_pct;
+            float y_val_sat   = y_val / desc->analog_saturate_pct;
+
+            unsigned int base = (desc->type == OVERLAY_TYPE_ANALOG_RIGHT) ? 2 : 0;
+
+            out->analog[base + 0] = clamp_float(x_val_sat, -1.0f, 1.0f) * 32767.0f;
+            out->analog[base + 1] = clamp_float(y_val_sat, -1.0f, 1.0f) * 32767.0f;
+         }
+         break;
+   }
+
+   if (desc->movable)
+   {
+      desc->delta_x = clamp_float(x_dist, -desc->range_x, desc->range_x)
+         * ol->active->mod_w;
+      desc->delta_y = clamp_float(y_dist, -desc->range_y, desc->range_y)
+         * ol->active->mod_h;
+   }
+}
+
 /**
  * input_overlay_poll:
  * @out                   : Polled output data.
@@ -273,68 +497,40 @@ static void input_overlay_poll(
       int16_t norm_x, int16_t norm_y)
 {
    size_t i;
+   const struct overlay *active = ol->active;
 
    /* norm_x and norm_y is in [-0x7fff, 0x7fff] range,
     * like RETRO_DEVICE_POINTER. */
    float x = (float)(norm_x + 0x7fff) / 0xffff;
    float y = (float)(norm_y + 0x7fff) / 0xffff;
 
-   x -= ol->active->mod_x;
-   y -= ol->active->mod_y;
-   x /= ol->active->mod_w;
-   y /= ol->active->mod_h;
+   x -= active->mod_x;
+   y -= active->mod_y;
+   x /= active->mod_w;
+   y /= active->mod_h;
 
-   for (i = 0; i < ol->active->size; i++)
+   if (active->grid.cells)
    {
-      float x_dist, y_dist;
-      struct overlay_desc *desc = &ol->active->descs[i];
-
-      if (!inside_hitbox(desc, x, y))
-         continue;
-
-      desc->updated = true;
-      x_dist        = x - desc->x;
-      y_dist        = y - desc->y;
-
-      switch (desc->type)
-      {
-         case OVERLAY_TYPE_BUTTONS:
-            {
-               uint64_t mask = desc->key_mask;
-
-               out->buttons |= mask;
-
-               if (mask & (UINT64_C(1) << RARCH_OVERLAY_NEXT))
-                  ol->next_index = desc->next_index;
-            }
-            break;
-         case OVERLAY_TYPE_KEYBOARD:
-            if (desc->key_mask < RETROK_LAST)
-               OVERLAY_SET_KEY(out, desc->key_mask);
-            break;
-         default:
-            {
-               float x_val       = x_dist / desc->range_x;
-               float y_val       = y_dist / desc->range_y;
-               float x_val_sat   = x_val / desc->analog_saturate_pct;
-               float y_val_sat   = y_val / desc->analog_saturate_pct;
-
-               unsigned int base = (desc->type == OVERLAY_TYPE_ANALOG_RIGHT) ? 2 : 0;
-
-               out->analog[base + 0] = clamp_float(x_val_sat, -1.0f, 1.0f) * 32767.0f;
-               out->analog[base + 1] = clamp_float(y_val_sat, -1.0f, 1.0f) * 32767.0f;
-            }
-            break;
-      }
-
-      if (desc->movable)
+      /* Outside the grid is outside every hitbox */
+      if (     x >= active->grid.x && x <= active->grid.x + active->grid.w
+            && y >= active->grid.y && y <= active->grid.y + active->grid.h)
       {
-         desc->delta_x = clamp_float(x_dist, -desc->range_x, desc->range_x)
-            * ol->active->mod_w;
-         desc->delta_y = clamp_float(y_dist, -desc->range_y, desc->range_y)
-            * ol->active->mod_h;
+         unsigned cell =
+              input_overlay_grid_cell(y, active->grid.y,
+                  active->grid.h, active->grid.rows) * active->grid.cols
+            + input_overlay_grid_cell(x, active->grid.x,
+                  active->grid.w, active->grid.cols);
+
+         for (i = active->grid.cells[cell];
+               i < active->grid.cells[cell + 1]; i++)
+            input_overlay_poll_desc(ol, out, active->grid.descs[i], x, y);
       }
    }
+   else
+   {
+      for (i = 0; i < active->size; i++)
+         input_overlay_poll_desc(ol, out, (unsigned)i, x, y);
+   }
 
    if (!out->buttons)
       ol->blocked = false;
@@ -366,43 +562,101 @@ static void input_overlay_update_desc_geom(input_overlay_t *ol,
    desc->delta_y = 0.0f;
 }
 
+/**
+ * input_overlay_release_desc:
+ * @ol                    : overlay handle.
+ * @idx                   : index of a desc of the active overlay.
+ *
+ * Restores the hitbox and alpha of a desc that is no longer pressed.
+ **/
+static void input_overlay_release_desc(input_overlay_t *ol, unsigned idx)
+{
+   struct overlay_desc *desc = &ol->active->descs[idx];
+
+   desc->range_x_mod = desc->range_x;
+   desc->range_y_mod = desc->range_y;
+
+   if (desc->image.pixels && ol->iface->set_alpha)
+      ol->iface->set_alpha(ol->iface_data, desc->image_index, ol->opacity);
+}
+
 /**
  * input_overlay_post_poll:
  *
  * Called after all the input_overlay_poll() calls to
  * update the range modifiers for pressed/unpressed regions
  * and alpha mods.
+ *
+ * Only the descs pressed at this poll or at the previous one
+ * are touched, the others are already in their resting state.
  **/
 static void input_overlay_post_poll(input_overlay_t *ol, float opacity)
 {
-   size_t i;
+   unsigned i;
+   unsigned *swap;
 
-   input_overlay_set_alpha_mod(ol, opacity);
+   if (opacity != ol->opacity)
+      input_overlay_set_alpha_mod(ol, opacity);
 
-   for (i = 0; i < ol->active->size; i++)
+   for (i = 0; i < ol->was_pressed_size; i++)
    {
-      struct overlay_desc *desc = &ol->active->descs[i];
+      unsigned idx = ol->was_pressed[i];
 
-      desc->range_x_mod = desc->range_x;
-      desc->range_y_mod = desc->range_y;
+      if (!ol->active->descs[idx].updated)
+         input_overlay_release_desc(ol, idx);
+   }
 
-      if (desc->updated)
-      {
-         /* If pressed this frame, change the hitbox. */
-         desc->range_x_mod *= desc->range_mod;
-         desc->range_y_mod *= desc->range_mod;
+   for (i = 0; i < ol->pressed_size; i++)
+   {
+      struct overlay_desc *desc = &ol->active->descs[ol->pressed[i]];
 
-         if (desc->image.pixels)
-         {
-            if (ol->iface->set_alpha)
-               ol->iface->set_alpha(ol->iface_data, desc->image_index,
-                     desc->alpha_mod * opacity);
-         }
+      /* If pressed this frame, change the hitbox. */
+      desc->range_x_mod = desc->range_x * desc->range_mod;
+      desc->range_y_mod = desc->range_y * desc->range_mod;
+
+      if (desc->image.pixels)
+      {
+         if (ol->iface->set_alpha)
+            ol->iface->set_alpha(ol->iface_data, desc->image_index,
+                  desc->alpha_mod * opacity);
       }
 
-      input_overlay_update_desc_geom(ol, desc);
       desc->updated = false;
    }
+
+   for (i = 0; i < ol->active->movable_size; i++)
+      input_overlay_update_desc_geom(ol,
+            &ol->active->descs[ol->active->movable[i]]);
+
+   swap                 = ol->was_pressed;
+   ol->was_pressed      = ol->pressed;
+   ol->was_pressed_size = ol->pressed_size;
+   ol->pressed          = swap;
+   ol->pressed_size     = 0;
+}
+
+/**
+ * input_overlay_release_all:
+ * @ol                    : overlay handle
+ *
+ * Puts every desc of the active overlay that was pressed
+ * back into its resting state.
+ **/
+static void input_overlay_release_all(input_overlay_t *ol)
+{
+   unsigned i;
+
+   for (i = 0; i < ol->was_pressed_size; i++)
+      input_overlay_release_desc(ol, ol->was_pressed[i]);
+
+   for (i = 0; i < ol->pressed_size; i++)
+   {
+      ol->active->descs[ol->pressed[i]].updated = false;
+      input_overlay_release_desc(ol, ol->pressed[i]);
+   }
+
+   ol->was_pressed_size = 0;
+   ol->pressed_size     = 0;
 }
 
 /**
@@ -414,19 +668,18 @@ static void input_overlay_post_poll(input_overlay_t *ol, float opacity)
  **/
 static void input_overlay_poll_clear(input_overlay_t *ol, float opacity)
 {
-   size_t i;
+   unsigned i;
 
    ol->blocked = false;
 
-   input_overlay_set_alpha_mod(ol, opacity);
+   if (opacity != ol->opacity)
+      input_overlay_set_alpha_mod(ol, opacity);
 
-   for (i = 0; i < ol->active->size; i++)
-   {
-      struct overlay_desc *desc = &ol->active->descs[i];
+   input_overlay_release_all(ol);
 
-      desc->range_x_mod = desc->range_x;
-      desc->range_y_mod = desc->range_y;
-      desc->updated     = false;
+   for (i = 0; i < ol->active->movable_size; i++)
+   {
+      struct overlay_desc *desc = &ol->active->descs[ol->active->movable[i]];
 
       desc->delta_x     = 0.0f;
       desc->delta_y     = 0.0f;
@@ -446,6 +699,8 @@ void input_overlay_next(input_overlay_t *ol, float opacity)
    if (!ol)
       return;
 
+   input_overlay_release_all(ol);
+
    ol->index      = ol->next_index;
    ol->active     = &ol->overlays[ol->index];
 
@@ -472,6 +727,8 @@ void input_overlay_free(input_overlay_t *ol)
    if (ol->iface->enable)
       ol->iface->enable(ol->iface_data, false);
 
+   free(ol->pressed);
+   free(ol->was_pressed);
    free(ol);
 }
 
@@ -479,6 +736,7 @@ void input_overlay_free(input_overlay_t *ol)
 void input_overlay_loaded(void *task_data, void *user_data, const char *err)
 {
    size_t i;
+   size_t max_descs                      = 1;
    overlay_task_data_t              *data = (overlay_task_data_t*)task_data;
    input_overlay_t                    *ol = NULL;
    const video_overlay_interface_t *iface = NULL;
@@ -501,7 +759,24 @@ void input_overlay_loaded(void *task_data, void *user_data, const char *err)
       goto abort_load;
    }
 
+   for (i = 0; i < data->size; i++)
+      if (data->overlays[i].size > max_descs)
+         max_descs = data->overlays[i].size;
+
    ol             = (input_overlay_t*)calloc(1, sizeof(*ol));
+   if (!ol)
+      goto abort_load;
+
+   ol->pressed     = (unsigned*)malloc(max_descs * sizeof(unsigned));
+   ol->was_pressed = (unsigned*)malloc(max_descs * sizeof(unsigned));
+   if (!ol->pressed || !ol->was_pressed)
+   {
+      free(ol->pressed);
+      free(ol->was_pressed);
+      free(ol);
+      goto abort_load;
+   }
+
    ol->overlays   = data->overlays;
    ol->size       = data->size;
    ol->active     = data->active;
@@ -543,6 +818,8 @@ void input_overlay_set_alpha_mod(input_overlay_t *ol, float mod)
    if (!ol)
       return;
 
+   ol->opacity = mod;
+
    for (i = 0; i < ol->active->load_images_size; i++)
       ol->iface->set_alpha(ol->iface_data, i, mod);
 }
@@ -145,6 +145,21 @@ struct overlay
 
    struct texture_image *load_images;
    unsigned load_images_size;
+
+   /* Buckets the descs by the grid cells their hitboxes overlap,
+    * so that a pointer is only tested against the descs of its
+    * cell. Built by input_overlay_build_index(). */
+   struct
+   {
+      float x, y, w, h;
+      unsigned cols, rows;
+      unsigned *cells;     /* cols * rows + 1 offsets into descs */
+      unsigned *descs;
+   } grid;
+
+   /* Descs that can move, and need their geometry updated */
+   unsigned *movable;
+   unsigned movable_size;
 };
 
 struct overlay_desc
@@ -247,6 +262,17 @@ bool input_overlay_key_pressed(input_overlay_t *ol, int key);
 
 bool input_overlay_is_alive(input_overlay_t *ol);
 
+/**
+ * input_overlay_build_index:
+ * @ol                    : Overlay, with all its descs loaded.
+ *
+ * Builds the hit-testing grid and the list of movable descs
+ * of an overlay.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool input_overlay_build_index(struct overlay *ol);
+
 void input_overlay_loaded(void *task_data, void *user_data, const char *err);
 
 /* FIXME - temporary. Globals are bad */
@@ -2354,6 +2354,8 @@ MSG_HASH(MSG_WIFI_SCAN_COMPLETE,
       "Wi-Fi scan complete.")
 MSG_HASH(MSG_SCANNING_WIRELESS_NETWORKS,
       "Scanning wireless networks...")
+MSG_HASH(MSG_READING_DIRECTORY,
+      "Reading directory...")
 MSG_HASH(MSG_NETPLAY_LAN_SCAN_COMPLETE,
       "Netplay scan complete.")
 MSG_HASH(MSG_NETPLAY_LAN_SCANNING,
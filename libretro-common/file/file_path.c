@@ -28,6 +28,10 @@
 
 #include <sys/stat.h>
 
+#if defined(_WIN32) && !defined(_XBOX) && !defined(__WINRT__)
+#include <windows.h>
+#endif
+
 #include <file/file_path.h>
 
 #ifndef __MACH__
@@ -197,6 +201,33 @@ bool path_file_exists(const char *path)
    return true;
 }
 
+/**
+ * path_replace_file:
+ * @src                : path of the new file
+ * @dst                : path of the file to replace
+ *
+ * Moves @src over @dst, replacing @dst if it exists.
+ * Where the platform allows it, @dst is never missing
+ * while this happens.
+ *
+ * Returns: true (1) if @src was moved, otherwise false (0).
+ */
+bool path_replace_file(const char *src, const char *dst)
+{
+#if defined(_WIN32) && !defined(_XBOX) && !defined(__WINRT__)
+   /* rename() does not replace existing files here, and
+    * removing @dst first would leave a window where
+    * neither file exists */
+   return MoveFileExA(src, dst,
+         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+#ifdef _WIN32
+   remove(dst);
+#endif
+   return rename(src, dst) == 0;
+#endif
+}
+
 /**
  * fill_pathname:
  * @out_path           : output path
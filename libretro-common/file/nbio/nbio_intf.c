@@ -0,0 +1,176 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (nbio_intf.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <file/nbio.h>
+
+/* Same test as in nbio_unix.c */
+#if !defined(_WIN32) && (defined(__linux__) || defined(HAVE_MMAP))
+#define HAVE_NBIO_UNIX
+#endif
+
+struct nbio_t
+{
+   const nbio_intf_t *intf;
+   void *handle;
+};
+
+extern nbio_intf_t nbio_stdio;
+#if defined(HAVE_NBIO_UNIX) && defined(HAVE_IO_URING)
+extern nbio_intf_t nbio_uring;
+#endif
+#if defined(HAVE_NBIO_UNIX) && defined(HAVE_THREADS)
+extern nbio_intf_t nbio_pool;
+#endif
+
+/* In order of preference */
+static const nbio_intf_t *nbio_backends[] = {
+#if defined(HAVE_NBIO_UNIX) && defined(HAVE_IO_URING)
+   &nbio_uring,
+#endif
+#if defined(HAVE_NBIO_UNIX) && defined(HAVE_THREADS)
+   &nbio_pool,
+#endif
+   &nbio_stdio,
+   NULL
+};
+
+static const nbio_intf_t *nbio_forced = NULL;
+
+static const nbio_intf_t *nbio_find_backend(void)
+{
+   unsigned i;
+
+   if (nbio_forced)
+      return nbio_forced;
+
+   /* Backends remember whether they could be set up */
+   for (i = 0; nbio_backends[i]; i++)
+      if (nbio_backends[i]->init())
+         return nbio_backends[i];
+
+   return &nbio_stdio;
+}
+
+bool nbio_set_backend(const char *ident)
+{
+   unsigned i;
+
+   if (!ident)
+   {
+      nbio_forced = NULL;
+      return true;
+   }
+
+   for (i = 0; nbio_backends[i]; i++)
+   {
+      if (strcmp(nbio_backends[i]->ident, ident))
+         continue;
+      if (!nbio_backends[i]->init())
+         return false;
+      nbio_forced = nbio_backends[i];
+      return true;
+   }
+
+   return false;
+}
+
+const char *nbio_get_backend(void)
+{
+   return nbio_find_backend()->ident;
+}
+
+struct nbio_t* nbio_open(const char * filename, unsigned mode)
+{
+   struct nbio_t *nbio      = NULL;
+   const nbio_intf_t *intf  = nbio_find_backend();
+   void *handle             = intf->open(filename, mode);
+
+   if (!handle)
+      return NULL;
+
+   nbio = (struct nbio_t*)malloc(sizeof(*nbio));
+
+   if (!nbio)
+   {
+      intf->free(handle);
+      return NULL;
+   }
+
+   nbio->intf   = intf;
+   nbio->handle = handle;
+
+   return nbio;
+}
+
+void nbio_begin_read(struct nbio_t* handle)
+{
+   if (handle)
+      handle->intf->begin_read(handle->handle);
+}
+
+void nbio_begin_write(struct nbio_t* handle)
+{
+   if (handle)
+      handle->intf->begin_write(handle->handle);
+}
+
+bool nbio_iterate(struct nbio_t* handle)
+{
+   if (!handle)
+      return false;
+   return handle->intf->iterate(handle->handle);
+}
+
+void nbio_resize(struct nbio_t* handle, size_t len)
+{
+   if (handle)
+      handle->intf->resize(handle->handle, len);
+}
+
+void* nbio_get_ptr(struct nbio_t* handle, size_t* len)
+{
+   if (!handle)
+      return NULL;
+   return handle->intf->get_ptr(handle->handle, len);
+}
+
+void nbio_cancel(struct nbio_t* handle)
+{
+   if (handle)
+      handle->intf->cancel(handle->handle);
+}
+
+void nbio_free(struct nbio_t* handle)
+{
+   if (!handle)
+      return;
+
+   handle->intf->free(handle->handle);
+   free(handle);
+}
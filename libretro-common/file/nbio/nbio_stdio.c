@@ -3,7 +3,7 @@
 
 #include <file/nbio.h>
 
-struct nbio_t
+struct nbio_stdio_t
 {
    FILE* f;
    void* data;
@@ -21,16 +21,27 @@ struct nbio_t
 
 static const char * modes[]={ "rb", "wb", "r+b", "rb", "wb", "r+b" };
 
-struct nbio_t* nbio_open(const char * filename, unsigned mode)
+static bool nbio_stdio_init(void)
 {
-   void *buf             = NULL;
-   struct nbio_t* handle = NULL;
-   size_t len            = 0;
-   FILE* f               = fopen(filename, modes[mode]);
+   return true;
+}
+
+static void *nbio_stdio_open(const char * filename, unsigned mode)
+{
+   void *buf                   = NULL;
+   struct nbio_stdio_t* handle = NULL;
+   size_t len                  = 0;
+   FILE* f                     = NULL;
+
+   /* Nothing to map here, it is read like any other */
+   if (mode == NBIO_READ_MAPPED)
+      mode                     = NBIO_READ;
+
+   f                           = fopen(filename, modes[mode]);
    if (!f)
       return NULL;
 
-   handle                = (struct nbio_t*)malloc(sizeof(struct nbio_t));
+   handle                = (struct nbio_stdio_t*)malloc(sizeof(struct nbio_stdio_t));
 
    if (!handle)
       goto error;
@@ -53,7 +64,8 @@ struct nbio_t* nbio_open(const char * filename, unsigned mode)
    if (len)
       buf                = malloc(len);
 
-   if (!buf)
+   /* Files to write start out empty, until resized */
+   if (!buf && (len || (mode != NBIO_WRITE && mode != BIO_WRITE)))
       goto error;
 
    handle->data          = buf;
@@ -70,8 +82,10 @@ error:
    return NULL;
 }
 
-void nbio_begin_read(struct nbio_t* handle)
+static void nbio_stdio_begin_read(void *data)
 {
+   struct nbio_stdio_t *handle = (struct nbio_stdio_t*)data;
+
    if (!handle)
       return;
 
@@ -87,8 +101,10 @@ void nbio_begin_read(struct nbio_t* handle)
    handle->progress = 0;
 }
 
-void nbio_begin_write(struct nbio_t* handle)
+static void nbio_stdio_begin_write(void *data)
 {
+   struct nbio_stdio_t *handle = (struct nbio_stdio_t*)data;
+
    if (!handle)
       return;
 
@@ -103,9 +119,10 @@ void nbio_begin_write(struct nbio_t* handle)
    handle->progress = 0;
 }
 
-bool nbio_iterate(struct nbio_t* handle)
+static bool nbio_stdio_iterate(void *data)
 {
-   size_t amount = 65536;
+   size_t amount               = 65536;
+   struct nbio_stdio_t *handle = (struct nbio_stdio_t*)data;
 
    if (!handle)
       return false;
@@ -145,8 +162,10 @@ bool nbio_iterate(struct nbio_t* handle)
    return (handle->op < 0);
 }
 
-void nbio_resize(struct nbio_t* handle, size_t len)
+static void nbio_stdio_resize(void *data, size_t len)
 {
+   struct nbio_stdio_t *handle = (struct nbio_stdio_t*)data;
+
    if (!handle)
       return;
 
@@ -167,8 +186,10 @@ void nbio_resize(struct nbio_t* handle, size_t len)
    handle->progress = handle->len;
 }
 
-void* nbio_get_ptr(struct nbio_t* handle, size_t* len)
+static void *nbio_stdio_get_ptr(void *data, size_t* len)
 {
+   struct nbio_stdio_t *handle = (struct nbio_stdio_t*)data;
+
    if (!handle)
       return NULL;
    if (len)
@@ -178,8 +199,10 @@ void* nbio_get_ptr(struct nbio_t* handle, size_t* len)
    return NULL;
 }
 
-void nbio_cancel(struct nbio_t* handle)
+static void nbio_stdio_cancel(void *data)
 {
+   struct nbio_stdio_t *handle = (struct nbio_stdio_t*)data;
+
    if (!handle)
       return;
 
@@ -187,8 +210,10 @@ void nbio_cancel(struct nbio_t* handle)
    handle->progress = handle->len;
 }
 
-void nbio_free(struct nbio_t* handle)
+static void nbio_stdio_free(void *data)
 {
+   struct nbio_stdio_t *handle = (struct nbio_stdio_t*)data;
+
    if (!handle)
       return;
    if (handle->op >= 0)
@@ -203,3 +228,16 @@ void nbio_free(struct nbio_t* handle)
    handle->data = NULL;
    free(handle);
 }
+
+nbio_intf_t nbio_stdio = {
+   nbio_stdio_init,
+   nbio_stdio_open,
+   nbio_stdio_begin_read,
+   nbio_stdio_begin_write,
+   nbio_stdio_iterate,
+   nbio_stdio_resize,
+   nbio_stdio_get_ptr,
+   nbio_stdio_cancel,
+   nbio_stdio_free,
+   "stdio",
+};
@@ -0,0 +1,875 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (nbio_unix.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* nbio backends that really transfer in the background: io_uring where
+ * the kernel has it, otherwise a few threads doing blocking reads and
+ * writes. Both share the handle logic below; files are transferred in
+ * chunks, several at a time, and each call to nbio_iterate() collects
+ * the chunks of every handle that are done. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/* Needs POSIX file descriptors, pread/pwrite and mmap. Consoles that
+ * have threads but not those are left with the stdio backend.
+ * Keep in sync with nbio_intf.c. */
+#if !defined(_WIN32) && (defined(__linux__) || defined(HAVE_MMAP))
+#define HAVE_NBIO_UNIX
+#endif
+
+#if defined(HAVE_NBIO_UNIX) && (defined(HAVE_IO_URING) || defined(HAVE_THREADS))
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#ifdef HAVE_IO_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include <file/nbio.h>
+
+/* Size of each transfer, and how many a handle has going at once */
+#define NBIO_UNIX_CHUNK        (1 << 20)
+#define NBIO_UNIX_MAX_INFLIGHT 4
+
+#define NBIO_UNIX_RING_ENTRIES 64
+#define NBIO_UNIX_WORKERS      4
+
+enum nbio_unix_req_state
+{
+   NBIO_UNIX_REQ_FREE = 0,
+   /* What's left of a short transfer, to be queued again */
+   NBIO_UNIX_REQ_PENDING,
+   NBIO_UNIX_REQ_QUEUED
+};
+
+struct nbio_unix_t;
+
+struct nbio_unix_req
+{
+   struct nbio_unix_t *handle;
+   struct nbio_unix_req *next;
+   size_t offset;
+   size_t size;
+   enum nbio_unix_req_state state;
+};
+
+struct nbio_unix_t
+{
+   const struct nbio_unix_engine *engine;
+   int fd;
+   void *data;
+   size_t len;
+   size_t submitted;
+   size_t completed;
+   unsigned inflight;
+   /* As in nbio_stdio.c */
+   signed char op;
+   signed char mode;
+   bool mapped;
+   bool error;
+   struct nbio_unix_req reqs[NBIO_UNIX_MAX_INFLIGHT];
+};
+
+typedef struct nbio_unix_engine
+{
+   bool (*setup)(void);
+   /* Takes a request, or returns false if it can't take more for now */
+   bool (*queue)(struct nbio_unix_req *req);
+   /* Starts the queued requests and collects the finished ones,
+    * waiting for at least one if wait is set */
+   void (*flush)(bool wait);
+   /* Drops the queued requests of a handle that haven't started */
+   void (*unqueue)(struct nbio_unix_t *handle);
+   int state;
+} nbio_unix_engine_t;
+
+#ifdef HAVE_THREADS
+static slock_t *nbio_unix_lock       = NULL;
+static scond_t *nbio_unix_done       = NULL;
+
+#define NBIO_UNIX_LOCK()   slock_lock(nbio_unix_lock)
+#define NBIO_UNIX_UNLOCK() slock_unlock(nbio_unix_lock)
+#else
+#define NBIO_UNIX_LOCK()
+#define NBIO_UNIX_UNLOCK()
+#endif
+
+static bool nbio_unix_engine_init(nbio_unix_engine_t *engine)
+{
+   bool ret;
+
+#ifdef HAVE_THREADS
+   /* Only the first backend lookup gets here without the lock
+    * existing; see nbio_get_backend() on why that can't race */
+   if (!nbio_unix_lock)
+      nbio_unix_lock = slock_new();
+   if (!nbio_unix_done)
+      nbio_unix_done = scond_new();
+   if (!nbio_unix_lock || !nbio_unix_done)
+      return false;
+#endif
+
+   NBIO_UNIX_LOCK();
+   if (!engine->state)
+      engine->state = engine->setup() ? 1 : -1;
+   ret = engine->state > 0;
+   NBIO_UNIX_UNLOCK();
+
+   return ret;
+}
+
+/* Called with the lock held */
+static void nbio_unix_complete(struct nbio_unix_req *req, ssize_t res)
+{
+   struct nbio_unix_t *handle = req->handle;
+
+   handle->inflight--;
+   req->state = NBIO_UNIX_REQ_FREE;
+
+   if (res <= 0)
+   {
+      /* Nothing transferred is the file being shorter than it was */
+      handle->error = true;
+      return;
+   }
+
+   handle->completed += res;
+
+   if ((size_t)res < req->size)
+   {
+      req->offset += res;
+      req->size   -= res;
+      req->state   = NBIO_UNIX_REQ_PENDING;
+   }
+}
+
+#if defined(HAVE_IO_URING) && defined(IORING_FEAT_RW_CUR_POS)
+/* Plain IORING_OP_READ/WRITE, so Linux 5.6 or later */
+static struct
+{
+   int fd;
+   unsigned entries;
+   unsigned to_submit;
+   unsigned *sq_head;
+   unsigned *sq_tail;
+   unsigned *sq_mask;
+   unsigned *sq_array;
+   unsigned *cq_head;
+   unsigned *cq_tail;
+   unsigned *cq_mask;
+   struct io_uring_sqe *sqes;
+   struct io_uring_cqe *cqes;
+   void *sq_ring;
+   void *cq_ring;
+   size_t sq_ring_size;
+   size_t cq_ring_size;
+   size_t sqes_size;
+} nbio_ring;
+
+static bool nbio_uring_setup(void)
+{
+   struct io_uring_params p;
+   char *sq_ring = NULL;
+   char *cq_ring = NULL;
+
+   memset(&p, 0, sizeof(p));
+
+   nbio_ring.fd = (int)syscall(__NR_io_uring_setup,
+         NBIO_UNIX_RING_ENTRIES, &p);
+
+   if (nbio_ring.fd < 0)
+      return false;
+
+   if (!(p.features & IORING_FEAT_RW_CUR_POS))
+      goto error;
+
+   nbio_ring.entries      = p.sq_entries;
+   nbio_ring.sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+   nbio_ring.cq_ring_size = p.cq_off.cqes
+      + p.cq_entries * sizeof(struct io_uring_cqe);
+   nbio_ring.sqes_size    = p.sq_entries * sizeof(struct io_uring_sqe);
+
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+   {
+      if (nbio_ring.cq_ring_size > nbio_ring.sq_ring_size)
+         nbio_ring.sq_ring_size = nbio_ring.cq_ring_size;
+      nbio_ring.cq_ring_size    = 0;
+   }
+
+   nbio_ring.sq_ring = mmap(NULL, nbio_ring.sq_ring_size,
+         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+         nbio_ring.fd, IORING_OFF_SQ_RING);
+
+   if (nbio_ring.sq_ring == MAP_FAILED)
+      goto error;
+
+   if (nbio_ring.cq_ring_size)
+   {
+      nbio_ring.cq_ring = mmap(NULL, nbio_ring.cq_ring_size,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            nbio_ring.fd, IORING_OFF_CQ_RING);
+
+      if (nbio_ring.cq_ring == MAP_FAILED)
+         goto error;
+   }
+   else
+      nbio_ring.cq_ring = nbio_ring.sq_ring;
+
+   nbio_ring.sqes = (struct io_uring_sqe*)mmap(NULL, nbio_ring.sqes_size,
+         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+         nbio_ring.fd, IORING_OFF_SQES);
+
+   if (nbio_ring.sqes == MAP_FAILED)
+      goto error;
+
+   sq_ring            = (char*)nbio_ring.sq_ring;
+   cq_ring            = (char*)nbio_ring.cq_ring;
+   nbio_ring.sq_head  = (unsigned*)(sq_ring + p.sq_off.head);
+   nbio_ring.sq_tail  = (unsigned*)(sq_ring + p.sq_off.tail);
+   nbio_ring.sq_mask  = (unsigned*)(sq_ring + p.sq_off.ring_mask);
+   nbio_ring.sq_array = (unsigned*)(sq_ring + p.sq_off.array);
+   nbio_ring.cq_head  = (unsigned*)(cq_ring + p.cq_off.head);
+   nbio_ring.cq_tail  = (unsigned*)(cq_ring + p.cq_off.tail);
+   nbio_ring.cq_mask  = (unsigned*)(cq_ring + p.cq_off.ring_mask);
+   nbio_ring.cqes     = (struct io_uring_cqe*)(cq_ring + p.cq_off.cqes);
+
+   return true;
+
+error:
+   if (nbio_ring.sq_ring && nbio_ring.sq_ring != MAP_FAILED)
+      munmap(nbio_ring.sq_ring, nbio_ring.sq_ring_size);
+   if (nbio_ring.cq_ring_size && nbio_ring.cq_ring
+         && nbio_ring.cq_ring != MAP_FAILED)
+      munmap(nbio_ring.cq_ring, nbio_ring.cq_ring_size);
+   close(nbio_ring.fd);
+   memset(&nbio_ring, 0, sizeof(nbio_ring));
+   return false;
+}
+
+static bool nbio_uring_queue(struct nbio_unix_req *req)
+{
+   struct io_uring_sqe *sqe;
+   unsigned tail  = *nbio_ring.sq_tail;
+   unsigned head  = __atomic_load_n(nbio_ring.sq_head, __ATOMIC_ACQUIRE);
+   unsigned index = tail & *nbio_ring.sq_mask;
+
+   if (tail - head >= nbio_ring.entries)
+      return false;
+
+   sqe            = &nbio_ring.sqes[index];
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->opcode    = req->handle->op == NBIO_READ
+      ? IORING_OP_READ : IORING_OP_WRITE;
+   sqe->fd        = req->handle->fd;
+   sqe->addr      = (uint64_t)(uintptr_t)
+      ((char*)req->handle->data + req->offset);
+   sqe->len       = (uint32_t)req->size;
+   sqe->off       = req->offset;
+   sqe->user_data = (uint64_t)(uintptr_t)req;
+
+   nbio_ring.sq_array[index] = index;
+   __atomic_store_n(nbio_ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+   nbio_ring.to_submit++;
+
+   return true;
+}
+
+static void nbio_uring_flush(bool wait)
+{
+   unsigned head, tail;
+
+   if (nbio_ring.to_submit || wait)
+   {
+      int ret = (int)syscall(__NR_io_uring_enter, nbio_ring.fd,
+            nbio_ring.to_submit, wait ? 1 : 0,
+            wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+
+      /* On EINTR, EAGAIN or EBUSY, try again on the next call */
+      if (ret > 0)
+         nbio_ring.to_submit -= ret;
+   }
+
+   head = *nbio_ring.cq_head;
+   tail = __atomic_load_n(nbio_ring.cq_tail, __ATOMIC_ACQUIRE);
+
+   for (; head != tail; head++)
+   {
+      struct io_uring_cqe *cqe = &nbio_ring.cqes[head & *nbio_ring.cq_mask];
+
+      nbio_unix_complete((struct nbio_unix_req*)(uintptr_t)cqe->user_data,
+            cqe->res);
+   }
+
+   __atomic_store_n(nbio_ring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+static void nbio_uring_unqueue(struct nbio_unix_t *handle)
+{
+   /* Once in the ring, requests run to completion */
+}
+#elif defined(HAVE_IO_URING)
+/* The kernel headers are too old for the requests used here */
+static bool nbio_uring_setup(void)
+{
+   return false;
+}
+
+static bool nbio_uring_queue(struct nbio_unix_req *req)
+{
+   return false;
+}
+
+static void nbio_uring_flush(bool wait)
+{
+}
+
+static void nbio_uring_unqueue(struct nbio_unix_t *handle)
+{
+}
+#endif
+
+#ifdef HAVE_THREADS
+static struct
+{
+   scond_t *cond;
+   struct nbio_unix_req *head;
+   struct nbio_unix_req *tail;
+   sthread_t *workers[NBIO_UNIX_WORKERS];
+} nbio_pool_queue;
+
+static void nbio_pool_worker(void *data)
+{
+   NBIO_UNIX_LOCK();
+
+   for (;;)
+   {
+      ssize_t res;
+      struct nbio_unix_t *handle = NULL;
+      struct nbio_unix_req *req  = nbio_pool_queue.head;
+
+      if (!req)
+      {
+         scond_wait(nbio_pool_queue.cond, nbio_unix_lock);
+         continue;
+      }
+
+      nbio_pool_queue.head = req->next;
+      if (!nbio_pool_queue.head)
+         nbio_pool_queue.tail = NULL;
+
+      /* The handle can't go away or be resized while the request
+       * is queued, so this needs no lock */
+      handle = req->handle;
+      NBIO_UNIX_UNLOCK();
+
+      do
+      {
+         if (handle->op == NBIO_READ)
+            res = pread(handle->fd, (char*)handle->data + req->offset,
+                  req->size, req->offset);
+         else
+            res = pwrite(handle->fd, (char*)handle->data + req->offset,
+                  req->size, req->offset);
+      } while (res < 0 && errno == EINTR);
+
+      NBIO_UNIX_LOCK();
+      nbio_unix_complete(req, res);
+      scond_broadcast(nbio_unix_done);
+   }
+}
+
+static bool nbio_pool_setup(void)
+{
+   unsigned i;
+   unsigned workers = 0;
+
+   nbio_pool_queue.cond = scond_new();
+
+   if (!nbio_pool_queue.cond)
+      return false;
+
+   /* The workers live as long as the process */
+   for (i = 0; i < NBIO_UNIX_WORKERS; i++)
+   {
+      nbio_pool_queue.workers[i] = sthread_create(nbio_pool_worker, NULL);
+
+      if (nbio_pool_queue.workers[i])
+         workers++;
+   }
+
+   return workers > 0;
+}
+
+static bool nbio_pool_queue_req(struct nbio_unix_req *req)
+{
+   req->next = NULL;
+
+   if (nbio_pool_queue.tail)
+      nbio_pool_queue.tail->next = req;
+   else
+      nbio_pool_queue.head       = req;
+   nbio_pool_queue.tail          = req;
+
+   scond_signal(nbio_pool_queue.cond);
+   return true;
+}
+
+static void nbio_pool_flush(bool wait)
+{
+   if (wait)
+      scond_wait(nbio_unix_done, nbio_unix_lock);
+}
+
+static void nbio_pool_unqueue(struct nbio_unix_t *handle)
+{
+   struct nbio_unix_req *prev = NULL;
+   struct nbio_unix_req *req  = nbio_pool_queue.head;
+
+   while (req)
+   {
+      struct nbio_unix_req *next = req->next;
+
+      if (req->handle == handle)
+      {
+         if (prev)
+            prev->next           = next;
+         else
+            nbio_pool_queue.head = next;
+         if (nbio_pool_queue.tail == req)
+            nbio_pool_queue.tail = prev;
+
+         req->state = NBIO_UNIX_REQ_FREE;
+         handle->inflight--;
+      }
+      else
+         prev = req;
+
+      req = next;
+   }
+}
+#endif
+
+/* Called with the lock held */
+static void nbio_unix_fill(struct nbio_unix_t *handle)
+{
+   unsigned i;
+
+   for (i = 0; i < NBIO_UNIX_MAX_INFLIGHT; i++)
+   {
+      struct nbio_unix_req *req = &handle->reqs[i];
+
+      if (handle->error && req->state == NBIO_UNIX_REQ_PENDING)
+         req->state = NBIO_UNIX_REQ_FREE;
+
+      if (handle->error)
+         continue;
+
+      if (req->state == NBIO_UNIX_REQ_FREE)
+      {
+         if (handle->submitted >= handle->len)
+            continue;
+
+         req->handle = handle;
+         req->offset = handle->submitted;
+         req->size   = handle->len - handle->submitted;
+         if (req->size > NBIO_UNIX_CHUNK)
+            req->size = NBIO_UNIX_CHUNK;
+
+         if (!handle->engine->queue(req))
+            break;
+
+         handle->submitted += req->size;
+      }
+      else if (req->state == NBIO_UNIX_REQ_PENDING)
+      {
+         if (!handle->engine->queue(req))
+            break;
+      }
+      else
+         continue;
+
+      req->state = NBIO_UNIX_REQ_QUEUED;
+      handle->inflight++;
+   }
+}
+
+/* Called with the lock held */
+static bool nbio_unix_is_done(struct nbio_unix_t *handle)
+{
+   unsigned i;
+
+   if (handle->inflight)
+      return false;
+
+   if (handle->error)
+      return true;
+
+   for (i = 0; i < NBIO_UNIX_MAX_INFLIGHT; i++)
+      if (handle->reqs[i].state != NBIO_UNIX_REQ_FREE)
+         return false;
+
+   return handle->submitted >= handle->len;
+}
+
+/* Reads or writes the whole file at once, for BIO_READ and BIO_WRITE */
+static void nbio_unix_transfer_blocking(struct nbio_unix_t *handle)
+{
+   while (handle->completed < handle->len)
+   {
+      char *ptr   = (char*)handle->data + handle->completed;
+      size_t size = handle->len - handle->completed;
+      ssize_t res = handle->op == NBIO_READ
+         ? pread(handle->fd, ptr, size, handle->completed)
+         : pwrite(handle->fd, ptr, size, handle->completed);
+
+      if (res < 0 && errno == EINTR)
+         continue;
+
+      if (res <= 0)
+      {
+         handle->error = true;
+         break;
+      }
+
+      handle->completed += res;
+   }
+
+   handle->submitted = handle->len;
+}
+
+static void *nbio_unix_open(const nbio_unix_engine_t *engine,
+      const char *filename, unsigned mode)
+{
+   struct stat st;
+   int flags                  = O_RDONLY;
+   struct nbio_unix_t *handle = NULL;
+
+   switch (mode)
+   {
+      case NBIO_WRITE:
+      case BIO_WRITE:
+         flags = O_WRONLY | O_CREAT | O_TRUNC;
+         break;
+      case NBIO_UPDATE:
+         flags = O_RDWR;
+         break;
+      default:
+         break;
+   }
+
+   handle = (struct nbio_unix_t*)calloc(1, sizeof(*handle));
+
+   if (!handle)
+      return NULL;
+
+   handle->engine = engine;
+   handle->mode   = mode;
+   handle->op     = -2;
+   handle->fd     = open(filename, flags | O_CLOEXEC, 0644);
+
+   if (handle->fd < 0)
+      goto error;
+
+   if (flags & O_TRUNC)
+      return handle;
+
+   if (fstat(handle->fd, &st) != 0 || st.st_size <= 0)
+      goto error;
+
+   handle->len = (size_t)st.st_size;
+
+   if (mode == NBIO_READ_MAPPED)
+   {
+      handle->data = mmap(NULL, handle->len, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE, handle->fd, 0);
+
+      if (handle->data != MAP_FAILED)
+      {
+         /* Have the kernel read ahead while the caller gets to it */
+         madvise(handle->data, handle->len, MADV_SEQUENTIAL);
+         madvise(handle->data, handle->len, MADV_WILLNEED);
+         handle->mapped = true;
+         return handle;
+      }
+
+      handle->data = NULL;
+      handle->mode = NBIO_READ;
+   }
+
+   handle->data = malloc(handle->len);
+
+   if (!handle->data)
+      goto error;
+
+   return handle;
+
+error:
+   if (handle->fd >= 0)
+      close(handle->fd);
+   free(handle);
+   return NULL;
+}
+
+static void nbio_unix_begin(void *data, signed char op, const char *what)
+{
+   struct nbio_unix_t *handle = (struct nbio_unix_t*)data;
+
+   if (!handle)
+      return;
+
+   if (handle->op >= 0)
+   {
+      printf("ERROR - attempted file %s operation while busy\n", what);
+      abort();
+   }
+
+   handle->op        = op;
+   handle->submitted = 0;
+   handle->completed = 0;
+   handle->error     = false;
+
+   /* The view is already there */
+   if (handle->mapped && op == NBIO_READ)
+   {
+      handle->submitted = handle->completed = handle->len;
+      handle->op        = -1;
+      return;
+   }
+
+   if (handle->mode == BIO_READ || handle->mode == BIO_WRITE)
+      return;
+
+   /* Get the transfer going before the caller moves on */
+   NBIO_UNIX_LOCK();
+   nbio_unix_fill(handle);
+   handle->engine->flush(false);
+   NBIO_UNIX_UNLOCK();
+}
+
+static void nbio_unix_begin_read(void *data)
+{
+   nbio_unix_begin(data, NBIO_READ, "read");
+}
+
+static void nbio_unix_begin_write(void *data)
+{
+   nbio_unix_begin(data, NBIO_WRITE, "write");
+}
+
+static bool nbio_unix_iterate(void *data)
+{
+   struct nbio_unix_t *handle = (struct nbio_unix_t*)data;
+
+   if (!handle)
+      return false;
+
+   if (handle->op < 0)
+      return true;
+
+   if (handle->mode == BIO_READ || handle->mode == BIO_WRITE)
+   {
+      nbio_unix_transfer_blocking(handle);
+      handle->op = -1;
+      return true;
+   }
+
+   NBIO_UNIX_LOCK();
+   nbio_unix_fill(handle);
+   handle->engine->flush(false);
+   if (nbio_unix_is_done(handle))
+      handle->op = -1;
+   NBIO_UNIX_UNLOCK();
+
+   return handle->op < 0;
+}
+
+static void nbio_unix_resize(void *data, size_t len)
+{
+   void *buf                  = NULL;
+   struct nbio_unix_t *handle = (struct nbio_unix_t*)data;
+
+   if (!handle)
+      return;
+
+   if (handle->op >= 0)
+   {
+      puts("ERROR - attempted file resize operation while busy");
+      abort();
+   }
+   if (len < handle->len || handle->mapped)
+   {
+      puts("ERROR - attempted file shrink operation, not implemented");
+      abort();
+   }
+
+   buf = realloc(handle->data, len);
+
+   if (!buf && len)
+   {
+      puts("ERROR - could not resize file buffer");
+      abort();
+   }
+
+   handle->data  = buf;
+   handle->len   = len;
+   handle->op    = -1;
+   handle->error = false;
+}
+
+static void *nbio_unix_get_ptr(void *data, size_t *len)
+{
+   struct nbio_unix_t *handle = (struct nbio_unix_t*)data;
+
+   if (!handle)
+      return NULL;
+   if (len)
+      *len = handle->len;
+   if (handle->op == -1 && !handle->error)
+      return handle->data;
+   return NULL;
+}
+
+static void nbio_unix_cancel(void *data)
+{
+   unsigned i;
+   struct nbio_unix_t *handle = (struct nbio_unix_t*)data;
+
+   if (!handle || handle->op < 0)
+      return;
+
+   NBIO_UNIX_LOCK();
+
+   /* The kernel or the workers may still be using the buffer */
+   handle->engine->unqueue(handle);
+   while (handle->inflight)
+      handle->engine->flush(true);
+
+   for (i = 0; i < NBIO_UNIX_MAX_INFLIGHT; i++)
+      handle->reqs[i].state = NBIO_UNIX_REQ_FREE;
+
+   handle->op = -1;
+
+   NBIO_UNIX_UNLOCK();
+}
+
+static void nbio_unix_free(void *data)
+{
+   struct nbio_unix_t *handle = (struct nbio_unix_t*)data;
+
+   if (!handle)
+      return;
+   if (handle->op >= 0)
+   {
+      puts("ERROR - attempted free() while busy");
+      abort();
+   }
+
+   if (handle->mapped)
+      munmap(handle->data, handle->len);
+   else
+      free(handle->data);
+   close(handle->fd);
+   free(handle);
+}
+
+#ifdef HAVE_IO_URING
+static nbio_unix_engine_t nbio_uring_engine = {
+   nbio_uring_setup,
+   nbio_uring_queue,
+   nbio_uring_flush,
+   nbio_uring_unqueue,
+   0
+};
+
+static bool nbio_uring_init(void)
+{
+   return nbio_unix_engine_init(&nbio_uring_engine);
+}
+
+static void *nbio_uring_open(const char *filename, unsigned mode)
+{
+   return nbio_unix_open(&nbio_uring_engine, filename, mode);
+}
+
+nbio_intf_t nbio_uring = {
+   nbio_uring_init,
+   nbio_uring_open,
+   nbio_unix_begin_read,
+   nbio_unix_begin_write,
+   nbio_unix_iterate,
+   nbio_unix_resize,
+   nbio_unix_get_ptr,
+   nbio_unix_cancel,
+   nbio_unix_free,
+   "io_uring",
+};
+#endif
+
+#ifdef HAVE_THREADS
+static nbio_unix_engine_t nbio_pool_engine = {
+   nbio_pool_setup,
+   nbio_pool_queue_req,
+   nbio_pool_flush,
+   nbio_pool_unqueue,
+   0
+};
+
+static bool nbio_pool_init(void)
+{
+   return nbio_unix_engine_init(&nbio_pool_engine);
+}
+
+static void *nbio_pool_open(const char *filename, unsigned mode)
+{
+   return nbio_unix_open(&nbio_pool_engine, filename, mode);
+}
+
+nbio_intf_t nbio_pool = {
+   nbio_pool_init,
+   nbio_pool_open,
+   nbio_unix_begin_read,
+   nbio_unix_begin_write,
+   nbio_unix_iterate,
+   nbio_unix_resize,
+   nbio_unix_get_ptr,
+   nbio_unix_cancel,
+   nbio_unix_free,
+   "threads",
+};
+#endif
+
+#endif
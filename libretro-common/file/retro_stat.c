@@ -81,7 +81,8 @@ enum stat_mode
    IS_VALID
 };
 
-static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
+static bool path_stat(const char *path, enum stat_mode mode,
+      int32_t *size, int64_t *mtime)
 {
 #if defined(VITA) || defined(PSP)
    SceIoStat buf;
@@ -118,6 +119,15 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
    if (size)
       *size = (int32_t)buf.st_size;
 
+   if (mtime)
+   {
+#if defined(VITA) || defined(PSP)
+      *mtime = 0;
+#else
+      *mtime = (int64_t)buf.st_mtime;
+#endif
+   }
+
    switch (mode)
    {
       case IS_DIRECTORY:
@@ -153,28 +163,46 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
  */
 bool path_is_directory(const char *path)
 {
-   return path_stat(path, IS_DIRECTORY, NULL);
+   return path_stat(path, IS_DIRECTORY, NULL, NULL);
 }
 
 bool path_is_character_special(const char *path)
 {
-   return path_stat(path, IS_CHARACTER_SPECIAL, NULL);
+   return path_stat(path, IS_CHARACTER_SPECIAL, NULL, NULL);
 }
 
 bool path_is_valid(const char *path)
 {
-   return path_stat(path, IS_VALID, NULL);
+   return path_stat(path, IS_VALID, NULL, NULL);
 }
 
 int32_t path_get_size(const char *path)
 {
    int32_t filesize = 0;
-   if (path_stat(path, IS_VALID, &filesize))
+   if (path_stat(path, IS_VALID, &filesize, NULL))
       return filesize;
 
    return -1;
 }
 
+/**
+ * path_get_mtime:
+ * @path               : path
+ * @mtime              : modification time, in seconds since the epoch.
+ *
+ * Gets the last modification time of a file or directory.
+ *
+ * Returns: true (1) if @mtime could be determined, otherwise false (0).
+ **/
+bool path_get_mtime(const char *path, int64_t *mtime)
+{
+#if defined(VITA) || defined(PSP)
+   return false;
+#else
+   return path_stat(path, IS_VALID, NULL, mtime);
+#endif
+}
+
 /**
  * path_mkdir_norecurse:
  * @dir                : directory
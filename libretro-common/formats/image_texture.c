@@ -215,6 +215,115 @@ void image_texture_free(struct texture_image *img)
    img->pixels = NULL;
 }
 
+bool image_texture_downscale(struct texture_image *img,
+      unsigned max_width, unsigned max_height)
+{
+   unsigned x, y, c;
+   unsigned width, height;
+   unsigned *x_start  = NULL;
+   uint64_t *sums     = NULL;
+   uint32_t *pixels   = NULL;
+
+   if (!img || !img->pixels || !img->width || !img->height)
+      return false;
+
+   width  = img->width;
+   height = img->height;
+
+   if (max_width && width > max_width)
+   {
+      height = (unsigned)(((uint64_t)height * max_width
+               + width / 2) / width);
+      width  = max_width;
+   }
+
+   if (max_height && height > max_height)
+   {
+      width  = (unsigned)(((uint64_t)width * max_height
+               + height / 2) / height);
+      height = max_height;
+   }
+
+   if (!width)
+      width  = 1;
+   if (!height)
+      height = 1;
+
+   if (width == img->width && height == img->height)
+      return false;
+
+   x_start = (unsigned*)malloc((width + 1) * sizeof(*x_start));
+   sums    = (uint64_t*)malloc(width * 4 * sizeof(*sums));
+   pixels  = (uint32_t*)malloc(width * height * sizeof(*pixels));
+
+   if (!x_start || !sums || !pixels)
+      goto error;
+
+   for (x = 0; x <= width; x++)
+      x_start[x] = (unsigned)((uint64_t)x * img->width / width);
+
+   /* Box filter; every destination pixel averages the source
+    * pixels it covers, channel by channel. The target is never
+    * larger than the source, so no box is empty. */
+   for (y = 0; y < height; y++)
+   {
+      unsigned sy;
+      unsigned y0 = (unsigned)((uint64_t)y       * img->height / height);
+      unsigned y1 = (unsigned)((uint64_t)(y + 1) * img->height / height);
+
+      memset(sums, 0, width * 4 * sizeof(*sums));
+
+      for (sy = y0; sy < y1; sy++)
+      {
+         const uint32_t *src = img->pixels + sy * img->width;
+
+         for (x = 0; x < width; x++)
+         {
+            unsigned sx;
+            unsigned x1    = x_start[x + 1];
+            uint64_t *sum  = sums + x * 4;
+
+            for (sx = x_start[x]; sx < x1; sx++)
+            {
+               uint32_t col = src[sx];
+               sum[0]      += (col >> 24);
+               sum[1]      += (col >> 16) & 0xff;
+               sum[2]      += (col >>  8) & 0xff;
+               sum[3]      += (col >>  0) & 0xff;
+            }
+         }
+      }
+
+      for (x = 0; x < width; x++)
+      {
+         uint32_t col   = 0;
+         uint64_t count = (uint64_t)(x_start[x + 1] - x_start[x])
+            * (y1 - y0);
+
+         for (c = 0; c < 4; c++)
+            col = (col << 8) | (uint32_t)((sums[x * 4 + c] + count / 2) / count);
+
+         pixels[y * width + x] = col;
+      }
+   }
+
+   free(x_start);
+   free(sums);
+   free(img->pixels);
+
+   img->pixels = pixels;
+   img->width  = width;
+   img->height = height;
+
+   return true;
+
+error:
+   free(x_start);
+   free(sums);
+   free(pixels);
+   return false;
+}
+
 static enum video_image_format image_texture_get_type(const char *path)
 {
 #ifdef HAVE_RTGA
@@ -278,12 +387,15 @@ bool image_texture_load(struct texture_image *out_img,
 
    if (fmt != IMAGE_FORMAT_NONE)
    {
-      handle = (struct nbio_t*)nbio_open(path, NBIO_READ);
+      /* Read it all at once, rather than spinning on nbio_iterate() */
+      handle = (struct nbio_t*)nbio_open(path, BIO_READ);
       if (!handle)
          goto error;
       nbio_begin_read(handle);
 
-      while (!nbio_iterate(handle));
+      /* BIO_READ completes within the first iterate */
+      if (!nbio_iterate(handle))
+         goto error;
 
       ptr = nbio_get_ptr(handle, &file_len);
 
@@ -68,6 +68,7 @@ typedef struct
 struct rjpeg
 {
    uint8_t *buff_data;
+   unsigned scale_shift;
 };
 
 #ifdef _MSC_VER
@@ -113,7 +114,11 @@ struct rjpeg
 #define RJPEG_NO_SIMD
 #endif
 
-#if defined(__SSE2__)
+#if defined(__SSE2__) && !defined(RJPEG_NO_SIMD)
+#define RJPEG_SSE2
+#endif
+
+#ifdef RJPEG_SSE2
 #include <emmintrin.h>
 
 #ifdef _MSC_VER
@@ -125,6 +130,10 @@ struct rjpeg
 #endif
 
 /* ARM NEON */
+#if defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS) && !defined(RJPEG_NEON)
+#define RJPEG_NEON
+#endif
+
 #if defined(RJPEG_NO_SIMD) && defined(RJPEG_NEON)
 #undef RJPEG_NEON
 #endif
@@ -228,6 +237,9 @@ typedef struct
    int scan_n, order[4];
    int restart_interval, todo;
 
+   /* output is downscaled by 1 << scale_shift in each axis (0..3) */
+   int scale_shift;
+
    /* kernels */
    void (*idct_block_kernel)(uint8_t *out, int out_stride, short data[64]);
    void (*YCbCr_to_RGB_kernel)(uint8_t *out, const uint8_t *y, const uint8_t *pcb,
@@ -775,7 +787,11 @@ static INLINE uint8_t rjpeg__clamp(int x)
 {
    /* trick to use a single test to catch both cases */
    if ((unsigned int) x > 255)
+   {
+      if (x < 0)
+         return 0;
       return 255;
+   }
    return (uint8_t) x;
 }
 
@@ -882,7 +898,7 @@ static void rjpeg__idct_block(uint8_t *out, int out_stride, short data[64])
    }
 }
 
-#if defined(__SSE2__)
+#if defined(RJPEG_SSE2)
 /* sse2 integer IDCT. not the fastest possible implementation but it
  * produces bit-identical results to the generic C version so it's
  * fully "transparent".
@@ -1273,6 +1289,102 @@ static void rjpeg__idct_simd(uint8_t *out, int out_stride, short data[64])
 
 #endif /* RJPEG_NEON */
 
+/* reduced-size IDCTs for scaled decoding: only the low-frequency
+ * corner of the block is used, run through a 4- or 2-point IDCT.
+ * Each 1D pass carries a factor of 1/2 compared to the 8x8 IDCT,
+ * so the row pass drops two extra bits. */
+#define RJPEG__IDCT4_1D(s0,s1,s2,s3) \
+   int e0 = ((s0) + (s2)) * rjpeg__f2f(0.707106781f); \
+   int e1 = ((s0) - (s2)) * rjpeg__f2f(0.707106781f); \
+   int o0 = (s1) * rjpeg__f2f(0.923879533f) + (s3) * rjpeg__f2f(0.382683432f); \
+   int o1 = (s1) * rjpeg__f2f(0.382683432f) - (s3) * rjpeg__f2f(0.923879533f);
+
+static void rjpeg__idct_block_4x4(uint8_t *out, int out_stride,
+      const short data[64])
+{
+   int i, val[16];
+   int *v = val;
+
+   /* columns */
+   for (i = 0; i < 4; ++i, ++v)
+   {
+      const short *d = data + i;
+
+      if (d[8] == 0 && d[16] == 0 && d[24] == 0)
+      {
+         int dcterm = (d[0] * rjpeg__f2f(0.707106781f) + 2048) >> 12;
+         v[0] = v[4] = v[8] = v[12] = dcterm;
+      }
+      else
+      {
+         RJPEG__IDCT4_1D(d[0], d[8], d[16], d[24])
+         v[ 0] = (e0 + o0 + 2048) >> 12;
+         v[12] = (e0 - o0 + 2048) >> 12;
+         v[ 4] = (e1 + o1 + 2048) >> 12;
+         v[ 8] = (e1 - o1 + 2048) >> 12;
+      }
+   }
+
+   /* rows; fold the level shift into the rounding bias */
+   for (i = 0, v = val; i < 4; ++i, v += 4, out += out_stride)
+   {
+      RJPEG__IDCT4_1D(v[0], v[1], v[2], v[3])
+      e0 += (1 << 13) + (128 << 14);
+      e1 += (1 << 13) + (128 << 14);
+      out[0] = rjpeg__clamp((e0 + o0) >> 14);
+      out[3] = rjpeg__clamp((e0 - o0) >> 14);
+      out[1] = rjpeg__clamp((e1 + o1) >> 14);
+      out[2] = rjpeg__clamp((e1 - o1) >> 14);
+   }
+}
+
+#undef RJPEG__IDCT4_1D
+
+static void rjpeg__idct_block_2x2(uint8_t *out, int out_stride,
+      const short data[64])
+{
+   const int c  = rjpeg__f2f(0.707106781f);
+   /* columns */
+   int v0       = ((data[0] + data[8]) * c + 2048) >> 12;
+   int v2       = ((data[0] - data[8]) * c + 2048) >> 12;
+   int v1       = ((data[1] + data[9]) * c + 2048) >> 12;
+   int v3       = ((data[1] - data[9]) * c + 2048) >> 12;
+   const int b  = (1 << 13) + (128 << 14);
+
+   /* rows */
+   out[0]              = rjpeg__clamp(((v0 + v1) * c + b) >> 14);
+   out[1]              = rjpeg__clamp(((v0 - v1) * c + b) >> 14);
+   out[out_stride]     = rjpeg__clamp(((v2 + v3) * c + b) >> 14);
+   out[out_stride + 1] = rjpeg__clamp(((v2 - v3) * c + b) >> 14);
+}
+
+/* IDCT block (bx, by) of component n into its place in the
+ * (possibly downscaled) component plane */
+static void rjpeg__idct_store(rjpeg__jpeg *z, int n, int bx, int by,
+      short data[64])
+{
+   int      size = 8 >> z->scale_shift;
+   int    stride = z->img_comp[n].w2;
+   uint8_t  *out = z->img_comp[n].data + stride * by * size + bx * size;
+
+   switch (z->scale_shift)
+   {
+      case 0:
+         z->idct_block_kernel(out, stride, data);
+         break;
+      case 1:
+         rjpeg__idct_block_4x4(out, stride, data);
+         break;
+      case 2:
+         rjpeg__idct_block_2x2(out, stride, data);
+         break;
+      case 3:
+         /* DC only, same rounding as the full IDCT */
+         *out = rjpeg__clamp(((data[0] + 4) >> 3) + 128);
+         break;
+   }
+}
+
 static uint8_t rjpeg__get_marker(rjpeg__jpeg *j)
 {
    uint8_t x;
@@ -1374,8 +1486,7 @@ static int rjpeg__parse_entropy_coded_data(rjpeg__jpeg *z)
                         z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq]))
                   return 0;
 
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8,
-                     z->img_comp[n].w2, data);
+               rjpeg__idct_store(z, n, i, j, data);
 
                /* every data block is an MCU, so countdown the restart interval */
                if (--z->todo <= 0)
@@ -1454,8 +1565,8 @@ static int rjpeg__parse_entropy_coded_data(rjpeg__jpeg *z)
                   {
                      for (x=0; x < z->img_comp[n].h; ++x)
                      {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
+                        int x2 = i*z->img_comp[n].h + x;
+                        int y2 = j*z->img_comp[n].v + y;
                         int ha = z->img_comp[n].ha;
 
                         if (!rjpeg__jpeg_decode_block(z, data,
@@ -1464,8 +1575,7 @@ static int rjpeg__parse_entropy_coded_data(rjpeg__jpeg *z)
                                  n, z->dequant[z->img_comp[n].tq]))
                            return 0;
 
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2,
-                              z->img_comp[n].w2, data);
+                        rjpeg__idct_store(z, n, x2, y2, data);
                      }
                   }
                }
@@ -1513,8 +1623,7 @@ static void rjpeg__jpeg_finish(rjpeg__jpeg *z)
          {
             short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
             rjpeg__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-            z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8,
-                  z->img_comp[n].w2, data);
+            rjpeg__idct_store(z, n, i, j, data);
          }
       }
    }
@@ -1803,8 +1912,8 @@ static int rjpeg__process_frame_header(rjpeg__jpeg *z, int scan)
           * the bogus oversized data from using interleaved MCUs and their
           * big blocks (e.g. a 16x16 iMCU on an image of width 33); we won't
           * discard the extra data until colorspace conversion */
-         z->img_comp[i].w2       = z->img_mcu_x * z->img_comp[i].h * 8;
-         z->img_comp[i].h2       = z->img_mcu_y * z->img_comp[i].v * 8;
+         z->img_comp[i].w2       = (z->img_mcu_x * z->img_comp[i].h * 8) >> z->scale_shift;
+         z->img_comp[i].h2       = (z->img_mcu_y * z->img_comp[i].v * 8) >> z->scale_shift;
          z->img_comp[i].raw_data = malloc(z->img_comp[i].w2 * z->img_comp[i].h2+15);
 
          /* Out of memory? */
@@ -1822,8 +1931,8 @@ static int rjpeg__process_frame_header(rjpeg__jpeg *z, int scan)
          /* align blocks for IDCT using MMX/SSE */
          z->img_comp[i].data      = (uint8_t*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
          z->img_comp[i].linebuf   = NULL;
-         z->img_comp[i].coeff_w   = (z->img_comp[i].w2 + 7) >> 3;
-         z->img_comp[i].coeff_h   = (z->img_comp[i].h2 + 7) >> 3;
+         z->img_comp[i].coeff_w   = z->img_mcu_x * z->img_comp[i].h;
+         z->img_comp[i].coeff_h   = z->img_mcu_y * z->img_comp[i].v;
          z->img_comp[i].raw_coeff = malloc(z->img_comp[i].coeff_w * 
                                     z->img_comp[i].coeff_h * 64 * sizeof(short) + 15);
          z->img_comp[i].coeff     = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -1841,8 +1950,8 @@ static int rjpeg__process_frame_header(rjpeg__jpeg *z, int scan)
           * the bogus oversized data from using interleaved MCUs and their
           * big blocks (e.g. a 16x16 iMCU on an image of width 33); we won't
           * discard the extra data until colorspace conversion */
-         z->img_comp[i].w2       = z->img_mcu_x * z->img_comp[i].h * 8;
-         z->img_comp[i].h2       = z->img_mcu_y * z->img_comp[i].v * 8;
+         z->img_comp[i].w2       = (z->img_mcu_x * z->img_comp[i].h * 8) >> z->scale_shift;
+         z->img_comp[i].h2       = (z->img_mcu_y * z->img_comp[i].v * 8) >> z->scale_shift;
          z->img_comp[i].raw_data = malloc(z->img_comp[i].w2 * z->img_comp[i].h2+15);
 
          /* Out of memory? */
@@ -2042,7 +2151,7 @@ static uint8_t *rjpeg__resample_row_hv_2(uint8_t *out, uint8_t *in_near,
    return out;
 }
 
-#if defined(__SSE2__) || defined(RJPEG_NEON)
+#if defined(RJPEG_SSE2) || defined(RJPEG_NEON)
 static uint8_t *rjpeg__resample_row_hv_2_simd(uint8_t *out, uint8_t *in_near,
       uint8_t *in_far, int w, int hs)
 {
@@ -2062,7 +2171,7 @@ static uint8_t *rjpeg__resample_row_hv_2_simd(uint8_t *out, uint8_t *in_near,
     */
    for (; i < ((w-1) & ~7); i += 8)
    {
-#if defined(__SSE2__)
+#if defined(RJPEG_SSE2)
       /* load and perform the vertical filtering pass
        * this uses 3*x + y = 4*x + (y - x) */
       __m128i zero  = _mm_setzero_si128();
@@ -2201,11 +2310,11 @@ static void rjpeg__YCbCr_to_RGB_row(uint8_t *out, const uint8_t *y,
       g >>= 20;
       b >>= 20;
       if ((unsigned) r > 255)
-         r = 255;
+         r = (r < 0) ? 0 : 255;
       if ((unsigned) g > 255)
-         g = 255;
+         g = (g < 0) ? 0 : 255;
       if ((unsigned) b > 255)
-         b = 255;
+         b = (b < 0) ? 0 : 255;
       out[0] = (uint8_t)r;
       out[1] = (uint8_t)g;
       out[2] = (uint8_t)b;
@@ -2214,13 +2323,13 @@ static void rjpeg__YCbCr_to_RGB_row(uint8_t *out, const uint8_t *y,
    }
 }
 
-#if defined(__SSE2__) || defined(RJPEG_NEON)
+#if defined(RJPEG_SSE2) || defined(RJPEG_NEON)
 static void rjpeg__YCbCr_to_RGB_simd(uint8_t *out, const uint8_t *y,
       const uint8_t *pcb, const uint8_t *pcr, int count, int step)
 {
    int i = 0;
 
-#if defined(__SSE2__)
+#if defined(RJPEG_SSE2)
    /* step == 3 is pretty ugly on the final interleave, and i'm not convinced
     * it's useful in practice (you wouldn't use it for textures, for example).
     * so just accelerate step == 4 case.
@@ -2345,11 +2454,11 @@ static void rjpeg__YCbCr_to_RGB_simd(uint8_t *out, const uint8_t *y,
       g >>= 20;
       b >>= 20;
       if ((unsigned) r > 255)
-         r = 255;
+         r = (r < 0) ? 0 : 255;
       if ((unsigned) g > 255)
-         g = 255;
+         g = (g < 0) ? 0 : 255;
       if ((unsigned) b > 255)
-         b = 255;
+         b = (b < 0) ? 0 : 255;
       out[0] = (uint8_t)r;
       out[1] = (uint8_t)g;
       out[2] = (uint8_t)b;
@@ -2362,28 +2471,35 @@ static void rjpeg__YCbCr_to_RGB_simd(uint8_t *out, const uint8_t *y,
 /* set up the kernels */
 static void rjpeg__setup_jpeg(rjpeg__jpeg *j)
 {
-   uint64_t mask = cpu_features_get();
+   /* cpu_features_get() may have to parse /proc/cpuinfo,
+    * so only query it for the first image */
+   static uint64_t mask = 0;
+   static bool mask_init = false;
 
-   (void)mask;
+   if (!mask_init)
+   {
+      mask      = cpu_features_get();
+      mask_init = true;
+   }
 
    j->idct_block_kernel        = rjpeg__idct_block;
    j->YCbCr_to_RGB_kernel      = rjpeg__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = rjpeg__resample_row_hv_2;
 
-
-#if defined(__SSE2__)
+#if defined(RJPEG_SSE2)
    if (mask & RETRO_SIMD_SSE2)
    {
       j->idct_block_kernel        = rjpeg__idct_simd;
       j->YCbCr_to_RGB_kernel      = rjpeg__YCbCr_to_RGB_simd;
       j->resample_row_hv_2_kernel = rjpeg__resample_row_hv_2_simd;
    }
-#endif
-
-#ifdef RJPEG_NEON
-   j->idct_block_kernel           = rjpeg__idct_simd;
-   j->YCbCr_to_RGB_kernel         = rjpeg__YCbCr_to_RGB_simd;
-   j->resample_row_hv_2_kernel    = rjpeg__resample_row_hv_2_simd;
+#elif defined(RJPEG_NEON)
+   if (mask & RETRO_SIMD_NEON)
+   {
+      j->idct_block_kernel        = rjpeg__idct_simd;
+      j->YCbCr_to_RGB_kernel      = rjpeg__YCbCr_to_RGB_simd;
+      j->resample_row_hv_2_kernel = rjpeg__resample_row_hv_2_simd;
+   }
 #endif
 }
 
@@ -2436,6 +2552,22 @@ static uint8_t *rjpeg_load_jpeg_image(rjpeg__jpeg *z,
    if (!rjpeg__decode_jpeg_image(z))
       goto error;
 
+   /* the IDCT already wrote reduced blocks, shrink the
+    * dimensions to match before resampling */
+   if (z->scale_shift)
+   {
+      int round = (1 << z->scale_shift) - 1;
+
+      for (k = 0; k < z->s->img_n; ++k)
+      {
+         z->img_comp[k].x = (z->img_comp[k].x + round) >> z->scale_shift;
+         z->img_comp[k].y = (z->img_comp[k].y + round) >> z->scale_shift;
+      }
+
+      z->s->img_x = (z->s->img_x + round) >> z->scale_shift;
+      z->s->img_y = (z->s->img_y + round) >> z->scale_shift;
+   }
+
    /* determine actual number of components to generate */
    n = req_comp ? req_comp : z->s->img_n;
 
@@ -2541,7 +2673,7 @@ error:
 }
 
 static uint8_t *rjpeg_load_from_memory(const uint8_t *buffer, int len,
-      unsigned *x, unsigned *y, int *comp, int req_comp)
+      unsigned scale_shift, unsigned *x, unsigned *y, int *comp, int req_comp)
 {
    rjpeg__jpeg j;
    rjpeg__context s;
@@ -2551,6 +2683,7 @@ static uint8_t *rjpeg_load_from_memory(const uint8_t *buffer, int len,
    s.img_buffer_end      = (uint8_t*)buffer+len;
 
    j.s                   = &s;
+   j.scale_shift         = scale_shift;
    rjpeg__setup_jpeg(&j);
 
    return rjpeg_load_jpeg_image(&j, x,y,comp,req_comp);
@@ -2561,44 +2694,78 @@ int rjpeg_process_image(rjpeg_t *rjpeg, void **buf_data,
 {
    int comp;
    uint32_t *img         = NULL;
-   uint32_t *pixels      = NULL;
    unsigned size_tex     = 0;
+   unsigned i            = 0;
 
    if (!rjpeg)
       return IMAGE_PROCESS_ERROR;
 
-   img   = (uint32_t*)rjpeg_load_from_memory(rjpeg->buff_data, (int)size, width, height, &comp, 4);
+   img   = (uint32_t*)rjpeg_load_from_memory(rjpeg->buff_data, (int)size,
+         rjpeg->scale_shift, width, height, &comp, 4);
 
    if (!img)
       return IMAGE_PROCESS_ERROR;
 
    size_tex = (*width) * (*height);
-   pixels   = (uint32_t*)malloc(size_tex * sizeof(uint32_t));
 
-   if (!pixels)
+   /* Convert RGBA to ARGB in place */
+#if defined(RJPEG_SSE2)
    {
-      free(img);
-      return IMAGE_PROCESS_ERROR;
-   }
+      const __m128i mask_ag = _mm_set1_epi32(0xFF00FF00);
+      const __m128i mask_r  = _mm_set1_epi32(0x000000FF);
 
-   *buf_data = pixels;
+      for (; i + 4 <= size_tex; i += 4)
+      {
+         __m128i texel = _mm_loadu_si128((const __m128i*)(img + i));
+         __m128i ag    = _mm_and_si128(texel, mask_ag);
+         __m128i r     = _mm_slli_epi32(_mm_and_si128(texel, mask_r), 16);
+         __m128i b     = _mm_and_si128(_mm_srli_epi32(texel, 16), mask_r);
+         _mm_storeu_si128((__m128i*)(img + i),
+               _mm_or_si128(ag, _mm_or_si128(r, b)));
+      }
+   }
+#endif
 
-   /* Convert RGBA to ARGB */
-   while (size_tex--)
+   for (; i < size_tex; i++)
    {
-      unsigned int texel = img[size_tex];
-      unsigned int A     = texel & 0xFF000000;
-      unsigned int B     = texel & 0x00FF0000;
-      unsigned int G     = texel & 0x0000FF00;
-      unsigned int R     = texel & 0x000000FF;
-      ((unsigned int*)pixels)[size_tex] = A | (R << 16) | G | (B >> 16);
+      uint32_t texel = img[i];
+      uint32_t AG    = texel & 0xFF00FF00;
+      uint32_t B     = texel & 0x00FF0000;
+      uint32_t R     = texel & 0x000000FF;
+      img[i]         = AG | (R << 16) | (B >> 16);
    }
 
-   free(img);
+   *buf_data = img;
 
    return IMAGE_PROCESS_END;
 }
 
+bool rjpeg_get_size(rjpeg_t *rjpeg, size_t size,
+      unsigned *width, unsigned *height)
+{
+   rjpeg__jpeg j;
+   rjpeg__context s;
+
+   if (!rjpeg || !rjpeg->buff_data)
+      return false;
+
+   s.img_buffer          = rjpeg->buff_data;
+   s.img_buffer_original = rjpeg->buff_data;
+   s.img_buffer_end      = rjpeg->buff_data + size;
+   s.img_n               = 0;
+
+   j.s                   = &s;
+   j.scale_shift         = 0;
+
+   if (!rjpeg__decode_jpeg_header(&j, RJPEG_SCAN_HEADER))
+      return false;
+
+   *width  = s.img_x;
+   *height = s.img_y;
+
+   return true;
+}
+
 bool rjpeg_set_buf_ptr(rjpeg_t *rjpeg, void *data)
 {
    if (!rjpeg)
@@ -2609,6 +2776,36 @@ bool rjpeg_set_buf_ptr(rjpeg_t *rjpeg, void *data)
    return true;
 }
 
+bool rjpeg_set_scale(rjpeg_t *rjpeg, unsigned denom)
+{
+   unsigned shift;
+
+   if (!rjpeg)
+      return false;
+
+   switch (denom)
+   {
+      case 1:
+         shift = 0;
+         break;
+      case 2:
+         shift = 1;
+         break;
+      case 4:
+         shift = 2;
+         break;
+      case 8:
+         shift = 3;
+         break;
+      default:
+         return false;
+   }
+
+   rjpeg->scale_shift = shift;
+
+   return true;
+}
+
 void rjpeg_free(rjpeg_t *rjpeg)
 {
    if (!rjpeg)
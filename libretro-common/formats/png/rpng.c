@@ -29,6 +29,13 @@
 #include <malloc.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define RPNG_NEON
+#endif
+
 #include <boolean.h>
 #include <formats/image.h>
 #include <formats/rpng.h>
@@ -65,6 +72,10 @@ enum png_chunk_type
    PNG_CHUNK_IEND
 };
 
+/* Amount of image data inflated at a time while scanlines
+ * are being unfiltered, so that both work on cache-hot data. */
+#define RPNG_INFLATE_CHUNK_SIZE (32 * 1024)
+
 struct adam7_pass
 {
    unsigned x;
@@ -97,6 +108,7 @@ struct rpng_process
    uint8_t *prev_scanline;
    uint8_t *decoded_scanline;
    uint8_t *inflate_buf;
+   uint8_t *inflate_out;
    size_t restore_buf_size;
    size_t adam7_restore_buf_size;
    size_t data_restore_buf_size;
@@ -231,7 +243,52 @@ end:
 static void png_reverse_filter_copy_line_rgb(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0;
+
+   if (bpp == 8)
+   {
+#if defined(__SSE2__)
+      const __m128i mask_ag = _mm_set1_epi32((int)0xff00ff00);
+      const __m128i alpha   = _mm_set1_epi32((int)0xff000000);
+
+      /* Four pixels from a 16 byte load, so stop while two more
+       * are left to not read past the end of the line. Each pixel
+       * is shifted down into the low word and the four low words
+       * gathered, which leaves it as 0x??BBGGRR. */
+      for (; i + 6 <= width; i += 4, decoded += 12)
+      {
+         __m128i rgb = _mm_loadu_si128((const __m128i*)decoded);
+         __m128i lo  = _mm_unpacklo_epi32(rgb, _mm_srli_si128(rgb, 3));
+         __m128i hi  = _mm_unpacklo_epi32(_mm_srli_si128(rgb, 6),
+               _mm_srli_si128(rgb, 9));
+         __m128i px  = _mm_unpacklo_epi64(lo, hi);
+         __m128i ag  = _mm_and_si128(px, mask_ag);
+         __m128i rb  = _mm_andnot_si128(mask_ag, px);
+
+         rb          = _mm_or_si128(_mm_slli_epi32(rb, 16),
+               _mm_srli_epi32(rb, 16));
+         _mm_storeu_si128((__m128i*)(data + i),
+               _mm_or_si128(_mm_or_si128(ag, rb), alpha));
+      }
+#elif defined(RPNG_NEON)
+      for (; i + 8 <= width; i += 8, decoded += 24)
+      {
+         uint8x8x3_t rgb = vld3_u8(decoded);
+         uint8x8x4_t bgra;
+
+         bgra.val[0] = rgb.val[2];
+         bgra.val[1] = rgb.val[1];
+         bgra.val[2] = rgb.val[0];
+         bgra.val[3] = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(data + i), bgra);
+      }
+#endif
+
+      for (; i < width; i++, decoded += 3)
+         data[i] = (0xffu << 24) | (decoded[0] << 16)
+            | (decoded[1] << 8) | decoded[2];
+      return;
+   }
 
    bpp /= 8;
 
@@ -252,7 +309,42 @@ static void png_reverse_filter_copy_line_rgb(uint32_t *data,
 static void png_reverse_filter_copy_line_rgba(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0;
+
+   if (bpp == 8)
+   {
+#if defined(__SSE2__)
+      const __m128i mask_ag = _mm_set1_epi32((int)0xff00ff00);
+
+      /* RGBA bytes read as little endian words are 0xAABBGGRR,
+       * so swapping R and B is all it takes. */
+      for (; i + 4 <= width; i += 4, decoded += 16)
+      {
+         __m128i rgba = _mm_loadu_si128((const __m128i*)decoded);
+         __m128i ag   = _mm_and_si128(rgba, mask_ag);
+         __m128i rb   = _mm_andnot_si128(mask_ag, rgba);
+
+         rb           = _mm_or_si128(_mm_slli_epi32(rb, 16),
+               _mm_srli_epi32(rb, 16));
+         _mm_storeu_si128((__m128i*)(data + i), _mm_or_si128(ag, rb));
+      }
+#elif defined(RPNG_NEON)
+      for (; i + 8 <= width; i += 8, decoded += 32)
+      {
+         uint8x8x4_t rgba = vld4_u8(decoded);
+         uint8x8_t r      = rgba.val[0];
+
+         rgba.val[0]      = rgba.val[2];
+         rgba.val[2]      = r;
+         vst4_u8((uint8_t*)(data + i), rgba);
+      }
+#endif
+
+      for (; i < width; i++, decoded += 4)
+         data[i] = ((uint32_t)decoded[3] << 24) | (decoded[0] << 16)
+            | (decoded[1] << 8) | decoded[2];
+      return;
+   }
 
    bpp /= 8;
 
@@ -425,6 +517,228 @@ static void png_reverse_filter_copy_line_plt(uint32_t *data,
    }
 }
 
+#if defined(__SSE2__)
+static INLINE __m128i png_simd_load_pixel(const uint8_t *p, unsigned bpp)
+{
+   uint32_t v = p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16);
+   if (bpp == 4)
+      v    |= (uint32_t)p[3] << 24;
+   return _mm_cvtsi32_si128((int)v);
+}
+
+static INLINE void png_simd_store_pixel(uint8_t *p, __m128i x, unsigned bpp)
+{
+   uint32_t v = (uint32_t)_mm_cvtsi128_si32(x);
+   p[0]       = (uint8_t)v;
+   p[1]       = (uint8_t)(v >> 8);
+   p[2]       = (uint8_t)(v >> 16);
+   if (bpp == 4)
+      p[3]    = (uint8_t)(v >> 24);
+}
+
+static INLINE __m128i png_simd_abs_epi16(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static INLINE __m128i png_simd_select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#elif defined(RPNG_NEON)
+static INLINE uint8x8_t png_simd_load_pixel(const uint8_t *p, unsigned bpp)
+{
+   uint32_t v = p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16);
+   if (bpp == 4)
+      v    |= (uint32_t)p[3] << 24;
+   return vreinterpret_u8_u32(vdup_n_u32(v));
+}
+
+static INLINE void png_simd_store_pixel(uint8_t *p, uint8x8_t x, unsigned bpp)
+{
+   uint32_t v = vget_lane_u32(vreinterpret_u32_u8(x), 0);
+   p[0]       = (uint8_t)v;
+   p[1]       = (uint8_t)(v >> 8);
+   p[2]       = (uint8_t)(v >> 16);
+   if (bpp == 4)
+      p[3]    = (uint8_t)(v >> 24);
+}
+#endif
+
+static void png_reverse_filter_sub(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i = 0;
+
+#if defined(__SSE2__)
+   if (bpp == 4)
+   {
+      __m128i a = _mm_setzero_si128();
+
+      /* Prefix sum over four pixels at a time. */
+      for (; i + 16 <= pitch; i += 16)
+      {
+         __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+         x         = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+         x         = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+         x         = _mm_add_epi8(x, a);
+         _mm_storeu_si128((__m128i*)(out + i), x);
+         a         = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+      }
+   }
+#elif defined(RPNG_NEON)
+   if (bpp == 4)
+   {
+      uint8x8_t a = vdup_n_u8(0);
+
+      for (; i + 4 <= pitch; i += 4)
+      {
+         a = vadd_u8(a, png_simd_load_pixel(in + i, 4));
+         png_simd_store_pixel(out + i, a, 4);
+      }
+   }
+#endif
+
+   for (; i < bpp && i < pitch; i++)
+      out[i] = in[i];
+   for (; i < pitch; i++)
+      out[i] = out[i - bpp] + in[i];
+}
+
+static void png_reverse_filter_up(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i = 0;
+
+#if defined(__SSE2__)
+   for (; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(
+               _mm_loadu_si128((const __m128i*)(in + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= pitch; i += 16)
+      vst1q_u8(out + i, vaddq_u8(vld1q_u8(in + i), vld1q_u8(prev + i)));
+#endif
+
+   for (; i < pitch; i++)
+      out[i] = prev[i] + in[i];
+}
+
+static void png_reverse_filter_avg(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i = 0;
+
+#if defined(__SSE2__)
+   if (bpp == 3 || bpp == 4)
+   {
+      const __m128i one = _mm_set1_epi8(1);
+      __m128i a         = _mm_setzero_si128();
+
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         __m128i b   = png_simd_load_pixel(prev + i, bpp);
+         /* _mm_avg_epu8 rounds up, PNG wants the floor. */
+         __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+               _mm_and_si128(_mm_xor_si128(a, b), one));
+
+         a           = _mm_add_epi8(png_simd_load_pixel(in + i, bpp), avg);
+         png_simd_store_pixel(out + i, a, bpp);
+      }
+   }
+#elif defined(RPNG_NEON)
+   if (bpp == 3 || bpp == 4)
+   {
+      uint8x8_t a = vdup_n_u8(0);
+
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         a = vadd_u8(png_simd_load_pixel(in + i, bpp),
+               vhadd_u8(a, png_simd_load_pixel(prev + i, bpp)));
+         png_simd_store_pixel(out + i, a, bpp);
+      }
+   }
+#endif
+
+   for (; i < bpp && i < pitch; i++)
+      out[i] = (prev[i] >> 1) + in[i];
+   for (; i < pitch; i++)
+      out[i] = ((out[i - bpp] + prev[i]) >> 1) + in[i];
+}
+
+static void png_reverse_filter_paeth(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i = 0;
+
+#if defined(__SSE2__)
+   if (bpp == 3 || bpp == 4)
+   {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i mask = _mm_set1_epi16(0xff);
+      __m128i a          = zero;
+      __m128i c          = zero;
+
+      /* Works on one pixel at a time, widened to 16-bit lanes:
+       * pa = |b - c|, pb = |a - c| and pc = |a + b - 2c|. */
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         __m128i b        = _mm_unpacklo_epi8(
+               png_simd_load_pixel(prev + i, bpp), zero);
+         __m128i x        = _mm_unpacklo_epi8(
+               png_simd_load_pixel(in + i, bpp), zero);
+         __m128i pa       = _mm_sub_epi16(b, c);
+         __m128i pb       = _mm_sub_epi16(a, c);
+         __m128i pc       = png_simd_abs_epi16(_mm_add_epi16(pa, pb));
+         __m128i smallest;
+         __m128i nearest;
+
+         pa               = png_simd_abs_epi16(pa);
+         pb               = png_simd_abs_epi16(pb);
+         smallest         = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+         nearest          = png_simd_select(
+               _mm_cmpeq_epi16(smallest, pc), c, b);
+         nearest          = png_simd_select(
+               _mm_cmpeq_epi16(smallest, pb), b, nearest);
+         nearest          = png_simd_select(
+               _mm_cmpeq_epi16(smallest, pa), a, nearest);
+
+         a                = _mm_and_si128(_mm_add_epi16(x, nearest), mask);
+         c                = b;
+         png_simd_store_pixel(out + i, _mm_packus_epi16(a, a), bpp);
+      }
+   }
+#elif defined(RPNG_NEON)
+   if (bpp == 3 || bpp == 4)
+   {
+      uint8x8_t a = vdup_n_u8(0);
+      uint8x8_t c = vdup_n_u8(0);
+
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         uint8x8_t b      = png_simd_load_pixel(prev + i, bpp);
+         uint16x8_t pa    = vabdl_u8(b, c);
+         uint16x8_t pb    = vabdl_u8(a, c);
+         uint16x8_t pc    = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+         uint8x8_t use_a  = vmovn_u16(vandq_u16(
+                  vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+         uint8x8_t use_b  = vmovn_u16(vcleq_u16(pb, pc));
+         uint8x8_t near_  = vbsl_u8(use_a, a, vbsl_u8(use_b, b, c));
+
+         a                = vadd_u8(png_simd_load_pixel(in + i, bpp), near_);
+         c                = b;
+         png_simd_store_pixel(out + i, a, bpp);
+      }
+   }
+#endif
+
+   for (; i < bpp && i < pitch; i++)
+      out[i] = paeth(0, prev[i], 0) + in[i];
+   for (; i < pitch; i++)
+      out[i] = paeth(out[i - bpp], prev[i], prev[i - bpp]) + in[i];
+}
+
 static void png_pass_geom(const struct png_ihdr *ihdr,
       unsigned width, unsigned height,
       unsigned *bpp_out, unsigned *pitch_out, size_t *pass_size)
@@ -555,7 +869,8 @@ static int png_reverse_filter_init(const struct png_ihdr *ihdr,
 
    png_pass_geom(ihdr, ihdr->width, ihdr->height, &pngp->bpp, &pngp->pitch, &pass_size);
 
-   if (pngp->total_out < pass_size)
+   /* While still inflating, this gets checked line by line. */
+   if (!pngp->stream && pngp->total_out < pass_size)
       return -1;
 
    pngp->restore_buf_size      = 0;
@@ -579,7 +894,7 @@ error:
 static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp, unsigned filter)
 {
-   unsigned i;
+   uint8_t *tmp = NULL;
 
    switch (filter)
    {
@@ -587,33 +902,22 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
          break;
       case PNG_FILTER_SUB:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->decoded_scanline[i - pngp->bpp] + pngp->inflate_buf[i];
+         png_reverse_filter_sub(pngp->decoded_scanline,
+               pngp->inflate_buf, pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_UP:
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->prev_scanline[i] + pngp->inflate_buf[i];
+         png_reverse_filter_up(pngp->decoded_scanline,
+               pngp->inflate_buf, pngp->prev_scanline, pngp->pitch);
          break;
       case PNG_FILTER_AVERAGE:
-         for (i = 0; i < pngp->bpp; i++)
-         {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-         {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
+         png_reverse_filter_avg(pngp->decoded_scanline,
+               pngp->inflate_buf, pngp->prev_scanline,
+               pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_PAETH:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = paeth(0, pngp->prev_scanline[i], 0) + pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]) + pngp->inflate_buf[i];
+         png_reverse_filter_paeth(pngp->decoded_scanline,
+               pngp->inflate_buf, pngp->prev_scanline,
+               pngp->pitch, pngp->bpp);
          break;
 
       default:
@@ -641,11 +945,60 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
+   /* The line just decoded is the previous one for the next line. */
+   tmp                    = pngp->prev_scanline;
+   pngp->prev_scanline    = pngp->decoded_scanline;
+   pngp->decoded_scanline = tmp;
 
    return IMAGE_PROCESS_NEXT;
 }
 
+/**
+ * rpng_inflate_chunk:
+ * @process            : decoder state.
+ * @max_out            : maximum number of bytes to inflate.
+ *
+ * Inflates the next bit of the IDAT stream.
+ *
+ * Returns: 1 if there is more to inflate, 0 once the stream
+ * is exhausted and -1 on error.
+ **/
+static int rpng_inflate_chunk(struct rpng_process *process, size_t max_out)
+{
+   bool zstatus;
+   enum trans_stream_error terror;
+   uint32_t rd, wn;
+   size_t out_size = process->avail_out;
+
+   if (!process->stream || process->avail_in == 0 || out_size == 0)
+      return 0;
+
+   if (out_size > max_out)
+      out_size = max_out;
+
+   process->stream_backend->set_out(process->stream,
+         process->inflate_out, (uint32_t)out_size);
+
+   zstatus = process->stream_backend->trans(process->stream, false, &rd, &wn, &terror);
+
+   if (!zstatus && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
+      return -1;
+
+   process->avail_in    -= rd;
+   process->avail_out   -= wn;
+   process->total_out   += wn;
+   process->inflate_out += wn;
+
+   if (!terror)
+   {
+      process->stream_backend->stream_free(process->stream);
+      process->stream = NULL;
+      return 0;
+   }
+
+   return 1;
+}
+
 static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp)
 {
@@ -653,7 +1006,20 @@ static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_
 
    if (pngp->h < ihdr->height)
    {
-      unsigned filter = *pngp->inflate_buf++;
+      unsigned filter;
+      size_t needed = pngp->restore_buf_size + pngp->pitch + 1;
+
+      while (pngp->total_out < needed)
+      {
+         if (rpng_inflate_chunk(pngp, RPNG_INFLATE_CHUNK_SIZE) != 1
+               && pngp->total_out < needed)
+         {
+            ret = IMAGE_PROCESS_ERROR_END;
+            goto end;
+         }
+      }
+
+      filter = *pngp->inflate_buf++;
       pngp->restore_buf_size += 1;
       ret = png_reverse_filter_copy_line(*data,
             ihdr, pngp, filter);
@@ -769,31 +1135,23 @@ static int png_reverse_filter_iterate(rpng_t *rpng, uint32_t **data)
 static int rpng_load_image_argb_process_inflate_init(rpng_t *rpng,
       uint32_t **data, unsigned *width, unsigned *height)
 {
-   bool zstatus;
-   enum trans_stream_error terror;
-   uint32_t rd, wn;
    struct rpng_process *process = (struct rpng_process*)rpng->process;
-   bool to_continue        = (process->avail_in > 0
-         && process->avail_out > 0);
-
-   if (!to_continue)
-      goto end;
-
-   zstatus = process->stream_backend->trans(process->stream, false, &rd, &wn, &terror);
-
-   if (!zstatus && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
-      goto error;
-
-   process->avail_in -= rd;
-   process->avail_out -= wn;
-   process->total_out += wn;
 
-   if (terror)
-      return 0;
-
-end:
-   process->stream_backend->stream_free(process->stream);
-   process->stream = NULL;
+   /* The passes of an interlaced image can only be taken apart
+    * once all of it is inflated. Anything else is inflated
+    * on demand, as the scanlines are being unfiltered. */
+   if (rpng->ihdr.interlace == 1)
+   {
+      switch (rpng_inflate_chunk(process, process->avail_out))
+      {
+         case -1:
+            goto error;
+         case 1:
+            return 0;
+         default:
+            break;
+      }
+   }
 
    *width  = rpng->ihdr.width;
    *height = rpng->ihdr.height;
@@ -892,6 +1250,7 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng, unsigned *width, uns
       goto error;
 
    process->inflate_buf = inflate_buf;
+   process->inflate_out = inflate_buf;
    process->avail_in = rpng->idat_buf.size;
    process->avail_out = process->inflate_buf_size;
    process->total_out = 0;
@@ -966,8 +1325,6 @@ bool rpng_iterate_image(rpng_t *rpng)
    if (!read_chunk_header(buf, &chunk))
       return false;
 
-   *buf += 8;
-
 #if 0
    for (i = 0; i < 4; i++)
    {
@@ -326,7 +326,9 @@ static void SHA1Reset(SHA1Context *context)
    context->Corrupted  = 0;
 }
 
-static void SHA1ProcessMessageBlock(SHA1Context *context)
+/* Runs the compression function over one 64-byte block */
+static void SHA1ProcessBlock(SHA1Context *context,
+      const unsigned char *block)
 {
    const unsigned K[] =            /* Constants defined in SHA-1   */      
    {
@@ -343,10 +345,10 @@ static void SHA1ProcessMessageBlock(SHA1Context *context)
    /* Initialize the first 16 words in the array W */
    for(t = 0; t < 16; t++)
    {
-      W[t] = ((unsigned) context->Message_Block[t * 4]) << 24;
-      W[t] |= ((unsigned) context->Message_Block[t * 4 + 1]) << 16;
-      W[t] |= ((unsigned) context->Message_Block[t * 4 + 2]) << 8;
-      W[t] |= ((unsigned) context->Message_Block[t * 4 + 3]);
+      W[t] = ((unsigned) block[t * 4]) << 24;
+      W[t] |= ((unsigned) block[t * 4 + 1]) << 16;
+      W[t] |= ((unsigned) block[t * 4 + 2]) << 8;
+      W[t] |= ((unsigned) block[t * 4 + 3]);
    }
 
    for(t = 16; t < 80; t++)
@@ -414,7 +416,11 @@ static void SHA1ProcessMessageBlock(SHA1Context *context)
       (context->Message_Digest[3] + D) & 0xFFFFFFFF;
    context->Message_Digest[4] =
       (context->Message_Digest[4] + E) & 0xFFFFFFFF;
+}
 
+static void SHA1ProcessMessageBlock(SHA1Context *context)
+{
+   SHA1ProcessBlock(context, context->Message_Block);
    context->Message_Block_Index = 0;
 }
 
@@ -473,6 +479,8 @@ static void SHA1Input(SHA1Context *context,
       const unsigned char *message_array,
       unsigned length)
 {
+   uint64_t bits;
+
    if (!length)
       return;
 
@@ -482,30 +490,98 @@ static void SHA1Input(SHA1Context *context,
       return;
    }
 
-   while(length-- && !context->Corrupted)
+   /* Length is kept in bits, as two 32-bit halves */
+   bits = ((uint64_t)context->Length_High << 32) | context->Length_Low;
+   if (bits + ((uint64_t)length << 3) < bits)
    {
-      context->Message_Block[context->Message_Block_Index++] =
-         (*message_array & 0xFF);
+      context->Corrupted = 1; /* Message is too long */
+      return;
+   }
 
-      context->Length_Low += 8;
-      /* Force it to 32 bits */
-      context->Length_Low &= 0xFFFFFFFF;
-      if (context->Length_Low == 0)
+   bits                += (uint64_t)length << 3;
+   context->Length_Low  = (unsigned)(bits & 0xFFFFFFFF);
+   context->Length_High = (unsigned)(bits >> 32);
+
+   while (length)
+   {
+      unsigned copy;
+
+      /* Whole blocks are hashed straight from the input */
+      if (context->Message_Block_Index == 0 && length >= 64)
       {
-         context->Length_High++;
-         /* Force it to 32 bits */
-         context->Length_High &= 0xFFFFFFFF;
-         if (context->Length_High == 0)
-            context->Corrupted = 1; /* Message is too long */
+         SHA1ProcessBlock(context, message_array);
+         message_array += 64;
+         length        -= 64;
+         continue;
       }
 
+      copy = 64 - context->Message_Block_Index;
+      if (copy > length)
+         copy = length;
+
+      memcpy(context->Message_Block + context->Message_Block_Index,
+            message_array, copy);
+      context->Message_Block_Index += copy;
+      message_array                += copy;
+      length                       -= copy;
+
       if (context->Message_Block_Index == 64)
          SHA1ProcessMessageBlock(context);
+   }
+}
 
-      message_array++;
+/**
+ * sha1_init:
+ * @context           : SHA1 state to reset.
+ *
+ * Starts a new SHA1 digest, fed with sha1_update().
+ **/
+void sha1_init(SHA1Context *context)
+{
+   SHA1Reset(context);
+}
+
+/**
+ * sha1_update:
+ * @context           : SHA1 state.
+ * @data              : Next bytes of the message.
+ * @len               : Size of @data.
+ **/
+void sha1_update(SHA1Context *context, const void *data, size_t len)
+{
+   const unsigned char *in = (const unsigned char*)data;
+
+   while (len)
+   {
+      unsigned chunk = len > 0x10000000 ? 0x10000000 : (unsigned)len;
+
+      SHA1Input(context, in, chunk);
+      in  += chunk;
+      len -= chunk;
    }
 }
 
+/**
+ * sha1_final:
+ * @context           : SHA1 state, can't be updated any further.
+ * @digest            : Receives the 20-byte digest.
+ *
+ * Returns: false if the message was too long to hash.
+ **/
+bool sha1_final(SHA1Context *context, uint8_t *digest)
+{
+   unsigned i;
+
+   if (!SHA1Result(context))
+      return false;
+
+   for (i = 0; i < 20; i++)
+      digest[i] = (uint8_t)(context->Message_Digest[i >> 2]
+            >> (24 - (i & 3) * 8));
+
+   return true;
+}
+
 int sha1_calculate(const char *path, char *result)
 {
    SHA1Context sha;
@@ -0,0 +1,110 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rhash_multi.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <rhash.h>
+#include <encodings/crc32.h>
+#include <streams/file_stream.h>
+
+/* How much each algorithm walks before handing over to the next one.
+ * Small enough to still be in L1 when the last algorithm gets to it. */
+#define RHASH_MULTI_SLICE (16 * 1024)
+
+/* Read size of rhash_multi_file() */
+#define RHASH_MULTI_READ  (256 * 1024)
+
+void rhash_multi_init(rhash_multi_t *hash, unsigned types)
+{
+   memset(hash, 0, sizeof(*hash));
+   hash->types = types;
+
+   if (types & RHASH_MD5)
+      MD5_Init(&hash->md5);
+   if (types & RHASH_SHA1)
+      sha1_init(&hash->sha1);
+}
+
+void rhash_multi_update(rhash_multi_t *hash, const void *data, size_t len)
+{
+   const uint8_t *in = (const uint8_t*)data;
+
+   hash->size += len;
+
+   while (len)
+   {
+      size_t slice = len > RHASH_MULTI_SLICE ? RHASH_MULTI_SLICE : len;
+
+      if (hash->types & RHASH_CRC32)
+         hash->crc32 = encoding_crc32(hash->crc32, in, slice);
+      if (hash->types & RHASH_MD5)
+         MD5_Update(&hash->md5, in, (unsigned long)slice);
+      if (hash->types & RHASH_SHA1)
+         sha1_update(&hash->sha1, in, slice);
+
+      in  += slice;
+      len -= slice;
+   }
+}
+
+bool rhash_multi_file(rhash_multi_t *hash, const char *path)
+{
+   ssize_t rv;
+   uint8_t *buf = NULL;
+   RFILE *file  = filestream_open(path, RFILE_MODE_READ, -1);
+
+   if (!file)
+      return false;
+
+   buf = (uint8_t*)malloc(RHASH_MULTI_READ);
+   if (!buf)
+   {
+      filestream_close(file);
+      return false;
+   }
+
+   while ((rv = filestream_read(file, buf, RHASH_MULTI_READ)) > 0)
+      rhash_multi_update(hash, buf, (size_t)rv);
+
+   free(buf);
+   filestream_close(file);
+   return rv == 0;
+}
+
+void rhash_multi_final(const rhash_multi_t *hash, rhash_digest_t *digest)
+{
+   memset(digest, 0, sizeof(*digest));
+   digest->crc32 = hash->crc32;
+
+   if (hash->types & RHASH_MD5)
+   {
+      MD5_CTX md5 = hash->md5;
+      MD5_Final(digest->md5, &md5);
+   }
+
+   if (hash->types & RHASH_SHA1)
+   {
+      SHA1Context sha1 = hash->sha1;
+      sha1_final(&sha1, digest->sha1);
+   }
+}
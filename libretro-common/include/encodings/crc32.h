@@ -30,9 +30,14 @@
 
 RETRO_BEGIN_DECLS
 
-
+/* Uses PCLMULQDQ (x86) or the ARMv8 CRC32 instructions when
+ * available, slicing-by-16 tables otherwise. */
 uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len);
 
+uint32_t encoding_crc32_generic(uint32_t crc, const uint8_t *buf, size_t len);
+
+const char *encoding_crc32_hw_name(void);
+
 RETRO_END_DECLS
 
 #endif
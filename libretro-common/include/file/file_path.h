@@ -84,6 +84,19 @@ bool path_is_compressed_file(const char *path);
  */
 bool path_file_exists(const char *path);
 
+/**
+ * path_replace_file:
+ * @src                : path of the new file
+ * @dst                : path of the file to replace
+ *
+ * Moves @src over @dst, replacing @dst if it exists.
+ * Where the platform allows it, @dst is never missing
+ * while this happens.
+ *
+ * Returns: true (1) if @src was moved, otherwise false (0).
+ */
+bool path_replace_file(const char *src, const char *dst);
+
 /**
  * path_get_archive_delim:
  * @path               : path
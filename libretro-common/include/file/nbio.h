@@ -50,8 +50,46 @@ RETRO_BEGIN_DECLS
 #define BIO_WRITE   4
 #endif
 
+/* Like NBIO_READ, but maps the file rather than reading it, where the
+ * backend can. The pointer is then a private, copy-on-write view. */
+#ifndef NBIO_READ_MAPPED
+#define NBIO_READ_MAPPED 5
+#endif
+
 struct nbio_t;
 
+typedef struct nbio_intf
+{
+   /* Whether the backend can be used on this system */
+   bool (*init)(void);
+
+   void *(*open)(const char *filename, unsigned mode);
+   void (*begin_read)(void *data);
+   void (*begin_write)(void *data);
+   bool (*iterate)(void *data);
+   void (*resize)(void *data, size_t len);
+   void *(*get_ptr)(void *data, size_t *len);
+   void (*cancel)(void *data);
+   void (*free)(void *data);
+
+   const char *ident;
+} nbio_intf_t;
+
+/*
+ * Makes nbio_open use the backend called ident ("io_uring", "threads"
+ * or "stdio"), or the best one available here if ident is NULL.
+ * Returns false if that backend is not available.
+ */
+bool nbio_set_backend(const char *ident);
+
+/*
+ * Returns the name of the backend nbio_open uses.
+ * The first call to this, nbio_set_backend or nbio_open sets the
+ * backend up, and must not race with other nbio calls. Programs that
+ * use nbio from several threads should call this before starting them.
+ */
+const char *nbio_get_backend(void);
+
 /*
  * Creates an nbio structure for performing the given operation on the given file.
  */
@@ -71,7 +109,9 @@ void nbio_begin_write(struct nbio_t* handle);
 
 /*
  * Performs part of the requested operation, or checks how it's going.
- * When it returns true, it's done.
+ * When it returns true, it's done. Backends that can keep transfers
+ * going in the background return straight away; those handles are
+ * then all moved forward by any call.
  */
 bool nbio_iterate(struct nbio_t* handle);
 
@@ -83,7 +123,8 @@ void nbio_resize(struct nbio_t* handle, size_t len);
 
 /*
  * Returns a pointer to the file data. Writable only if structure was not created with nbio_read.
- * If any operation is in progress, the pointer will be NULL, but len will still be correct.
+ * If any operation is in progress, or the last one failed, the pointer will be NULL,
+ * but len will still be correct.
  */
 void* nbio_get_ptr(struct nbio_t* handle, size_t* len);
 
@@ -67,6 +67,20 @@ bool image_texture_color_convert(unsigned r_shift,
 bool image_texture_load(struct texture_image *img, const char *path);
 void image_texture_free(struct texture_image *img);
 
+/**
+ * image_texture_downscale:
+ * @img                : Image to shrink in place.
+ * @max_width          : Maximum width, or 0 for no limit.
+ * @max_height         : Maximum height, or 0 for no limit.
+ *
+ * Box filters @img down so that it fits in @max_width x @max_height,
+ * keeping its aspect ratio. Images that already fit are left alone.
+ *
+ * Returns: true if @img was resized, otherwise false.
+ **/
+bool image_texture_downscale(struct texture_image *img,
+      unsigned max_width, unsigned max_height);
+
 /* Image transfer */
 
 void image_transfer_free(void *data, enum image_type_enum type);
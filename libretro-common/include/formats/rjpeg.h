@@ -39,6 +39,33 @@ int rjpeg_process_image(rjpeg_t *rjpeg, void **buf,
 
 bool rjpeg_set_buf_ptr(rjpeg_t *rjpeg, void *data);
 
+/**
+ * rjpeg_get_size:
+ * @rjpeg               : JPEG decoder handle, with the buffer set.
+ * @size                : Size of the buffer.
+ * @width               : Receives the image width.
+ * @height              : Receives the image height.
+ *
+ * Reads the image size from the JPEG header, without decoding.
+ *
+ * Returns: true if the header could be parsed, otherwise false.
+ **/
+bool rjpeg_get_size(rjpeg_t *rjpeg, size_t size,
+      unsigned *width, unsigned *height);
+
+/**
+ * rjpeg_set_scale:
+ * @rjpeg               : JPEG decoder handle.
+ * @denom               : Downscaling factor; 1, 2, 4 or 8.
+ *
+ * Makes rjpeg_process_image() decode directly to 1/@denom of the
+ * image size in each axis (rounded up), using a reduced IDCT
+ * instead of decoding at full size and shrinking afterwards.
+ *
+ * Returns: true if @denom is supported, otherwise false.
+ **/
+bool rjpeg_set_scale(rjpeg_t *rjpeg, unsigned denom);
+
 void rjpeg_free(rjpeg_t *rjpeg);
 
 rjpeg_t *rjpeg_alloc(void);
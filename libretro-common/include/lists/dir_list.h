@@ -82,6 +82,41 @@ void dir_list_free(struct string_list *list);
 int dir_list_read(const char *dir, struct string_list *list, struct string_list *ext_list,
       bool include_dirs, bool include_hidden, bool include_compressed, bool recursive);
 
+struct dir_list_reader;
+
+/**
+ * dir_list_reader_new:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : include compressed files, even when not part of ext.
+ *
+ * Opens a directory for an incremental, non-recursive listing, so that
+ * large directories can be read in steps (e.g. from a task).
+ *
+ * Returns: reader handle on success, NULL in case of error.
+ * Has to be freed with dir_list_reader_free().
+ **/
+struct dir_list_reader *dir_list_reader_new(const char *dir,
+      const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed);
+
+/**
+ * dir_list_reader_step:
+ * @reader             : reader handle.
+ * @list               : the string list to add files to.
+ * @max_entries        : maximum number of directory entries to
+ *                       inspect during this call.
+ *
+ * Returns: 1 if there are entries left, 0 once the listing
+ * is complete, -1 on error.
+ **/
+int dir_list_reader_step(struct dir_list_reader *reader,
+      struct string_list *list, size_t max_entries);
+
+void dir_list_reader_free(struct dir_list_reader *reader);
+
 RETRO_END_DECLS
 
 #endif
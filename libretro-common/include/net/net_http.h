@@ -33,6 +33,13 @@ RETRO_BEGIN_DECLS
 
 struct http_t;
 struct http_connection_t;
+struct http_pool_t;
+
+/* Receives the body of a successful response as it arrives,
+ * instead of it being collected for net_http_data.
+ * Return false to abort the transfer. */
+typedef bool (*net_http_sink_t)(void *userdata,
+      const uint8_t *data, size_t len);
 
 struct http_connection_t *net_http_connection_new(const char *url, const char *method, const char *data);
 
@@ -46,8 +53,27 @@ const char *net_http_connection_url(struct http_connection_t *conn);
 
 struct http_t *net_http_new(struct http_connection_t *conn);
 
+/* Like net_http_new, but the request goes on a keep-alive socket
+ * from the pool, shared with other requests to the same host.
+ * GET requests may be pipelined behind others on a busy socket.
+ * The request may wait in net_http_update until a socket is free. */
+struct http_t *net_http_new_pooled(struct http_connection_t *conn,
+      struct http_pool_t *pool);
+
+struct http_pool_t *net_http_pool_new(void);
+
+/* Closes the pool's sockets. Every handle using the pool
+ * must have been deleted first. */
+void net_http_pool_free(struct http_pool_t *pool);
+
+/* Streams the body to a sink; call before the first net_http_update.
+ * net_http_data then returns NULL, with the length delivered. */
+void net_http_set_sink(struct http_t *state,
+      net_http_sink_t sink, void *userdata);
+
 /* You can use this to call net_http_update 
- * only when something will happen; select() it for reading. */
+ * only when something will happen; select() it for reading.
+ * Returns -1 while a pooled request waits for a socket. */
 int net_http_fd(struct http_t *state);
 
 /* Returns true if it's done, or if something broke.
@@ -48,6 +48,8 @@ bool path_is_valid(const char *path);
 
 int32_t path_get_size(const char *path);
 
+bool path_get_mtime(const char *path, int64_t *mtime);
+
 /**
  * path_mkdir_norecurse:
  * @dir                : directory
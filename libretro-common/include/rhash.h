@@ -55,6 +55,7 @@
 #endif
 
 #include <retro_inline.h>
+#include <boolean.h>
 
 #include <retro_common_api.h>
 
@@ -86,6 +87,12 @@ typedef struct SHA1Context
 
 int sha1_calculate(const char *path, char *result);
 
+void sha1_init(SHA1Context *context);
+
+void sha1_update(SHA1Context *context, const void *data, size_t len);
+
+bool sha1_final(SHA1Context *context, uint8_t *digest);
+
 uint32_t djb2_calculate(const char *str);
 
 /* Any 32-bit or wider unsigned integer data type will do */
@@ -127,6 +134,66 @@ void MD5_Init(MD5_CTX *ctx);
 void MD5_Update(MD5_CTX *ctx, const void *data, unsigned long size);
 void MD5_Final(unsigned char *result, MD5_CTX *ctx);
 
+/* Multi-hash: any mix of CRC32, MD5 and SHA1 over one pass of the data.
+ * The input is walked in cache-sized slices, each going through every
+ * requested algorithm before the next slice is touched, so a file is
+ * read (and pulled into the cache) only once. See rhash_multi.c. */
+enum rhash_type
+{
+   RHASH_CRC32 = 1 << 0,
+   RHASH_MD5   = 1 << 1,
+   RHASH_SHA1  = 1 << 2
+};
+
+typedef struct rhash_multi
+{
+   MD5_CTX md5;
+   SHA1Context sha1;
+   uint64_t size;              /* Bytes hashed so far              */
+   uint32_t crc32;             /* Valid at any time                */
+   unsigned types;             /* RHASH_* mask                     */
+} rhash_multi_t;
+
+typedef struct rhash_digest
+{
+   uint32_t crc32;
+   uint8_t md5[16];
+   uint8_t sha1[20];
+} rhash_digest_t;
+
+/**
+ * rhash_multi_init:
+ * @hash              : State to reset.
+ * @types             : RHASH_* mask of the digests to compute.
+ **/
+void rhash_multi_init(rhash_multi_t *hash, unsigned types);
+
+/**
+ * rhash_multi_update:
+ * @hash              : State.
+ * @data              : Next bytes of the message.
+ * @len               : Size of @data.
+ **/
+void rhash_multi_update(rhash_multi_t *hash, const void *data, size_t len);
+
+/**
+ * rhash_multi_file:
+ * @hash              : State.
+ * @path              : File to stream through rhash_multi_update().
+ *
+ * Returns: false if the file couldn't be read.
+ **/
+bool rhash_multi_file(rhash_multi_t *hash, const char *path);
+
+/**
+ * rhash_multi_final:
+ * @hash              : State, left untouched so it can be extended
+ *                      further (e.g. padded) and finalized again.
+ * @digest            : Receives the digests in @hash->types, the
+ *                      others are zeroed.
+ **/
+void rhash_multi_final(const rhash_multi_t *hash, rhash_digest_t *digest);
+
 RETRO_END_DECLS
 
 #endif
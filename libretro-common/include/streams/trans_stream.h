@@ -98,9 +98,18 @@ const struct trans_stream_backend* trans_stream_get_zlib_deflate_backend(void);
 const struct trans_stream_backend* trans_stream_get_zlib_inflate_backend(void);
 const struct trans_stream_backend* trans_stream_get_pipe_backend(void);
 
+/* The LZ4 backends encode/decode their whole input as one block per
+ * trans() call. A block never exceeds TRANS_STREAM_LZ4_BOUND(in_size). */
+#define TRANS_STREAM_LZ4_BOUND(size) ((size) + (size) / 255 + 16)
+
+const struct trans_stream_backend* trans_stream_get_lz4_compress_backend(void);
+const struct trans_stream_backend* trans_stream_get_lz4_decompress_backend(void);
+
 extern const struct trans_stream_backend zlib_deflate_backend;
 extern const struct trans_stream_backend zlib_inflate_backend;
 extern const struct trans_stream_backend pipe_backend;
+extern const struct trans_stream_backend lz4_compress_backend;
+extern const struct trans_stream_backend lz4_decompress_backend;
 
 RETRO_END_DECLS
 
@@ -87,6 +87,37 @@ void dir_list_free(struct string_list *list)
    string_list_free(list);
 }
 
+/**
+ * dir_list_ext_supported:
+ * @ext_list           : pointer to allowed file extensions listing.
+ * @file_ext           : file extension of the directory listing entry.
+ *
+ * Case-insensitively matches @file_ext against @ext_list, where
+ * list entries may optionally carry a leading '.'.
+ *
+ * Returns: true (1) if @file_ext is part of @ext_list, otherwise false (0).
+ **/
+static bool dir_list_ext_supported(const struct string_list *ext_list,
+      const char *file_ext)
+{
+   size_t i;
+
+   if (!ext_list)
+      return false;
+
+   for (i = 0; i < ext_list->size; i++)
+   {
+      const char *elem = ext_list->elems[i].data;
+
+      if (*elem == '.')
+         elem++;
+      if (string_is_equal_noncase(elem, file_ext))
+         return true;
+   }
+
+   return false;
+}
+
 /**
  * parse_dir_entry:
  * @name               : name of the directory listing entry.
@@ -117,16 +148,12 @@ static int parse_dir_entry(const char *name, char *file_path,
    if (!is_dir)
    {
       is_compressed_file = path_is_compressed_file(file_path);
-      if (string_list_find_elem_prefix(ext_list, ".", file_ext))
-         supported_by_core = true;
+      supported_by_core  = dir_list_ext_supported(ext_list, file_ext);
    }
 
    if (!include_dirs && is_dir)
       return 1;
 
-   if ((memcmp(name, ".", 1) == 0) || (memcmp(name, "..", 2) == 0))
-      return 1;
-
    if (!is_dir && ext_list &&
            ((!is_compressed_file && !supported_by_core) ||
             (!supported_by_core && !include_compressed)))
@@ -153,6 +180,81 @@ static int parse_dir_entry(const char *name, char *file_path,
    return 0;
 }
 
+struct dir_list_reader
+{
+   struct RDIR *entry;
+   struct string_list *ext_list;
+   char *dir;
+   bool include_dirs;
+   bool include_hidden;
+   bool include_compressed;
+};
+
+static struct RDIR *dir_list_open(const char *dir, bool include_hidden)
+{
+   struct RDIR *entry = retro_opendir(dir);
+
+   if (!entry)
+      return NULL;
+
+   if (retro_dirent_error(entry))
+   {
+      retro_closedir(entry);
+      return NULL;
+   }
+
+#ifdef _WIN32
+   if (include_hidden)
+      entry->entry.dwFileAttributes |= FILE_ATTRIBUTE_HIDDEN;
+   else
+      entry->entry.dwFileAttributes &= ~FILE_ATTRIBUTE_HIDDEN;
+#endif
+
+   return entry;
+}
+
+/**
+ * dir_list_read_entry:
+ *
+ * Handles the entry @entry currently points at.
+ *
+ * Returns: zero on success, -1 on error, 1 if the entry
+ * was skipped.
+ **/
+static int dir_list_read_entry(struct RDIR *entry, const char *dir,
+      struct string_list *list, struct string_list *ext_list,
+      bool include_dirs, bool include_hidden,
+      bool include_compressed, bool recursive)
+{
+   char file_path[PATH_MAX_LENGTH];
+   bool is_dir                     = false;
+   const char *name                = retro_dirent_get_name(entry);
+   const char *file_ext            = NULL;
+
+   /* Dot files (and with them '.' and '..') are never part
+    * of a listing, so bail out before touching the filesystem. */
+   if (!name || *name == '.')
+      return 1;
+
+   file_ext     = path_get_extension(name);
+   file_path[0] = '\0';
+
+   fill_pathname_join(file_path, dir, name, sizeof(file_path));
+   is_dir = retro_dirent_is_dir(entry, file_path);
+
+   if (is_dir && recursive)
+   {
+      if (strstr(name, "."))
+         return 1;
+
+      dir_list_read(file_path, list, ext_list, include_dirs,
+            include_hidden, include_compressed, recursive);
+   }
+
+   return parse_dir_entry(name, file_path, is_dir,
+         include_dirs, include_compressed, list, ext_list, file_ext);
+}
+
 /**
  * dir_list_new:
  * @dir                : directory path.
@@ -212,66 +314,117 @@ int dir_list_read(const char *dir,
       bool include_dirs, bool include_hidden,
       bool include_compressed, bool recursive)
 {
-   struct RDIR *entry = retro_opendir(dir);
+   struct RDIR *entry = dir_list_open(dir, include_hidden);
 
    if (!entry)
       return -1;
 
-   if (retro_dirent_error(entry))
+   while (retro_readdir(entry))
    {
-      retro_closedir(entry);
-      return -1;
+      if (dir_list_read_entry(entry, dir, list, ext_list, include_dirs,
+               include_hidden, include_compressed, recursive) == -1)
+      {
+         retro_closedir(entry);
+         return -1;
+      }
    }
 
-#ifdef _WIN32
-   if (include_hidden)
-      entry->entry.dwFileAttributes |= FILE_ATTRIBUTE_HIDDEN;
-   else
-      entry->entry.dwFileAttributes &= ~FILE_ATTRIBUTE_HIDDEN;
-#endif
+   retro_closedir(entry);
 
-   while (retro_readdir(entry))
+   return 0;
+}
+
+/**
+ * dir_list_reader_new:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : include compressed files, even when not part of ext.
+ *
+ * Opens @dir for an incremental, non-recursive listing.
+ *
+ * Returns: reader handle on success, NULL in case of error.
+ * Has to be freed with dir_list_reader_free().
+ **/
+struct dir_list_reader *dir_list_reader_new(const char *dir,
+      const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed)
+{
+   struct dir_list_reader *reader = NULL;
+   struct RDIR *entry             = dir_list_open(dir, include_hidden);
+
+   if (!entry)
+      return NULL;
+
+   reader = (struct dir_list_reader*)calloc(1, sizeof(*reader));
+   if (!reader)
    {
-      char file_path[PATH_MAX_LENGTH];
-      bool is_dir                     = false;
-      int ret                         = 0;
-      const char *name                = retro_dirent_get_name(entry);
-      const char *file_ext            = path_get_extension(name);
+      retro_closedir(entry);
+      return NULL;
+   }
 
-      file_path[0] = '\0';
+   reader->entry              = entry;
+   reader->dir                = strdup(dir);
+   reader->include_dirs       = include_dirs;
+   reader->include_hidden     = include_hidden;
+   reader->include_compressed = include_compressed;
 
-      fill_pathname_join(file_path, dir, name, sizeof(file_path));
-      is_dir = retro_dirent_is_dir(entry, file_path);
+   if (ext)
+      reader->ext_list        = string_split(ext, "|");
 
-      if (!include_hidden)
-      {
-         if (*name == '.')
-            continue;
-      }
+   return reader;
+}
 
-      if(is_dir && recursive)
-      {
-         if(strstr(name, ".") || strstr(name, ".."))
-            continue;
+/**
+ * dir_list_reader_step:
+ * @reader             : reader handle.
+ * @list               : the string list to add files to.
+ * @max_entries        : maximum number of directory entries to
+ *                       inspect during this call.
+ *
+ * Continues the listing started by dir_list_reader_new().
+ *
+ * Returns: 1 if there are entries left, 0 once the listing
+ * is complete, -1 on error.
+ **/
+int dir_list_reader_step(struct dir_list_reader *reader,
+      struct string_list *list, size_t max_entries)
+{
+   size_t i;
 
-         dir_list_read(file_path, list, ext_list, include_dirs,
-               include_hidden, include_compressed, recursive);
-      }
+   if (!reader || !reader->entry)
+      return -1;
 
-      ret    = parse_dir_entry(name, file_path, is_dir,
-            include_dirs, include_compressed, list, ext_list, file_ext);
+   for (i = 0; i < max_entries; i++)
+   {
+      if (!retro_readdir(reader->entry))
+         return 0;
 
-      if (ret == -1)
-      {
-         retro_closedir(entry);
+      if (dir_list_read_entry(reader->entry, reader->dir, list,
+               reader->ext_list, reader->include_dirs,
+               reader->include_hidden, reader->include_compressed,
+               false) == -1)
          return -1;
-      }
-
-      if (ret == 1)
-         continue;
    }
 
-   retro_closedir(entry);
+   return 1;
+}
 
-   return 0;
+/**
+ * dir_list_reader_free:
+ * @reader             : reader handle.
+ *
+ * Closes the directory and frees @reader.
+ **/
+void dir_list_reader_free(struct dir_list_reader *reader)
+{
+   if (!reader)
+      return;
+
+   if (reader->entry)
+      retro_closedir(reader->entry);
+   string_list_free(reader->ext_list);
+   free(reader->dir);
+   free(reader);
 }
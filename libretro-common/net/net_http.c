@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <time.h>
 
 #include <net/net_http.h>
 #include <net/net_compat.h>
@@ -30,12 +31,30 @@
 #include <compat/strl.h>
 #include <string/stdstring.h>
 
+/* Sockets a pool keeps open per host, and how many requests may
+ * be queued on one of them before the first is answered. */
+#define NET_HTTP_POOL_MAX_PER_HOST  4
+#define NET_HTTP_POOL_PIPELINE      4
+/* Seconds an idle pooled socket is kept; servers commonly drop
+ * idle keep-alive connections after 15 seconds or more. */
+#define NET_HTTP_POOL_IDLE_TIMEOUT  10
+
+/* Initial size of the receive buffer; header lines may grow
+ * it up to NET_HTTP_RX_MAX. */
+#define NET_HTTP_RX_SIZE            (32 * 1024)
+#define NET_HTTP_RX_MAX             (256 * 1024)
+/* Bytes read by a single net_http_update call at most,
+ * so a fast download doesn't starve the caller. */
+#define NET_HTTP_UPDATE_BUDGET      (1024 * 1024)
+
 enum
 {
    P_HEADER_TOP = 0,
    P_HEADER,
    P_BODY,
    P_BODY_CHUNKLEN,
+   P_BODY_CHUNKEND,
+   P_BODY_TRAILER,
    P_DONE,
    P_ERROR
 };
@@ -47,19 +66,73 @@ enum
    T_CHUNK
 };
 
-struct http_t
+struct http_socket_t
 {
+   struct http_socket_t *next;
+   struct http_pool_t *pool;
+
+   char *domain;
+   int port;
    int fd;
+
+   /* Handles attached to the socket, and the number of
+    * requests written to and responses read from it. */
+   unsigned users;
+   unsigned sent;
+   unsigned received;
+
+   /* No further responses will be read from the socket. */
+   bool dead;
+
+   /* Bytes read past the end of the last response; they
+    * belong to the next pipelined one. */
+   char *leftover;
+   size_t leftover_len;
+
+   time_t last_used;
+};
+
+struct http_pool_t
+{
+   struct http_socket_t *sockets;
+};
+
+struct http_t
+{
    int status;
-   
+
    char part;
    char bodytype;
    bool error;
-   
+   bool keep_alive;
+   bool retried;
+
+   /* The request is kept, so that it can be sent again on another
+    * socket if a reused one turns out to have been closed. */
+   char *domain;
+   int port;
+   char *request;
+   size_t request_len;
+   bool pipeline;
+
+   struct http_pool_t *pool;
+   struct http_socket_t *sock;
+   unsigned seq;
+
+   /* Received bytes not parsed yet are rx[rx_pos..rx_len). */
+   char *rx;
+   size_t rx_pos;
+   size_t rx_len;
+   size_t rx_size;
+
    size_t pos;
    size_t len;
+   size_t chunk_left;
    size_t buflen;
    char * data;
+
+   net_http_sink_t sink;
+   void *sink_data;
 };
 
 struct http_connection_t
@@ -144,15 +217,6 @@ error:
    return -1;
 }
 
-static void net_http_send_str(int fd, bool *error, const char *text)
-{
-   if (*error)
-      return;
-
-   if (!socket_send_all_blocking(fd, text, strlen(text), true))
-      *error = true;
-}
-
 struct http_connection_t *net_http_connection_new(const char *url,
       const char *method, const char *data)
 {
@@ -223,11 +287,12 @@ bool net_http_connection_done(struct http_connection_t *conn)
    if (*conn->scan == '\0')
       return false;
 
-   *conn->scan  = '\0';
    conn->port   = 80;
 
    if (*conn->scan == ':')
    {
+      *conn->scan = '\0';
+
       if (!isdigit((int)conn->scan[1]))
          return false;
 
@@ -237,6 +302,8 @@ bool net_http_connection_done(struct http_connection_t *conn)
          return false;
    }
 
+   *conn->scan  = '\0';
+
    *location = conn->scan + 1;
 
    return true;
@@ -272,325 +339,726 @@ const char *net_http_connection_url(struct http_connection_t *conn)
    return conn->urlcopy;
 }
 
-struct http_t *net_http_new(struct http_connection_t *conn)
+static char *net_http_build_request(struct http_connection_t *conn,
+      bool keep_alive, size_t *len)
 {
-   bool error            = false;
-   int fd                = -1;
-   struct http_t *state  = NULL;
+   size_t size, pos;
+   char *request    = NULL;
+   size_t post_len  = 0;
+   const char *method = conn->methodcopy ? conn->methodcopy : "GET";
+   bool post        = conn->methodcopy
+      && (memcmp(conn->methodcopy, "POST", 4) == 0);
+
+   if (post)
+   {
+      if (!conn->postdatacopy)
+         return NULL;
+      post_len = strlen(conn->postdatacopy);
+   }
 
-   if (!conn)
-      goto error;
+   size = strlen(method) + strlen(conn->location) + strlen(conn->domain)
+      + (conn->contenttypecopy ? strlen(conn->contenttypecopy) : 0)
+      + post_len + 256;
 
-   fd = net_http_new_socket(conn->domain, conn->port);
-   if (fd < 0)
-      goto error;
-
-   error = false;
+   request = (char*)malloc(size);
+   if (!request)
+      return NULL;
 
    /* This is a bit lazy, but it works. */
-   if (conn->methodcopy)
+   pos = snprintf(request, size, "%s /%s HTTP/1.1\r\nHost: %s",
+         method, conn->location, conn->domain);
+
+   if (conn->port != 80)
+      pos += snprintf(request + pos, size - pos, ":%i", conn->port);
+
+   pos += snprintf(request + pos, size - pos, "\r\n");
+
+   /* this is not being set anywhere yet */
+   if (conn->contenttypecopy)
+      pos += snprintf(request + pos, size - pos,
+            "Content-Type: %s\r\n", conn->contenttypecopy);
+
+   if (post)
    {
-      net_http_send_str(fd, &error, conn->methodcopy);
-      net_http_send_str(fd, &error, " /");
+      if (!conn->contenttypecopy)
+         pos += snprintf(request + pos, size - pos,
+               "Content-Type: application/x-www-form-urlencoded\r\n");
+
+      pos += snprintf(request + pos, size - pos,
+            "Content-Length: %llu\r\n", (long long unsigned)post_len);
    }
-   else
+
+   pos += snprintf(request + pos, size - pos,
+         "User-Agent: libretro\r\nConnection: %s\r\n\r\n",
+         keep_alive ? "keep-alive" : "close");
+
+   if (post)
    {
-      net_http_send_str(fd, &error, "GET /");
+      memcpy(request + pos, conn->postdatacopy, post_len);
+      pos += post_len;
    }
 
-   net_http_send_str(fd, &error, conn->location);
-   net_http_send_str(fd, &error, " HTTP/1.1\r\n");
+   *len = pos;
+   return request;
+}
 
-   net_http_send_str(fd, &error, "Host: ");
-   net_http_send_str(fd, &error, conn->domain);
+static struct http_socket_t *net_http_socket_new(struct http_pool_t *pool,
+      const char *domain, int port)
+{
+   struct http_socket_t *sock = NULL;
+   int fd                     = net_http_new_socket(domain, port);
 
-   if (conn->port != 80)
+   if (fd < 0)
+      return NULL;
+
+   sock = (struct http_socket_t*)calloc(1, sizeof(*sock));
+   if (!sock)
    {
-      char portstr[16];
+      socket_close(fd);
+      return NULL;
+   }
 
-      portstr[0] = '\0';
+   sock->fd     = fd;
+   sock->port   = port;
+   sock->domain = strdup(domain);
+   sock->pool   = pool;
 
-      snprintf(portstr, sizeof(portstr), ":%i", conn->port);
-      net_http_send_str(fd, &error, portstr);
+   if (pool)
+   {
+      sock->next    = pool->sockets;
+      pool->sockets = sock;
    }
 
-   net_http_send_str(fd, &error, "\r\n");
+   return sock;
+}
 
-   /* this is not being set anywhere yet */
-   if (conn->contenttypecopy)
+static void net_http_socket_free(struct http_socket_t *sock)
+{
+   if (sock->pool)
    {
-      net_http_send_str(fd, &error, "Content-Type: ");
-      net_http_send_str(fd, &error, conn->contenttypecopy);
-      net_http_send_str(fd, &error, "\r\n");
+      struct http_socket_t **link = &sock->pool->sockets;
+
+      while (*link != sock)
+         link = &(*link)->next;
+      *link = sock->next;
    }
 
-   if (conn->methodcopy && (memcmp(conn->methodcopy, "POST", 4) == 0))
+   socket_close(sock->fd);
+   free(sock->domain);
+   free(sock->leftover);
+   free(sock);
+}
+
+/* Closes the socket once its last handle lets go of it,
+ * unless it can be kept in the pool for the next request. */
+static void net_http_socket_release(struct http_socket_t *sock)
+{
+   if (--sock->users)
+      return;
+
+   if (sock->dead || !sock->pool)
+      net_http_socket_free(sock);
+   else
+      sock->last_used = time(NULL);
+}
+
+/**
+ * net_http_pool_get:
+ * @pool                 : connection pool.
+ * @domain               : host to connect to.
+ * @port                 : port to connect to.
+ * @pipeline             : whether the request may be queued behind
+ *                         others on a busy socket.
+ *
+ * Picks the socket a request to @domain:@port should be sent on.
+ * An idle one is preferred, then a new one while the host has less
+ * than NET_HTTP_POOL_MAX_PER_HOST, then the least busy one that
+ * still has room in its pipeline. Idle sockets that have timed out
+ * are closed on the way.
+ *
+ * Returns: socket, or NULL if they are all busy (with @full set)
+ * or a new one couldn't be opened.
+ **/
+static struct http_socket_t *net_http_pool_get(struct http_pool_t *pool,
+      const char *domain, int port, bool pipeline, bool *full)
+{
+   struct http_socket_t *sock = NULL;
+   struct http_socket_t *next = NULL;
+   struct http_socket_t *best = NULL;
+   unsigned best_pending      = 0;
+   unsigned count             = 0;
+   time_t now                 = time(NULL);
+
+   for (sock = pool->sockets; sock; sock = next)
    {
-      size_t post_len, len;
-      char *len_str        = NULL;
+      unsigned pending = sock->sent - sock->received;
 
-      if (!conn->postdatacopy)
-         goto error;
+      next = sock->next;
 
-      if (!conn->contenttypecopy)
-         net_http_send_str(fd, &error,
-               "Content-Type: application/x-www-form-urlencoded\r\n");
+      if (!sock->users && (sock->dead
+               || now - sock->last_used > NET_HTTP_POOL_IDLE_TIMEOUT))
+      {
+         net_http_socket_free(sock);
+         continue;
+      }
 
-      net_http_send_str(fd, &error, "Content-Length: ");
+      if (sock->port != port || !string_is_equal(sock->domain, domain))
+         continue;
 
-      post_len = strlen(conn->postdatacopy);
-#ifdef _WIN32
-      len = snprintf(NULL, 0, "%I64u", post_len);
-      len_str = (char*)malloc(len + 1);
-      snprintf(len_str, len + 1, "%I64u", post_len);
-#else
-      len = snprintf(NULL, 0, "%llu", (long long unsigned)post_len);
-      len_str = (char*)malloc(len + 1);
-      snprintf(len_str, len + 1, "%llu", (long long unsigned)post_len);
-#endif
-
-      len_str[len] = '\0';
-
-      net_http_send_str(fd, &error, len_str);
-      net_http_send_str(fd, &error, "\r\n");
-
-      free(len_str);
+      count++;
+
+      if (sock->dead)
+         continue;
+
+      if (pending && !pipeline)
+         continue;
+
+      if (pending >= NET_HTTP_POOL_PIPELINE)
+         continue;
+
+      if (!best || pending < best_pending)
+      {
+         best         = sock;
+         best_pending = pending;
+      }
    }
 
-   net_http_send_str(fd, &error, "User-Agent: libretro\r\n");
-   net_http_send_str(fd, &error, "Connection: close\r\n");
-   net_http_send_str(fd, &error, "\r\n");
+   if (best && !best_pending)
+      return best;
 
-   if (conn->methodcopy && (memcmp(conn->methodcopy, "POST", 4) == 0))
-      net_http_send_str(fd, &error, conn->postdatacopy);
+   if (count < NET_HTTP_POOL_MAX_PER_HOST)
+      return net_http_socket_new(pool, domain, port);
 
-   if (error)
-      goto error;
+   if (!best)
+      *full = true;
 
-   state          = (struct http_t*)malloc(sizeof(struct http_t));
-   state->fd      = fd;
-   state->status  = -1;
-   state->data    = NULL;
-   state->part    = P_HEADER_TOP;
-   state->bodytype= T_FULL;
-   state->error   = false;
-   state->pos     = 0;
-   state->len     = 0;
-   state->buflen  = 512;
-   state->data    = (char*)malloc(state->buflen);
-
-   if (!state->data)
-      goto error;
+   return best;
+}
 
-   return state;
+static void net_http_reset(struct http_t *state)
+{
+   state->status     = -1;
+   state->part       = P_HEADER_TOP;
+   state->bodytype   = T_FULL;
+   state->keep_alive = true;
+   state->rx_pos     = 0;
+   state->rx_len     = 0;
+   state->pos        = 0;
+   state->len        = 0;
+   state->chunk_left = 0;
+}
 
-error:
-   if (conn->methodcopy)
-      free(conn->methodcopy);
-   if (conn->contenttypecopy)
-      free(conn->contenttypecopy);
-   conn->methodcopy = NULL;
-   conn->contenttypecopy = NULL;
-   conn->postdatacopy = NULL;
-   if (fd >= 0)
-      socket_close(fd);
-   if (state)
-      free(state);
-   return NULL;
+/* Sends the request on a socket. Returns false with state->error
+ * unset if every socket to the host is busy. */
+static bool net_http_attach(struct http_t *state)
+{
+   for (;;)
+   {
+      bool full                  = false;
+      bool reused                = false;
+      struct http_socket_t *sock = NULL;
+
+      if (state->pool)
+         sock = net_http_pool_get(state->pool, state->domain, state->port,
+               state->pipeline, &full);
+      else
+         sock = net_http_socket_new(NULL, state->domain, state->port);
+
+      if (!sock)
+      {
+         state->error = !full;
+         return false;
+      }
+
+      if (socket_send_all_blocking(sock->fd,
+               state->request, state->request_len, true))
+      {
+         sock->users++;
+         state->seq  = sock->sent++;
+         state->sock = sock;
+         return true;
+      }
+
+      /* A pooled socket may have been closed by the server; nothing
+       * was sent, so try again until a new socket fails too. */
+      reused     = sock->sent > 0;
+      sock->dead = true;
+      if (!sock->users)
+         net_http_socket_free(sock);
+
+      if (!reused)
+         break;
+   }
+
+   state->error = true;
+   return false;
 }
 
-int net_http_fd(struct http_t *state)
+static void net_http_detach(struct http_t *state)
 {
-   if (!state)
-      return -1;
-   return state->fd;
+   struct http_socket_t *sock = state->sock;
+
+   if (!sock)
+      return;
+
+   /* Leaving a response unread would hand it to the next request. */
+   if (state->part != P_DONE)
+      sock->dead = true;
+
+   state->sock = NULL;
+   net_http_socket_release(sock);
 }
 
-bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
+static void net_http_response_done(struct http_t *state)
 {
-   ssize_t newlen = 0;
+   struct http_socket_t *sock = state->sock;
+   size_t excess              = state->rx_len - state->rx_pos;
 
-   if (!state || state->error)
-      goto fail;
+   sock->received++;
 
-   if (state->part < P_BODY)
+   if (!state->keep_alive)
+      sock->dead = true;
+   else if (excess)
    {
-      if (state->error)
-         newlen = -1;
+      sock->leftover = (char*)malloc(excess);
+      if (sock->leftover)
+      {
+         memcpy(sock->leftover, state->rx + state->rx_pos, excess);
+         sock->leftover_len = excess;
+      }
       else
-         newlen = socket_receive_all_nonblocking(state->fd, &state->error,
-               (uint8_t*)state->data + state->pos,
-               state->buflen - state->pos);
+         sock->dead = true;
+   }
 
-      if (newlen < 0)
-         goto fail;
+   state->rx_pos = state->rx_len;
+
+   net_http_detach(state);
+}
+
+static bool net_http_body_append(struct http_t *state,
+      const char *data, size_t len)
+{
+   if (state->sink && state->status >= 200 && state->status <= 299)
+   {
+      if (!state->sink(state->sink_data, (const uint8_t*)data, len))
+         return false;
+      state->pos += len;
+      return true;
+   }
+
+   if (state->pos + len + 1 > state->buflen)
+   {
+      char *data_new = NULL;
+      size_t buflen  = state->buflen ? state->buflen : 512;
+
+      if (!state->buflen && state->bodytype == T_LEN)
+         buflen = state->len + 1;
+
+      while (buflen < state->pos + len + 1)
+         buflen *= 2;
+
+      data_new = (char*)realloc(state->data, buflen);
+      if (!data_new)
+         return false;
+
+      state->data   = data_new;
+      state->buflen = buflen;
+   }
+
+   memcpy(state->data + state->pos, data, len);
+   state->pos += len;
+   state->data[state->pos] = '\0';
+
+   return true;
+}
+
+/* Case-insensitive match of a header name; returns its value. */
+static const char *net_http_header_value(const char *line, const char *name)
+{
+   size_t len = strlen(name);
+   size_t i;
+
+   for (i = 0; i < len; i++)
+      if (tolower((unsigned char)line[i]) != name[i])
+         return NULL;
+
+   if (line[len] != ':')
+      return NULL;
+
+   line += len + 1;
+   while (*line == ' ' || *line == '\t')
+      line++;
 
-      if (state->pos + newlen >= state->buflen - 64)
+   return line;
+}
+
+static bool net_http_parse_header(struct http_t *state, const char *line)
+{
+   const char *value = NULL;
+
+   if (state->part == P_HEADER_TOP)
+   {
+      if (strncmp(line, "HTTP/1.", strlen("HTTP/1.")) != 0)
+         return false;
+
+      state->status = (int)strtoul(line + strlen("HTTP/1.1 "), NULL, 10);
+
+      /* HTTP/1.0 closes the connection unless told otherwise. */
+      if (line[strlen("HTTP/1.")] == '0')
+         state->keep_alive = false;
+
+      state->part = P_HEADER;
+      return true;
+   }
+
+   if (!*line)
+   {
+      if (state->bodytype == T_CHUNK)
+         state->part = P_BODY_CHUNKLEN;
+      else if (state->status == 204 || state->status == 304
+            || (state->bodytype == T_LEN && !state->len))
+         state->part = P_DONE;
+      else
       {
-         state->buflen *= 2;
-         state->data    = (char*)realloc(state->data, state->buflen);
+         /* The body ends when the server closes the connection. */
+         if (state->bodytype == T_FULL)
+            state->keep_alive = false;
+         state->part = P_BODY;
       }
-      state->pos += newlen;
+      return true;
+   }
+
+   /* TODO: save headers somewhere */
+   if ((value = net_http_header_value(line, "content-length")))
+   {
+      state->bodytype = T_LEN;
+      state->len      = strtoul(value, NULL, 10);
+   }
+   else if ((value = net_http_header_value(line, "transfer-encoding")))
+   {
+      if (string_is_equal_noncase(value, "chunked"))
+         state->bodytype = T_CHUNK;
+   }
+   else if ((value = net_http_header_value(line, "connection")))
+   {
+      if (string_is_equal_noncase(value, "close"))
+         state->keep_alive = false;
+      else if (string_is_equal_noncase(value, "keep-alive"))
+         state->keep_alive = true;
+   }
+
+   return true;
+}
 
-      while (state->part < P_BODY)
+/* Consumes as much of the receive buffer as possible. */
+static bool net_http_parse(struct http_t *state)
+{
+   while (state->part < P_DONE)
+   {
+      char *start    = state->rx + state->rx_pos;
+      size_t avail   = state->rx_len - state->rx_pos;
+      char *lineend  = NULL;
+
+      if (state->part == P_BODY)
       {
-         char *dataend = state->data + state->pos;
-         char *lineend = (char*)memchr(state->data, '\n', state->pos);
+         size_t len = avail;
 
-         if (!lineend)
-            break;
+         if (state->bodytype == T_LEN && len > state->len - state->pos)
+            len = state->len - state->pos;
+         else if (state->bodytype == T_CHUNK && len > state->chunk_left)
+            len = state->chunk_left;
 
-         *lineend='\0';
+         if (len && !net_http_body_append(state, start, len))
+            return false;
 
-         if (lineend != state->data && lineend[-1]=='\r')
-            lineend[-1]='\0';
+         state->rx_pos += len;
 
-         if (state->part == P_HEADER_TOP)
+         if (state->bodytype == T_CHUNK)
          {
-            if (strncmp(state->data, "HTTP/1.", strlen("HTTP/1."))!=0)
-               goto fail;
-            state->status = (int)strtoul(state->data + strlen("HTTP/1.1 "), NULL, 10);
-            state->part   = P_HEADER;
+            state->chunk_left -= len;
+            if (state->chunk_left)
+               break;
+            state->part = P_BODY_CHUNKEND;
          }
+         else if (state->bodytype == T_LEN && state->pos == state->len)
+            state->part = P_DONE;
          else
-         {
-            if (!strncmp(state->data, "Content-Length: ",
-                     strlen("Content-Length: ")))
-            {
-               state->bodytype = T_LEN;
-               state->len = strtol(state->data + 
-                     strlen("Content-Length: "), NULL, 10);
-            }
-            if (string_is_equal(state->data, "Transfer-Encoding: chunked"))
-               state->bodytype = T_CHUNK;
-
-            /* TODO: save headers somewhere */
-            if (state->data[0]=='\0')
-            {
-               state->part = P_BODY;
-               if (state->bodytype == T_CHUNK)
-                  state->part = P_BODY_CHUNKLEN;
-            }
-         }
+            break;
 
-         memmove(state->data, lineend + 1, dataend-(lineend+1));
-         state->pos = (dataend-(lineend + 1));
+         continue;
       }
-      if (state->part >= P_BODY)
+
+      /* Everything else is line based. */
+      lineend = (char*)memchr(start, '\n', avail);
+      if (!lineend)
+         break;
+
+      *lineend = '\0';
+      if (lineend != start && lineend[-1] == '\r')
+         lineend[-1] = '\0';
+
+      state->rx_pos += lineend + 1 - start;
+
+      switch (state->part)
       {
-         newlen = state->pos;
-         state->pos = 0;
+         case P_HEADER_TOP:
+         case P_HEADER:
+            if (!net_http_parse_header(state, start))
+               return false;
+            break;
+         case P_BODY_CHUNKLEN:
+            state->chunk_left = strtoul(start, NULL, 16);
+            state->part       = state->chunk_left ? P_BODY : P_BODY_TRAILER;
+            break;
+         case P_BODY_CHUNKEND:
+            state->part       = P_BODY_CHUNKLEN;
+            break;
+         case P_BODY_TRAILER:
+            if (!*start)
+               state->part    = P_DONE;
+            break;
       }
    }
 
-   if (state->part >= P_BODY && state->part < P_DONE)
+   return true;
+}
+
+/* Makes room at the end of the receive buffer. */
+static bool net_http_rx_reserve(struct http_t *state)
+{
+   if (state->rx_pos)
    {
-      if (!newlen)
-      {
-         if (state->error)
-            newlen = -1;
-         else
-            newlen = socket_receive_all_nonblocking(
-                  state->fd,
-                  &state->error,
-                  (uint8_t*)state->data + state->pos,
-                  state->buflen - state->pos);
+      memmove(state->rx, state->rx + state->rx_pos,
+            state->rx_len - state->rx_pos);
+      state->rx_len -= state->rx_pos;
+      state->rx_pos  = 0;
+   }
 
-         if (newlen < 0)
-         {
-            if (state->bodytype == T_FULL)
-            {
-               state->part = P_DONE;
-               state->data = (char*)realloc(state->data, state->len);
-            }
-            else
-               goto fail;
-            newlen=0;
-         }
+   if (state->rx_len == state->rx_size)
+   {
+      char *rx      = NULL;
+      size_t size   = state->rx_size ? state->rx_size * 2 : NET_HTTP_RX_SIZE;
+
+      /* A header line that doesn't end. */
+      if (size > NET_HTTP_RX_MAX)
+         return false;
+
+      rx = (char*)realloc(state->rx, size);
+      if (!rx)
+         return false;
+
+      state->rx      = rx;
+      state->rx_size = size;
+   }
+
+   return true;
+}
+
+/* Takes over the bytes of this response the previous one on
+ * the socket read past its end; the receive buffer is still
+ * empty at this point. The buffer gets its usual size so that
+ * the rest of the response isn't read a few bytes at a time. */
+static bool net_http_take_leftover(struct http_t *state)
+{
+   struct http_socket_t *sock = state->sock;
+   size_t size                = sock->leftover_len > NET_HTTP_RX_SIZE
+      ? sock->leftover_len : NET_HTTP_RX_SIZE;
+
+   if (state->rx_size < size)
+   {
+      char *rx = (char*)realloc(state->rx, size);
+
+      if (!rx)
+         return false;
+
+      state->rx      = rx;
+      state->rx_size = size;
+   }
+
+   memcpy(state->rx, sock->leftover, sock->leftover_len);
+   state->rx_len      = sock->leftover_len;
+   state->rx_pos      = 0;
+
+   free(sock->leftover);
+   sock->leftover     = NULL;
+   sock->leftover_len = 0;
+   return true;
+}
+
+static struct http_t *net_http_new_internal(struct http_connection_t *conn,
+      struct http_pool_t *pool)
+{
+   struct http_t *state  = NULL;
+
+   if (!conn)
+      return NULL;
+
+   state = (struct http_t*)calloc(1, sizeof(*state));
+   if (!state)
+      return NULL;
 
-         if (state->pos + newlen >= state->buflen - 64)
+   state->request  = net_http_build_request(conn, pool != NULL,
+         &state->request_len);
+   state->domain   = strdup(conn->domain);
+   state->port     = conn->port;
+   state->pool     = pool;
+   state->pipeline = !conn->methodcopy
+      || string_is_equal(conn->methodcopy, "GET");
+
+   if (!state->request || !state->domain)
+      goto error;
+
+   net_http_reset(state);
+
+   /* Connect right away, so an unreachable host fails here;
+    * a pooled request may have to wait for a free socket. */
+   if (!net_http_attach(state) && state->error)
+      goto error;
+
+   return state;
+
+error:
+   net_http_delete(state);
+   return NULL;
+}
+
+struct http_t *net_http_new(struct http_connection_t *conn)
+{
+   return net_http_new_internal(conn, NULL);
+}
+
+struct http_t *net_http_new_pooled(struct http_connection_t *conn,
+      struct http_pool_t *pool)
+{
+   return net_http_new_internal(conn, pool);
+}
+
+struct http_pool_t *net_http_pool_new(void)
+{
+   return (struct http_pool_t*)calloc(1, sizeof(struct http_pool_t));
+}
+
+void net_http_pool_free(struct http_pool_t *pool)
+{
+   if (!pool)
+      return;
+
+   while (pool->sockets)
+      net_http_socket_free(pool->sockets);
+
+   free(pool);
+}
+
+void net_http_set_sink(struct http_t *state,
+      net_http_sink_t sink, void *userdata)
+{
+   if (!state)
+      return;
+
+   state->sink      = sink;
+   state->sink_data = userdata;
+}
+
+int net_http_fd(struct http_t *state)
+{
+   if (!state || !state->sock)
+      return -1;
+   return state->sock->fd;
+}
+
+bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
+{
+   size_t budget = NET_HTTP_UPDATE_BUDGET;
+
+   if (!state || state->error)
+      goto fail;
+
+   while (state->part < P_DONE)
+   {
+      ssize_t newlen             = 0;
+      bool error                 = false;
+      struct http_socket_t *sock = state->sock;
+
+      if (!sock)
+      {
+         if (!net_http_attach(state))
          {
-            state->buflen *= 2;
-            state->data = (char*)realloc(state->data, state->buflen);
+            if (state->error)
+               goto fail;
+            /* Every socket to the host is busy. */
+            break;
          }
+         sock = state->sock;
       }
 
-parse_again:
-      if (state->bodytype == T_CHUNK)
+      /* The socket was closed after an earlier response;
+       * send the request again on another one. */
+      if (sock->dead)
       {
-         if (state->part == P_BODY_CHUNKLEN)
-         {
-            state->pos += newlen;
-            if (state->pos - state->len >= 2)
-            {
-               /*
-                * len=start of chunk including \r\n
-                * pos=end of data
-                */
-
-               char *fullend = state->data + state->pos;
-               char *end     = (char*)memchr(state->data + state->len + 2, '\n',
-                                             state->pos - state->len - 2);
-
-               if (end)
-               {
-                  size_t chunklen = strtoul(state->data+state->len, NULL, 16);
-                  state->pos      = state->len;
-                  end++;
-
-                  memmove(state->data+state->len, end, fullend-end);
-
-                  state->len      = chunklen;
-                  newlen          = (fullend - end);
-
-                  /*
-                     len=num bytes
-                     newlen=unparsed bytes after \n
-                     pos=start of chunk including \r\n
-                     */
-
-                  state->part = P_BODY;
-                  if (state->len == 0)
-                  {
-                     state->part = P_DONE;
-                     state->len  = state->pos;
-                     state->data = (char*)realloc(state->data, state->len);
-                  }
-                  goto parse_again;
-               }
-            }
-         }
-         else if (state->part == P_BODY)
-         {
-            if ((size_t)newlen >= state->len)
-            {
-               state->pos += state->len;
-               newlen     -= state->len;
-               state->len  = state->pos;
-               state->part = P_BODY_CHUNKLEN;
-               goto parse_again;
-            }
-            else
-            {
-               state->pos += newlen;
-               state->len -= newlen;
-            }
-         }
+         net_http_detach(state);
+         net_http_reset(state);
+         continue;
       }
-      else
+
+      /* An earlier response on the socket isn't read yet. */
+      if (state->seq != sock->received)
+         break;
+
+      if (sock->leftover)
       {
-         state->pos += newlen;
+         if (!net_http_take_leftover(state) || !net_http_parse(state))
+            goto fail;
+         continue;
+      }
+
+      if (!net_http_rx_reserve(state))
+         goto fail;
+
+      newlen = socket_receive_all_nonblocking(sock->fd, &error,
+            (uint8_t*)state->rx + state->rx_len,
+            state->rx_size - state->rx_len);
 
-         if (state->pos == state->len)
+      if (newlen < 0)
+      {
+         if (state->part == P_BODY && state->bodytype == T_FULL)
          {
             state->part = P_DONE;
-            state->data = (char*)realloc(state->data, state->len);
+            break;
          }
-         if (state->pos > state->len)
-            goto fail;
+
+         sock->dead = true;
+
+         /* A reused socket may have been closed by the server before
+          * it answered this request; try once on a new one, unless
+          * part of the body was already handed to a sink. */
+         if (state->seq && !state->retried
+               && !(state->sink && state->pos))
+         {
+            state->retried = true;
+            net_http_detach(state);
+            net_http_reset(state);
+            continue;
+         }
+
+         goto fail;
       }
+
+      if (!newlen)
+         break;
+
+      state->rx_len += newlen;
+
+      if (!net_http_parse(state))
+         goto fail;
+
+      if ((size_t)newlen >= budget)
+         break;
+      budget -= newlen;
    }
 
+   if (state->part == P_DONE && state->sock)
+      net_http_response_done(state);
+
    if (progress)
       *progress = state->pos;
 
@@ -610,6 +1078,7 @@ fail:
       state->error  = true;
       state->part   = P_ERROR;
       state->status = -1;
+      net_http_detach(state);
    }
 
    return true;
@@ -635,7 +1104,15 @@ uint8_t* net_http_data(struct http_t *state, size_t* len, bool accept_error)
    }
 
    if (len)
-      *len=state->len;
+      *len=state->pos;
+
+   /* Callers expect a buffer even for an empty body. */
+   if (!state->data && !state->sink)
+   {
+      state->data = (char*)calloc(1, 1);
+      if (state->data)
+         state->buflen = 1;
+   }
 
    return (uint8_t*)state->data;
 }
@@ -645,8 +1122,11 @@ void net_http_delete(struct http_t *state)
    if (!state)
       return;
 
-   if (state->fd >= 0)
-      socket_close(state->fd);
+   net_http_detach(state);
+
+   free(state->domain);
+   free(state->request);
+   free(state->rx);
    free(state);
 }
 
@@ -778,6 +778,14 @@ bool scond_wait_timeout(scond_t *cond, slock_t *lock, int64_t timeout_us)
    now.tv_sec  += seconds;
    now.tv_nsec += remainder * INT64_C(1000);
 
+   /* pthread_cond_timedwait fails with EINVAL on an
+    * out of range tv_nsec. */
+   if (now.tv_nsec >= INT64_C(1000000000))
+   {
+      now.tv_sec  += 1;
+      now.tv_nsec -= INT64_C(1000000000);
+   }
+
    ret = pthread_cond_timedwait(&cond->cond, &lock->lock, &now);
    return (ret == 0);
 #endif
@@ -1,8 +1,15 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <file/nbio.h>
 
+static const char *backends[] = { "stdio", "threads", "io_uring", NULL };
+
 static void nbio_write_test(void)
 {
    size_t size;
@@ -27,11 +34,11 @@ static void nbio_write_test(void)
    nbio_free(write);
 }
 
-static void nbio_read_test(void)
+static void nbio_read_test(unsigned mode)
 {
    size_t size;
    bool looped = false;
-   struct nbio_t* read = nbio_open("test.bin", NBIO_READ);
+   struct nbio_t* read = nbio_open("test.bin", mode);
    void* ptr           = nbio_get_ptr(read, &size);
 
    if (size != 1024*1024)
@@ -43,21 +50,206 @@ static void nbio_read_test(void)
 
    while (!nbio_iterate(read)) looped=true;
 
-   if (!looped)
+   /* io_uring finishes reads of cached files on the first call */
+   if (!looped && mode == NBIO_READ && !strcmp(nbio_get_backend(), "stdio"))
       puts("Read finished immediately?");
 
    ptr = nbio_get_ptr(read, &size);
 
    if (size != 1024*1024)
       puts("ERROR: wrong size (3)");
-   if (*(char*)ptr != 0x42 || memcmp(ptr, (char*)ptr+1, 1024*1024-1))
+   if (!ptr || *(char*)ptr != 0x42 || memcmp(ptr, (char*)ptr+1, 1024*1024-1))
       puts("ERROR: wrong data");
 
    nbio_free(read);
 }
 
-int main(void)
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Stands in for decoding what was read, touching every cache line */
+static uint32_t checksum(const uint8_t *data, size_t len)
+{
+   size_t i;
+   uint32_t sum = 0;
+
+   for (i = 0; i < len; i += 64)
+      sum = sum * 31 + data[i];
+
+   return sum;
+}
+
+static void bench_create(const char *dir, unsigned files, size_t size)
+{
+   unsigned i;
+   char path[1024];
+   char *buf = (char*)malloc(size);
+
+   for (i = 0; i < size; i++)
+      buf[i] = (char)(i * 7 + size);
+
+   for (i = 0; i < files; i++)
+   {
+      FILE *f;
+
+      snprintf(path, sizeof(path), "%s/%u_%u.bin", dir,
+            (unsigned)size, i);
+      f = fopen(path, "wb");
+      fwrite(buf, 1, size, f);
+      fclose(f);
+   }
+
+   free(buf);
+}
+
+/* Drops the files from the page cache, so they come from the disk */
+static void bench_evict(const char *dir, unsigned files, size_t size)
+{
+   unsigned i;
+   char path[1024];
+
+   for (i = 0; i < files; i++)
+   {
+      int fd;
+
+      snprintf(path, sizeof(path), "%s/%u_%u.bin", dir,
+            (unsigned)size, i);
+      fd = open(path, O_RDONLY);
+      fdatasync(fd);
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+   }
+}
+
+/* Reads the files with up to @outstanding of them in flight, and
+ * checksums each as soon as it is in. */
+static void bench_read(const char *dir, unsigned files, size_t size,
+      unsigned mode, unsigned outstanding, bool cold)
+{
+   unsigned i;
+   double start;
+   char path[1024];
+   unsigned next         = 0;
+   unsigned done         = 0;
+   uint32_t sum          = 0;
+   struct nbio_t **slots = (struct nbio_t**)
+      calloc(outstanding, sizeof(*slots));
+
+   if (cold)
+      bench_evict(dir, files, size);
+
+   start = now();
+
+   while (done < files)
+   {
+      for (i = 0; i < outstanding; i++)
+      {
+         if (!slots[i] && next < files)
+         {
+            snprintf(path, sizeof(path), "%s/%u_%u.bin", dir,
+                  (unsigned)size, next++);
+            slots[i] = nbio_open(path, mode);
+            if (!slots[i])
+            {
+               printf("ERROR: could not open %s\n", path);
+               exit(1);
+            }
+            nbio_begin_read(slots[i]);
+         }
+
+         if (slots[i] && nbio_iterate(slots[i]))
+         {
+            size_t len;
+            const uint8_t *ptr = (const uint8_t*)
+               nbio_get_ptr(slots[i], &len);
+
+            if (!ptr || len != size)
+            {
+               puts("ERROR: read failed");
+               exit(1);
+            }
+
+            sum += checksum(ptr, len);
+            nbio_free(slots[i]);
+            slots[i] = NULL;
+            done++;
+         }
+      }
+   }
+
+   printf("%-8s %-6s %5u x %8u bytes, %3u at once, %s: %8.1f ms (%08x)\n",
+         nbio_get_backend(), mode == NBIO_READ_MAPPED ? "mapped" : "read",
+         files, (unsigned)size, outstanding, cold ? "cold" : "warm",
+         (now() - start) * 1000.0, sum);
+
+   free(slots);
+}
+
+static void bench(const char *dir)
+{
+   unsigned b, c;
+   static const struct
+   {
+      unsigned files;
+      size_t size;
+   } sets[] = {
+      { 2000, 16 * 1024 },
+      {    8, 64 * 1024 * 1024 },
+   };
+
+   for (c = 0; c < sizeof(sets) / sizeof(sets[0]); c++)
+      bench_create(dir, sets[c].files, sets[c].size);
+
+   for (c = 0; c < sizeof(sets) / sizeof(sets[0]); c++)
+   {
+      for (b = 0; backends[b]; b++)
+      {
+         unsigned cold;
+
+         if (!nbio_set_backend(backends[b]))
+            continue;
+
+         for (cold = 0; cold < 2; cold++)
+         {
+            bench_read(dir, sets[c].files, sets[c].size, NBIO_READ, 1, cold);
+            bench_read(dir, sets[c].files, sets[c].size, NBIO_READ, 32, cold);
+            if (b)
+               bench_read(dir, sets[c].files, sets[c].size,
+                     NBIO_READ_MAPPED, 32, cold);
+         }
+      }
+   }
+}
+
+int main(int argc, char *argv[])
 {
-   nbio_write_test();
-   nbio_read_test();
+   unsigned b;
+
+   if (argc > 2 && !strcmp(argv[1], "bench"))
+   {
+      bench(argv[2]);
+      return 0;
+   }
+
+   for (b = 0; backends[b]; b++)
+   {
+      if (!nbio_set_backend(backends[b]))
+      {
+         printf("%s: not available\n", backends[b]);
+         continue;
+      }
+
+      printf("%s\n", nbio_get_backend());
+      nbio_write_test();
+      nbio_read_test(NBIO_READ);
+      nbio_read_test(NBIO_READ_MAPPED);
+      nbio_read_test(BIO_READ);
+   }
+
+   remove("test.bin");
+   return 0;
 }
@@ -0,0 +1,271 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rjpeg_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <file/nbio.h>
+#include <formats/rjpeg.h>
+#include <string/stdstring.h>
+#include <formats/image.h>
+
+#define RJPEG_BENCH_ITERATIONS 10
+
+static bool rjpeg_decode_argb(void *ptr, size_t file_len, unsigned denom,
+      uint32_t **data, unsigned *width, unsigned *height)
+{
+   int retval;
+   bool              ret = true;
+   rjpeg_t        *rjpeg = rjpeg_alloc();
+
+   if (!rjpeg)
+      return false;
+
+   if (  !rjpeg_set_buf_ptr(rjpeg, ptr) ||
+         !rjpeg_set_scale(rjpeg, denom))
+   {
+      ret = false;
+      goto end;
+   }
+
+   retval = rjpeg_process_image(rjpeg,
+         (void**)data, file_len, width, height);
+
+   if (retval == IMAGE_PROCESS_ERROR || retval == IMAGE_PROCESS_ERROR_END)
+      ret = false;
+
+end:
+   rjpeg_free(rjpeg);
+   return ret;
+}
+
+static void *rjpeg_read_file(const char *path, size_t *len)
+{
+   void             *ptr = NULL;
+   void            *copy = NULL;
+   struct nbio_t* handle = (struct nbio_t*)nbio_open(path, NBIO_READ);
+
+   if (!handle)
+      return NULL;
+
+   nbio_begin_read(handle);
+
+   while (!nbio_iterate(handle));
+
+   ptr = nbio_get_ptr(handle, len);
+
+   if (ptr && (copy = malloc(*len)))
+      memcpy(copy, ptr, *len);
+
+   nbio_free(handle);
+   return copy;
+}
+
+/* PSNR of a scaled decode against a box filtered full size decode */
+static double rjpeg_scaled_psnr(const uint32_t *full,
+      unsigned full_w, unsigned full_h,
+      const uint32_t *scaled, unsigned w, unsigned h, unsigned denom)
+{
+   unsigned x, y, c;
+   double mse   = 0.0;
+
+   for (y = 0; y < h; y++)
+   {
+      for (x = 0; x < w; x++)
+      {
+         for (c = 0; c < 24; c += 8)
+         {
+            unsigned i, j;
+            double diff;
+            unsigned sum   = 0;
+            unsigned count = 0;
+
+            for (j = y * denom; j < (y + 1) * denom && j < full_h; j++)
+            {
+               for (i = x * denom; i < (x + 1) * denom && i < full_w; i++)
+               {
+                  sum += (full[j * full_w + i] >> c) & 0xff;
+                  count++;
+               }
+            }
+
+            diff = (double)sum / count - ((scaled[y * w + x] >> c) & 0xff);
+            mse += diff * diff;
+         }
+      }
+   }
+
+   mse /= (double)w * h * 3;
+
+   if (mse == 0.0)
+      return 99.0;
+   return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+static int bench_rjpeg(int num_files, char *paths[], bool psnr)
+{
+   int i, j;
+   unsigned denom;
+   void **files   = (void**)calloc(num_files, sizeof(*files));
+   size_t *lens   = (size_t*)calloc(num_files, sizeof(*lens));
+
+   if (!files || !lens)
+      return 1;
+
+   for (i = 0; i < num_files; i++)
+   {
+      if (!(files[i] = rjpeg_read_file(paths[i], &lens[i])))
+      {
+         fprintf(stderr, "Could not read %s.\n", paths[i]);
+         return 1;
+      }
+   }
+
+   for (denom = 1; denom <= 8; denom <<= 1)
+   {
+      clock_t start;
+      double secs;
+      double mbytes     = 0.0;
+      double psnr_total = 0.0;
+      unsigned count    = 0;
+
+      start = clock();
+
+      for (j = 0; j < (psnr ? 1 : RJPEG_BENCH_ITERATIONS); j++)
+      {
+         for (i = 0; i < num_files; i++)
+         {
+            uint32_t *data  = NULL;
+            unsigned width  = 0;
+            unsigned height = 0;
+
+            if (!rjpeg_decode_argb(files[i], lens[i], denom,
+                     &data, &width, &height))
+            {
+               fprintf(stderr, "Could not decode %s.\n", paths[i]);
+               free(data);
+               return 1;
+            }
+
+            if (psnr)
+            {
+               uint32_t *full  = NULL;
+               unsigned full_w = 0;
+               unsigned full_h = 0;
+
+               if (!rjpeg_decode_argb(files[i], lens[i], 1,
+                        &full, &full_w, &full_h))
+                  return 1;
+
+               psnr_total += rjpeg_scaled_psnr(full, full_w, full_h,
+                     data, width, height, denom);
+               free(full);
+            }
+
+            /* account for the source pixels, so scales are comparable */
+            mbytes += (double)width * height * denom * denom
+               * sizeof(uint32_t) / (1024.0 * 1024.0);
+            count++;
+            free(data);
+         }
+      }
+
+      secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+      if (psnr)
+         printf("1/%u: average PSNR %.2f dB over %u images.\n",
+               denom, psnr_total / count, count);
+      else
+         printf("1/%u: decoded %u images (%.2f MB) in %.3f s: %.2f MB/s.\n",
+               denom, count, mbytes, secs,
+               secs > 0.0 ? mbytes / secs : 0.0);
+   }
+
+   for (i = 0; i < num_files; i++)
+      free(files[i]);
+   free(files);
+   free(lens);
+
+   return 0;
+}
+
+static int test_rjpeg(const char *in_path)
+{
+   unsigned denom;
+   size_t file_len = 0;
+   void *ptr       = rjpeg_read_file(in_path, &file_len);
+
+   if (!ptr)
+      return 1;
+
+   fprintf(stderr, "Path: %s.\n", in_path);
+
+   for (denom = 1; denom <= 8; denom <<= 1)
+   {
+      uint32_t *data  = NULL;
+      unsigned width  = 0;
+      unsigned height = 0;
+
+      if (!rjpeg_decode_argb(ptr, file_len, denom, &data, &width, &height))
+      {
+         free(ptr);
+         return 2;
+      }
+
+      fprintf(stderr, "Got image at 1/%u: %u x %u.\n", denom, width, height);
+      free(data);
+   }
+
+   free(ptr);
+   return 0;
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc > 2 && string_is_equal(argv[1], "-b"))
+      return bench_rjpeg(argc - 2, argv + 2, false);
+
+   if (argc > 2 && string_is_equal(argv[1], "-p"))
+      return bench_rjpeg(argc - 2, argv + 2, true);
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s <jpeg file>\n", argv[0]);
+      fprintf(stderr, "       %s -b <jpeg files...>\n", argv[0]);
+      fprintf(stderr, "       %s -p <jpeg files...>\n", argv[0]);
+      return 1;
+   }
+
+   fprintf(stderr, "Doing tests...\n");
+
+   if (test_rjpeg(argv[1]) != 0)
+   {
+      fprintf(stderr, "Test failed.\n");
+      return -1;
+   }
+
+   return 0;
+}
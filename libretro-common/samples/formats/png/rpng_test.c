@@ -24,46 +24,27 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 #ifdef HAVE_IMLIB2
 #include <Imlib2.h>
 #endif
 
 #include <file/nbio.h>
 #include <formats/rpng.h>
+#include <string/stdstring.h>
 #include <formats/image.h>
 
-static bool rpng_load_image_argb(const char *path, uint32_t **data,
+#define RPNG_BENCH_ITERATIONS 10
+
+static bool rpng_decode_argb(void *ptr, size_t file_len, uint32_t **data,
       unsigned *width, unsigned *height)
 {
    int retval;
-   size_t file_len;
    bool              ret = true;
-   rpng_t          *rpng = NULL;
-   void             *ptr = NULL;
-   struct nbio_t* handle = (struct nbio_t*)nbio_open(path, NBIO_READ);
-
-   if (!handle)
-      goto end;
-
-   nbio_begin_read(handle);
-
-   while (!nbio_iterate(handle));
-
-   ptr = nbio_get_ptr(handle, &file_len);
-
-   if (!ptr)
-   {
-      ret = false;
-      goto end;
-   }
-
-   rpng = rpng_alloc();
+   rpng_t          *rpng = rpng_alloc();
 
    if (!rpng)
-   {
-      ret = false;
-      goto end;
-   }
+      return false;
 
    if (!rpng_set_buf_ptr(rpng, (uint8_t*)ptr))
    {
@@ -95,16 +76,108 @@ static bool rpng_load_image_argb(const char *path, uint32_t **data,
       ret = false;
 
 end:
-   if (handle)
-      nbio_free(handle);
-   if (rpng)
-      rpng_free(rpng);
-   rpng = NULL;
+   rpng_free(rpng);
+   return ret;
+}
+
+static void *rpng_read_file(const char *path, size_t *len)
+{
+   void             *ptr = NULL;
+   void            *copy = NULL;
+   struct nbio_t* handle = (struct nbio_t*)nbio_open(path, NBIO_READ);
+
+   if (!handle)
+      return NULL;
+
+   nbio_begin_read(handle);
+
+   while (!nbio_iterate(handle));
+
+   ptr = nbio_get_ptr(handle, len);
+
+   if (ptr && (copy = malloc(*len)))
+      memcpy(copy, ptr, *len);
+
+   nbio_free(handle);
+   return copy;
+}
+
+static bool rpng_load_image_argb(const char *path, uint32_t **data,
+      unsigned *width, unsigned *height)
+{
+   bool ret;
+   size_t file_len = 0;
+   void *ptr       = rpng_read_file(path, &file_len);
+
+   if (!ptr)
+      return false;
+
+   ret = rpng_decode_argb(ptr, file_len, data, width, height);
+
+   free(ptr);
    if (!ret)
       free(*data);
    return ret;
 }
 
+static int bench_rpng(int num_files, char *paths[])
+{
+   int i, j;
+   clock_t start;
+   double secs;
+   double mbytes  = 0.0;
+   unsigned count = 0;
+   void **files   = (void**)calloc(num_files, sizeof(*files));
+   size_t *lens   = (size_t*)calloc(num_files, sizeof(*lens));
+
+   if (!files || !lens)
+      return 1;
+
+   for (i = 0; i < num_files; i++)
+   {
+      if (!(files[i] = rpng_read_file(paths[i], &lens[i])))
+      {
+         fprintf(stderr, "Could not read %s.\n", paths[i]);
+         return 1;
+      }
+   }
+
+   start = clock();
+
+   for (j = 0; j < RPNG_BENCH_ITERATIONS; j++)
+   {
+      for (i = 0; i < num_files; i++)
+      {
+         uint32_t *data  = NULL;
+         unsigned width  = 0;
+         unsigned height = 0;
+
+         if (!rpng_decode_argb(files[i], lens[i], &data, &width, &height))
+         {
+            fprintf(stderr, "Could not decode %s.\n", paths[i]);
+            free(data);
+            return 1;
+         }
+
+         mbytes += width * height * sizeof(uint32_t) / (1024.0 * 1024.0);
+         count++;
+         free(data);
+      }
+   }
+
+   secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+   printf("Decoded %u images (%.2f MB) in %.3f s: %.2f MB/s.\n",
+         count, mbytes, secs, secs > 0.0 ? mbytes / secs : 0.0);
+
+   for (i = 0; i < num_files; i++)
+      free(files[i]);
+   free(files);
+   free(lens);
+
+   return 0;
+}
+
 static int test_rpng(const char *in_path)
 {
 #ifdef HAVE_IMLIB2
@@ -186,9 +259,13 @@ int main(int argc, char *argv[])
 {
    const char *in_path = "/tmp/test.png";
 
+   if (argc > 2 && string_is_equal(argv[1], "-b"))
+      return bench_rpng(argc - 2, argv + 2);
+
    if (argc > 2)
    {
       fprintf(stderr, "Usage: %s <png file>\n", argv[0]);
+      fprintf(stderr, "       %s -b <png files...>\n", argv[0]);
       return 1;
    }
 
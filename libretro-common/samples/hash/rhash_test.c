@@ -0,0 +1,105 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rhash_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <rhash.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+
+/* Hashes @size bytes of @data with @types in one pass, returns the time */
+static retro_time_t rhash_test_pass(const uint8_t *data,
+      size_t size, unsigned types, rhash_digest_t *digest)
+{
+   rhash_multi_t hash;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   rhash_multi_init(&hash, types);
+   rhash_multi_update(&hash, data, size);
+   rhash_multi_final(&hash, digest);
+
+   return cpu_features_get_time_usec() - start;
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i;
+   rhash_digest_t separate, combined, single;
+   retro_time_t elapsed_generic, elapsed_crc, elapsed_md5;
+   retro_time_t elapsed_sha1, elapsed_all, start;
+   uint32_t generic_crc;
+   const char *hw     = encoding_crc32_hw_name();
+   unsigned megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+   size_t size        = (size_t)(megabytes ? megabytes : 1) << 20;
+   uint8_t *data      = (uint8_t*)malloc(size);
+   uint32_t seed      = 0x12345678;
+   unsigned mismatch  = 0;
+
+   if (!data)
+      return 1;
+
+   for (i = 0; i < size; i++)
+   {
+      seed    = seed * 1103515245 + 12345;
+      data[i] = (uint8_t)(seed >> 16);
+   }
+
+   start           = cpu_features_get_time_usec();
+   generic_crc     = encoding_crc32_generic(0, data, size);
+   elapsed_generic = cpu_features_get_time_usec() - start;
+
+   memset(&separate, 0, sizeof(separate));
+
+   elapsed_crc    = rhash_test_pass(data, size, RHASH_CRC32, &single);
+   separate.crc32 = single.crc32;
+
+   elapsed_md5    = rhash_test_pass(data, size, RHASH_MD5, &single);
+   memcpy(separate.md5, single.md5, sizeof(separate.md5));
+
+   elapsed_sha1   = rhash_test_pass(data, size, RHASH_SHA1, &single);
+   memcpy(separate.sha1, single.sha1, sizeof(separate.sha1));
+
+   elapsed_all    = rhash_test_pass(data, size,
+         RHASH_CRC32 | RHASH_MD5 | RHASH_SHA1, &combined);
+
+   mismatch += generic_crc != separate.crc32;
+   mismatch += memcmp(&separate, &combined, sizeof(combined)) != 0;
+
+   printf("%u MB\n", (unsigned)(size >> 20));
+   printf("CRC32 slicing-by-16: %8.1f MB/s\n",
+         size / (elapsed_generic + 1.0));
+   printf("CRC32 %-13s: %8.1f MB/s\n",
+         hw ? hw : "slicing-by-16", size / (elapsed_crc + 1.0));
+   printf("MD5                : %8.1f MB/s\n", size / (elapsed_md5 + 1.0));
+   printf("SHA1               : %8.1f MB/s\n", size / (elapsed_sha1 + 1.0));
+   printf("CRC32+MD5+SHA1, three passes: %8.1f MB/s\n",
+         size / (elapsed_crc + elapsed_md5 + elapsed_sha1 + 1.0));
+   printf("CRC32+MD5+SHA1, one pass    : %8.1f MB/s\n",
+         size / (elapsed_all + 1.0));
+   printf("%u digests differ\n", mismatch);
+
+   free(data);
+   return mismatch ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <retro_miscellaneous.h>
+#include <retro_stat.h>
+
+#define NUM_FILES  50000
+#define CHUNK_SIZE 2048
+
+static double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void populate(const char *dir)
+{
+   unsigned i;
+   char path[PATH_MAX_LENGTH];
+
+   mkdir_norecurse(dir);
+
+   for (i = 0; i < NUM_FILES; i++)
+   {
+      FILE *fp;
+
+      snprintf(path, sizeof(path), "%s/game%05u.%s", dir, i,
+            (i % 10) == 0 ? "zip" : ((i % 3) == 0 ? "txt" : "sfc"));
+
+      if (!(fp = fopen(path, "wb")))
+      {
+         printf("Could not create %s\n", path);
+         return;
+      }
+      fclose(fp);
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   double start, first_chunk;
+   int ret;
+   size_t chunks                  = 0;
+   const char *dir                = "dir_list_test.tmp";
+   const char *exts               = "sfc|smc";
+   struct string_list *list       = NULL;
+   struct dir_list_reader *reader = NULL;
+
+   if (argc > 1)
+      dir = argv[1];
+   else if (!path_is_directory(dir))
+   {
+      printf("Creating %u files in %s...\n", NUM_FILES, dir);
+      populate(dir);
+   }
+
+   start = now();
+   list  = dir_list_new(dir, exts, true, false, true, false);
+   if (!list)
+   {
+      printf("Could not list %s\n", dir);
+      return 1;
+   }
+   printf("dir_list_new:     %u entries in %.2f ms\n",
+         (unsigned)list->size, (now() - start) * 1000.0);
+   dir_list_free(list);
+
+   start       = now();
+   first_chunk = 0.0;
+   list        = string_list_new();
+   reader      = dir_list_reader_new(dir, exts, true, false, true);
+
+   while ((ret = dir_list_reader_step(reader, list, CHUNK_SIZE)) == 1)
+   {
+      if (chunks++ == 0)
+         first_chunk = now() - start;
+   }
+
+   if (ret == -1)
+      puts("ERROR: dir_list_reader_step failed");
+
+   printf("dir_list_reader:  %u entries in %.2f ms "
+         "(first %u entries after %.2f ms)\n",
+         (unsigned)list->size, (now() - start) * 1000.0,
+         CHUNK_SIZE, first_chunk * 1000.0);
+
+   start = now();
+   dir_list_sort(list, true);
+   printf("dir_list_sort:    %.2f ms\n", (now() - start) * 1000.0);
+
+   dir_list_reader_free(reader);
+   dir_list_free(list);
+
+   return 0;
+}
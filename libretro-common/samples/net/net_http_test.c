@@ -21,6 +21,10 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
 #include <net/net_http.h>
 #include <net/net_compat.h>
 
@@ -28,30 +32,138 @@
 #include <winsock2.h>
 #endif
 
-int main(void)
+/* Requests kept in flight while fetching the small files. */
+#define MAX_INFLIGHT 16
+
+static double now(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static struct http_t *http_test_new(const char *url, struct http_pool_t *pool)
+{
+   struct http_t *http            = NULL;
+   struct http_connection_t *conn = net_http_connection_new(url, "GET", NULL);
+
+   if (!conn)
+      return NULL;
+
+   while (!net_http_connection_iterate(conn)) {}
+
+   if (net_http_connection_done(conn))
+      http = pool ? net_http_new_pooled(conn, pool) : net_http_new(conn);
+
+   net_http_connection_free(conn);
+   return http;
+}
+
+/* Fetches base/small/0 .. base/small/count-1, keeping up to
+ * MAX_INFLIGHT requests going (just one without a pool). */
+static int fetch_small(const char *base, unsigned count,
+      struct http_pool_t *pool, size_t *bytes)
+{
+   struct http_t *http[MAX_INFLIGHT] = {NULL};
+   unsigned inflight = pool ? MAX_INFLIGHT : 1;
+   unsigned next     = 0;
+   unsigned done     = 0;
+   unsigned i;
+
+   *bytes = 0;
+
+   while (done < count)
+   {
+      for (i = 0; i < inflight; i++)
+      {
+         size_t len;
+         char *data;
+
+         if (!http[i])
+         {
+            char url[1024];
+
+            if (next == count)
+               continue;
+
+            snprintf(url, sizeof(url), "%s/small/%u", base, next++);
+            if (!(http[i] = http_test_new(url, pool)))
+               return -1;
+         }
+
+         if (!net_http_update(http[i], NULL, NULL))
+            continue;
+
+         data = (char*)net_http_data(http[i], &len, true);
+         if (net_http_error(http[i]))
+            return -1;
+
+         *bytes += len;
+         free(data);
+         net_http_delete(http[i]);
+         http[i] = NULL;
+         done++;
+      }
+   }
+
+   return 0;
+}
+
+static bool count_sink(void *userdata, const uint8_t *data, size_t len)
 {
-   char   *data;
-   struct http_t *http1, *http3;
-   size_t len, pos = 0, tot = 0;
+   (void)data;
+   *(size_t*)userdata += len;
+   return true;
+}
+
+int main(int argc, char *argv[])
+{
+   double t;
+   size_t bytes              = 0;
+   unsigned count            = 1000;
+   struct http_t *http       = NULL;
+   struct http_pool_t *pool  = NULL;
+   const char *base          = argc > 1 ? argv[1] : "http://127.0.0.1:8000";
+   char url[1024];
+
+   if (argc > 2)
+      count = strtoul(argv[2], NULL, 10);
 
    if (!network_init())
       return -1;
 
-   http1 = net_http_new("http://buildbot.libretro.com/nightly/win-x86/latest/mednafen_psx_libretro.dll.zip");
+   t = now();
+   if (fetch_small(base, count, NULL, &bytes) < 0)
+      return 1;
+   t = now() - t;
+   printf("%u small files (%lu bytes), new connection each: %.3f s, %.0f files/s\n",
+         count, (unsigned long)bytes, t, count / t);
+
+   pool = net_http_pool_new();
+   t    = now();
+   if (fetch_small(base, count, pool, &bytes) < 0)
+      return 1;
+   t    = now() - t;
+   printf("%u small files (%lu bytes), pooled and pipelined: %.3f s, %.0f files/s\n",
+         count, (unsigned long)bytes, t, count / t);
 
-   while (!net_http_update(http1, &pos, &tot))
-      printf("%.9lu / %.9lu        \r",pos,tot);
-	
-   http3 = net_http_new("http://www.wikipedia.org/");
-   while (!net_http_update(http3, NULL, NULL)) {}
-	
-   data  = (char*)net_http_data(http3, &len, false);
+   /* Stream the large file through a sink instead of into memory. */
+   snprintf(url, sizeof(url), "%s/large", base);
+   bytes = 0;
+   t     = now();
+   if (!(http = http_test_new(url, pool)))
+      return 1;
+   net_http_set_sink(http, count_sink, &bytes);
+   while (!net_http_update(http, NULL, NULL)) {}
+   t     = now() - t;
+   if (net_http_error(http))
+      return 1;
+   printf("large file streamed: %lu bytes, %.3f s, %.1f MB/s\n",
+         (unsigned long)bytes, t, bytes / t / (1024 * 1024));
 
-   printf("%.*s\n", (int)256, data);
+   net_http_delete(http);
+   net_http_pool_free(pool);
 
-   net_http_delete(http1);
-   net_http_delete(http3);
-   
    network_deinit();
 
    return 0;
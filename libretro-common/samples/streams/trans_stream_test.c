@@ -0,0 +1,334 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (trans_stream_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <streams/trans_stream.h>
+#include <string/stdstring.h>
+
+/* Same chunk size the compressed savestate container uses */
+#define BENCH_CHUNK_SIZE  (256 * 1024)
+#define BENCH_MIN_BYTES   (64 * 1024 * 1024)
+
+struct bench_codec
+{
+   const char *name;
+   const struct trans_stream_backend *backend;
+   int level;
+};
+
+static void *read_file(const char *path, size_t *len)
+{
+   long size;
+   void *buf = NULL;
+   FILE *fp  = fopen(path, "rb");
+
+   if (!fp)
+      return NULL;
+
+   fseek(fp, 0, SEEK_END);
+   size = ftell(fp);
+   fseek(fp, 0, SEEK_SET);
+
+   if (size >= 0 && (buf = malloc(size ? size : 1)))
+   {
+      if (fread(buf, 1, size, fp) != (size_t)size)
+      {
+         free(buf);
+         buf = NULL;
+      }
+      *len = size;
+   }
+
+   fclose(fp);
+   return buf;
+}
+
+static bool codec_trans(const struct trans_stream_backend *backend,
+      void *stream, const uint8_t *in, uint32_t in_size,
+      uint8_t *out, uint32_t out_size, uint32_t *written)
+{
+   uint32_t rd = 0;
+   enum trans_stream_error err;
+
+   backend->set_in(stream, in, in_size);
+   backend->set_out(stream, out, out_size);
+
+   if (!backend->trans(stream, true, &rd, written, &err))
+      return false;
+
+   return rd == in_size;
+}
+
+/* Compresses buf chunk by chunk, then decompresses and compares. */
+static bool bench_file(const struct bench_codec *codec,
+      const uint8_t *buf, size_t len,
+      double *comp_secs, double *decomp_secs, size_t *comp_len)
+{
+   size_t pos;
+   clock_t start;
+   unsigned i;
+   bool ret         = false;
+   unsigned passes  = (unsigned)(BENCH_MIN_BYTES / (len ? len : 1)) + 1;
+   uint32_t bound   = TRANS_STREAM_LZ4_BOUND(BENCH_CHUNK_SIZE) + 1024;
+   size_t chunks    = (len + BENCH_CHUNK_SIZE - 1) / BENCH_CHUNK_SIZE;
+   uint8_t *comp    = (uint8_t*)malloc(chunks * bound + 1);
+   uint32_t *sizes  = (uint32_t*)calloc(chunks + 1, sizeof(*sizes));
+   uint8_t *decomp  = (uint8_t*)malloc(len + 1);
+   void *cstream    = codec->backend->stream_new();
+   void *dstream    = codec->backend->reverse->stream_new();
+
+   if (!comp || !sizes || !decomp || !cstream || !dstream)
+      goto end;
+
+   if (codec->level >= 0)
+      codec->backend->define(cstream, "level", codec->level);
+
+   start = clock();
+   for (i = 0; i < passes; i++)
+   {
+      size_t out = 0;
+      size_t c   = 0;
+
+      for (pos = 0; pos < len; pos += BENCH_CHUNK_SIZE, c++)
+      {
+         uint32_t chunk = (uint32_t)(len - pos < BENCH_CHUNK_SIZE
+               ? len - pos : BENCH_CHUNK_SIZE);
+
+         if (!codec_trans(codec->backend, cstream, buf + pos, chunk,
+                  comp + c * bound, bound, &sizes[c]))
+            goto end;
+         out += sizes[c];
+      }
+      *comp_len = out;
+   }
+   *comp_secs = (double)(clock() - start) / CLOCKS_PER_SEC / passes;
+
+   start = clock();
+   for (i = 0; i < passes; i++)
+   {
+      size_t c = 0;
+
+      for (pos = 0; pos < len; pos += BENCH_CHUNK_SIZE, c++)
+      {
+         uint32_t written = 0;
+         uint32_t chunk   = (uint32_t)(len - pos < BENCH_CHUNK_SIZE
+               ? len - pos : BENCH_CHUNK_SIZE);
+
+         if (!codec_trans(codec->backend->reverse, dstream,
+                  comp + c * bound, sizes[c], decomp + pos, chunk, &written)
+               || written != chunk)
+            goto end;
+      }
+   }
+   *decomp_secs = (double)(clock() - start) / CLOCKS_PER_SEC / passes;
+
+   ret = !memcmp(buf, decomp, len);
+
+end:
+   if (cstream)
+      codec->backend->stream_free(cstream);
+   if (dstream)
+      codec->backend->reverse->stream_free(dstream);
+   free(comp);
+   free(sizes);
+   free(decomp);
+   return ret;
+}
+
+static int bench_trans_stream(int num_files, char *paths[])
+{
+   int i;
+   unsigned j;
+   struct bench_codec codecs[3];
+   unsigned num_codecs = 0;
+
+   codecs[num_codecs].name    = "lz4";
+   codecs[num_codecs].backend = trans_stream_get_lz4_compress_backend();
+   codecs[num_codecs++].level = -1;
+
+   if (trans_stream_get_zlib_deflate_backend())
+   {
+      codecs[num_codecs].name    = "zlib -1";
+      codecs[num_codecs].backend = trans_stream_get_zlib_deflate_backend();
+      codecs[num_codecs++].level = 1;
+      codecs[num_codecs].name    = "zlib -6";
+      codecs[num_codecs].backend = trans_stream_get_zlib_deflate_backend();
+      codecs[num_codecs++].level = 6;
+   }
+
+   for (i = 0; i < num_files; i++)
+   {
+      size_t len = 0;
+      uint8_t *buf = (uint8_t*)read_file(paths[i], &len);
+
+      if (!buf)
+      {
+         fprintf(stderr, "Could not read %s.\n", paths[i]);
+         return 1;
+      }
+
+      printf("%s: %u bytes\n", paths[i], (unsigned)len);
+
+      for (j = 0; j < num_codecs; j++)
+      {
+         double comp_secs   = 0.0;
+         double decomp_secs = 0.0;
+         size_t comp_len    = 0;
+
+         if (!bench_file(&codecs[j], buf, len,
+                  &comp_secs, &decomp_secs, &comp_len))
+         {
+            fprintf(stderr, "%s: round trip failed for %s.\n",
+                  codecs[j].name, paths[i]);
+            free(buf);
+            return 1;
+         }
+
+         printf("  %-8s %10u bytes (%5.1f%%)  save %8.3f ms  load %8.3f ms\n",
+               codecs[j].name, (unsigned)comp_len,
+               len ? 100.0 * comp_len / len : 0.0,
+               comp_secs * 1000.0, decomp_secs * 1000.0);
+      }
+
+      free(buf);
+   }
+
+   return 0;
+}
+
+static bool test_round_trip(void *cstream, void *dstream,
+      const uint8_t *buf, uint32_t len, uint8_t *comp, uint8_t *decomp)
+{
+   uint32_t comp_len = 0;
+   uint32_t written  = 0;
+
+   if (!codec_trans(&lz4_compress_backend, cstream, buf, len,
+            comp, TRANS_STREAM_LZ4_BOUND(len), &comp_len))
+      return false;
+
+   if (!codec_trans(&lz4_decompress_backend, dstream, comp, comp_len,
+            decomp, len, &written))
+      return false;
+
+   return written == len && !memcmp(buf, decomp, len);
+}
+
+static int test_trans_stream(void)
+{
+   uint32_t i, len;
+   uint32_t written = 0;
+   uint32_t max_len = 1024 * 1024;
+   uint8_t *buf     = (uint8_t*)malloc(max_len);
+   uint8_t *comp    = (uint8_t*)malloc(TRANS_STREAM_LZ4_BOUND(max_len));
+   uint8_t *decomp  = (uint8_t*)malloc(max_len);
+   void *cstream    = lz4_compress_backend.stream_new();
+   void *dstream    = lz4_decompress_backend.stream_new();
+
+   srand(1);
+
+   /* Small and odd sizes, both incompressible and repetitive */
+   for (len = 0; len < 300; len++)
+   {
+      for (i = 0; i < len; i++)
+         buf[i] = (uint8_t)rand();
+      if (!test_round_trip(cstream, dstream, buf, len, comp, decomp))
+         goto fail;
+
+      for (i = 0; i < len; i++)
+         buf[i] = (uint8_t)(i % 7);
+      if (!test_round_trip(cstream, dstream, buf, len, comp, decomp))
+         goto fail;
+   }
+
+   /* Savestate-like data: zero pages, repeated tables and noise */
+   for (i = 0; i < max_len; i++)
+   {
+      uint32_t page = i >> 12;
+      if (page % 3 == 0)
+         buf[i] = 0;
+      else if (page % 3 == 1)
+         buf[i] = (uint8_t)((i * 13) >> 3);
+      else
+         buf[i] = (uint8_t)rand();
+   }
+   if (!test_round_trip(cstream, dstream, buf, max_len, comp, decomp))
+      goto fail;
+
+   /* Output buffer too small must fail cleanly */
+   if (codec_trans(&lz4_compress_backend, cstream, buf, max_len,
+            comp, max_len / 8, &written))
+      goto fail;
+
+   /* Corrupt input must never decode out of bounds */
+   codec_trans(&lz4_compress_backend, cstream, buf, 65536,
+         comp, TRANS_STREAM_LZ4_BOUND(65536), &len);
+   for (i = 0; i < 20000; i++)
+   {
+      uint32_t pos = rand() % len;
+      uint8_t old  = comp[pos];
+
+      comp[pos] = (uint8_t)rand();
+      codec_trans(&lz4_decompress_backend, dstream,
+            comp, 1 + rand() % len, decomp, 1 + rand() % 65536, &written);
+      comp[pos] = old;
+   }
+
+   lz4_compress_backend.stream_free(cstream);
+   lz4_decompress_backend.stream_free(dstream);
+   free(buf);
+   free(comp);
+   free(decomp);
+   return 0;
+
+fail:
+   fprintf(stderr, "Round trip failed at %u bytes.\n", (unsigned)len);
+   return 1;
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc > 2 && string_is_equal(argv[1], "-b"))
+      return bench_trans_stream(argc - 2, argv + 2);
+
+   if (argc != 2 || !string_is_equal(argv[1], "-t"))
+   {
+      fprintf(stderr, "Usage: %s -t\n", argv[0]);
+      fprintf(stderr, "       %s -b <savestate files...>\n", argv[0]);
+      return 1;
+   }
+
+   fprintf(stderr, "Doing tests...\n");
+
+   if (test_trans_stream() != 0)
+   {
+      fprintf(stderr, "Test failed.\n");
+      return -1;
+   }
+
+   fprintf(stderr, "All tests passed.\n");
+   return 0;
+}
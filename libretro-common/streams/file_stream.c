@@ -437,8 +437,12 @@ ssize_t filestream_tell(RFILE *stream)
    if (stream->mapped && stream->hints & RFILE_HINT_MMAP)
       return stream->mappos;
 #endif
-   if (lseek(stream->fd, 0, SEEK_CUR) < 0)
-      goto error;
+   {
+      ssize_t pos = lseek(stream->fd, 0, SEEK_CUR);
+      if (pos < 0)
+         goto error;
+      return pos;
+   }
 #endif
 
    return 0;
@@ -554,6 +558,8 @@ int filestream_close(RFILE *stream)
    if (stream->fd > 0)
       close(stream->fd);
 #endif
+   if (stream->ext)
+      free(stream->ext);
    free(stream);
 
    return 0;
@@ -0,0 +1,453 @@
+/* Copyright  (C) 2010-2017 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (trans_stream_lz4.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Self-contained encoder/decoder for the LZ4 block format.
+ *
+ * Every call to trans() treats its whole input as one independent
+ * block, so callers that want to stream large buffers split them
+ * into chunks themselves. The flush flag is ignored. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <streams/trans_stream.h>
+
+#define LZ4_MINMATCH       4
+#define LZ4_MFLIMIT        12
+#define LZ4_LASTLITERALS   5
+#define LZ4_HASH_LOG       12
+#define LZ4_MAX_DISTANCE   65535
+#define LZ4_SKIP_TRIGGER   6
+#define LZ4_RUN_MASK       15
+
+struct lz4_trans_stream
+{
+   const uint8_t *in;
+   uint8_t *out;
+   uint32_t in_size, out_size;
+   uint32_t *table;
+};
+
+static INLINE uint32_t lz4_read32(const uint8_t *p)
+{
+   uint32_t v;
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+static INLINE uint32_t lz4_hash(uint32_t v)
+{
+   return (v * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static INLINE size_t lz4_length_bytes(size_t len)
+{
+   return len >= LZ4_RUN_MASK ? (len - LZ4_RUN_MASK) / 255 + 1 : 0;
+}
+
+static uint8_t *lz4_write_length(uint8_t *op, size_t len)
+{
+   if (len < LZ4_RUN_MASK)
+      return op;
+
+   len -= LZ4_RUN_MASK;
+   while (len >= 255)
+   {
+      *op++ = 255;
+      len  -= 255;
+   }
+   *op++ = (uint8_t)len;
+   return op;
+}
+
+/* Returns the end of the common prefix of ip and match, not going past limit. */
+static INLINE const uint8_t *lz4_match_end(const uint8_t *ip,
+      const uint8_t *match, const uint8_t *limit)
+{
+   while (ip + 8 <= limit)
+   {
+      uint64_t a, b;
+      memcpy(&a, ip,    sizeof(a));
+      memcpy(&b, match, sizeof(b));
+      if (a != b)
+         break;
+      ip    += 8;
+      match += 8;
+   }
+
+   while (ip < limit && *ip == *match)
+   {
+      ip++;
+      match++;
+   }
+
+   return ip;
+}
+
+/**
+ * lz4_compress_block:
+ *
+ * Greedy single-pass LZ4 block encoder.
+ *
+ * Returns: compressed size, or 0 if the output did not fit in @dst_size.
+ **/
+static uint32_t lz4_compress_block(uint32_t *table,
+      const uint8_t *src, uint32_t src_size,
+      uint8_t *dst, uint32_t dst_size)
+{
+   const uint8_t *ip         = src;
+   const uint8_t *anchor     = src;
+   const uint8_t *iend       = src + src_size;
+   const uint8_t *mflimit    = NULL;
+   const uint8_t *matchlimit = NULL;
+   uint8_t *op               = dst;
+   uint8_t *oend             = dst + dst_size;
+   size_t lit_len;
+
+   if (src_size < LZ4_MFLIMIT + 1)
+      goto last_literals;
+
+   mflimit    = iend - LZ4_MFLIMIT;
+   matchlimit = iend - LZ4_LASTLITERALS;
+
+   memset(table, 0, sizeof(*table) << LZ4_HASH_LOG);
+   table[lz4_hash(lz4_read32(ip))] = 0;
+   ip++;
+
+   for (;;)
+   {
+      const uint8_t *match;
+      const uint8_t *match_end;
+      size_t match_len;
+      uint8_t *token;
+      unsigned attempts = 1 << LZ4_SKIP_TRIGGER;
+      unsigned step     = 1;
+
+      /* Find a match, skipping faster through incompressible data */
+      for (;;)
+      {
+         uint32_t h;
+
+         if (ip > mflimit)
+            goto last_literals;
+
+         h        = lz4_hash(lz4_read32(ip));
+         match    = src + table[h];
+         table[h] = (uint32_t)(ip - src);
+
+         if (ip - match <= LZ4_MAX_DISTANCE
+               && lz4_read32(match) == lz4_read32(ip))
+            break;
+
+         ip  += step;
+         step = attempts++ >> LZ4_SKIP_TRIGGER;
+      }
+
+      while (ip > anchor && match > src && ip[-1] == match[-1])
+      {
+         ip--;
+         match--;
+      }
+
+      match_end = lz4_match_end(ip + LZ4_MINMATCH,
+            match + LZ4_MINMATCH, matchlimit);
+      lit_len   = ip - anchor;
+      match_len = match_end - ip - LZ4_MINMATCH;
+
+      if ((size_t)(oend - op) < 1 + lz4_length_bytes(lit_len) + lit_len
+            + 2 + lz4_length_bytes(match_len))
+         return 0;
+
+      token  = op++;
+      *token = (uint8_t)(
+            ((lit_len   >= LZ4_RUN_MASK ? LZ4_RUN_MASK : lit_len) << 4) |
+             (match_len >= LZ4_RUN_MASK ? LZ4_RUN_MASK : match_len));
+
+      op = lz4_write_length(op, lit_len);
+      memcpy(op, anchor, lit_len);
+      op   += lit_len;
+
+      *op++ = (uint8_t)((ip - match) & 0xff);
+      *op++ = (uint8_t)((ip - match) >> 8);
+
+      op     = lz4_write_length(op, match_len);
+
+      ip     = match_end;
+      anchor = ip;
+
+      if (ip > mflimit)
+         break;
+
+      /* Seed the table with a position inside the match we just took */
+      table[lz4_hash(lz4_read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+   }
+
+last_literals:
+   lit_len = iend - anchor;
+
+   if ((size_t)(oend - op) < 1 + lz4_length_bytes(lit_len) + lit_len)
+      return 0;
+
+   *op++ = (uint8_t)((lit_len >= LZ4_RUN_MASK ? LZ4_RUN_MASK : lit_len) << 4);
+   op    = lz4_write_length(op, lit_len);
+   memcpy(op, anchor, lit_len);
+   op   += lit_len;
+
+   return (uint32_t)(op - dst);
+}
+
+static bool lz4_read_length(const uint8_t **ip, const uint8_t *iend,
+      size_t *len, size_t limit)
+{
+   uint8_t b;
+
+   if (*len != LZ4_RUN_MASK)
+      return true;
+
+   do
+   {
+      if (*ip >= iend)
+         return false;
+      b     = *(*ip)++;
+      *len += b;
+      if (*len > limit)
+         return false;
+   } while (b == 255);
+
+   return true;
+}
+
+/**
+ * lz4_decompress_block:
+ *
+ * Bounds-checked LZ4 block decoder; never reads or writes outside
+ * the given buffers, even for corrupt input.
+ *
+ * Returns: true and the decoded size in @out_size on success.
+ **/
+static bool lz4_decompress_block(const uint8_t *src, uint32_t src_size,
+      uint8_t *dst, uint32_t dst_size, uint32_t *out_size)
+{
+   const uint8_t *ip   = src;
+   const uint8_t *iend = src + src_size;
+   uint8_t *op         = dst;
+   uint8_t *oend       = dst + dst_size;
+
+   while (ip < iend)
+   {
+      const uint8_t *match;
+      size_t offset;
+      unsigned token = *ip++;
+      size_t len     = token >> 4;
+
+      if (!lz4_read_length(&ip, iend, &len, dst_size))
+         return false;
+      if (len > (size_t)(iend - ip) || len > (size_t)(oend - op))
+         return false;
+
+      memcpy(op, ip, len);
+      op += len;
+      ip += len;
+
+      /* The last sequence of a block carries literals only */
+      if (ip == iend)
+         break;
+
+      if (iend - ip < 2)
+         return false;
+
+      offset = ip[0] | (ip[1] << 8);
+      ip    += 2;
+
+      if (offset == 0 || offset > (size_t)(op - dst))
+         return false;
+
+      len = token & LZ4_RUN_MASK;
+      if (!lz4_read_length(&ip, iend, &len, dst_size))
+         return false;
+      len += LZ4_MINMATCH;
+
+      if (len > (size_t)(oend - op))
+         return false;
+
+      match = op - offset;
+
+      if (offset >= len)
+      {
+         memcpy(op, match, len);
+         op += len;
+      }
+      else
+      {
+         /* Overlapping copy: the span behind op is periodic, so each
+          * pass can copy everything written since match. */
+         while (len)
+         {
+            size_t n = (size_t)(op - match);
+            if (n > len)
+               n = len;
+            memcpy(op, match, n);
+            op  += n;
+            len -= n;
+         }
+      }
+   }
+
+   *out_size = (uint32_t)(op - dst);
+   return true;
+}
+
+static void *lz4_compress_stream_new(void)
+{
+   struct lz4_trans_stream *ret = (struct lz4_trans_stream*)
+      calloc(1, sizeof(struct lz4_trans_stream));
+
+   if (!ret)
+      return NULL;
+
+   ret->table = (uint32_t*)malloc(sizeof(uint32_t) << LZ4_HASH_LOG);
+
+   if (!ret->table)
+   {
+      free(ret);
+      return NULL;
+   }
+
+   return ret;
+}
+
+static void *lz4_decompress_stream_new(void)
+{
+   return (struct lz4_trans_stream*)calloc(1, sizeof(struct lz4_trans_stream));
+}
+
+static void lz4_stream_free(void *data)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+   if (!z)
+      return;
+   free(z->table);
+   free(z);
+}
+
+static void lz4_set_in(void *data, const uint8_t *in, uint32_t in_size)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+   z->in      = in;
+   z->in_size = in_size;
+}
+
+static void lz4_set_out(void *data, uint8_t *out, uint32_t out_size)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+   z->out      = out;
+   z->out_size = out_size;
+}
+
+static bool lz4_compress_trans(
+   void *data, bool flush,
+   uint32_t *rd, uint32_t *wn,
+   enum trans_stream_error *error)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+   uint32_t written           = lz4_compress_block(z->table,
+         z->in, z->in_size, z->out, z->out_size);
+
+   *rd = *wn = 0;
+
+   if (!written)
+   {
+      if (error)
+         *error = TRANS_STREAM_ERROR_BUFFER_FULL;
+      return false;
+   }
+
+   *rd        = z->in_size;
+   *wn        = written;
+   z->in     += z->in_size;
+   z->out    += written;
+   z->in_size = 0;
+   if (error)
+      *error  = TRANS_STREAM_ERROR_NONE;
+   return true;
+}
+
+static bool lz4_decompress_trans(
+   void *data, bool flush,
+   uint32_t *rd, uint32_t *wn,
+   enum trans_stream_error *error)
+{
+   struct lz4_trans_stream *z = (struct lz4_trans_stream *) data;
+   uint32_t written           = 0;
+
+   *rd = *wn = 0;
+
+   if (!lz4_decompress_block(z->in, z->in_size,
+            z->out, z->out_size, &written))
+   {
+      if (error)
+         *error = TRANS_STREAM_ERROR_INVALID;
+      return false;
+   }
+
+   *rd        = z->in_size;
+   *wn        = written;
+   z->in     += z->in_size;
+   z->out    += written;
+   z->in_size = 0;
+   if (error)
+      *error  = TRANS_STREAM_ERROR_NONE;
+   return true;
+}
+
+const struct trans_stream_backend lz4_compress_backend = {
+   "lz4_compress",
+   &lz4_decompress_backend,
+   lz4_compress_stream_new,
+   lz4_stream_free,
+   NULL,
+   lz4_set_in,
+   lz4_set_out,
+   lz4_compress_trans
+};
+
+const struct trans_stream_backend lz4_decompress_backend = {
+   "lz4_decompress",
+   &lz4_compress_backend,
+   lz4_decompress_stream_new,
+   lz4_stream_free,
+   NULL,
+   lz4_set_in,
+   lz4_set_out,
+   lz4_decompress_trans
+};
+
+const struct trans_stream_backend* trans_stream_get_lz4_compress_backend(void)
+{
+   return &lz4_compress_backend;
+}
+
+const struct trans_stream_backend* trans_stream_get_lz4_decompress_backend(void)
+{
+   return &lz4_decompress_backend;
+}
@@ -32,6 +32,7 @@
 
 #include <retro_assert.h>
 #include <string/stdstring.h>
+#include <rthreads/rthreads.h>
 
 #include "libretrodb.h"
 
@@ -67,8 +68,6 @@ typedef struct
 typedef struct dat_converter_map_t dat_converter_map_t;
 typedef struct dat_converter_list_t dat_converter_list_t;
 typedef union dat_converter_list_item_t dat_converter_list_item_t;
-typedef struct dat_converter_search_tree_t dat_converter_search_tree_t;
-typedef struct dat_converter_bt_node_t dat_converter_bt_node_t;
 
 struct dat_converter_map_t
 {
@@ -86,7 +85,10 @@ struct dat_converter_list_t
 {
    dat_converter_list_enum type;
    dat_converter_list_item_t* values;
-   dat_converter_bt_node_t* bt_root;
+   /* open-addressed hash of keyed map values, -1 marks a free slot */
+   int* index;
+   int index_count;
+   int index_capacity;
    int count;
    int capacity;
 };
@@ -99,15 +101,6 @@ union dat_converter_list_item_t
    dat_converter_list_t* list;
 };
 
-
-struct dat_converter_bt_node_t
-{
-   int index;
-   uint32_t hash;
-   dat_converter_bt_node_t* right;
-   dat_converter_bt_node_t* left;
-};
-
 static dat_converter_list_t* dat_converter_list_create(
       dat_converter_list_enum type)
 {
@@ -116,23 +109,15 @@ static dat_converter_list_t* dat_converter_list_create(
    list->type                 = type;
    list->count                = 0;
    list->capacity             = (1 << 2);
-   list->bt_root              = NULL;
+   list->index                = NULL;
+   list->index_count          = 0;
+   list->index_capacity       = 0;
    list->values               = (dat_converter_list_item_t*)malloc(
          sizeof(*list->values) * list->capacity);
 
    return list;
 }
 
-static void dat_converter_bt_node_free(dat_converter_bt_node_t* node)
-{
-   if (!node)
-      return;
-
-   dat_converter_bt_node_free(node->left);
-   dat_converter_bt_node_free(node->right);
-   free(node);
-}
-
 static void dat_converter_list_free(dat_converter_list_t* list)
 {
    if (!list)
@@ -149,7 +134,7 @@ static void dat_converter_list_free(dat_converter_list_t* list)
          if (list->values[list->count].map.type == DAT_CONVERTER_LIST_MAP)
             dat_converter_list_free(list->values[list->count].map.value.list);
       }
-      dat_converter_bt_node_free(list->bt_root);
+      free(list->index);
       break;
    default:
       break;
@@ -160,44 +145,79 @@ static void dat_converter_list_free(dat_converter_list_t* list)
 }
 static void dat_converter_list_append(dat_converter_list_t* dst, void* item);
 
-static dat_converter_bt_node_t* dat_converter_bt_node_insert(
-      dat_converter_list_t* list,
-      dat_converter_bt_node_t** node,
-      dat_converter_map_t* map)
+static void dat_converter_list_index_grow(dat_converter_list_t* list)
 {
-   retro_assert(map->key);
-   retro_assert(list->type == DAT_CONVERTER_MAP_LIST);
+   int i;
+   int mask;
+
+   free(list->index);
+   list->index_capacity = list->index_capacity
+      ? list->index_capacity << 1 : (1 << 4);
+   list->index          = malloc(sizeof(*list->index) * list->index_capacity);
+   mask                 = list->index_capacity - 1;
 
-   if (!*node)
+   for (i = 0; i < list->index_capacity; i++)
+      list->index[i] = -1;
+
+   for (i = 0; i < list->count; i++)
    {
-      *node = calloc(1, sizeof(dat_converter_bt_node_t));
-      return *node;
+      int slot;
+
+      if (!list->values[i].map.key)
+         continue;
+
+      slot = list->values[i].map.hash & mask;
+      while (list->index[slot] >= 0)
+         slot = (slot + 1) & mask;
+      list->index[slot] = i;
    }
+}
+
+/* Returns the slot holding an entry with the same key as @map,
+ * or the free slot it should go into. */
+static int* dat_converter_list_index_lookup(
+      dat_converter_list_t* list, dat_converter_map_t* map)
+{
+   int mask;
+   int slot;
+
+   if ((list->index_count + 1) * 2 > list->index_capacity)
+      dat_converter_list_index_grow(list);
+
+   mask = list->index_capacity - 1;
+   slot = map->hash & mask;
+
+   while (list->index[slot] >= 0)
+   {
+      dat_converter_map_t* entry = &list->values[list->index[slot]].map;
 
-   int diff = (*node)->hash - map->hash;
+      if (entry->hash == map->hash && string_is_equal(entry->key, map->key))
+         break;
 
-   if (!diff)
-      diff = strcmp(list->values[(*node)->index].map.key, map->key);
+      slot = (slot + 1) & mask;
+   }
 
-   if (diff < 0)
-      return dat_converter_bt_node_insert(list, &(*node)->left, map);
-   else if (diff > 0)
-      return dat_converter_bt_node_insert(list, &(*node)->right, map);
+   return &list->index[slot];
+}
 
-   /* found match */
+static void dat_converter_list_merge(dat_converter_list_t* list,
+      int index, dat_converter_map_t* map)
+{
+   retro_assert(map->key);
+   retro_assert(list->type == DAT_CONVERTER_MAP_LIST);
 
-   if (list->values[(*node)->index].map.type == DAT_CONVERTER_LIST_MAP)
+   if (list->values[index].map.type == DAT_CONVERTER_LIST_MAP)
    {
       if (map->type == DAT_CONVERTER_LIST_MAP)
       {
          int i;
 
-         retro_assert(list->values[(*node)->index].map.value.list->type 
+         retro_assert(list->values[index].map.value.list->type 
                == map->value.list->type);
 
          for (i = 0; i < map->value.list->count; i++)
             dat_converter_list_append(
-                  list->values[(*node)->index].map.value.list,
+                  list->values[index].map.value.list,
                   &map->value.list->values[i]);
 
          /* set count to 0 to prevent freeing the child nodes */
@@ -206,12 +226,9 @@ static dat_converter_bt_node_t* dat_converter_bt_node_insert(
       }
    }
    else
-      list->values[(*node)->index].map = *map;
-
-   return NULL;
+      list->values[index].map = *map;
 }
 
-
 static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
 {
    if (dst->count == dst->capacity)
@@ -240,16 +257,20 @@ static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
          dst->values[dst->count].map = *map;
       else
       {
+         int* slot;
+
          map->hash = djb2_calculate(map->key);
-         dat_converter_bt_node_t* new_node = 
-            dat_converter_bt_node_insert(dst, &dst->bt_root, map);
+         slot      = dat_converter_list_index_lookup(dst, map);
 
-         if (!new_node)
+         if (*slot >= 0)
+         {
+            dat_converter_list_merge(dst, *slot, map);
             return;
+         }
 
          dst->values[dst->count].map = *map;
-         new_node->index = dst->count;
-         new_node->hash = map->hash;
+         *slot = dst->count;
+         dst->index_count++;
       }
       break;
    }
@@ -736,19 +757,112 @@ static int dat_converter_value_provider(
    return 0;
 }
 
+typedef struct
+{
+   const char* path;
+   char* buffer;
+   dat_converter_list_t* parsed;
+} dat_converter_dat_t;
+
+typedef struct
+{
+   dat_converter_dat_t* dats;
+   dat_converter_match_key_t* match_key;
+   slock_t* lock;
+   int count;
+   int next;
+} dat_converter_parse_queue_t;
+
+static void dat_converter_load(dat_converter_dat_t* dat,
+      dat_converter_match_key_t* match_key)
+{
+   size_t dat_file_size;
+   dat_converter_list_t* dat_lexer_list = NULL;
+   FILE* dat_file                       = fopen(dat->path, "r");
+
+   if (!dat_file)
+   {
+      printf("could not open dat file '%s': %s\n",
+            dat->path, strerror(errno));
+      dat_converter_exit(1);
+   }
+
+   fseek(dat_file, 0, SEEK_END);
+   dat_file_size = ftell(dat_file);
+   fseek(dat_file, 0, SEEK_SET);
+   dat->buffer = (char*)malloc(dat_file_size + 1);
+   fread(dat->buffer, 1, dat_file_size, dat_file);
+   fclose(dat_file);
+   dat->buffer[dat_file_size] = '\0';
+
+   printf("Parsing dat file '%s'...\n", dat->path);
+   dat_lexer_list = dat_converter_lexer(dat->buffer, dat->path);
+   dat->parsed    = dat_converter_parser(NULL, dat_lexer_list, match_key);
+
+   dat_converter_list_free(dat_lexer_list);
+}
+
+static void dat_converter_parse_thread(void* data)
+{
+   dat_converter_parse_queue_t* queue = (dat_converter_parse_queue_t*)data;
+
+   for (;;)
+   {
+      int i;
+
+      slock_lock(queue->lock);
+      i = queue->next++;
+      slock_unlock(queue->lock);
+
+      if (i >= queue->count)
+         break;
+
+      dat_converter_load(&queue->dats[i], queue->match_key);
+   }
+}
+
+static int dat_converter_default_threads(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+   long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   if (cpus > 0)
+      return (int)cpus;
+#endif
+   return 1;
+}
+
 int main(int argc, char** argv)
 {
+   int i;
    const char* rdb_path;
    dat_converter_match_key_t* match_key = NULL;
    RFILE* rdb_file;
+   const char* program                  = *argv;
+   int threads                          = 0;
+
+   argc--;
+   argv++;
+
+   /* -j<N> sets the number of DAT parsing threads */
+   if (argc && !strncmp(*argv, "-j", 2))
+   {
+      if ((*argv)[2])
+         threads = atoi(*argv + 2);
+      else if (argc > 1)
+      {
+         argc--;
+         argv++;
+         threads = atoi(*argv);
+      }
+      argc--;
+      argv++;
+   }
 
-   if (argc < 2)
+   if (argc < 1)
    {
-      printf("usage:\n%s <db file> [args ...]\n", *argv);
+      printf("usage:\n%s [-j<threads>] <db file> [args ...]\n", program);
       dat_converter_exit(1);
    }
-   argc--;
-   argv++;
 
    rdb_path  = *argv;
    argc--;
@@ -762,42 +876,79 @@ int main(int argc, char** argv)
    }
 
    int dat_count                         = argc;
-   char** dat_buffers                    = (char**)
-      malloc(dat_count * sizeof(*dat_buffers));
-   char** dat_buffer                     = dat_buffers;
+   dat_converter_dat_t* dats             = (dat_converter_dat_t*)
+      calloc(dat_count ? dat_count : 1, sizeof(*dats));
    dat_converter_list_t* dat_parser_list = NULL;
 
-   while (argc)
+   for (i = 0; i < dat_count; i++)
+      dats[i].path = argv[i];
+
+   if (threads <= 0)
+      threads = dat_converter_default_threads();
+   if (threads > dat_count)
+      threads = dat_count;
+
+   if (threads > 1)
+   {
+      sthread_t** workers                = (sthread_t**)
+         calloc(threads, sizeof(*workers));
+      dat_converter_parse_queue_t queue;
+
+      queue.dats      = dats;
+      queue.match_key = match_key;
+      queue.lock      = slock_new();
+      queue.count     = dat_count;
+      queue.next      = 0;
+
+      for (i = 0; i < threads; i++)
+         workers[i] = sthread_create(dat_converter_parse_thread, &queue);
+
+      /* The main thread helps out, and covers for any worker
+       * that could not be started. */
+      dat_converter_parse_thread(&queue);
+
+      for (i = 0; i < threads; i++)
+         if (workers[i])
+            sthread_join(workers[i]);
+
+      slock_free(queue.lock);
+      free(workers);
+   }
+   else
    {
-      size_t dat_file_size;
-      dat_converter_list_t* dat_lexer_list = NULL;
-      FILE* dat_file                       = fopen(*argv, "r");
+      for (i = 0; i < dat_count; i++)
+         dat_converter_load(&dats[i], match_key);
+   }
 
-      if (!dat_file)
+   /* Merge in command line order so the output does not depend
+    * on which thread finished first. */
+   for (i = 0; i < dat_count; i++)
+   {
+      int j;
+
+      if (!dat_parser_list)
       {
-         printf("could not open dat file '%s': %s\n",
-               *argv, strerror(errno));
-         dat_converter_exit(1);
+         dat_parser_list = dats[i].parsed;
+         continue;
       }
 
-      fseek(dat_file, 0, SEEK_END);
-      dat_file_size = ftell(dat_file);
-      fseek(dat_file, 0, SEEK_SET);
-      *dat_buffer = (char*)malloc(dat_file_size + 1);
-      fread(*dat_buffer, 1, dat_file_size, dat_file);
-      fclose(dat_file);
-      (*dat_buffer)[dat_file_size] = '\0';
+      /* skip the leading list terminator */
+      for (j = 1; j < dats[i].parsed->count; j++)
+         dat_converter_list_append(dat_parser_list,
+               &dats[i].parsed->values[j].map);
 
-      printf("Parsing dat file '%s'...\n", *argv);
-      dat_lexer_list  = dat_converter_lexer(*dat_buffer, *argv);
-      dat_parser_list = dat_converter_parser(
-            dat_parser_list, dat_lexer_list, match_key);
-
-      dat_converter_list_free(dat_lexer_list);
+      /* ownership of the entries moved to dat_parser_list */
+      dats[i].parsed->count = 0;
+      dat_converter_list_free(dats[i].parsed);
+   }
 
-      argc--;
-      argv++;
-      dat_buffer++;
+   if (!dat_parser_list)
+   {
+      dat_converter_map_t map = {0};
+      map.type                = DAT_CONVERTER_LIST_MAP;
+      dat_parser_list         = dat_converter_list_create(
+            DAT_CONVERTER_MAP_LIST);
+      dat_converter_list_append(dat_parser_list, &map);
    }
 
    rdb_file = filestream_open(rdb_path, RFILE_MODE_WRITE, -1);
@@ -826,11 +977,10 @@ int main(int argc, char** argv)
    dat_converter_list_free(dat_parser_list);
 
    while (dat_count--)
-      free(dat_buffers[dat_count]);
-   free(dat_buffers);
+      free(dats[dat_count].buffer);
+   free(dats);
 
    dat_converter_match_key_free(match_key);
 
    return 0;
 }
-
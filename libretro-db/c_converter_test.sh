@@ -3,6 +3,7 @@
 DAT_dir=dat
 lua_RDB_outdir=rdb_lua
 c_RDB_outdir=rdb_c
+c_st_RDB_outdir=rdb_c_st
 
 echo
 echo "==========================================================="
@@ -36,6 +37,22 @@ for dat_file in $DAT_dir/*.dat ; do
 done
 ./c_converter "$c_RDB_outdir/merged.rdb" rom.sha1 $DAT_dir/N*.dat
 
+echo
+echo "==========================================================="
+echo "============ running single-threaded C converter ==========="
+echo "==========================================================="
+echo
+
+rm -rf $c_st_RDB_outdir
+mkdir -p $c_st_RDB_outdir
+
+for dat_file in $DAT_dir/*.dat ; do
+   name=`echo "$dat_file" | sed "s/${DAT_dir}\/*//"`
+   name=`echo "$name" | sed "s/\.dat//"`
+   ./c_converter -j1 "$c_st_RDB_outdir/$name.rdb" "$dat_file"
+done
+./c_converter -j1 "$c_st_RDB_outdir/merged.rdb" rom.sha1 $DAT_dir/N*.dat
+
 echo
 echo "==========================================================="
 echo "==================== comparing files ====================="
@@ -61,6 +78,19 @@ for lua_rdb_file in $lua_RDB_outdir/*.rdb ; do
    fi
 done
 
+# The threaded parser must produce byte-identical output
+for c_st_rdb_file in $c_st_RDB_outdir/*.rdb ; do
+   name=`echo "$c_st_rdb_file" | sed "s/${c_st_RDB_outdir}\/*//"`
+
+   if cmp -s "$c_RDB_outdir/$name" "$c_st_rdb_file"; then
+      matches=$(( $matches + 1 ))
+   else
+      failed=$(( $failed + 1 ))
+      ls -la "$c_RDB_outdir/$name"
+      ls -la "$c_st_rdb_file"
+   fi
+done
+
 echo
 echo "==========================================================="
 echo
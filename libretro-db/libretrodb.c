@@ -39,17 +39,12 @@
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "query.h"
 #include "libretrodb.h"
 
 #define MAGIC_NUMBER "RARCHDB"
 
-struct node_iter_ctx
-{
-	libretrodb_t *db;
-	libretrodb_index_t *idx;
-};
+#define CURSOR_MAX_FIELDS 25
 
 struct libretrodb
 {
@@ -85,6 +80,12 @@ struct libretrodb_cursor
 	int eof;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
+   struct rmsgpack_dom_reader *reader;
+   struct rmsgpack_dom_arena *arena;
+   /* Keys the query tests, or -1 if items must be decoded in full
+    * before filtering */
+   int num_fields;
+   struct rmsgpack_dom_value fields[CURSOR_MAX_FIELDS];
 };
 
 static struct rmsgpack_dom_value sentinal;
@@ -273,33 +274,34 @@ static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
    return -1;
 }
 
-static int node_compare(const void *a, const void *b, void *ctx)
-{
-   return memcmp(a, b, *(uint8_t *)ctx);
-}
-
+/* Index entries are the key bytes immediately followed by the
+ * native-endian offset of the item, sorted by key. */
 static int binsearch(const void *buff, const void *item,
       uint64_t count, uint8_t field_size, uint64_t *offset)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = node_compare(current, item, &field_size);
+   uint64_t lo        = 0;
+   uint64_t hi        = count;
+   size_t item_size   = field_size + sizeof(uint64_t);
 
-   if (rv == 0)
+   while (lo < hi)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
-   }
+      uint64_t mid           = lo + (hi - lo) / 2;
+      const uint8_t *current = (const uint8_t*)buff + mid * item_size;
+      int rv                 = memcmp(current, item, field_size);
 
-   if (count == 0)
-      return -1;
+      if (rv == 0)
+      {
+         memcpy(offset, current + field_size, sizeof(uint64_t));
+         return 0;
+      }
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+      if (rv > 0)
+         hi = mid;
+      else
+         lo = mid + 1;
+   }
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+   return -1;
 }
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
@@ -322,7 +324,7 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
 
    while (nread < bufflen)
    {
-      void *buff_ = (uint64_t *)buff + nread;
+      void *buff_ = (uint8_t *)buff + nread;
       rv = (int)filestream_read(db->fd, buff_, bufflen - nread);
 
       if (rv <= 0)
@@ -353,40 +355,91 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
    cursor->eof = 0;
-   return (int)filestream_seek(cursor->fd,
-         (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
-         SEEK_SET);
+   return rmsgpack_dom_reader_seek(cursor->reader,
+         (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)));
 }
 
-int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
-      struct rmsgpack_dom_value *out)
+/* Decodes records into the cursor arena until one passes the query.
+ * Only the keys the query tests are materialized while filtering. */
+static int libretrodb_cursor_next(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out, ssize_t *offset, int *partial)
 {
    int rv;
+   const struct rmsgpack_dom_value *fields = NULL;
 
    if (cursor->eof)
       return EOF;
 
-retry:
-   rv = rmsgpack_dom_read(cursor->fd, out);
-   if (rv < 0)
-      return rv;
+   if (cursor->query && cursor->num_fields >= 0)
+      fields = cursor->fields;
 
-   if (out->type == RDT_NULL)
+   for (;;)
    {
-      cursor->eof = 1;
-      return EOF;
+      rmsgpack_dom_arena_reset(cursor->arena);
+      *offset = rmsgpack_dom_reader_tell(cursor->reader);
+
+      if ((rv = rmsgpack_dom_read_buffered(cursor->reader, cursor->arena,
+                  fields, (unsigned)cursor->num_fields, out)) < 0)
+         return rv;
+
+      if (out->type == RDT_NULL)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      if (!cursor->query || libretrodb_query_filter(cursor->query, out))
+         break;
    }
 
-   if (cursor->query)
+   *partial = (fields != NULL);
+   return 0;
+}
+
+/* Decodes records straight onto the heap, since the caller gets to
+ * keep them; the arena only pays off for libretrodb_cursor_read_item_view(). */
+int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+
+   if (cursor->eof)
+      return EOF;
+
+   for (;;)
    {
-      if (!libretrodb_query_filter(cursor->query, out))
+      if ((rv = rmsgpack_dom_read_buffered(cursor->reader, NULL,
+                  NULL, 0, out)) < 0)
+         return rv;
+
+      if (out->type == RDT_NULL)
       {
-         rmsgpack_dom_value_free(out);
-         goto retry;
+         cursor->eof = 1;
+         return EOF;
       }
+
+      if (!cursor->query || libretrodb_query_filter(cursor->query, out))
+         return 0;
+
+      rmsgpack_dom_value_free(out);
    }
+}
 
-   return 0;
+int libretrodb_cursor_read_item_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   int partial    = 0;
+   ssize_t offset = 0;
+   int rv         = libretrodb_cursor_next(cursor, out, &offset, &partial);
+
+   if (rv != 0 || !partial)
+      return rv;
+
+   rmsgpack_dom_arena_reset(cursor->arena);
+   if ((rv = rmsgpack_dom_reader_seek(cursor->reader, offset)) < 0)
+      return rv;
+   return rmsgpack_dom_read_buffered(cursor->reader, cursor->arena,
+         NULL, 0, out);
 }
 
 /**
@@ -400,6 +453,12 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (!cursor)
       return;
 
+   if (cursor->reader)
+      rmsgpack_dom_reader_free(cursor->reader);
+
+   if (cursor->arena)
+      rmsgpack_dom_arena_free(cursor->arena);
+
    if (cursor->fd)
       filestream_close(cursor->fd);
 
@@ -411,6 +470,8 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    cursor->fd       = NULL;
    cursor->db       = NULL;
    cursor->query    = NULL;
+   cursor->reader   = NULL;
+   cursor->arena    = NULL;
 }
 
 /**
@@ -431,60 +492,115 @@ int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
    if (!cursor->fd)
       return -errno;
 
+   cursor->reader = rmsgpack_dom_reader_new(cursor->fd, 0);
+   cursor->arena  = rmsgpack_dom_arena_new(0);
+
+   if (!cursor->reader || !cursor->arena)
+   {
+      rmsgpack_dom_reader_free(cursor->reader);
+      rmsgpack_dom_arena_free(cursor->arena);
+      filestream_close(cursor->fd);
+      cursor->reader = NULL;
+      cursor->arena  = NULL;
+      cursor->fd     = NULL;
+      return -ENOMEM;
+   }
+
    cursor->db = db;
    cursor->is_valid = 1;
    libretrodb_cursor_reset(cursor);
    cursor->query = q;
+   cursor->num_fields = -1;
 
    if (q)
+   {
       libretrodb_query_inc_ref(q);
+      cursor->num_fields = libretrodb_query_get_fields(q,
+            cursor->fields, CURSOR_MAX_FIELDS);
+   }
 
    return 0;
 }
 
-static int node_iter(void *value, void *ctx)
+/* LSD radix sort of fixed-size index entries by their key bytes,
+ * giving the same order as memcmp() over the key. */
+static int libretrodb_sort_index(uint8_t *entries, uint64_t count,
+      uint8_t field_size)
 {
-   struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
+   int byte;
+   size_t item_size = field_size + sizeof(uint64_t);
+   uint8_t *tmp     = NULL;
+   uint8_t *src     = entries;
+   uint8_t *dst     = NULL;
 
-   if (filestream_write(nictx->db->fd, value,
-            (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
+   if (count < 2)
       return 0;
 
-   return -1;
-}
+   if (!(tmp = (uint8_t*)malloc((size_t)count * item_size)))
+      return -ENOMEM;
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
-{
-   return filestream_seek(db->fd, 0, SEEK_CUR);
+   dst = tmp;
+
+   for (byte = field_size - 1; byte >= 0; byte--)
+   {
+      uint64_t i;
+      uint64_t buckets[257] = {0};
+
+      for (i = 0; i < count; i++)
+         buckets[src[i * item_size + byte] + 1]++;
+
+      for (i = 1; i < 257; i++)
+         buckets[i] += buckets[i - 1];
+
+      for (i = 0; i < count; i++)
+      {
+         const uint8_t *entry = src + i * item_size;
+         memcpy(dst + buckets[entry[byte]]++ * item_size, entry, item_size);
+      }
+
+      dst = src;
+      src = (src == entries) ? tmp : entries;
+   }
+
+   if (src != entries)
+      memcpy(entries, src, (size_t)count * item_size);
+
+   free(tmp);
+   return 0;
 }
 
 int libretrodb_create_index(libretrodb_t *db,
       const char *name, const char *field_name)
 {
-   struct node_iter_ctx nictx;
+   uint64_t i;
    struct rmsgpack_dom_value key;
    libretrodb_index_t idx;
    struct rmsgpack_dom_value item;
-   uint64_t idx_header_offset       = 0;
    libretrodb_cursor_t cur          = {0};
    struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
+   uint8_t *entries                 = NULL;
+   uint64_t count                   = 0;
+   uint64_t capacity                = 0;
    uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
-   bintree_t *tree                  = bintree_new(node_compare, &field_size);
-
-   item.type                        = RDT_NULL;
+   size_t item_size                 = 0;
 
-   if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
+   if (libretrodb_cursor_open(db, &cur, NULL) != 0)
       goto clean;
 
    key.type            = RDT_STRING;
    key.val.string.len  = (uint32_t)strlen(field_name);
    key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
 
-   while (libretrodb_cursor_read_item(&cur, &item) == 0)
+   /* Collect every key first and sort them in one go */
+   for (;;)
    {
+      int partial      = 0;
+      ssize_t item_loc = 0;
+      uint64_t offset  = 0;
+
+      if (libretrodb_cursor_next(&cur, &item, &item_loc, &partial) != 0)
+         break;
+
       if (item.type != RDT_MAP)
       {
          printf("Only map keys are supported\n");
@@ -512,38 +628,56 @@ int libretrodb_create_index(libretrodb_t *db,
       }
 
       if (field_size == 0)
+      {
          field_size = field->val.binary.len;
+         item_size  = field_size + sizeof(uint64_t);
+      }
       else if (field->val.binary.len != field_size)
       {
          printf("field is not of correct size\n");
          goto clean;
       }
 
-      buff = malloc(field_size + sizeof(uint64_t));
-      if (!buff)
-         goto clean;
+      if (count == capacity)
+      {
+         uint8_t *tmp;
+         capacity = capacity ? capacity * 2 : 1024;
+         tmp      = (uint8_t*)realloc(entries, (size_t)capacity * item_size);
 
-      memcpy(buff, field->val.binary.buff, field_size);
+         if (!tmp)
+            goto clean;
+         entries  = tmp;
+      }
 
-      buff_u64 = (uint64_t *)buff + field_size;
+      offset = (uint64_t)item_loc;
+      memcpy(entries + count * item_size, field->val.binary.buff, field_size);
+      memcpy(entries + count * item_size + field_size,
+            &offset, sizeof(uint64_t));
+      count++;
+   }
 
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+   if (libretrodb_sort_index(entries, count, field_size) != 0)
+      goto clean;
 
-      if (bintree_insert(tree, buff) != 0)
+   for (i = 1; i < count; i++)
+   {
+      if (memcmp(entries + (i - 1) * item_size,
+               entries + i * item_size, field_size) == 0)
       {
+         struct rmsgpack_dom_value value;
+
+         value.type            = RDT_BINARY;
+         value.val.binary.len  = field_size;
+         value.val.binary.buff = (char*)entries + i * item_size;
+
          printf("Value is not unique: ");
-         rmsgpack_dom_value_print(field);
+         rmsgpack_dom_value_print(&value);
          printf("\n");
          goto clean;
       }
-      buff     = NULL;
-      rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
    }
 
-   idx_header_offset = filestream_seek(db->fd, 0, SEEK_END);
-
-   (void)idx_header_offset;
+   filestream_seek(db->fd, 0, SEEK_END);
 
    strncpy(idx.name, name, 50);
 
@@ -552,19 +686,13 @@ int libretrodb_create_index(libretrodb_t *db,
    idx.next     = db->count * (field_size + sizeof(uint64_t));
    libretrodb_write_index_header(db->fd, &idx);
 
-   nictx.db  = db;
-   nictx.idx = &idx;
-   bintree_iterate(tree, node_iter, &nictx);
+   if (count)
+      filestream_write(db->fd, entries, (size_t)(count * item_size));
 
 clean:
-   rmsgpack_dom_value_free(&item);
-   if (buff)
-      free(buff);
+   free(entries);
    if (cur.is_valid)
       libretrodb_cursor_close(&cur);
-   if (tree)
-      bintree_free(tree);
-   free(tree);
    return 0;
 }
 
@@ -105,6 +105,20 @@ void libretrodb_query_free(void *q);
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
+/**
+ * libretrodb_cursor_read_item_view:
+ * @cursor              : Handle to database cursor.
+ * @out                 : Next item matching the cursor query.
+ *
+ * Same as libretrodb_cursor_read_item(), except that @out is
+ * decoded into memory owned by @cursor. It stays valid until the
+ * next read, reset or close and must not be freed by the caller.
+ *
+ * Returns: 0 if successful, EOF at the end, otherwise negative.
+ **/
+int libretrodb_cursor_read_item_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out);
+
 RETRO_END_DECLS
 
 #endif
@@ -22,12 +22,53 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include <string/stdstring.h>
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 
+/* Scans the whole database once and returns the number of matching
+ * items, either copying each one to the heap or decoding in place. */
+static int libretrodb_tool_bench_scan(libretrodb_t *db,
+      libretrodb_cursor_t *cur, libretrodb_query_t *q, int view,
+      double *secs)
+{
+   int rv;
+   struct rmsgpack_dom_value item;
+   int count     = 0;
+   clock_t start = clock();
+
+   if (q)
+      libretrodb_query_inc_ref(q);
+
+   if ((rv = libretrodb_cursor_open(db, cur, q)) != 0)
+   {
+      if (q)
+         libretrodb_query_free(q);
+      return rv;
+   }
+
+   if (view)
+   {
+      while (libretrodb_cursor_read_item_view(cur, &item) == 0)
+         count++;
+   }
+   else
+   {
+      while (libretrodb_cursor_read_item(cur, &item) == 0)
+      {
+         rmsgpack_dom_value_free(&item);
+         count++;
+      }
+   }
+
+   libretrodb_cursor_close(cur);
+   *secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+   return count;
+}
+
 int main(int argc, char ** argv)
 {
    int rv;
@@ -44,6 +85,7 @@ int main(int argc, char ** argv)
       printf("\tlist\n");
       printf("\tcreate-index <index name> <field name>\n");
       printf("\tfind <query expression>\n");
+      printf("\tbench [query expression]\n");
       return 1;
    }
 
@@ -75,11 +117,10 @@ int main(int argc, char ** argv)
          goto error;
       }
 
-      while (libretrodb_cursor_read_item(cur, &item) == 0)
+      while (libretrodb_cursor_read_item_view(cur, &item) == 0)
       {
          rmsgpack_dom_value_print(&item);
          printf("\n");
-         rmsgpack_dom_value_free(&item);
       }
    }
    else if (memcmp(command, "find", 4) == 0)
@@ -106,13 +147,54 @@ int main(int argc, char ** argv)
          goto error;
       }
 
-      while (libretrodb_cursor_read_item(cur, &item) == 0)
+      while (libretrodb_cursor_read_item_view(cur, &item) == 0)
       {
          rmsgpack_dom_value_print(&item);
          printf("\n");
-         rmsgpack_dom_value_free(&item);
       }
    }
+   else if (memcmp(command, "bench", 5) == 0)
+   {
+      int view;
+      q = NULL;
+
+      if (argc > 4)
+      {
+         printf("Usage: %s <db file> bench [query expression]\n", argv[0]);
+         goto error;
+      }
+
+      if (argc == 4)
+      {
+         query_exp = argv[3];
+         error = NULL;
+         q = libretrodb_query_compile(db, query_exp, strlen(query_exp), &error);
+
+         if (error)
+         {
+            printf("%s\n", error);
+            goto error;
+         }
+      }
+
+      for (view = 0; view < 2; view++)
+      {
+         double secs = 0.0;
+
+         if ((rv = libretrodb_tool_bench_scan(db, cur, q, view, &secs)) < 0)
+         {
+            printf("Could not open cursor: %s\n", strerror(-rv));
+            break;
+         }
+
+         printf("%-6s: %d items in %.3f s (%.0f items/s)\n",
+               view ? "view" : "copy", rv, secs,
+               secs > 0.0 ? rv / secs : 0.0);
+      }
+
+      if (q)
+         libretrodb_query_free(q);
+   }
    else if (memcmp(command, "create-index", 12) == 0)
    {
       const char * index_name, * field_name;
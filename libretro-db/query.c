@@ -1023,3 +1023,25 @@ int libretrodb_query_filter(libretrodb_query_t *q,
    struct rmsgpack_dom_value res = inv.func(*v, inv.argc, inv.argv);
    return (res.type == RDT_BOOL && res.val.bool_);
 }
+
+int libretrodb_query_get_fields(libretrodb_query_t *q,
+      struct rmsgpack_dom_value *fields, unsigned max_fields)
+{
+   unsigned i;
+   unsigned count            = 0;
+   struct invocation *root   = &((struct query *)q)->root;
+
+   /* Only table queries name the keys they match on; any other
+    * function receives the whole item. */
+   if (root->func != query_func_all_map)
+      return -1;
+
+   for (i = 0; i + 1 < root->argc; i += 2)
+   {
+      if (root->argv[i].type != AT_VALUE || count >= max_fields)
+         return -1;
+      fields[count++] = root->argv[i].a.value;
+   }
+
+   return (int)count;
+}
@@ -38,6 +38,18 @@ void libretrodb_query_dec_ref(libretrodb_query_t *q);
 
 int libretrodb_query_filter(libretrodb_query_t *q, struct rmsgpack_dom_value *v);
 
+/**
+ * libretrodb_query_get_fields:
+ * @q                   : Compiled query.
+ * @fields              : Array receiving the top-level keys @q tests.
+ * @max_fields          : Capacity of @fields.
+ *
+ * Returns: number of keys written to @fields, or -1 if the
+ * query may look at any field of the item.
+ **/
+int libretrodb_query_get_fields(libretrodb_query_t *q,
+      struct rmsgpack_dom_value *fields, unsigned max_fields);
+
 RETRO_END_DECLS
 
 #endif
@@ -511,3 +511,563 @@ clean:
    rmsgpack_dom_value_free(&map);
    return 0;
 }
+
+/* Buffered, arena-backed DOM decoder.
+ *
+ * rmsgpack_read() pulls every token through filestream_read() and
+ * mallocs every string, map and array. The decoder below reads from
+ * a private buffer instead and, when given an arena, carves all nodes
+ * out of it so that a whole record can be discarded with a single
+ * rmsgpack_dom_arena_reset(). */
+
+#define DOM_ARENA_ALIGN(x) (((x) + 7) & ~((size_t)7))
+
+struct rmsgpack_dom_arena_block
+{
+   struct rmsgpack_dom_arena_block *next;
+   uint8_t *data;
+   size_t size;
+   size_t used;
+};
+
+struct rmsgpack_dom_arena
+{
+   struct rmsgpack_dom_arena_block *head;
+   struct rmsgpack_dom_arena_block *current;
+   size_t block_size;
+};
+
+struct rmsgpack_dom_reader
+{
+   RFILE *fd;
+   uint8_t *buff;
+   size_t buff_size;
+   size_t pos;
+   size_t len;
+   ssize_t buff_offset;
+};
+
+static struct rmsgpack_dom_arena_block *rmsgpack_dom_arena_block_new(
+      size_t size)
+{
+   struct rmsgpack_dom_arena_block *block =
+      (struct rmsgpack_dom_arena_block*)calloc(1, sizeof(*block));
+
+   if (!block)
+      return NULL;
+
+   block->data = (uint8_t*)malloc(size);
+
+   if (!block->data)
+   {
+      free(block);
+      return NULL;
+   }
+
+   block->size = size;
+   return block;
+}
+
+struct rmsgpack_dom_arena *rmsgpack_dom_arena_new(size_t block_size)
+{
+   struct rmsgpack_dom_arena *arena =
+      (struct rmsgpack_dom_arena*)calloc(1, sizeof(*arena));
+
+   if (!arena)
+      return NULL;
+
+   arena->block_size = DOM_ARENA_ALIGN(block_size ? block_size : 16384);
+   arena->head       = rmsgpack_dom_arena_block_new(arena->block_size);
+
+   if (!arena->head)
+   {
+      free(arena);
+      return NULL;
+   }
+
+   arena->current    = arena->head;
+   return arena;
+}
+
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena)
+{
+   struct rmsgpack_dom_arena_block *block = NULL;
+
+   if (!arena)
+      return;
+
+   for (block = arena->head; block; block = block->next)
+      block->used = 0;
+
+   arena->current = arena->head;
+}
+
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena)
+{
+   struct rmsgpack_dom_arena_block *block = NULL;
+
+   if (!arena)
+      return;
+
+   block = arena->head;
+
+   while (block)
+   {
+      struct rmsgpack_dom_arena_block *next = block->next;
+      free(block->data);
+      free(block);
+      block = next;
+   }
+
+   free(arena);
+}
+
+static void *rmsgpack_dom_arena_alloc(struct rmsgpack_dom_arena *arena,
+      size_t size)
+{
+   struct rmsgpack_dom_arena_block *block = arena->current;
+
+   size = DOM_ARENA_ALIGN(size ? size : 1);
+
+   while (block->used + size > block->size)
+   {
+      struct rmsgpack_dom_arena_block *next = block->next;
+
+      /* Blocks kept from a previous record are reused as long as the
+       * allocation fits; otherwise a new block is spliced in. */
+      if (!next || size > next->size)
+      {
+         next = rmsgpack_dom_arena_block_new(
+               size > arena->block_size ? size : arena->block_size);
+         if (!next)
+            return NULL;
+         next->next  = block->next;
+         block->next = next;
+      }
+
+      block          = next;
+      arena->current = block;
+   }
+
+   block->used += size;
+   return block->data + block->used - size;
+}
+
+struct rmsgpack_dom_reader *rmsgpack_dom_reader_new(RFILE *fd,
+      size_t buff_size)
+{
+   struct rmsgpack_dom_reader *reader =
+      (struct rmsgpack_dom_reader*)calloc(1, sizeof(*reader));
+
+   if (!reader)
+      return NULL;
+
+   reader->buff_size = buff_size ? buff_size : 65536;
+   reader->buff      = (uint8_t*)malloc(reader->buff_size);
+
+   if (!reader->buff)
+   {
+      free(reader);
+      return NULL;
+   }
+
+   reader->fd          = fd;
+   reader->buff_offset = filestream_seek(fd, 0, SEEK_CUR);
+   return reader;
+}
+
+void rmsgpack_dom_reader_free(struct rmsgpack_dom_reader *reader)
+{
+   if (!reader)
+      return;
+
+   free(reader->buff);
+   free(reader);
+}
+
+ssize_t rmsgpack_dom_reader_tell(struct rmsgpack_dom_reader *reader)
+{
+   return reader->buff_offset + (ssize_t)reader->pos;
+}
+
+int rmsgpack_dom_reader_seek(struct rmsgpack_dom_reader *reader,
+      ssize_t offset)
+{
+   /* Rewinding within the current window (e.g. to decode the record
+    * we just filtered again) does not touch the file. */
+   if (offset >= reader->buff_offset &&
+         offset <= reader->buff_offset + (ssize_t)reader->len)
+   {
+      reader->pos = (size_t)(offset - reader->buff_offset);
+      return 0;
+   }
+
+   if (filestream_seek(reader->fd, offset, SEEK_SET) == -1)
+      return -errno;
+
+   reader->buff_offset = offset;
+   reader->pos         = 0;
+   reader->len         = 0;
+   return 0;
+}
+
+static int rmsgpack_dom_reader_fill(struct rmsgpack_dom_reader *reader)
+{
+   ssize_t read_len;
+
+   reader->buff_offset += (ssize_t)reader->len;
+   reader->pos          = 0;
+   reader->len          = 0;
+
+   read_len = filestream_read(reader->fd, reader->buff,
+         (ssize_t)reader->buff_size);
+
+   if (read_len <= 0)
+      return -EINVAL;
+
+   reader->len = (size_t)read_len;
+   return 0;
+}
+
+static int rmsgpack_dom_reader_read(struct rmsgpack_dom_reader *reader,
+      void *s, size_t len)
+{
+   uint8_t *out = (uint8_t*)s;
+
+   while (len)
+   {
+      size_t avail = reader->len - reader->pos;
+
+      if (!avail)
+      {
+         if (rmsgpack_dom_reader_fill(reader) < 0)
+            return -EINVAL;
+         continue;
+      }
+
+      if (avail > len)
+         avail = len;
+
+      if (out)
+      {
+         memcpy(out, reader->buff + reader->pos, avail);
+         out += avail;
+      }
+
+      reader->pos += avail;
+      len         -= avail;
+   }
+
+   return 0;
+}
+
+static int rmsgpack_dom_reader_read_uint(struct rmsgpack_dom_reader *reader,
+      uint64_t *out, unsigned size)
+{
+   unsigned i;
+   uint8_t tmp[8];
+
+   if (rmsgpack_dom_reader_read(reader, tmp, size) < 0)
+      return -EINVAL;
+
+   *out = 0;
+   for (i = 0; i < size; i++)
+      *out = (*out << 8) | tmp[i];
+
+   return 0;
+}
+
+/* Heap allocations are zeroed so that a partially decoded value can
+ * still be released with rmsgpack_dom_value_free(). */
+static void *rmsgpack_dom_alloc(struct rmsgpack_dom_arena *arena,
+      size_t size)
+{
+   if (!arena)
+      return calloc(1, size ? size : 1);
+   return rmsgpack_dom_arena_alloc(arena, size);
+}
+
+static int rmsgpack_dom_read_buff(struct rmsgpack_dom_reader *reader,
+      struct rmsgpack_dom_arena *arena, uint32_t len, char **out)
+{
+   char *buff = (char*)rmsgpack_dom_alloc(arena, (size_t)len + 1);
+
+   if (!buff)
+      return -ENOMEM;
+
+   if (rmsgpack_dom_reader_read(reader, buff, len) < 0)
+   {
+      if (!arena)
+         free(buff);
+      return -EINVAL;
+   }
+
+   buff[len] = '\0';
+   *out      = buff;
+   return 0;
+}
+
+static int rmsgpack_dom_read_value(struct rmsgpack_dom_reader *reader,
+      struct rmsgpack_dom_arena *arena,
+      const struct rmsgpack_dom_value *fields, unsigned num_fields,
+      struct rmsgpack_dom_value *out, unsigned depth);
+
+static int rmsgpack_dom_read_map(struct rmsgpack_dom_reader *reader,
+      struct rmsgpack_dom_arena *arena,
+      const struct rmsgpack_dom_value *fields, unsigned num_fields,
+      struct rmsgpack_dom_value *out, uint32_t len, unsigned depth)
+{
+   uint32_t i;
+   struct rmsgpack_dom_pair *items = (struct rmsgpack_dom_pair*)
+      rmsgpack_dom_alloc(arena, len * sizeof(*items));
+
+   if (!items)
+      return -ENOMEM;
+
+   out->type          = RDT_MAP;
+   out->val.map.len   = 0;
+   out->val.map.items = items;
+
+   for (i = 0; i < len; i++)
+   {
+      int rv;
+      struct rmsgpack_dom_pair *pair = &items[out->val.map.len];
+
+      out->val.map.len++;
+
+      if ((rv = rmsgpack_dom_read_value(reader, arena,
+                  NULL, 0, &pair->key, depth + 1)) < 0)
+         return rv;
+
+      if (fields)
+      {
+         unsigned j;
+         int wanted = 0;
+
+         for (j = 0; j < num_fields; j++)
+         {
+            if (rmsgpack_dom_value_cmp(&pair->key, &fields[j]) == 0)
+            {
+               wanted = 1;
+               break;
+            }
+         }
+
+         if (!wanted)
+         {
+            /* Lazy mode: drop the pair and step over its value */
+            if (!arena)
+               rmsgpack_dom_value_free(&pair->key);
+            pair->key.type = RDT_NULL;
+            out->val.map.len--;
+
+            if ((rv = rmsgpack_dom_read_value(reader, NULL,
+                        NULL, 0, NULL, depth + 1)) < 0)
+               return rv;
+            continue;
+         }
+      }
+
+      if ((rv = rmsgpack_dom_read_value(reader, arena,
+                  NULL, 0, &pair->value, depth + 1)) < 0)
+         return rv;
+   }
+
+   return 0;
+}
+
+static int rmsgpack_dom_read_array(struct rmsgpack_dom_reader *reader,
+      struct rmsgpack_dom_arena *arena,
+      struct rmsgpack_dom_value *out, uint32_t len, unsigned depth)
+{
+   uint32_t i;
+   struct rmsgpack_dom_value *items = (struct rmsgpack_dom_value*)
+      rmsgpack_dom_alloc(arena, len * sizeof(*items));
+
+   if (!items)
+      return -ENOMEM;
+
+   out->type            = RDT_ARRAY;
+   out->val.array.len   = len;
+   out->val.array.items = items;
+
+   for (i = 0; i < len; i++)
+   {
+      int rv = rmsgpack_dom_read_value(reader, arena,
+            NULL, 0, &items[i], depth + 1);
+      if (rv < 0)
+         return rv;
+   }
+
+   return 0;
+}
+
+/* With out == NULL the value is skipped without being materialized. */
+static int rmsgpack_dom_read_value(struct rmsgpack_dom_reader *reader,
+      struct rmsgpack_dom_arena *arena,
+      const struct rmsgpack_dom_value *fields, unsigned num_fields,
+      struct rmsgpack_dom_value *out, unsigned depth)
+{
+   uint8_t type     = 0;
+   uint64_t tmp_len = 0;
+   uint64_t tmp     = 0;
+
+   if (depth >= MAX_DEPTH)
+      return -ENOMEM;
+
+   if (out)
+      out->type = RDT_NULL;
+
+   if (rmsgpack_dom_reader_read(reader, &type, sizeof(type)) < 0)
+      return -EINVAL;
+
+   if (type < 0x80 || type > 0xdf)
+   {
+      /* Positive and negative fixint */
+      if (out)
+      {
+         out->type     = RDT_INT;
+         out->val.int_ = (type < 0x80) ? (int64_t)type : (int64_t)type - 0x100;
+      }
+      return 0;
+   }
+   else if (type < 0x90)
+      tmp_len = type - 0x80;
+   else if (type < 0xa0)
+      tmp_len = type - 0x90;
+   else if (type < 0xc0)
+      tmp_len = type - 0xa0;
+   else switch (type)
+   {
+      case 0xc0:
+         return 0;
+      case 0xc2:
+      case 0xc3:
+         if (out)
+         {
+            out->type      = RDT_BOOL;
+            out->val.bool_ = (type == 0xc3);
+         }
+         return 0;
+      case 0xc4:
+      case 0xc5:
+      case 0xc6:
+      case 0xd9:
+      case 0xda:
+      case 0xdb:
+         if (rmsgpack_dom_reader_read_uint(reader, &tmp_len,
+                  1 << ((type >= 0xd9 ? type - 0xd9 : type - 0xc4))) < 0)
+            return -EINVAL;
+         break;
+      case 0xcc:
+      case 0xcd:
+      case 0xce:
+      case 0xcf:
+         if (rmsgpack_dom_reader_read_uint(reader, &tmp,
+                  1 << (type - 0xcc)) < 0)
+            return -EINVAL;
+         if (out)
+         {
+            out->type      = RDT_UINT;
+            out->val.uint_ = tmp;
+         }
+         return 0;
+      case 0xd0:
+      case 0xd1:
+      case 0xd2:
+      case 0xd3:
+         {
+            unsigned size = 1 << (type - 0xd0);
+
+            if (rmsgpack_dom_reader_read_uint(reader, &tmp, size) < 0)
+               return -EINVAL;
+
+            /* Sign-extend from the encoded width */
+            if (size < 8 && (tmp & (UINT64_C(1) << (size * 8 - 1))))
+               tmp |= ~UINT64_C(0) << (size * 8);
+
+            if (out)
+            {
+               out->type     = RDT_INT;
+               out->val.int_ = (int64_t)tmp;
+            }
+         }
+         return 0;
+      case 0xdc:
+      case 0xdd:
+      case 0xde:
+      case 0xdf:
+         if (rmsgpack_dom_reader_read_uint(reader, &tmp_len,
+                  2 << ((type & 1))) < 0)
+            return -EINVAL;
+         break;
+      default:
+         return -EINVAL;
+   }
+
+   /* Strings and binaries */
+   if ((type >= 0xa0 && type < 0xc0) || (type >= 0xc4 && type <= 0xc6)
+         || (type >= 0xd9 && type <= 0xdb))
+   {
+      char *buff = NULL;
+      int rv;
+
+      if (!out)
+         return rmsgpack_dom_reader_read(reader, NULL, (size_t)tmp_len);
+
+      if ((rv = rmsgpack_dom_read_buff(reader, arena,
+                  (uint32_t)tmp_len, &buff)) < 0)
+         return rv;
+
+      if (type >= 0xc4 && type <= 0xc6)
+      {
+         out->type            = RDT_BINARY;
+         out->val.binary.len  = (uint32_t)tmp_len;
+         out->val.binary.buff = buff;
+      }
+      else
+      {
+         out->type            = RDT_STRING;
+         out->val.string.len  = (uint32_t)tmp_len;
+         out->val.string.buff = buff;
+      }
+      return 0;
+   }
+
+   /* Maps and arrays */
+   if (type < 0x90 || type == 0xde || type == 0xdf)
+   {
+      if (!out)
+         tmp_len *= 2;
+      else
+         return rmsgpack_dom_read_map(reader, arena, fields, num_fields,
+               out, (uint32_t)tmp_len, depth);
+   }
+   else if (out)
+      return rmsgpack_dom_read_array(reader, arena,
+            out, (uint32_t)tmp_len, depth);
+
+   while (tmp_len--)
+   {
+      int rv = rmsgpack_dom_read_value(reader, NULL,
+            NULL, 0, NULL, depth + 1);
+      if (rv < 0)
+         return rv;
+   }
+
+   return 0;
+}
+
+int rmsgpack_dom_read_buffered(struct rmsgpack_dom_reader *reader,
+      struct rmsgpack_dom_arena *arena,
+      const struct rmsgpack_dom_value *fields, unsigned num_fields,
+      struct rmsgpack_dom_value *out)
+{
+   int rv = rmsgpack_dom_read_value(reader, arena,
+         fields, num_fields, out, 0);
+
+   if (rv < 0 && !arena)
+      rmsgpack_dom_value_free(out);
+
+   return rv;
+}
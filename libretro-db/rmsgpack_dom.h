@@ -95,6 +95,53 @@ int rmsgpack_dom_write(RFILE *fd, const struct rmsgpack_dom_value *obj);
 
 int rmsgpack_dom_read_into(RFILE *fd, ...);
 
+struct rmsgpack_dom_arena;
+
+struct rmsgpack_dom_reader;
+
+struct rmsgpack_dom_arena *rmsgpack_dom_arena_new(size_t block_size);
+
+/**
+ * rmsgpack_dom_arena_reset:
+ * @arena               : Arena handle.
+ *
+ * Releases every value allocated from @arena at once, keeping
+ * the underlying blocks around for the next record.
+ **/
+void rmsgpack_dom_arena_reset(struct rmsgpack_dom_arena *arena);
+
+void rmsgpack_dom_arena_free(struct rmsgpack_dom_arena *arena);
+
+struct rmsgpack_dom_reader *rmsgpack_dom_reader_new(RFILE *fd,
+      size_t buff_size);
+
+void rmsgpack_dom_reader_free(struct rmsgpack_dom_reader *reader);
+
+ssize_t rmsgpack_dom_reader_tell(struct rmsgpack_dom_reader *reader);
+
+int rmsgpack_dom_reader_seek(struct rmsgpack_dom_reader *reader,
+      ssize_t offset);
+
+/**
+ * rmsgpack_dom_read_buffered:
+ * @reader              : Buffered reader to decode from.
+ * @arena               : Arena to allocate from, or NULL to use the heap.
+ * @fields              : Map keys to materialize, or NULL for all of them.
+ * @num_fields          : Number of entries in @fields.
+ * @out                 : Decoded value.
+ *
+ * Decodes the next value from @reader. When @fields is set, pairs
+ * of a top-level map whose key is not listed are skipped over without
+ * being allocated. Values allocated from @arena are only valid until
+ * it is reset and must not be passed to rmsgpack_dom_value_free().
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_read_buffered(struct rmsgpack_dom_reader *reader,
+      struct rmsgpack_dom_arena *arena,
+      const struct rmsgpack_dom_value *fields, unsigned num_fields,
+      struct rmsgpack_dom_value *out);
+
 RETRO_END_DECLS
 
 #endif
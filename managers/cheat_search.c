@@ -0,0 +1,1011 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CHEAT_SEARCH_SIMD
+#elif defined(__ARM_NEON__) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#include <arm_neon.h>
+#define CHEAT_SEARCH_NEON
+#define CHEAT_SEARCH_SIMD
+#endif
+
+#include <boolean.h>
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#ifdef HAVE_CHEEVOS
+#include "../cheevos/cheevos.h"
+#endif
+
+#ifdef HAVE_NETWORKING
+#include "../network/netplay/netplay.h"
+#endif
+
+#include "cheat_search.h"
+
+#include "../core.h"
+#include "../movie.h"
+#include "../runloop.h"
+#include "../verbosity.h"
+
+/* Candidates are tracked in chunks of this many values. A chunk is
+ * empty, full, or has a bitmap of its candidates, so that memory which
+ * has been ruled out costs neither space nor time in later passes. */
+#define CHEAT_SEARCH_CHUNK       4096
+#define CHEAT_SEARCH_CHUNK_WORDS (CHEAT_SEARCH_CHUNK / 64)
+
+struct cheat_search_chunk
+{
+   uint64_t *bits;   /* NULL when the chunk is empty or full */
+   unsigned count;
+};
+
+typedef struct cheat_search_region
+{
+   uint8_t *data;
+   uint8_t *prev;    /* Values at the previous pass */
+   struct cheat_search_chunk *chunks;
+   size_t size;
+   size_t start;     /* Address of data[0] */
+   size_t num_values;
+   size_t num_chunks;
+   bool big_endian;  /* As the memory map says */
+   bool search_big_endian;
+} cheat_search_region_t;
+
+struct cheat_patch
+{
+   uint8_t *ptr;
+   size_t address;
+   unsigned width;
+   uint8_t bytes[4];
+};
+
+/* Adjacent patches, written with a single copy */
+struct cheat_patch_run
+{
+   uint8_t *ptr;
+   size_t len;
+   size_t offset;
+};
+
+struct cheat_search
+{
+   cheat_search_region_t *regions;
+   unsigned num_regions;
+   unsigned width;
+   bool active;
+   size_t count;
+
+   struct cheat_patch *patches;
+   size_t num_patches;
+   size_t patches_size;
+
+   struct cheat_patch_run *runs;
+   size_t num_runs;
+   uint8_t *run_data;
+   bool runs_dirty;
+};
+
+/* How a pass compares a value (a) with its operand (b) */
+struct cheat_search_cmp
+{
+   uint32_t value;
+   unsigned width;
+   bool big_endian;
+   bool equal;       /* a == b rather than a > b */
+   bool swap;        /* b > a rather than a > b */
+   bool invert;
+};
+
+static struct cheat_search cheat_search_st;
+
+static INLINE unsigned cheat_search_popcount(uint64_t x)
+{
+#ifdef __GNUC__
+   return __builtin_popcountll(x);
+#else
+   x = x - ((x >> 1) & 0x5555555555555555ULL);
+   x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+   x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+   return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+static INLINE unsigned cheat_search_ctz(uint64_t x)
+{
+#ifdef __GNUC__
+   return __builtin_ctzll(x);
+#else
+   unsigned n = 0;
+   while (!(x & 1))
+   {
+      x >>= 1;
+      n++;
+   }
+   return n;
+#endif
+}
+
+static INLINE uint32_t cheat_search_read(const uint8_t *p,
+      unsigned width, bool big_endian)
+{
+   switch (width)
+   {
+      case 2:
+         return big_endian
+            ? ((uint32_t)p[0] << 8) | p[1]
+            : ((uint32_t)p[1] << 8) | p[0];
+      case 4:
+         return big_endian
+            ? ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+            | ((uint32_t)p[2] << 8) | p[3]
+            : ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16)
+            | ((uint32_t)p[1] << 8) | p[0];
+      default:
+         break;
+   }
+
+   return p[0];
+}
+
+static void cheat_search_write(uint8_t *p, uint32_t value,
+      unsigned width, bool big_endian)
+{
+   unsigned i;
+
+   for (i = 0; i < width; i++)
+   {
+      unsigned shift = 8 * (big_endian ? width - 1 - i : i);
+      p[i]           = (uint8_t)(value >> shift);
+   }
+}
+
+static uint64_t cheat_search_match_scalar(const struct cheat_search_cmp *cmp,
+      const uint8_t *cur, const uint8_t *prev, unsigned n)
+{
+   unsigned i;
+   uint64_t mask = 0;
+
+   for (i = 0; i < n; i++)
+   {
+      bool match;
+      uint32_t a = cheat_search_read(cur + i * cmp->width,
+            cmp->width, cmp->big_endian);
+      uint32_t b = prev ? cheat_search_read(prev + i * cmp->width,
+            cmp->width, cmp->big_endian) : cmp->value;
+
+      if (cmp->equal)
+         match = a == b;
+      else
+         match = cmp->swap ? b > a : a > b;
+
+      if (match != cmp->invert)
+         mask |= (uint64_t)1 << i;
+   }
+
+   return mask;
+}
+
+#if defined(__SSE2__)
+static INLINE __m128i cheat_search_load_sse2(const uint8_t *p,
+      unsigned width, bool big_endian)
+{
+   __m128i v = _mm_loadu_si128((const __m128i*)p);
+
+   if (big_endian && width > 1)
+   {
+      if (width == 4)
+      {
+         v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+         v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+      }
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+   }
+
+   return v;
+}
+
+/* Returns one bit for each of the 16 values at cur */
+static INLINE unsigned cheat_search_match16(
+      const struct cheat_search_cmp *cmp, unsigned width,
+      const uint8_t *cur, const uint8_t *prev,
+      __m128i operand, __m128i bias)
+{
+   unsigned i;
+   __m128i r[4];
+
+   for (i = 0; i < width; i++)
+   {
+      __m128i a = cheat_search_load_sse2(cur + 16 * i,
+            width, cmp->big_endian);
+      __m128i b = prev ? cheat_search_load_sse2(prev + 16 * i,
+            width, cmp->big_endian) : operand;
+
+      if (cmp->equal)
+      {
+         switch (width)
+         {
+            case 1:
+               r[i] = _mm_cmpeq_epi8(a, b);
+               break;
+            case 2:
+               r[i] = _mm_cmpeq_epi16(a, b);
+               break;
+            default:
+               r[i] = _mm_cmpeq_epi32(a, b);
+               break;
+         }
+         continue;
+      }
+
+      /* SSE2 only compares signed values */
+      a = _mm_xor_si128(a, bias);
+      b = _mm_xor_si128(b, bias);
+      if (cmp->swap)
+      {
+         __m128i t = a;
+         a         = b;
+         b         = t;
+      }
+
+      switch (width)
+      {
+         case 1:
+            r[i] = _mm_cmpgt_epi8(a, b);
+            break;
+         case 2:
+            r[i] = _mm_cmpgt_epi16(a, b);
+            break;
+         default:
+            r[i] = _mm_cmpgt_epi32(a, b);
+            break;
+      }
+   }
+
+   /* Narrow the lanes down to one byte per value */
+   if (width == 2)
+      r[0] = _mm_packs_epi16(r[0], r[1]);
+   else if (width == 4)
+      r[0] = _mm_packs_epi16(
+            _mm_packs_epi32(r[0], r[1]), _mm_packs_epi32(r[2], r[3]));
+
+   return (unsigned)_mm_movemask_epi8(r[0]) ^ (cmp->invert ? 0xffff : 0);
+}
+
+static uint64_t cheat_search_match_simd(const struct cheat_search_cmp *cmp,
+      unsigned width, const uint8_t *cur, const uint8_t *prev)
+{
+   unsigned i;
+   __m128i operand, bias;
+   uint64_t mask = 0;
+
+   switch (width)
+   {
+      case 1:
+         operand = _mm_set1_epi8((char)cmp->value);
+         bias    = _mm_set1_epi8((char)0x80);
+         break;
+      case 2:
+         operand = _mm_set1_epi16((short)cmp->value);
+         bias    = _mm_set1_epi16((short)0x8000);
+         break;
+      default:
+         operand = _mm_set1_epi32((int)cmp->value);
+         bias    = _mm_set1_epi32((int)0x80000000);
+         break;
+   }
+
+   for (i = 0; i < 4; i++)
+      mask |= (uint64_t)cheat_search_match16(cmp, width,
+            cur + 16 * width * i, prev ? prev + 16 * width * i : NULL,
+            operand, bias) << (16 * i);
+
+   return mask;
+}
+#elif defined(CHEAT_SEARCH_NEON)
+static INLINE uint8x16_t cheat_search_load_neon(const uint8_t *p,
+      unsigned width, bool big_endian)
+{
+   uint8x16_t v = vld1q_u8(p);
+
+   if (big_endian && width == 2)
+      v = vrev16q_u8(v);
+   else if (big_endian && width == 4)
+      v = vrev32q_u8(v);
+
+   return v;
+}
+
+static INLINE uint8x16_t cheat_search_cmp_neon(
+      const struct cheat_search_cmp *cmp, unsigned width,
+      uint8x16_t a, uint8x16_t b)
+{
+   if (cmp->swap)
+   {
+      uint8x16_t t = a;
+      a            = b;
+      b            = t;
+   }
+
+   switch (width)
+   {
+      case 2:
+         return vreinterpretq_u8_u16(cmp->equal
+               ? vceqq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b))
+               : vcgtq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+      case 4:
+         return vreinterpretq_u8_u32(cmp->equal
+               ? vceqq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b))
+               : vcgtq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+      default:
+         break;
+   }
+
+   return cmp->equal ? vceqq_u8(a, b) : vcgtq_u8(a, b);
+}
+
+/* Returns one bit for each of the 16 values at cur */
+static INLINE unsigned cheat_search_match16(
+      const struct cheat_search_cmp *cmp, unsigned width,
+      const uint8_t *cur, const uint8_t *prev, uint8x16_t operand)
+{
+   static const uint8_t weights[16] = {
+      1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+   unsigned i;
+   uint8x16_t r[4];
+   uint8x8_t lo, hi;
+
+   for (i = 0; i < width; i++)
+      r[i] = cheat_search_cmp_neon(cmp, width,
+            cheat_search_load_neon(cur + 16 * i, width, cmp->big_endian),
+            prev ? cheat_search_load_neon(prev + 16 * i,
+               width, cmp->big_endian) : operand);
+
+   /* Narrow the lanes down to one byte per value */
+   if (width == 2)
+      r[0] = vcombine_u8(
+            vmovn_u16(vreinterpretq_u16_u8(r[0])),
+            vmovn_u16(vreinterpretq_u16_u8(r[1])));
+   else if (width == 4)
+      r[0] = vcombine_u8(
+            vmovn_u16(vcombine_u16(
+                  vmovn_u32(vreinterpretq_u32_u8(r[0])),
+                  vmovn_u32(vreinterpretq_u32_u8(r[1])))),
+            vmovn_u16(vcombine_u16(
+                  vmovn_u32(vreinterpretq_u32_u8(r[2])),
+                  vmovn_u32(vreinterpretq_u32_u8(r[3])))));
+
+   r[0] = vandq_u8(r[0], vld1q_u8(weights));
+   lo   = vget_low_u8(r[0]);
+   hi   = vget_high_u8(r[0]);
+   lo   = vpadd_u8(lo, lo);
+   lo   = vpadd_u8(lo, lo);
+   lo   = vpadd_u8(lo, lo);
+   hi   = vpadd_u8(hi, hi);
+   hi   = vpadd_u8(hi, hi);
+   hi   = vpadd_u8(hi, hi);
+
+   return ((unsigned)vget_lane_u8(lo, 0) | ((unsigned)vget_lane_u8(hi, 0) << 8))
+      ^ (cmp->invert ? 0xffff : 0);
+}
+
+static uint64_t cheat_search_match_simd(const struct cheat_search_cmp *cmp,
+      unsigned width, const uint8_t *cur, const uint8_t *prev)
+{
+   unsigned i;
+   uint8x16_t operand;
+   uint64_t mask = 0;
+
+   switch (width)
+   {
+      case 1:
+         operand = vdupq_n_u8((uint8_t)cmp->value);
+         break;
+      case 2:
+         operand = vreinterpretq_u8_u16(vdupq_n_u16((uint16_t)cmp->value));
+         break;
+      default:
+         operand = vreinterpretq_u8_u32(vdupq_n_u32(cmp->value));
+         break;
+   }
+
+   for (i = 0; i < 4; i++)
+      mask |= (uint64_t)cheat_search_match16(cmp, width,
+            cur + 16 * width * i, prev ? prev + 16 * width * i : NULL,
+            operand) << (16 * i);
+
+   return mask;
+}
+#endif
+
+/* Returns one bit for each of the n (at most 64) values at cur */
+static uint64_t cheat_search_match(const struct cheat_search_cmp *cmp,
+      const uint8_t *cur, const uint8_t *prev, unsigned n, bool simd)
+{
+#ifdef CHEAT_SEARCH_SIMD
+   if (simd && n == 64)
+   {
+      /* Constant widths, so that each gets its own unrolled loop */
+      switch (cmp->width)
+      {
+         case 1:
+            return cheat_search_match_simd(cmp, 1, cur, prev);
+         case 2:
+            return cheat_search_match_simd(cmp, 2, cur, prev);
+         default:
+            return cheat_search_match_simd(cmp, 4, cur, prev);
+      }
+   }
+#endif
+
+   return cheat_search_match_scalar(cmp, cur, prev, n);
+}
+
+static void cheat_search_region_free(cheat_search_region_t *region)
+{
+   size_t i;
+
+   if (region->chunks)
+   {
+      for (i = 0; i < region->num_chunks; i++)
+         free(region->chunks[i].bits);
+      free(region->chunks);
+   }
+   free(region->prev);
+
+   region->chunks     = NULL;
+   region->prev       = NULL;
+   region->num_values = 0;
+   region->num_chunks = 0;
+}
+
+/* Makes every value of the region a candidate */
+static bool cheat_search_region_start(cheat_search_region_t *region,
+      unsigned width)
+{
+   size_t i;
+
+   cheat_search_region_free(region);
+
+   region->num_values = region->size / width;
+   region->num_chunks = (region->num_values + CHEAT_SEARCH_CHUNK - 1)
+      / CHEAT_SEARCH_CHUNK;
+   region->prev       = (uint8_t*)malloc(region->size);
+   region->chunks     = (struct cheat_search_chunk*)
+      calloc(region->num_chunks, sizeof(*region->chunks));
+
+   if (!region->prev || !region->chunks)
+   {
+      cheat_search_region_free(region);
+      return false;
+   }
+
+   memcpy(region->prev, region->data, region->size);
+
+   for (i = 0; i < region->num_chunks; i++)
+      region->chunks[i].count = (unsigned)MIN(CHEAT_SEARCH_CHUNK,
+            region->num_values - i * CHEAT_SEARCH_CHUNK);
+
+   return true;
+}
+
+/* Filters the candidates of a region and returns how many are left */
+static size_t cheat_search_region_filter(cheat_search_region_t *region,
+      const struct cheat_search_cmp *cmp, bool previous, bool simd)
+{
+   size_t c;
+   size_t count = 0;
+   unsigned width = cmp->width;
+
+   for (c = 0; c < region->num_chunks; c++)
+   {
+      unsigned w, words, n;
+      uint64_t bits[CHEAT_SEARCH_CHUNK_WORDS];
+      struct cheat_search_chunk *chunk = &region->chunks[c];
+      size_t first                     = c * CHEAT_SEARCH_CHUNK;
+      size_t offset                    = first * width;
+      unsigned left                    = 0;
+
+      if (!chunk->count)
+         continue;
+
+      n     = (unsigned)MIN(CHEAT_SEARCH_CHUNK, region->num_values - first);
+      words = (n + 63) / 64;
+
+      for (w = 0; w < words; w++)
+      {
+         unsigned m    = MIN(64, n - w * 64);
+         uint64_t have = chunk->bits ? chunk->bits[w]
+            : (m == 64 ? ~(uint64_t)0 : ((uint64_t)1 << m) - 1);
+
+         bits[w]       = 0;
+         if (!have)
+            continue;
+
+         bits[w]       = have & cheat_search_match(cmp,
+               region->data + offset + w * 64 * width,
+               previous ? region->prev + offset + w * 64 * width : NULL,
+               m, simd);
+         left         += cheat_search_popcount(bits[w]);
+      }
+
+      if (left == 0 || left == n)
+      {
+         free(chunk->bits);
+         chunk->bits = NULL;
+      }
+      else
+      {
+         if (!chunk->bits)
+            chunk->bits = (uint64_t*)malloc(sizeof(bits));
+
+         /* Out of memory: keep the whole chunk */
+         if (!chunk->bits)
+            left = n;
+         else
+            memcpy(chunk->bits, bits, words * sizeof(*bits));
+      }
+
+      chunk->count = left;
+      count       += left;
+
+      if (left)
+         memcpy(region->prev + offset, region->data + offset, n * width);
+   }
+
+   return count;
+}
+
+static void cheat_search_cmp_init(struct cheat_search_cmp *cmp,
+      enum cheat_search_op op, uint32_t value, unsigned width)
+{
+   cmp->value  = value;
+   cmp->width  = width;
+   cmp->equal  = op == CHEAT_SEARCH_EQ || op == CHEAT_SEARCH_NE;
+   /* a < b is b > a, a <= b is !(a > b), a >= b is !(b > a) */
+   cmp->swap   = op == CHEAT_SEARCH_LT || op == CHEAT_SEARCH_GE;
+   cmp->invert = op == CHEAT_SEARCH_NE || op == CHEAT_SEARCH_LE
+      || op == CHEAT_SEARCH_GE;
+
+   if (width < 4)
+      cmp->value &= (1U << (8 * width)) - 1;
+}
+
+static bool cheat_search_has_region(const struct cheat_search *search,
+      const uint8_t *data)
+{
+   unsigned i;
+
+   for (i = 0; i < search->num_regions; i++)
+      if (search->regions[i].data == data)
+         return true;
+
+   return false;
+}
+
+static bool cheat_search_add_region(struct cheat_search *search,
+      uint8_t *data, size_t size, size_t start, bool big_endian)
+{
+   cheat_search_region_t *region = NULL;
+   cheat_search_region_t *regions = NULL;
+
+   /* Memory maps often describe mirrors of the same memory */
+   if (!data || !size || cheat_search_has_region(search, data))
+      return true;
+
+   regions = (cheat_search_region_t*)realloc(search->regions,
+         (search->num_regions + 1) * sizeof(*regions));
+   if (!regions)
+      return false;
+
+   search->regions   = regions;
+   region            = &regions[search->num_regions++];
+   memset(region, 0, sizeof(*region));
+   region->data       = data;
+   region->size       = size;
+   region->start      = start;
+   region->big_endian = big_endian;
+   return true;
+}
+
+static void cheat_search_free_regions(struct cheat_search *search)
+{
+   unsigned i;
+
+   for (i = 0; i < search->num_regions; i++)
+      cheat_search_region_free(&search->regions[i]);
+   free(search->regions);
+
+   search->regions     = NULL;
+   search->num_regions = 0;
+   search->active      = false;
+   search->count       = 0;
+}
+
+static bool cheat_search_init_regions(struct cheat_search *search)
+{
+   unsigned i;
+   rarch_system_info_t *system = runloop_get_system_info();
+
+   cheat_search_free_regions(search);
+
+   if (system && system->mmaps.num_descriptors)
+   {
+      for (i = 0; i < system->mmaps.num_descriptors; i++)
+      {
+         const struct retro_memory_descriptor *desc =
+            &system->mmaps.descriptors[i].core;
+
+         if (!desc->ptr || (desc->flags & RETRO_MEMDESC_CONST))
+            continue;
+
+         if (!cheat_search_add_region(search,
+                  (uint8_t*)desc->ptr + desc->offset, desc->len, desc->start,
+                  (desc->flags & RETRO_MEMDESC_BIGENDIAN) != 0))
+            return false;
+      }
+   }
+   else
+   {
+      retro_ctx_memory_info_t mem_info;
+
+      mem_info.id   = RETRO_MEMORY_SYSTEM_RAM;
+      mem_info.data = NULL;
+      mem_info.size = 0;
+
+      core_get_memory(&mem_info);
+
+      if (!cheat_search_add_region(search,
+               (uint8_t*)mem_info.data, mem_info.size, 0, false))
+         return false;
+   }
+
+   return search->num_regions != 0;
+}
+
+static cheat_search_region_t *cheat_search_find_region(
+      struct cheat_search *search, size_t address, unsigned width)
+{
+   unsigned i;
+
+   for (i = 0; i < search->num_regions; i++)
+   {
+      cheat_search_region_t *region = &search->regions[i];
+
+      if (address >= region->start && region->size >= width
+            && address - region->start <= region->size - width)
+         return region;
+   }
+
+   return NULL;
+}
+
+bool cheat_search_start(unsigned width, enum cheat_search_endian endian)
+{
+   unsigned i;
+   struct cheat_search *search = &cheat_search_st;
+
+   if (width != 1 && width != 2 && width != 4)
+      return false;
+
+   if (!cheat_search_init_regions(search))
+      return false;
+
+   search->width = width;
+   search->count = 0;
+
+   for (i = 0; i < search->num_regions; i++)
+   {
+      cheat_search_region_t *region = &search->regions[i];
+
+      if (!cheat_search_region_start(region, width))
+      {
+         cheat_search_free_regions(search);
+         return false;
+      }
+
+      region->search_big_endian = endian == CHEAT_SEARCH_ENDIAN_AUTO
+         ? region->big_endian : endian == CHEAT_SEARCH_ENDIAN_BIG;
+      search->count            += region->num_values;
+   }
+
+   search->active = true;
+
+   RARCH_LOG("[Cheats]: Searching %u memory regions, %u candidates.\n",
+         search->num_regions, (unsigned)search->count);
+   return true;
+}
+
+bool cheat_search_filter(enum cheat_search_op op, bool previous,
+      uint32_t value)
+{
+   unsigned i;
+   struct cheat_search_cmp cmp;
+   struct cheat_search *search = &cheat_search_st;
+
+   if (!search->active)
+      return false;
+
+   cheat_search_cmp_init(&cmp, op, value, search->width);
+   search->count = 0;
+
+   for (i = 0; i < search->num_regions; i++)
+   {
+      cmp.big_endian = search->regions[i].search_big_endian;
+      search->count += cheat_search_region_filter(
+            &search->regions[i], &cmp, previous, true);
+   }
+
+   return true;
+}
+
+size_t cheat_search_count(void)
+{
+   return cheat_search_st.count;
+}
+
+size_t cheat_search_results(size_t *addresses, uint32_t *values, size_t max)
+{
+   unsigned i;
+   size_t count                = 0;
+   struct cheat_search *search = &cheat_search_st;
+
+   if (!search->active)
+      return 0;
+
+   for (i = 0; i < search->num_regions && count < max; i++)
+   {
+      size_t c;
+      cheat_search_region_t *region = &search->regions[i];
+
+      for (c = 0; c < region->num_chunks && count < max; c++)
+      {
+         unsigned w;
+         struct cheat_search_chunk *chunk = &region->chunks[c];
+         size_t first                     = c * CHEAT_SEARCH_CHUNK;
+         unsigned n                       = (unsigned)MIN(
+               CHEAT_SEARCH_CHUNK, region->num_values - first);
+
+         if (!chunk->count)
+            continue;
+
+         for (w = 0; w < (n + 63) / 64 && count < max; w++)
+         {
+            unsigned m    = MIN(64, n - w * 64);
+            uint64_t bits = chunk->bits ? chunk->bits[w]
+               : (m == 64 ? ~(uint64_t)0 : ((uint64_t)1 << m) - 1);
+
+            while (bits && count < max)
+            {
+               size_t offset = (first + w * 64 + cheat_search_ctz(bits))
+                  * search->width;
+
+               addresses[count] = region->start + offset;
+               values[count]    = cheat_search_read(region->data + offset,
+                     search->width, region->search_big_endian);
+               count++;
+               bits            &= bits - 1;
+            }
+         }
+      }
+   }
+
+   return count;
+}
+
+bool cheat_search_patch_add(size_t address, uint32_t value,
+      unsigned width, enum cheat_search_endian endian)
+{
+   size_t i;
+   bool big_endian;
+   struct cheat_patch *patch     = NULL;
+   cheat_search_region_t *region = NULL;
+   struct cheat_search *search   = &cheat_search_st;
+#ifdef HAVE_CHEEVOS
+   bool data_bool                = true;
+#endif
+
+   if (!width)
+      width = search->width ? search->width : 1;
+   if (width != 1 && width != 2 && width != 4)
+      return false;
+
+   if (!search->regions && !cheat_search_init_regions(search))
+      return false;
+
+   region = cheat_search_find_region(search, address, width);
+   if (!region)
+      return false;
+
+   big_endian = endian == CHEAT_SEARCH_ENDIAN_AUTO
+      ? region->big_endian : endian == CHEAT_SEARCH_ENDIAN_BIG;
+
+   /* Replace any patch this one overlaps, so that runs never overlap */
+   for (i = 0; i < search->num_patches; )
+   {
+      struct cheat_patch *other = &search->patches[i];
+
+      if (other->address < address + width
+            && address < other->address + other->width)
+         *other = search->patches[--search->num_patches];
+      else
+         i++;
+   }
+
+   if (search->num_patches == search->patches_size)
+   {
+      size_t new_size             = search->patches_size
+         ? search->patches_size * 2 : 16;
+      struct cheat_patch *patches = (struct cheat_patch*)
+         realloc(search->patches, new_size * sizeof(*patches));
+
+      if (!patches)
+         return false;
+
+      search->patches      = patches;
+      search->patches_size = new_size;
+   }
+
+   patch          = &search->patches[search->num_patches++];
+   patch->ptr     = region->data + (address - region->start);
+   patch->address = address;
+   patch->width   = width;
+   cheat_search_write(patch->bytes, value, width, big_endian);
+
+   search->runs_dirty = true;
+
+#ifdef HAVE_CHEEVOS
+   cheevos_apply_cheats(&data_bool);
+#endif
+   return true;
+}
+
+bool cheat_search_patch_remove(size_t address)
+{
+   size_t i;
+   struct cheat_search *search = &cheat_search_st;
+
+   for (i = 0; i < search->num_patches; i++)
+   {
+      if (search->patches[i].address == address)
+      {
+         search->patches[i] = search->patches[--search->num_patches];
+         search->runs_dirty = true;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static void cheat_search_free_runs(struct cheat_search *search)
+{
+   free(search->runs);
+   free(search->run_data);
+   search->runs     = NULL;
+   search->run_data = NULL;
+   search->num_runs = 0;
+}
+
+void cheat_search_patch_clear(void)
+{
+   struct cheat_search *search = &cheat_search_st;
+
+   free(search->patches);
+   search->patches      = NULL;
+   search->num_patches  = 0;
+   search->patches_size = 0;
+   search->runs_dirty   = false;
+   cheat_search_free_runs(search);
+}
+
+static int cheat_patch_compare(const void *a, const void *b)
+{
+   const struct cheat_patch *pa = (const struct cheat_patch*)a;
+   const struct cheat_patch *pb = (const struct cheat_patch*)b;
+
+   if (pa->ptr < pb->ptr)
+      return -1;
+   return pa->ptr > pb->ptr;
+}
+
+/* Sorts the patches and merges adjacent ones into runs */
+static bool cheat_search_build_runs(struct cheat_search *search)
+{
+   size_t i;
+   size_t used = 0;
+
+   cheat_search_free_runs(search);
+   search->runs_dirty = false;
+
+   if (!search->num_patches)
+      return true;
+
+   qsort(search->patches, search->num_patches,
+         sizeof(*search->patches), cheat_patch_compare);
+
+   search->runs     = (struct cheat_patch_run*)malloc(
+         search->num_patches * sizeof(*search->runs));
+   search->run_data = (uint8_t*)malloc(search->num_patches * 4);
+
+   if (!search->runs || !search->run_data)
+   {
+      cheat_search_free_runs(search);
+      return false;
+   }
+
+   for (i = 0; i < search->num_patches; i++)
+   {
+      const struct cheat_patch *patch = &search->patches[i];
+      struct cheat_patch_run *run     = search->num_runs
+         ? &search->runs[search->num_runs - 1] : NULL;
+
+      if (!run || patch->ptr != run->ptr + run->len)
+      {
+         run         = &search->runs[search->num_runs++];
+         run->ptr    = patch->ptr;
+         run->len    = 0;
+         run->offset = used;
+      }
+
+      memcpy(search->run_data + used, patch->bytes, patch->width);
+      run->len += patch->width;
+      used     += patch->width;
+   }
+
+   return true;
+}
+
+void cheat_search_patch_apply(void)
+{
+   size_t i;
+   struct cheat_search *search = &cheat_search_st;
+
+   if (!search->num_patches)
+      return;
+
+#ifdef HAVE_NETWORKING
+   if (netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_DATA_INITED, NULL))
+      return;
+#endif
+   if (bsv_movie_ctl(BSV_MOVIE_CTL_IS_INITED, NULL))
+      return;
+
+   if (search->runs_dirty && !cheat_search_build_runs(search))
+      return;
+
+   for (i = 0; i < search->num_runs; i++)
+   {
+      const struct cheat_patch_run *run = &search->runs[i];
+      memcpy(run->ptr, search->run_data + run->offset, run->len);
+   }
+}
+
+void cheat_search_free(void)
+{
+   cheat_search_patch_clear();
+   cheat_search_free_regions(&cheat_search_st);
+   memset(&cheat_search_st, 0, sizeof(cheat_search_st));
+}
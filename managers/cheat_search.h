@@ -0,0 +1,128 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CHEAT_SEARCH_H
+#define __CHEAT_SEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+enum cheat_search_op
+{
+   CHEAT_SEARCH_EQ = 0,
+   CHEAT_SEARCH_NE,
+   CHEAT_SEARCH_LT,
+   CHEAT_SEARCH_GT,
+   CHEAT_SEARCH_LE,
+   CHEAT_SEARCH_GE
+};
+
+enum cheat_search_endian
+{
+   /* Big endian where the core's memory map says so */
+   CHEAT_SEARCH_ENDIAN_AUTO = 0,
+   CHEAT_SEARCH_ENDIAN_LITTLE,
+   CHEAT_SEARCH_ENDIAN_BIG
+};
+
+/**
+ * cheat_search_start:
+ * @width                     : Size of the values searched for, in bytes
+ *                              (1, 2 or 4).
+ * @endian                    : Byte order of the values.
+ *
+ * Starts a new search over the writable memory of the core, as
+ * described by its memory map, or over its system RAM if it has
+ * none. Every @width-aligned value is a candidate.
+ *
+ * Returns: true (1) if the core exposes any memory, otherwise false (0).
+ **/
+bool cheat_search_start(unsigned width, enum cheat_search_endian endian);
+
+/**
+ * cheat_search_filter:
+ * @op                        : Comparison the candidates have to pass.
+ * @previous                  : Compare with the value each candidate had
+ *                              at the previous pass rather than with @value.
+ * @value                     : Value to compare with.
+ *
+ * Keeps only the candidates whose current value compares to @value
+ * (or to their previous value) as @op says. Values are unsigned.
+ *
+ * Returns: true (1) if a search is in progress, otherwise false (0).
+ **/
+bool cheat_search_filter(enum cheat_search_op op, bool previous,
+      uint32_t value);
+
+size_t cheat_search_count(void);
+
+/**
+ * cheat_search_results:
+ * @addresses                 : Filled with the addresses of the candidates.
+ * @values                    : Filled with their current values.
+ * @max                       : Size of both arrays.
+ *
+ * Addresses are those of the core's memory map, or offsets into
+ * system RAM if it has none.
+ *
+ * Returns: the number of candidates written, at most @max.
+ **/
+size_t cheat_search_results(size_t *addresses, uint32_t *values, size_t max);
+
+/**
+ * cheat_search_patch_add:
+ * @address                   : Address, as returned by cheat_search_results.
+ * @value                     : Value to keep there.
+ * @width                     : Size of the value in bytes, or 0 for the
+ *                              width of the current search.
+ * @endian                    : Byte order of the value.
+ *
+ * Writes @value to @address before every frame, until removed or
+ * until the core is unloaded. A patch replaces any it overlaps.
+ *
+ * Returns: true (1) if @address is in the core's memory, otherwise false (0).
+ **/
+bool cheat_search_patch_add(size_t address, uint32_t value,
+      unsigned width, enum cheat_search_endian endian);
+
+bool cheat_search_patch_remove(size_t address);
+
+void cheat_search_patch_clear(void);
+
+/**
+ * cheat_search_patch_apply:
+ *
+ * Writes all patches to the core's memory. Called before each frame;
+ * patches are not applied during netplay or movie playback/recording,
+ * which they would desynchronize.
+ **/
+void cheat_search_patch_apply(void);
+
+/**
+ * cheat_search_free:
+ *
+ * Ends the search and drops all patches. Must be called before the
+ * core's memory goes away.
+ **/
+void cheat_search_free(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -29,6 +29,8 @@
 #include "../movie.h"
 #include "../core.h"
 #include "../verbosity.h"
+#include "../performance_counters.h"
+#include "../runloop.h"
 #include "../audio/audio_driver.h"
 
 #ifdef HAVE_NETWORKING
@@ -663,6 +665,11 @@ bool state_manager_frame_is_reversed(void)
    return frame_is_reversed;
 }
 
+bool state_manager_is_active(void)
+{
+   return rewind_state.state != NULL;
+}
+
 static void state_manager_set_frame_is_reversed(bool value)
 {
    frame_is_reversed = value;
@@ -780,17 +787,27 @@ bool state_manager_check_rewind(bool pressed,
 
       if ((cnt == 0) || bsv_movie_ctl(BSV_MOVIE_CTL_IS_INITED, NULL))
       {
+         static struct retro_perf_counter rewind_serialize = {0};
+         static struct retro_perf_counter rewind_compress  = {0};
          retro_ctx_serialize_info_t serial_info;
-         void *state = NULL;
+         void *state            = NULL;
+         bool is_perfcnt_enable = runloop_ctl(
+               RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL);
 
          state_manager_push_where(rewind_state.state, &state);
 
          serial_info.data = state;
          serial_info.size = rewind_state.size;
 
+         performance_counter_init(rewind_serialize, "rewind_serialize");
+         performance_counter_start_plus(is_perfcnt_enable, rewind_serialize);
          core_serialize(&serial_info);
+         performance_counter_stop_plus(is_perfcnt_enable, rewind_serialize);
 
+         performance_counter_init(rewind_compress, "rewind_compress");
+         performance_counter_start_plus(is_perfcnt_enable, rewind_compress);
          state_manager_push_do(rewind_state.state);
+         performance_counter_stop_plus(is_perfcnt_enable, rewind_compress);
       }
    }
 
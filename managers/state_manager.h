@@ -30,6 +30,8 @@ typedef struct state_manager state_manager_t;
 
 bool state_manager_frame_is_reversed(void);
 
+bool state_manager_is_active(void);
+
 void state_manager_event_deinit(void);
 
 void state_manager_event_init(unsigned rewind_buffer_size);
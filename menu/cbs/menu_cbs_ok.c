@@ -62,6 +62,8 @@ typedef struct
 {
    enum msg_hash_enums enum_idx;
    char path[PATH_MAX_LENGTH];
+   /* File a streamed download is written to until it completes. */
+   char part_path[PATH_MAX_LENGTH];
 } menu_file_transfer_t;
 
 enum
@@ -2512,26 +2514,16 @@ static void cb_generic_dir_download(void *task_data,
    }
 }
 
-/* expects http_transfer_t*, menu_file_transfer_t* */
-static void cb_generic_download(void *task_data,
-      void *user_data, const char *err)
+/* Directory a download of type @enum_idx is stored in, or NULL.
+ * @extract, if not NULL, is set to whether archives should be
+ * extracted once downloaded. */
+static const char *generic_download_dir(enum msg_hash_enums enum_idx,
+      bool *extract)
 {
-   char output_path[PATH_MAX_LENGTH];
-   bool extract = true;
-   const char             *dir_path      = NULL;
-   menu_file_transfer_t     *transf      = (menu_file_transfer_t*)user_data;
-   settings_t              *settings     = config_get_ptr();
-   http_transfer_data_t        *data     = (http_transfer_data_t*)task_data;
-
-   if (!data || !data->data | !transf)
-      goto finish;
-
-   output_path[0] = '\0';
+   const char *dir_path = NULL;
+   settings_t *settings = config_get_ptr();
 
-   /* we have to determine dir_path at the time of writting or else
-    * we'd run into races when the user changes the setting during an
-    * http transfer. */
-   switch (transf->enum_idx)
+   switch (enum_idx)
    {
       case MENU_ENUM_LABEL_CB_CORE_THUMBNAILS_DOWNLOAD:
          dir_path = settings->directory.thumbnails;
@@ -2541,7 +2533,8 @@ static void cb_generic_download(void *task_data,
          break;
       case MENU_ENUM_LABEL_CB_CORE_CONTENT_DOWNLOAD:
          dir_path = settings->directory.core_assets;
-         extract = settings->bools.network_buildbot_auto_extract_archive;
+         if (extract)
+            *extract = settings->bools.network_buildbot_auto_extract_archive;
          break;
       case MENU_ENUM_LABEL_CB_UPDATE_CORE_INFO_FILES:
          dir_path = settings->path.libretro_info;
@@ -2568,11 +2561,11 @@ static void cb_generic_download(void *task_data,
             static char shaderdir[PATH_MAX_LENGTH]       = {0};
             const char *dirname                          = NULL;
 
-            if (transf->enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_CG)
+            if (enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_CG)
                dirname                                   = "shaders_cg";
-            else if (transf->enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_GLSL)
+            else if (enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_GLSL)
                dirname                                   = "shaders_glsl";
-            else if (transf->enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_SLANG)
+            else if (enum_idx == MENU_ENUM_LABEL_CB_UPDATE_SHADERS_SLANG)
                dirname                                   = "shaders_slang";
 
             fill_pathname_join(shaderdir,
@@ -2581,7 +2574,7 @@ static void cb_generic_download(void *task_data,
                   sizeof(shaderdir));
 
             if (!path_file_exists(shaderdir) && !path_mkdir(shaderdir))
-               goto finish;
+               return NULL;
 
             dir_path = shaderdir;
          }
@@ -2591,10 +2584,33 @@ static void cb_generic_download(void *task_data,
          break;
       default:
          RARCH_WARN("Unknown transfer type '%s' bailing out.\n",
-               msg_hash_to_str(transf->enum_idx));
+               msg_hash_to_str(enum_idx));
          break;
    }
 
+   return dir_path;
+}
+
+/* expects http_transfer_t*, menu_file_transfer_t* */
+static void cb_generic_download(void *task_data,
+      void *user_data, const char *err)
+{
+   char output_path[PATH_MAX_LENGTH];
+   bool extract = true;
+   const char             *dir_path      = NULL;
+   menu_file_transfer_t     *transf      = (menu_file_transfer_t*)user_data;
+   http_transfer_data_t        *data     = (http_transfer_data_t*)task_data;
+
+   if (!data || !transf)
+      goto finish;
+
+   output_path[0] = '\0';
+
+   /* we have to determine dir_path at the time of writting or else
+    * we'd run into races when the user changes the setting during an
+    * http transfer. */
+   dir_path = generic_download_dir(transf->enum_idx, &extract);
+
    if (!string_is_empty(dir_path))
       fill_pathname_join(output_path, dir_path,
             transf->path, sizeof(output_path));
@@ -2623,7 +2639,7 @@ static void cb_generic_download(void *task_data,
    }
 #endif
 
-   if (!filestream_write_file(output_path, data->data, data->len))
+   if (!path_replace_file(transf->part_path, output_path))
    {
       err = "Write failed.";
       goto finish;
@@ -2660,6 +2676,9 @@ finish:
    {
       RARCH_ERR("Download of '%s' failed: %s\n",
             (transf ? transf->path: "unknown"), err);
+
+      if (transf)
+         remove(transf->part_path);
    }
 
    if (data)
@@ -2758,7 +2777,32 @@ static int action_ok_download_generic(const char *path,
    transf->enum_idx = enum_idx;
    strlcpy(transf->path, path, sizeof(transf->path));
 
-   task_push_http_transfer(s3, suppress_msg, msg_hash_to_str(enum_idx), cb, transf);
+   if (cb == cb_generic_download)
+   {
+      /* Cores, thumbnail packs and asset archives are streamed to
+       * a partial file next to where they end up instead of being
+       * held in memory, and moved into place once complete. */
+      const char *dir_path = generic_download_dir(enum_idx, NULL);
+
+      if (string_is_empty(dir_path))
+      {
+         free(transf);
+         return 0;
+      }
+
+      fill_pathname_join(transf->part_path, dir_path,
+            path, sizeof(transf->part_path));
+      strlcat(transf->part_path, ".part", sizeof(transf->part_path));
+
+      fill_pathname_basedir(s, transf->part_path, sizeof(s));
+
+      if (!path_mkdir(s) || !task_push_http_transfer_file(s3,
+               transf->part_path, suppress_msg,
+               msg_hash_to_str(enum_idx), cb, transf))
+         free(transf);
+   }
+   else
+      task_push_http_transfer(s3, suppress_msg, msg_hash_to_str(enum_idx), cb, transf);
 #endif
    return 0;
 }
@@ -1631,6 +1631,7 @@ static void mui_populate_entries(
 
 static void mui_context_reset(void *data)
 {
+   unsigned width, height;
    mui_handle_t *mui              = (mui_handle_t*)data;
    settings_t *settings           = config_get_ptr();
 
@@ -1642,9 +1643,15 @@ static void mui_context_reset(void *data)
    menu_display_allocate_white_texture();
    mui_context_reset_textures(mui);
 
+   video_driver_get_size(&width, &height);
+
+   /* The wallpaper gets stretched over the screen, so there is no
+    * point in uploading it any wider than that. The height is left
+    * alone, so it never ends up shorter than the screen either */
    if (path_file_exists(settings->path.menu_wallpaper))
-      task_push_image_load(settings->path.menu_wallpaper, 
-            menu_display_handle_wallpaper_upload, NULL);
+      task_push_thumbnail_load(settings->path.menu_wallpaper,
+            width, 0,
+            menu_display_handle_wallpaper_thumbnail_upload, NULL);
 }
 
 static int mui_environ(enum menu_environ_cb type, void *data, void *userdata)
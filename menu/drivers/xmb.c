@@ -1049,7 +1049,8 @@ static void xmb_update_thumbnail_image(void *data)
       return;
 
    if (path_file_exists(xmb->thumbnail_file_path))
-      task_push_image_load(xmb->thumbnail_file_path,
+      task_push_thumbnail_load(xmb->thumbnail_file_path,
+            (unsigned)(xmb->thumbnail_width + 0.5f), 0,
             menu_display_handle_thumbnail_upload, NULL);
    else if (xmb->depth == 1)
       xmb->thumbnail = 0;
@@ -941,10 +941,9 @@ void menu_display_handle_thumbnail_upload(void *task_data,
    load_image_info.data = img;
    load_image_info.type = MENU_IMAGE_THUMBNAIL;
 
+   /* Loaded by task_push_thumbnail_load, which frees the image itself */
    menu_driver_ctl(RARCH_MENU_CTL_LOAD_IMAGE, &load_image_info);
 
-   image_texture_free(img);
-   free(img);
    free(user_data);
 }
 
@@ -979,6 +978,21 @@ void menu_display_handle_wallpaper_upload(void *task_data,
    free(user_data);
 }
 
+void menu_display_handle_wallpaper_thumbnail_upload(void *task_data,
+      void *user_data, const char *err)
+{
+   menu_ctx_load_image_t load_image_info;
+   struct texture_image *img = (struct texture_image*)task_data;
+
+   load_image_info.data = img;
+   load_image_info.type = MENU_IMAGE_WALLPAPER;
+
+   /* Loaded by task_push_thumbnail_load, which frees the image itself */
+   menu_driver_ctl(RARCH_MENU_CTL_LOAD_IMAGE, &load_image_info);
+
+   free(user_data);
+}
+
 void menu_display_allocate_white_texture(void)
 {
    struct texture_image ti;
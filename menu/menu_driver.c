@@ -32,6 +32,7 @@
 #include "menu_event.h"
 #include "menu_navigation.h"
 #include "widgets/menu_dialog.h"
+#include "widgets/menu_filebrowser.h"
 #include "widgets/menu_list.h"
 #include "menu_shader.h"
 
@@ -617,6 +618,8 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
             command_event(CMD_EVENT_HISTORY_DEINIT, NULL);
 
             menu_dialog_reset();
+            filebrowser_cache_free();
+            task_thumbnail_cache_free();
 
             free(menu_driver_data);
          }
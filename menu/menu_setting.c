@@ -741,30 +741,146 @@ int menu_action_handle_setting(rarch_setting_t *setting,
    return -1;
 }
 
+/* Lookup index over the settings list currently owned by the menu.
+ * Both tables only hold the first setting of a given name or enum
+ * with a type up to ST_GROUP, which is the one a linear scan of the
+ * list would return. */
+typedef struct menu_setting_index
+{
+   rarch_setting_t *list;
+   rarch_setting_t **by_enum;
+   uint32_t *by_name;
+   uint32_t mask;
+} menu_setting_index_t;
+
+static menu_setting_index_t menu_setting_idx;
+static bool menu_setting_index_disabled = false;
+
+static void menu_setting_index_free(void)
+{
+   free(menu_setting_idx.by_enum);
+   free(menu_setting_idx.by_name);
+   memset(&menu_setting_idx, 0, sizeof(menu_setting_idx));
+}
+
+/**
+ * menu_setting_index_build:
+ * @list               : settings list, terminated by an ST_NONE entry.
+ *
+ * Builds a direct enum to setting table and an open-addressed
+ * table keyed by name_hash whose slots hold 1-based offsets
+ * into @list. If allocation fails the index is left empty and
+ * lookups fall back to scanning the list.
+ **/
+static void menu_setting_index_build(rarch_setting_t *list)
+{
+   size_t i;
+   size_t count             = 0;
+   uint32_t slots           = 64;
+   rarch_setting_t *setting = list;
+
+   menu_setting_index_free();
+
+   for (; setting_get_type(setting) != ST_NONE; setting++)
+      count++;
+
+   while (slots < count * 2)
+      slots <<= 1;
+
+   menu_setting_idx.by_enum = (rarch_setting_t**)
+      calloc(MSG_LAST, sizeof(*menu_setting_idx.by_enum));
+   menu_setting_idx.by_name = (uint32_t*)
+      calloc(slots, sizeof(*menu_setting_idx.by_name));
+
+   if (!menu_setting_idx.by_enum || !menu_setting_idx.by_name)
+   {
+      menu_setting_index_free();
+      return;
+   }
+
+   menu_setting_idx.mask = slots - 1;
+
+   for (i = 0; i < count; i++)
+   {
+      uint32_t pos;
+
+      setting = &list[i];
+
+      if (setting_get_type(setting) > ST_GROUP)
+         continue;
+
+      if ((unsigned)setting->enum_idx < MSG_LAST
+            && !menu_setting_idx.by_enum[setting->enum_idx])
+         menu_setting_idx.by_enum[setting->enum_idx] = setting;
+
+      if (!setting->name)
+         continue;
+
+      for (pos = setting->name_hash & menu_setting_idx.mask;
+            menu_setting_idx.by_name[pos];
+            pos = (pos + 1) & menu_setting_idx.mask)
+      {
+         const rarch_setting_t *other =
+            &list[menu_setting_idx.by_name[pos] - 1];
+
+         if (     other->name_hash == setting->name_hash
+               && string_is_equal(other->name, setting->name))
+            break;
+      }
+
+      if (!menu_setting_idx.by_name[pos])
+         menu_setting_idx.by_name[pos] = (uint32_t)(i + 1);
+   }
+
+   menu_setting_idx.list = list;
+}
+
+static rarch_setting_t *menu_setting_find_result(rarch_setting_t *setting)
+{
+   if (string_is_empty(setting->short_description))
+      return NULL;
+
+   if (setting->read_handler)
+      setting->read_handler(setting);
+
+   return setting;
+}
+
 static rarch_setting_t *menu_setting_find_internal(rarch_setting_t *setting, 
       const char *label)
 {
    uint32_t needle        = msg_hash_calculate(label);
    rarch_setting_t **list = &setting;
 
+   if (menu_setting_idx.list == setting && !menu_setting_index_disabled)
+   {
+      uint32_t pos;
+
+      for (pos = needle & menu_setting_idx.mask;
+            menu_setting_idx.by_name[pos];
+            pos = (pos + 1) & menu_setting_idx.mask)
+      {
+         rarch_setting_t *found =
+            &setting[menu_setting_idx.by_name[pos] - 1];
+
+         if (     (needle == found->name_hash)
+               && string_is_equal(label, found->name))
+            return menu_setting_find_result(found);
+      }
+
+      return NULL;
+   }
+
    for (; setting_get_type(setting) != ST_NONE; (*list = *list + 1))
    {
       if (     (needle                    == setting->name_hash)
             && (setting_get_type(setting) <= ST_GROUP))
       {
-         const char *name              = setting->name;
-         const char *short_description = setting->short_description;
          /* make sure this isn't a collision */
-         if (!string_is_equal(label, name))
+         if (!string_is_equal(label, setting->name))
             continue;
 
-         if (string_is_empty(short_description))
-            return NULL;
-
-         if (setting->read_handler)
-            setting->read_handler(setting);
-
-         return setting;
+         return menu_setting_find_result(setting);
       }
    }
 
@@ -775,19 +891,21 @@ static rarch_setting_t *menu_setting_find_internal_enum(rarch_setting_t *setting
      enum msg_hash_enums enum_idx)
 {
    rarch_setting_t **list = &setting;
-   for (; setting_get_type(setting) != ST_NONE; (*list = *list + 1))
+
+   if (menu_setting_idx.list == setting && !menu_setting_index_disabled)
    {
-      if (setting->enum_idx == enum_idx && setting_get_type(setting) <= ST_GROUP)
-      {
-         const char *short_description = setting->short_description;
-         if (string_is_empty(short_description))
-            return NULL;
+      rarch_setting_t *found = NULL;
 
-         if (setting->read_handler)
-            setting->read_handler(setting);
+      if ((unsigned)enum_idx < MSG_LAST)
+         found = menu_setting_idx.by_enum[enum_idx];
 
-         return setting;
-      }
+      return found ? menu_setting_find_result(found) : NULL;
+   }
+
+   for (; setting_get_type(setting) != ST_NONE; (*list = *list + 1))
+   {
+      if (setting->enum_idx == enum_idx && setting_get_type(setting) <= ST_GROUP)
+         return menu_setting_find_result(setting);
    }
 
    return NULL;
@@ -6645,6 +6763,9 @@ bool menu_setting_free(void *data)
    if (!setting)
       return false;
 
+   if (menu_setting_idx.list == setting)
+      menu_setting_index_free();
+
    /* Free data which was previously tagged */
    for (; setting_get_type(setting) != ST_NONE; (*list = *list + 1))
       for (values = (unsigned)setting->free_flags, n = 0; values != 0; values >>= 1, n++)
@@ -6769,6 +6890,9 @@ static rarch_setting_t *menu_setting_new(void)
    menu_settings_info_list_free(list_info);
    list_info = NULL;
 
+   if (list)
+      menu_setting_index_build(list);
+
    return list;
 }
 
@@ -6823,6 +6947,12 @@ bool menu_setting_ctl(enum menu_setting_ctl_state state, void *data)
                return false;
          }
          break;
+      case MENU_SETTING_CTL_INDEX_ENABLE:
+         menu_setting_index_disabled = false;
+         break;
+      case MENU_SETTING_CTL_INDEX_DISABLE:
+         menu_setting_index_disabled = true;
+         break;
       case MENU_SETTING_CTL_NONE:
       default:
          break;
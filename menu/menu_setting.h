@@ -32,7 +32,12 @@ enum menu_setting_ctl_state
    MENU_SETTING_CTL_NONE = 0,
    MENU_SETTING_CTL_NEW,
    MENU_SETTING_CTL_IS_OF_PATH_TYPE,
-   MENU_SETTING_CTL_ACTION_RIGHT
+   MENU_SETTING_CTL_ACTION_RIGHT,
+
+   /* Lookups normally go through an index built with the
+    * settings list; disabling it makes them scan the list. */
+   MENU_SETTING_CTL_INDEX_ENABLE,
+   MENU_SETTING_CTL_INDEX_DISABLE
 };
 
 enum setting_list_flags
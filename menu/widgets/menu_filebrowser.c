@@ -13,6 +13,8 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <time.h>
+
 #include <compat/strl.h>
 #include <lists/string_list.h>
 #include <string/stdstring.h>
@@ -20,6 +22,7 @@
 #include <file/archive_file.h>
 
 #include <lists/dir_list.h>
+#include <retro_stat.h>
 
 #include <boolean.h>
 
@@ -34,6 +37,33 @@
 
 #include "../../configuration.h"
 #include "../../paths.h"
+#include "../../tasks/tasks_internal.h"
+
+/* Number of directory listings kept around for quick re-entry. */
+#define FILEBROWSER_CACHE_SIZE   8
+
+/* Entries listed up front before the rest of a directory
+ * is handed off to a background task. */
+#define FILEBROWSER_SYNC_ENTRIES 2048
+
+typedef struct filebrowser_cache_entry
+{
+   char *path;
+   char *exts;
+   bool show_hidden;
+   int64_t mtime;
+   int64_t cached_at;
+   unsigned last_used;
+   unsigned generation;
+   struct string_list *list;
+} filebrowser_cache_entry_t;
+
+static filebrowser_cache_entry_t filebrowser_cache[FILEBROWSER_CACHE_SIZE];
+static unsigned filebrowser_cache_counter            = 0;
+/* Bumped by filebrowser_cache_free(), so listings that finish
+ * after the cache was torn down know to drop themselves. */
+static unsigned filebrowser_cache_generation         = 0;
+static filebrowser_cache_entry_t *filebrowser_pending = NULL;
 
 static enum filebrowser_enums filebrowser_types = FILEBROWSER_NONE;
 
@@ -53,10 +83,252 @@ void filebrowser_set_type(enum filebrowser_enums type)
       filebrowser_types = type;
 }
 
+static void filebrowser_cache_entry_free(filebrowser_cache_entry_t *entry)
+{
+   if (entry->path)
+      free(entry->path);
+   if (entry->exts)
+      free(entry->exts);
+   if (entry->list)
+      string_list_free(entry->list);
+   memset(entry, 0, sizeof(*entry));
+}
+
+static bool filebrowser_cache_entry_matches(
+      const filebrowser_cache_entry_t *entry,
+      const char *path, const char *exts, bool show_hidden)
+{
+   return entry->path
+      && entry->show_hidden == show_hidden
+      && string_is_equal(entry->path, path)
+      && string_is_equal(entry->exts, exts ? exts : "");
+}
+
+static filebrowser_cache_entry_t *filebrowser_cache_entry_new(
+      const char *path, const char *exts, bool show_hidden)
+{
+   filebrowser_cache_entry_t *entry = (filebrowser_cache_entry_t*)
+      calloc(1, sizeof(*entry));
+
+   if (!entry)
+      return NULL;
+
+   entry->path        = strdup(path);
+   entry->exts        = strdup(exts ? exts : "");
+   entry->show_hidden = show_hidden;
+   entry->cached_at   = (int64_t)time(NULL);
+   entry->generation  = filebrowser_cache_generation;
+
+   /* Without a modification time there is no telling
+    * whether a cached listing is still accurate. */
+   if (!path_get_mtime(path, &entry->mtime))
+      entry->mtime    = entry->cached_at;
+
+   return entry;
+}
+
+/* Takes ownership of the contents of @entry, evicting the
+ * least recently used listing if the cache is full. */
+static void filebrowser_cache_store(filebrowser_cache_entry_t *entry)
+{
+   unsigned i;
+   filebrowser_cache_entry_t *slot = &filebrowser_cache[0];
+
+   for (i = 0; i < FILEBROWSER_CACHE_SIZE; i++)
+   {
+      filebrowser_cache_entry_t *cur = &filebrowser_cache[i];
+
+      if (filebrowser_cache_entry_matches(cur,
+               entry->path, entry->exts, entry->show_hidden))
+      {
+         slot = cur;
+         break;
+      }
+
+      if (!cur->path)
+         slot = cur;
+      else if (slot->path && cur->last_used < slot->last_used)
+         slot = cur;
+   }
+
+   filebrowser_cache_entry_free(slot);
+   *slot           = *entry;
+   slot->last_used = ++filebrowser_cache_counter;
+}
+
+static struct string_list *filebrowser_cache_find(
+      const char *path, const char *exts, bool show_hidden)
+{
+   unsigned i;
+
+   for (i = 0; i < FILEBROWSER_CACHE_SIZE; i++)
+   {
+      int64_t mtime                    = 0;
+      filebrowser_cache_entry_t *entry = &filebrowser_cache[i];
+
+      if (!filebrowser_cache_entry_matches(entry, path, exts, show_hidden))
+         continue;
+
+      /* A directory modified within the second it was listed
+       * in may have changed after the listing was taken. */
+      if (     !path_get_mtime(path, &mtime)
+            || mtime != entry->mtime
+            || mtime >= entry->cached_at)
+      {
+         filebrowser_cache_entry_free(entry);
+         return NULL;
+      }
+
+      entry->last_used = ++filebrowser_cache_counter;
+      return entry->list;
+   }
+
+   return NULL;
+}
+
+void filebrowser_cache_free(void)
+{
+   unsigned i;
+
+   for (i = 0; i < FILEBROWSER_CACHE_SIZE; i++)
+      filebrowser_cache_entry_free(&filebrowser_cache[i]);
+
+   /* A listing still in flight is dropped by its callback. */
+   filebrowser_pending = NULL;
+   filebrowser_cache_generation++;
+}
+
+static void filebrowser_dir_list_cb(void *task_data,
+      void *user_data, const char *error)
+{
+   const char *path                 = NULL;
+   struct string_list *list         = (struct string_list*)task_data;
+   filebrowser_cache_entry_t *entry = (filebrowser_cache_entry_t*)user_data;
+   bool is_current                  = (entry == filebrowser_pending);
+
+   if (is_current)
+      filebrowser_pending = NULL;
+
+   /* The cache (and possibly the menu) went away while this was
+    * being listed - there is nothing left to hand it to. */
+   if (entry->generation != filebrowser_cache_generation)
+   {
+      string_list_free(list);
+      filebrowser_cache_entry_free(entry);
+      free(entry);
+      return;
+   }
+
+   if (!list)
+   {
+      filebrowser_cache_entry_free(entry);
+      free(entry);
+      return;
+   }
+
+   dir_list_sort(list, true);
+   entry->list = list;
+
+   menu_entries_get_last_stack(&path, NULL, NULL, NULL, NULL);
+
+   /* Only repopulate if we are still inside that directory. */
+   if (is_current && string_is_equal(path, entry->path))
+   {
+      bool refresh = false;
+      menu_entries_ctl(MENU_ENTRIES_CTL_SET_REFRESH, &refresh);
+   }
+
+   filebrowser_cache_store(entry);
+   free(entry);
+}
+
+/* Lists @path, finishing it in the background if it turns out
+ * to be large. Sets @loading when only part of the listing
+ * could be returned, which the caller then has to free; a
+ * complete listing is sorted and owned by the cache. */
+static struct string_list *filebrowser_dir_list(const char *path,
+      const char *exts, bool show_hidden, bool *loading)
+{
+   size_t i;
+   int ret                          = 0;
+   struct string_list *partial      = NULL;
+   struct string_list *list         = NULL;
+   filebrowser_cache_entry_t *entry = NULL;
+   struct dir_list_reader *reader   = NULL;
+
+   if (filebrowser_pending && filebrowser_cache_entry_matches(
+            filebrowser_pending, path, exts, show_hidden))
+   {
+      *loading = true;
+      return string_list_new();
+   }
+
+   entry  = filebrowser_cache_entry_new(path, exts, show_hidden);
+   reader = dir_list_reader_new(path, exts, true, show_hidden, true);
+   list   = string_list_new();
+
+   if (!entry || !reader || !list)
+      goto error;
+
+   ret    = dir_list_reader_step(reader, list, FILEBROWSER_SYNC_ENTRIES);
+
+   if (ret == 1)
+   {
+      union string_list_elem_attr attr;
+
+      attr.i  = 0;
+      partial = string_list_new();
+      if (!partial)
+         goto error;
+
+      for (i = 0; i < list->size; i++)
+      {
+         attr.i = list->elems[i].attr.i;
+         string_list_append(partial, list->elems[i].data, attr);
+      }
+
+      if (task_push_dir_list(reader, list, filebrowser_dir_list_cb, entry))
+      {
+         filebrowser_pending = entry;
+         *loading            = true;
+         return partial;
+      }
+
+      /* No task, finish up here. */
+      string_list_free(partial);
+      while ((ret = dir_list_reader_step(reader, list,
+                  FILEBROWSER_SYNC_ENTRIES)) == 1);
+   }
+
+   if (ret == -1)
+      goto error;
+
+   dir_list_reader_free(reader);
+   dir_list_sort(list, true);
+
+   entry->list = list;
+   filebrowser_cache_store(entry);
+   free(entry);
+
+   return list;
+
+error:
+   if (entry)
+   {
+      filebrowser_cache_entry_free(entry);
+      free(entry);
+   }
+   dir_list_reader_free(reader);
+   string_list_free(list);
+   return NULL;
+}
+
 void filebrowser_parse(void *data, unsigned type_data)
 {
    size_t i, list_size;
    struct string_list *str_list         = NULL;
+   bool str_list_cached                 = false;
+   bool loading                         = false;
    unsigned items_found                 = 0;
    unsigned files_count                 = 0;
    unsigned dirs_count                  = 0;
@@ -76,9 +348,22 @@ void filebrowser_parse(void *data, unsigned type_data)
    if (path_is_compressed)
       str_list = file_archive_get_file_list(info->path, info->exts);
    else
-      str_list = dir_list_new(info->path,
-            filter_ext ? info->exts : NULL,
-            true, settings->bools.show_hidden_files, true, false);
+   {
+      const char *exts = filter_ext ? info->exts : NULL;
+      bool show_hidden = settings->bools.show_hidden_files;
+
+      str_list         = filebrowser_cache_find(info->path, exts, show_hidden);
+
+      /* The cached list is already sorted, and owned by the cache. */
+      if (str_list)
+         str_list_cached = true;
+      else
+      {
+         str_list        = filebrowser_dir_list(info->path, exts,
+               show_hidden, &loading);
+         str_list_cached = !loading;
+      }
+   }
 
 #ifdef HAVE_LIBRETRODB
    if (filebrowser_types == FILEBROWSER_SCAN_DIR)
@@ -107,13 +392,15 @@ void filebrowser_parse(void *data, unsigned type_data)
       goto end;
    }
 
-   dir_list_sort(str_list, true);
+   if (!str_list_cached)
+      dir_list_sort(str_list, true);
 
    list_size = str_list->size;
 
    if (list_size == 0)
    {
-      string_list_free(str_list);
+      if (!str_list_cached)
+         string_list_free(str_list);
       str_list = NULL;
    }
    else
@@ -253,10 +540,16 @@ void filebrowser_parse(void *data, unsigned type_data)
       }
    }
 
-   if (str_list && str_list->size > 0)
+   if (str_list && str_list->size > 0 && !str_list_cached)
       string_list_free(str_list);
 
-   if (items_found == 0)
+   if (loading)
+      menu_entries_append_enum(info->list,
+            msg_hash_to_str(MSG_READING_DIRECTORY),
+            msg_hash_to_str(MENU_ENUM_LABEL_NO_ITEMS),
+            MENU_ENUM_LABEL_NO_ITEMS,
+            MENU_SETTING_NO_ITEM, 0, 0);
+   else if (items_found == 0)
    {
       menu_entries_append_enum(info->list,
             msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_ITEMS),
@@ -41,6 +41,8 @@ void filebrowser_set_type(enum filebrowser_enums type);
 
 void filebrowser_parse(void *data, unsigned type);
 
+void filebrowser_cache_free(void);
+
 RETRO_END_DECLS
 
 #endif
@@ -19,8 +19,10 @@
 
 #include <rhash.h>
 #include <compat/strl.h>
+#include <string/stdstring.h>
 #include <retro_endianness.h>
 #include <streams/file_stream.h>
+#include <streams/trans_stream.h>
 
 #include "configuration.h"
 #include "movie.h"
@@ -34,6 +36,40 @@
 #include "command.h"
 #include "file_path_special.h"
 
+/* BSV2 layout, all fields little-endian except the magic:
+ *
+ * header:  magic, version, content CRC, keyframe interval, state size,
+ *          reserved, u64 frame count, u64 index offset
+ * chunk:   u32 type, u32 payload size, u64 first frame, u32 frame count,
+ *          u32 raw size, u32 flags, data
+ *
+ * KEYF chunks hold the savestate taken before their frame runs,
+ * INPT chunks hold consecutive frames as a u32 word count followed by
+ * the int16 input words of that frame. The INDX chunk is written on
+ * close and lists every chunk; files that were never closed get their
+ * index rebuilt by scanning. */
+#define BSV2_VERSION              1
+#define BSV2_HEADER_SIZE          40
+#define BSV2_CHUNK_HEADER_SIZE    28
+#define BSV2_INDEX_ENTRY_SIZE     24
+#define BSV2_CHUNK_KEYFRAME       0x4659454B /* 'KEYF' */
+#define BSV2_CHUNK_INPUT          0x54504E49 /* 'INPT' */
+#define BSV2_CHUNK_INDEX          0x58444E49 /* 'INDX' */
+#define BSV2_FLAG_LZ4             1
+/* Input is flushed at every keyframe, or earlier once a block grows
+ * past this size. */
+#define BSV2_INPUT_BLOCK_SIZE     (64 * 1024)
+/* Used for conversion when recording is set to write BSV1. */
+#define BSV2_CONVERT_KEYFRAME_INTERVAL 600
+
+struct bsv_chunk_entry
+{
+   uint64_t frame;
+   uint64_t offset;
+   uint32_t type;
+   uint32_t frames;
+};
+
 struct bsv_movie
 {
    RFILE *file;
@@ -52,6 +88,42 @@ struct bsv_movie
    bool playback;
    bool first_rewind;
    bool did_rewind;
+
+   unsigned version;
+   uint32_t keyframe_interval;
+
+   /* BSV2 chunk list, in file order. */
+   struct bsv_chunk_entry *entries;
+   size_t num_entries;
+   size_t cap_entries;
+
+   /* Uncompressed input of the current block. */
+   uint8_t *block;
+   size_t block_size;
+   size_t block_cap;
+   size_t *frame_offsets;
+   size_t cap_frame_offsets;
+   uint64_t block_first_frame;
+   uint32_t block_frames;
+
+   /* Recording: offset of the word count of the frame in progress.
+    * Playback: read cursor and words left in the current frame. */
+   size_t frame_words_pos;
+   size_t block_pos;
+   uint32_t words_left;
+   long loaded_entry;
+
+   uint64_t frame;
+   uint64_t num_frames;
+
+   size_t state_cap;
+   uint8_t *comp;
+   size_t comp_cap;
+   void *compress_stream;
+   void *decompress_stream;
+
+   /* Re-records the movie being played back as BSV2. */
+   struct bsv_movie *convert;
 };
 
 struct bsv_state
@@ -63,14 +135,659 @@ struct bsv_state
 
    /* Immediate playback/recording. */
    char movie_start_path[PATH_MAX_LENGTH];
+   char movie_convert_path[PATH_MAX_LENGTH];
    bool movie_start_recording;
    bool movie_start_playback;
    bool movie_end;
+
+   /* Commands arrive while the core runs, seeks wait for
+    * the next frame. */
+   uint64_t movie_seek_frame;
+   bool movie_seek_pending;
 };
 
 static bsv_movie_t     *bsv_movie_state_handle = NULL;
 static struct bsv_state bsv_movie_state;
 
+static void bsv_store32(uint8_t *p, uint32_t val)
+{
+   val = swap_if_big32(val);
+   memcpy(p, &val, sizeof(val));
+}
+
+static void bsv_store64(uint8_t *p, uint64_t val)
+{
+   val = swap_if_big64(val);
+   memcpy(p, &val, sizeof(val));
+}
+
+static uint32_t bsv_load32(const uint8_t *p)
+{
+   uint32_t val;
+   memcpy(&val, p, sizeof(val));
+   return swap_if_big32(val);
+}
+
+static uint64_t bsv_load64(const uint8_t *p)
+{
+   uint64_t val;
+   memcpy(&val, p, sizeof(val));
+   return swap_if_big64(val);
+}
+
+static bool bsv_reserve(void **buf, size_t *cap, size_t size, size_t elem)
+{
+   void *tmp;
+   size_t new_cap;
+
+   if (size <= *cap)
+      return true;
+
+   new_cap = *cap * 2;
+   if (new_cap < size)
+      new_cap = size;
+
+   if (!(tmp = realloc(*buf, new_cap * elem)))
+      return false;
+
+   *buf = tmp;
+   *cap = new_cap;
+   return true;
+}
+
+static bool bsv_movie_add_entry(bsv_movie_t *handle, uint32_t type,
+      uint64_t frame, uint32_t frames, uint64_t offset)
+{
+   struct bsv_chunk_entry *entry = NULL;
+
+   if (!bsv_reserve((void**)&handle->entries, &handle->cap_entries,
+            handle->num_entries + 1, sizeof(*handle->entries)))
+      return false;
+
+   entry         = &handle->entries[handle->num_entries++];
+   entry->type   = type;
+   entry->frame  = frame;
+   entry->frames = frames;
+   entry->offset = offset;
+   return true;
+}
+
+static bool bsv_movie_write_header(bsv_movie_t *handle,
+      uint64_t index_offset)
+{
+   uint8_t header[BSV2_HEADER_SIZE] = {0};
+   uint32_t *content_crc_ptr        = NULL;
+   uint32_t magic                   = swap_if_little32(BSV2_MAGIC);
+
+   content_get_crc(&content_crc_ptr);
+
+   memcpy(header, &magic, sizeof(magic));
+   bsv_store32(header + 4,  BSV2_VERSION);
+   bsv_store32(header + 8,  *content_crc_ptr);
+   bsv_store32(header + 12, handle->keyframe_interval);
+   bsv_store32(header + 16, (uint32_t)handle->state_size);
+   bsv_store64(header + 24, handle->frame);
+   bsv_store64(header + 32, index_offset);
+
+   return filestream_write(handle->file, header, sizeof(header))
+      == sizeof(header);
+}
+
+/**
+ * bsv_movie_write_chunk:
+ * @handle             : movie handle, recording.
+ * @type               : BSV2_CHUNK_KEYFRAME or BSV2_CHUNK_INPUT.
+ * @frame              : first frame the chunk covers.
+ * @frames             : number of frames in the chunk.
+ * @data               : uncompressed payload.
+ * @size               : size of @data.
+ *
+ * Appends a chunk at the current file position, LZ4-compressed
+ * unless that does not make it smaller, and records it in the index.
+ *
+ * Returns: true if the whole chunk was written.
+ **/
+static bool bsv_movie_write_chunk(bsv_movie_t *handle, uint32_t type,
+      uint64_t frame, uint32_t frames, const uint8_t *data, size_t size)
+{
+   uint8_t head[BSV2_CHUNK_HEADER_SIZE];
+   uint32_t rd                  = 0;
+   uint32_t wn                  = 0;
+   uint32_t flags               = 0;
+   const uint8_t *out           = data;
+   size_t out_size              = size;
+   int64_t offset               = filestream_tell(handle->file);
+   const struct trans_stream_backend *backend =
+      trans_stream_get_lz4_compress_backend();
+   enum trans_stream_error err;
+
+   if (offset < 0)
+      return false;
+
+   if (size && bsv_reserve((void**)&handle->comp, &handle->comp_cap,
+            TRANS_STREAM_LZ4_BOUND(size), 1))
+   {
+      backend->set_in(handle->compress_stream, data, (uint32_t)size);
+      backend->set_out(handle->compress_stream, handle->comp,
+            (uint32_t)handle->comp_cap);
+
+      if (backend->trans(handle->compress_stream, true, &rd, &wn, &err)
+            && rd == size && wn < size)
+      {
+         out      = handle->comp;
+         out_size = wn;
+         flags    = BSV2_FLAG_LZ4;
+      }
+   }
+
+   bsv_store32(head,      type);
+   bsv_store32(head + 4,  (uint32_t)(BSV2_CHUNK_HEADER_SIZE - 8 + out_size));
+   bsv_store64(head + 8,  frame);
+   bsv_store32(head + 16, frames);
+   bsv_store32(head + 20, (uint32_t)size);
+   bsv_store32(head + 24, flags);
+
+   if (filestream_write(handle->file, head, sizeof(head)) != sizeof(head))
+      return false;
+   if (out_size && filestream_write(handle->file, out, out_size)
+         != (ssize_t)out_size)
+      return false;
+
+   return bsv_movie_add_entry(handle, type, frame, frames, offset);
+}
+
+/**
+ * bsv_movie_read_chunk:
+ * @handle             : movie handle.
+ * @entry              : chunk to read.
+ * @buf                : buffer to decompress into, grown as needed.
+ * @cap                : capacity of @buf.
+ * @size               : uncompressed size of the chunk.
+ *
+ * Returns: true if the chunk was read and decompressed.
+ **/
+static bool bsv_movie_read_chunk(bsv_movie_t *handle,
+      const struct bsv_chunk_entry *entry,
+      uint8_t **buf, size_t *cap, size_t *size)
+{
+   uint8_t head[BSV2_CHUNK_HEADER_SIZE];
+   uint32_t payload, raw_size, flags;
+
+   if (filestream_seek(handle->file, entry->offset, SEEK_SET) != 0
+         || filestream_read(handle->file, head, sizeof(head))
+         != sizeof(head)
+         || bsv_load32(head) != entry->type)
+      return false;
+
+   payload  = bsv_load32(head + 4);
+   raw_size = bsv_load32(head + 20);
+   flags    = bsv_load32(head + 24);
+
+   if (payload < BSV2_CHUNK_HEADER_SIZE - 8)
+      return false;
+   payload -= BSV2_CHUNK_HEADER_SIZE - 8;
+
+   if (!bsv_reserve((void**)buf, cap, raw_size ? raw_size : 1, 1))
+      return false;
+
+   if (flags & BSV2_FLAG_LZ4)
+   {
+      uint32_t rd = 0;
+      uint32_t wn = 0;
+      enum trans_stream_error err;
+      const struct trans_stream_backend *backend =
+         trans_stream_get_lz4_decompress_backend();
+
+      if (!handle->decompress_stream)
+         handle->decompress_stream = backend->stream_new();
+
+      if (!handle->decompress_stream
+            || !bsv_reserve((void**)&handle->comp, &handle->comp_cap,
+               payload ? payload : 1, 1)
+            || filestream_read(handle->file, handle->comp, payload)
+            != (ssize_t)payload)
+         return false;
+
+      backend->set_in(handle->decompress_stream, handle->comp, payload);
+      backend->set_out(handle->decompress_stream, *buf, raw_size);
+
+      if (!backend->trans(handle->decompress_stream, true, &rd, &wn, &err)
+            || wn != raw_size)
+         return false;
+   }
+   else if (payload != raw_size
+         || filestream_read(handle->file, *buf, raw_size)
+         != (ssize_t)raw_size)
+      return false;
+
+   *size = raw_size;
+   return true;
+}
+
+static bool bsv_movie_write_keyframe(bsv_movie_t *handle)
+{
+   retro_ctx_serialize_info_t serial_info;
+
+   serial_info.data = handle->state;
+   serial_info.size = handle->state_size;
+
+   if (!core_serialize(&serial_info))
+      return false;
+
+   return bsv_movie_write_chunk(handle, BSV2_CHUNK_KEYFRAME,
+         handle->frame, 0, handle->state, handle->state_size);
+}
+
+static bool bsv_movie_flush_input(bsv_movie_t *handle)
+{
+   bool ret = true;
+
+   if (handle->block_frames)
+      ret = bsv_movie_write_chunk(handle, BSV2_CHUNK_INPUT,
+            handle->block_first_frame, handle->block_frames,
+            handle->block, handle->block_size);
+
+   handle->block_first_frame += handle->block_frames;
+   handle->block_frames       = 0;
+   handle->block_size         = 0;
+   return ret;
+}
+
+static bool bsv_movie_begin_frame(bsv_movie_t *handle)
+{
+   if (!bsv_reserve((void**)&handle->block, &handle->block_cap,
+            handle->block_size + 4, 1)
+         || !bsv_reserve((void**)&handle->frame_offsets,
+            &handle->cap_frame_offsets, handle->block_frames + 1,
+            sizeof(*handle->frame_offsets)))
+      return false;
+
+   handle->frame_offsets[handle->block_frames] = handle->block_size;
+   handle->frame_words_pos                     = handle->block_size;
+   bsv_store32(handle->block + handle->block_size, 0);
+   handle->block_size                         += 4;
+   return true;
+}
+
+static void bsv_movie_put_input(bsv_movie_t *handle, int16_t val)
+{
+   uint16_t word = swap_if_big16((uint16_t)val);
+
+   if (!bsv_reserve((void**)&handle->block, &handle->block_cap,
+            handle->block_size + sizeof(word), 1))
+      return;
+
+   memcpy(handle->block + handle->block_size, &word, sizeof(word));
+   handle->block_size += sizeof(word);
+   bsv_store32(handle->block + handle->frame_words_pos,
+         bsv_load32(handle->block + handle->frame_words_pos) + 1);
+}
+
+static void bsv_movie_record_frame_end(bsv_movie_t *handle)
+{
+   handle->frame++;
+   handle->block_frames++;
+
+   if (handle->frame % handle->keyframe_interval == 0)
+   {
+      if (!bsv_movie_flush_input(handle) || !bsv_movie_write_keyframe(handle))
+         RARCH_WARN("Could not write movie keyframe %u.\n",
+               (unsigned)handle->frame);
+   }
+   else if (handle->block_size >= BSV2_INPUT_BLOCK_SIZE)
+      bsv_movie_flush_input(handle);
+
+   bsv_movie_begin_frame(handle);
+}
+
+/* Drops recorded input from frame @frame onwards, reloading an
+ * already written input block if the frame lies before the one
+ * in memory. The file is overwritten from that block on. */
+static bool bsv_movie_record_truncate(bsv_movie_t *handle, uint64_t frame)
+{
+   if (frame < handle->block_first_frame)
+   {
+      size_t i, size;
+      size_t pos                    = 0;
+      struct bsv_chunk_entry *entry = NULL;
+
+      for (i = handle->num_entries; i-- > 0; )
+      {
+         if (handle->entries[i].type == BSV2_CHUNK_INPUT
+               && handle->entries[i].frame <= frame)
+         {
+            entry = &handle->entries[i];
+            break;
+         }
+      }
+
+      if (!entry || !bsv_movie_read_chunk(handle, entry,
+               &handle->block, &handle->block_cap, &size)
+            || !bsv_reserve((void**)&handle->frame_offsets,
+               &handle->cap_frame_offsets, entry->frames + 1,
+               sizeof(*handle->frame_offsets)))
+         return false;
+
+      for (handle->block_frames = 0; handle->block_frames < entry->frames;
+            handle->block_frames++)
+      {
+         if (pos + 4 > size)
+            return false;
+         handle->frame_offsets[handle->block_frames] = pos;
+         pos += 4 + (size_t)bsv_load32(handle->block + pos) * 2;
+      }
+
+      handle->block_first_frame = entry->frame;
+      handle->block_size        = size;
+      filestream_seek(handle->file, entry->offset, SEEK_SET);
+
+      /* The keyframe preceding this block stays, everything
+       * written after it is dropped. */
+      handle->num_entries       = i;
+   }
+
+   handle->block_frames = (uint32_t)(frame - handle->block_first_frame);
+   handle->block_size   = handle->frame_offsets[handle->block_frames];
+   handle->frame        = frame;
+   return bsv_movie_begin_frame(handle);
+}
+
+static void bsv_movie_finish_record(bsv_movie_t *handle)
+{
+   size_t i;
+   int64_t index_offset;
+   uint8_t *index = NULL;
+
+   /* The frame in progress never finished, drop it. */
+   handle->block_size = handle->frame_words_pos;
+   bsv_movie_flush_input(handle);
+
+   index_offset = filestream_tell(handle->file);
+   index        = (uint8_t*)malloc(8 + handle->num_entries
+         * BSV2_INDEX_ENTRY_SIZE);
+
+   if (index_offset < 0 || !index)
+   {
+      free(index);
+      return;
+   }
+
+   bsv_store32(index,     BSV2_CHUNK_INDEX);
+   bsv_store32(index + 4, (uint32_t)(handle->num_entries
+            * BSV2_INDEX_ENTRY_SIZE));
+
+   for (i = 0; i < handle->num_entries; i++)
+   {
+      uint8_t *p = index + 8 + i * BSV2_INDEX_ENTRY_SIZE;
+      bsv_store32(p,      handle->entries[i].type);
+      bsv_store32(p + 4,  handle->entries[i].frames);
+      bsv_store64(p + 8,  handle->entries[i].frame);
+      bsv_store64(p + 16, handle->entries[i].offset);
+   }
+
+   if (filestream_write(handle->file, index, 8 + handle->num_entries
+            * BSV2_INDEX_ENTRY_SIZE)
+         == (ssize_t)(8 + handle->num_entries * BSV2_INDEX_ENTRY_SIZE)
+         && filestream_seek(handle->file, 0, SEEK_SET) == 0)
+      bsv_movie_write_header(handle, (uint64_t)index_offset);
+
+   free(index);
+}
+
+static bool bsv2_movie_init_record(bsv_movie_t *handle, const char *path,
+      unsigned keyframe_interval, size_t state_size)
+{
+   handle->file              = filestream_open(path,
+         RFILE_MODE_READ_WRITE, -1);
+
+   if (!handle->file)
+   {
+      RARCH_ERR("Could not open BSV file for recording, path : \"%s\".\n", path);
+      return false;
+   }
+
+   handle->version           = 2;
+   handle->keyframe_interval = keyframe_interval;
+   handle->state_size        = state_size;
+   handle->state             = (uint8_t*)malloc(state_size);
+   handle->compress_stream   =
+      trans_stream_get_lz4_compress_backend()->stream_new();
+
+   if (!handle->state || !handle->compress_stream)
+      return false;
+
+   return bsv_movie_write_header(handle, 0)
+      && bsv_movie_write_keyframe(handle)
+      && bsv_movie_begin_frame(handle);
+}
+
+/* Rebuilds the chunk list of a movie that was never closed. Stops
+ * at the first chunk that is cut off or out of sequence. */
+static void bsv_movie_scan_chunks(bsv_movie_t *handle)
+{
+   int64_t file_size;
+   uint64_t next_frame = 0;
+   uint64_t pos        = BSV2_HEADER_SIZE;
+
+   filestream_seek(handle->file, 0, SEEK_END);
+   file_size = filestream_tell(handle->file);
+
+   while (pos + BSV2_CHUNK_HEADER_SIZE <= (uint64_t)file_size)
+   {
+      uint8_t head[BSV2_CHUNK_HEADER_SIZE];
+      uint32_t type, payload, frames;
+      uint64_t frame;
+
+      if (filestream_seek(handle->file, pos, SEEK_SET) != 0
+            || filestream_read(handle->file, head, sizeof(head))
+            != sizeof(head))
+         break;
+
+      type    = bsv_load32(head);
+      payload = bsv_load32(head + 4);
+      frame   = bsv_load64(head + 8);
+      frames  = bsv_load32(head + 16);
+
+      if (     (type != BSV2_CHUNK_KEYFRAME && type != BSV2_CHUNK_INPUT)
+            || frame != next_frame
+            || pos + 8 + payload > (uint64_t)file_size
+            || !bsv_movie_add_entry(handle, type, frame, frames, pos))
+         break;
+
+      if (type == BSV2_CHUNK_INPUT)
+         next_frame += frames;
+      pos += 8 + payload;
+   }
+}
+
+static bool bsv_movie_read_index(bsv_movie_t *handle, uint64_t offset)
+{
+   size_t i, count;
+   uint8_t head[8];
+   uint8_t *index = NULL;
+
+   if (filestream_seek(handle->file, offset, SEEK_SET) != 0
+         || filestream_read(handle->file, head, sizeof(head))
+         != sizeof(head)
+         || bsv_load32(head) != BSV2_CHUNK_INDEX)
+      return false;
+
+   count = bsv_load32(head + 4) / BSV2_INDEX_ENTRY_SIZE;
+   if (!(index = (uint8_t*)malloc(count * BSV2_INDEX_ENTRY_SIZE + 1)))
+      return false;
+
+   if (filestream_read(handle->file, index, count * BSV2_INDEX_ENTRY_SIZE)
+         != (ssize_t)(count * BSV2_INDEX_ENTRY_SIZE))
+   {
+      free(index);
+      return false;
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      const uint8_t *p = index + i * BSV2_INDEX_ENTRY_SIZE;
+      if (!bsv_movie_add_entry(handle, bsv_load32(p), bsv_load64(p + 8),
+               bsv_load32(p + 4), bsv_load64(p + 16)))
+         break;
+   }
+
+   free(index);
+   return i == count;
+}
+
+/**
+ * bsv_movie_position:
+ * @handle             : movie handle, playing back.
+ * @frame              : frame to continue playback from.
+ *
+ * Points the input reader at the start of @frame, loading
+ * the input block that holds it.
+ *
+ * Returns: true on success.
+ **/
+static bool bsv_movie_position(bsv_movie_t *handle, uint64_t frame)
+{
+   size_t i, size;
+   uint64_t skip;
+   size_t pos = 0;
+
+   handle->frame      = frame;
+   handle->words_left = 0;
+
+   if (frame >= handle->num_frames)
+      return true;
+
+   for (i = handle->num_entries; i-- > 0; )
+      if (handle->entries[i].type == BSV2_CHUNK_INPUT
+            && handle->entries[i].frame <= frame)
+         break;
+
+   if (i == (size_t)-1)
+      return false;
+
+   if (handle->loaded_entry != (long)i)
+   {
+      handle->loaded_entry = -1;
+      if (!bsv_movie_read_chunk(handle, &handle->entries[i],
+               &handle->block, &handle->block_cap, &size))
+         return false;
+      handle->loaded_entry      = (long)i;
+      handle->block_size        = size;
+      handle->block_first_frame = handle->entries[i].frame;
+      handle->block_frames      = handle->entries[i].frames;
+   }
+
+   for (skip = frame - handle->block_first_frame; ; skip--)
+   {
+      uint32_t words;
+
+      if (pos + 4 > handle->block_size)
+         return false;
+
+      words = bsv_load32(handle->block + pos);
+      if ((uint64_t)words * 2 > handle->block_size - pos - 4)
+         return false;
+
+      if (!skip)
+      {
+         handle->block_pos  = pos + 4;
+         handle->words_left = words;
+         return true;
+      }
+
+      pos += 4 + (size_t)words * 2;
+   }
+}
+
+static void bsv_movie_playback_frame_end(bsv_movie_t *handle)
+{
+   uint64_t next = handle->frame + 1;
+   size_t pos    = handle->block_pos + (size_t)handle->words_left * 2;
+
+   if (next < handle->num_frames
+         && next < handle->block_first_frame + handle->block_frames
+         && pos + 4 <= handle->block_size)
+   {
+      uint32_t words = bsv_load32(handle->block + pos);
+
+      if ((uint64_t)words * 2 <= handle->block_size - pos - 4)
+      {
+         handle->frame      = next;
+         handle->block_pos  = pos + 4;
+         handle->words_left = words;
+         return;
+      }
+   }
+
+   if (!bsv_movie_position(handle, next))
+   {
+      RARCH_ERR("Movie input for frame %u is corrupt.\n", (unsigned)next);
+      handle->num_frames = next;
+      handle->frame      = next;
+      handle->words_left = 0;
+   }
+}
+
+static bool bsv2_movie_init_playback(bsv_movie_t *handle,
+      const uint8_t *header)
+{
+   size_t i, size;
+   retro_ctx_size_info_t info;
+   uint64_t index_offset     = bsv_load64(header + 32);
+   uint32_t *content_crc_ptr = NULL;
+
+   handle->version           = 2;
+   handle->loaded_entry      = -1;
+   handle->keyframe_interval = bsv_load32(header + 12);
+
+   content_get_crc(&content_crc_ptr);
+
+   if (bsv_load32(header + 8) != *content_crc_ptr)
+      RARCH_WARN("%s.\n", msg_hash_to_str(MSG_CRC32_CHECKSUM_MISMATCH));
+
+   if (!index_offset || !bsv_movie_read_index(handle, index_offset))
+   {
+      RARCH_WARN("Movie was not closed properly, rebuilding its index.\n");
+      handle->num_entries = 0;
+      bsv_movie_scan_chunks(handle);
+   }
+
+   for (i = 0; i < handle->num_entries; i++)
+      if (handle->entries[i].type == BSV2_CHUNK_INPUT)
+         handle->num_frames = handle->entries[i].frame
+            + handle->entries[i].frames;
+
+   if (!handle->num_entries
+         || handle->entries[0].type != BSV2_CHUNK_KEYFRAME
+         || !bsv_movie_read_chunk(handle, &handle->entries[0],
+            &handle->state, &handle->state_cap, &size))
+   {
+      RARCH_ERR("%s\n", msg_hash_to_str(MSG_COULD_NOT_READ_STATE_FROM_MOVIE));
+      return false;
+   }
+
+   handle->state_size = size;
+
+   core_serialize_size(&info);
+
+   if (info.size == size)
+   {
+      retro_ctx_serialize_info_t serial_info;
+
+      serial_info.data_const = handle->state;
+      serial_info.size       = size;
+      core_unserialize(&serial_info);
+   }
+   else
+      RARCH_WARN("%s\n",
+            msg_hash_to_str(MSG_MOVIE_FORMAT_DIFFERENT_SERIALIZER_VERSION));
+
+   RARCH_LOG("Movie has %u frames, keyframe every %u frames.\n",
+         (unsigned)handle->num_frames, handle->keyframe_interval);
+
+   return bsv_movie_position(handle, 0);
+}
+
 static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
 {
    uint32_t state_size;
@@ -86,13 +803,30 @@ static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
 
    handle->file              = file;
    handle->playback          = true;
+   handle->version           = 1;
 
-   if (filestream_read(handle->file, header, 4) != 4)
+   if (filestream_read(handle->file, header, sizeof(header)) != sizeof(header))
    {
       RARCH_ERR("%s\n", msg_hash_to_str(MSG_COULD_NOT_READ_MOVIE_HEADER));
       return false;
    }
 
+   if (swap_if_little32(header[MAGIC_INDEX]) == BSV2_MAGIC)
+   {
+      uint8_t header2[BSV2_HEADER_SIZE];
+
+      memcpy(header2, header, sizeof(header));
+      if (filestream_read(handle->file, header2 + sizeof(header),
+               sizeof(header2) - sizeof(header))
+            != sizeof(header2) - sizeof(header))
+      {
+         RARCH_ERR("%s\n", msg_hash_to_str(MSG_COULD_NOT_READ_MOVIE_HEADER));
+         return false;
+      }
+
+      return bsv2_movie_init_playback(handle, header2);
+   }
+
    /* Compatibility with old implementation that
     * used incorrect documentation. */
    if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
@@ -145,13 +879,23 @@ static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
    return true;
 }
 
-static bool bsv_movie_init_record(bsv_movie_t *handle, const char *path)
+static bool bsv_movie_init_record(bsv_movie_t *handle, const char *path,
+      unsigned keyframe_interval)
 {
    retro_ctx_size_info_t info;
    uint32_t state_size;
    uint32_t header[4]        = {0};
    uint32_t *content_crc_ptr = NULL;
-   RFILE *file               = filestream_open(path, RFILE_MODE_WRITE, -1);
+   RFILE *file               = NULL;
+
+   core_serialize_size(&info);
+
+   /* Keyframes need savestates, without them stay with BSV1. */
+   if (keyframe_interval && info.size)
+      return bsv2_movie_init_record(handle, path,
+            keyframe_interval, info.size);
+
+   file                      = filestream_open(path, RFILE_MODE_WRITE, -1);
 
    if (!file)
    {
@@ -160,6 +904,7 @@ static bool bsv_movie_init_record(bsv_movie_t *handle, const char *path)
    }
 
    handle->file              = file;
+   handle->version           = 1;
 
    content_get_crc(&content_crc_ptr);
 
@@ -168,13 +913,11 @@ static bool bsv_movie_init_record(bsv_movie_t *handle, const char *path)
    header[MAGIC_INDEX]      = swap_if_little32(BSV_MAGIC);
    header[CRC_INDEX]        = swap_if_big32(*content_crc_ptr);
 
-   core_serialize_size(&info);
-
    state_size               = (unsigned)info.size;
 
    header[STATE_SIZE_INDEX] = swap_if_big32(state_size);
 
-   filestream_write(handle->file, header, sizeof(uint32_t));
+   filestream_write(handle->file, header, sizeof(header));
 
    handle->min_file_pos     = sizeof(header) + state_size;
    handle->state_size       = state_size;
@@ -203,18 +946,40 @@ static void bsv_movie_free(bsv_movie_t *handle)
    if (!handle)
       return;
 
+   if (handle->convert)
+   {
+      RARCH_LOG("Converted %u movie frames.\n",
+            (unsigned)handle->convert->frame);
+      bsv_movie_free(handle->convert);
+   }
+
+   if (handle->version == 2 && !handle->playback && handle->file)
+      bsv_movie_finish_record(handle);
+
    filestream_close(handle->file);
 
+   if (handle->compress_stream)
+      trans_stream_get_lz4_compress_backend()->stream_free(
+            handle->compress_stream);
+   if (handle->decompress_stream)
+      trans_stream_get_lz4_decompress_backend()->stream_free(
+            handle->decompress_stream);
+
    free(handle->state);
    free(handle->frame_pos);
+   free(handle->entries);
+   free(handle->block);
+   free(handle->frame_offsets);
+   free(handle->comp);
    free(handle);
 }
 
 static bsv_movie_t *bsv_movie_init(const char *path,
       enum rarch_movie_type type)
 {
-   size_t *frame_pos   = NULL;
-   bsv_movie_t *handle = (bsv_movie_t*)calloc(1, sizeof(*handle));
+   size_t *frame_pos    = NULL;
+   settings_t *settings = config_get_ptr();
+   bsv_movie_t *handle  = (bsv_movie_t*)calloc(1, sizeof(*handle));
 
    if (!handle)
       return NULL;
@@ -223,10 +988,31 @@ static bsv_movie_t *bsv_movie_init(const char *path,
    {
       if (!bsv_movie_init_playback(handle, path))
          goto error;
+
+      if (!string_is_empty(bsv_movie_state.movie_convert_path))
+      {
+         handle->convert = (bsv_movie_t*)calloc(1, sizeof(*handle));
+
+         if (!handle->convert || !bsv_movie_init_record(handle->convert,
+                  bsv_movie_state.movie_convert_path,
+                  settings->movie_keyframe_interval
+                  ? settings->movie_keyframe_interval
+                  : BSV2_CONVERT_KEYFRAME_INTERVAL)
+               || handle->convert->version != 2)
+         {
+            RARCH_ERR("Could not convert movie to \"%s\".\n",
+                  bsv_movie_state.movie_convert_path);
+            goto error;
+         }
+      }
    }
-   else if (!bsv_movie_init_record(handle, path))
+   else if (!bsv_movie_init_record(handle, path,
+            settings->movie_keyframe_interval))
       goto error;
 
+   if (handle->version == 2)
+      return handle;
+
    /* Just pick something really large 
     * ~1 million frames rewind should do the trick. */
    if (!(frame_pos = (size_t*)calloc((1 << 20), sizeof(size_t))))
@@ -244,10 +1030,79 @@ error:
    return NULL;
 }
 
+/**
+ * bsv_movie_seek:
+ * @handle             : movie handle, playing back BSV2.
+ * @frame              : frame to seek to.
+ *
+ * Loads the closest keyframe at or before @frame and runs the core
+ * up to @frame with video and audio output discarded.
+ *
+ * Returns: true on success.
+ **/
+static bool bsv_movie_seek(bsv_movie_t *handle, uint64_t frame)
+{
+   size_t i, size;
+   retro_ctx_serialize_info_t serial_info;
+   struct bsv_chunk_entry *keyframe = NULL;
+
+   if (!handle || !handle->playback || handle->version != 2)
+      return false;
+
+   if (frame > handle->num_frames)
+      frame = handle->num_frames;
+
+   for (i = 0; i < handle->num_entries; i++)
+      if (handle->entries[i].type == BSV2_CHUNK_KEYFRAME
+            && handle->entries[i].frame <= frame)
+         keyframe = &handle->entries[i];
+
+   if (!keyframe || !bsv_movie_read_chunk(handle, keyframe,
+            &handle->state, &handle->state_cap, &size))
+      return false;
+
+   handle->state_size     = size;
+   serial_info.data_const = handle->state;
+   serial_info.size       = size;
+
+   if (!core_unserialize(&serial_info)
+         || !bsv_movie_position(handle, keyframe->frame))
+      return false;
+
+   RARCH_LOG("Seeking movie to frame %u from keyframe %u.\n",
+         (unsigned)frame, (unsigned)keyframe->frame);
+
+   core_set_hidden_frame_callbacks(true, true);
+
+   while (handle->frame < frame)
+   {
+      core_run();
+      bsv_movie_playback_frame_end(handle);
+   }
+
+   core_set_hidden_frame_callbacks(false, false);
+
+   /* States recorded before the seek no longer line up. */
+   handle->first_rewind = true;
+   handle->did_rewind   = false;
+   command_event(CMD_EVENT_REWIND_DEINIT, NULL);
+   command_event(CMD_EVENT_REWIND_INIT, NULL);
+
+   bsv_movie_state.movie_end = false;
+   return true;
+}
+
 /* Used for rewinding while playback/record. */
 void bsv_movie_set_frame_start(void)
 {
-   if (bsv_movie_state_handle)
+   if (bsv_movie_state.movie_seek_pending)
+   {
+      bsv_movie_state.movie_seek_pending = false;
+      bsv_movie_seek(bsv_movie_state_handle,
+            bsv_movie_state.movie_seek_frame);
+   }
+
+   if (bsv_movie_state_handle && bsv_movie_state_handle->version == 1)
       bsv_movie_state_handle->frame_pos[bsv_movie_state_handle->frame_ptr] 
          = filestream_tell(bsv_movie_state_handle->file);
 }
@@ -257,8 +1112,19 @@ void bsv_movie_set_frame_end(void)
    if (!bsv_movie_state_handle)
       return;
 
-   bsv_movie_state_handle->frame_ptr    = 
-      (bsv_movie_state_handle->frame_ptr + 1) & bsv_movie_state_handle->frame_mask;
+   if (bsv_movie_state_handle->convert)
+      bsv_movie_record_frame_end(bsv_movie_state_handle->convert);
+
+   if (bsv_movie_state_handle->version == 2)
+   {
+      if (bsv_movie_state_handle->playback)
+         bsv_movie_playback_frame_end(bsv_movie_state_handle);
+      else
+         bsv_movie_record_frame_end(bsv_movie_state_handle);
+   }
+   else
+      bsv_movie_state_handle->frame_ptr    = 
+         (bsv_movie_state_handle->frame_ptr + 1) & bsv_movie_state_handle->frame_mask;
 
    bsv_movie_state_handle->first_rewind = 
       !bsv_movie_state_handle->did_rewind;
@@ -267,8 +1133,26 @@ void bsv_movie_set_frame_end(void)
 
 static void bsv_movie_frame_rewind(bsv_movie_t *handle)
 {
+   /* Same frame arithmetic as the BSV1 ring buffer below. */
+   uint64_t back      = handle->first_rewind ? 1 : 2;
+
    handle->did_rewind = true;
 
+   if (handle->convert)
+      bsv_movie_record_truncate(handle->convert,
+            handle->convert->frame > back ? handle->convert->frame - back : 0);
+
+   if (handle->version == 2)
+   {
+      uint64_t frame = handle->frame > back ? handle->frame - back : 0;
+
+      if (handle->playback)
+         bsv_movie_position(handle, frame);
+      else
+         bsv_movie_record_truncate(handle, frame);
+      return;
+   }
+
    if (     (handle->frame_ptr <= 1) 
          && (handle->frame_pos[0] == handle->min_file_pos))
    {
@@ -365,10 +1249,36 @@ static void bsv_movie_init_state(void)
 
 bool bsv_movie_get_input(int16_t *bsv_data)
 {
-   if (filestream_read(bsv_movie_state_handle->file, bsv_data, 1) != 1)
-      return false;
+   bsv_movie_t *handle = bsv_movie_state_handle;
+
+   if (handle->version == 2)
+   {
+      uint16_t word = 0;
 
-   *bsv_data = swap_if_big16(*bsv_data);
+      if (handle->frame >= handle->num_frames)
+         return false;
+
+      /* A core polling more often than while recording gets zeros. */
+      if (handle->words_left)
+      {
+         memcpy(&word, handle->block + handle->block_pos, sizeof(word));
+         handle->block_pos += sizeof(word);
+         handle->words_left--;
+      }
+
+      *bsv_data = (int16_t)swap_if_big16(word);
+   }
+   else
+   {
+      if (filestream_read(handle->file, bsv_data, sizeof(*bsv_data))
+            != sizeof(*bsv_data))
+         return false;
+
+      *bsv_data = swap_if_big16(*bsv_data);
+   }
+
+   if (handle->convert)
+      bsv_movie_put_input(handle->convert, *bsv_data);
 
    return true;
 }
@@ -422,7 +1332,8 @@ bool bsv_movie_ctl(enum bsv_ctl_state state, void *data)
       case BSV_MOVIE_CTL_DEINIT:
          if (bsv_movie_state_handle)
             bsv_movie_free(bsv_movie_state_handle);
-         bsv_movie_state_handle = NULL;
+         bsv_movie_state_handle             = NULL;
+         bsv_movie_state.movie_seek_pending = false;
          break;
       case BSV_MOVIE_CTL_INIT:
          bsv_movie_init_state();
@@ -434,9 +1345,27 @@ bool bsv_movie_ctl(enum bsv_ctl_state state, void *data)
          {
             int16_t *bsv_data = (int16_t*)data;
 
-            *bsv_data = swap_if_big16(*bsv_data);
-            filestream_write(bsv_movie_state_handle->file, bsv_data, 1);
+            if (bsv_movie_state_handle->version == 2)
+               bsv_movie_put_input(bsv_movie_state_handle, *bsv_data);
+            else
+            {
+               int16_t word = swap_if_big16(*bsv_data);
+               filestream_write(bsv_movie_state_handle->file,
+                     &word, sizeof(word));
+            }
+         }
+         break;
+      case BSV_MOVIE_CTL_SEEK:
+         if (     !bsv_movie_state_handle
+               || !bsv_movie_state_handle->playback
+               || bsv_movie_state_handle->version != 2
+               || bsv_movie_state_handle->convert)
+         {
+            RARCH_WARN("Seeking needs a BSV2 movie being played back.\n");
+            return false;
          }
+         bsv_movie_state.movie_seek_frame   = *(uint64_t*)data;
+         bsv_movie_state.movie_seek_pending = true;
          break;
       case BSV_MOVIE_CTL_NONE:
       default:
@@ -458,6 +1387,12 @@ void bsv_movie_set_start_path(const char *path)
          sizeof(bsv_movie_state.movie_start_path));
 }
 
+void bsv_movie_set_convert_path(const char *path)
+{
+   strlcpy(bsv_movie_state.movie_convert_path, path,
+         sizeof(bsv_movie_state.movie_convert_path));
+}
+
 bool bsv_movie_init_handle(const char *path,
       enum rarch_movie_type type)
 {
@@ -26,6 +26,7 @@
 RETRO_BEGIN_DECLS
 
 #define BSV_MAGIC          0x42535631
+#define BSV2_MAGIC         0x42535632
 
 #define MAGIC_INDEX        0
 #define SERIALIZER_INDEX   1
@@ -58,7 +59,9 @@ enum bsv_ctl_state
    BSV_MOVIE_CTL_END_EOF,
    BSV_MOVIE_CTL_SET_END_EOF,
    BSV_MOVIE_CTL_SET_END,
-   BSV_MOVIE_CTL_UNSET_END
+   BSV_MOVIE_CTL_UNSET_END,
+   /* Seeks a BSV2 playback to the frame in the uint64_t data. */
+   BSV_MOVIE_CTL_SEEK
 };
 
 bool bsv_movie_is_playback_on(void);
@@ -69,6 +72,8 @@ void bsv_movie_set_path(const char *path);
 
 void bsv_movie_set_start_path(const char *path);
 
+void bsv_movie_set_convert_path(const char *path);
+
 void bsv_movie_set_frame_start(void);
 
 void bsv_movie_set_frame_end(void);
@@ -300,6 +300,7 @@ enum msg_hash_enums
    MSG_TAKING_SCREENSHOT,
    MSG_WIFI_SCAN_COMPLETE,
    MSG_SCANNING_WIRELESS_NETWORKS,
+   MSG_READING_DIRECTORY,
    MSG_FAILED_TO_TAKE_SCREENSHOT,
    MSG_CUSTOM_TIMING_GIVEN,
    MSG_SAVING_STATE,
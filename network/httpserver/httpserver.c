@@ -23,17 +23,37 @@
 #include <civetweb/civetweb.h>
 #include <string/stdstring.h>
 #include <compat/zlib.h>
+#include <compat/posix_string.h>
+#include <retro_miscellaneous.h>
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
 
+#include "../../configuration.h"
 #include "../../core.h"
+#include "../../paths.h"
 #include "../../runloop.h"
-#include "../../core.h"
 #include "../../gfx/video_driver.h"
 #include "../../managers/core_option_manager.h"
 #include "../../cheevos/cheevos.h"
 #include "../../content.h"
 
+#include "httpserver.h"
+
 #define BASIC_INFO "info"
 #define MEMORY_MAP "memoryMap"
+#define MEMORY_WATCH "memoryWatch"
+
+/* Limits for memory watches: subscriptions, regions per
+ * subscription and bytes watched by one subscription. */
+#define MEMORY_WATCH_MAX          16
+#define MEMORY_WATCH_MAX_REGIONS  32
+#define MEMORY_WATCH_MAX_SIZE     (16 * 1024 * 1024)
+/* Deltas are made of runs of changed blocks of this many bytes. */
+#define MEMORY_WATCH_BLOCK        32
+/* Watches not polled for this long are dropped, in microseconds. */
+#define MEMORY_WATCH_EXPIRE       (30 * 1000000)
+/* Longest a poll waits for the next frame, in milliseconds. */
+#define MEMORY_WATCH_MAX_TIMEOUT  10000
 
 static struct mg_callbacks s_httpserver_callbacks;
 static struct mg_context   *s_httpserver_ctx       = NULL;
@@ -64,9 +84,9 @@ static void httpserver_z85_encode_inplace(Bytef* data, size_t size)
    {
       do
       {
-         value  = source[0] * 256 * 256 * 256;
-         value += source[1] * 256 * 256;
-         value += source[2] * 256;
+         value  = (uLong)source[0] << 24;
+         value += (uLong)source[1] << 16;
+         value += (uLong)source[2] << 8;
          value += source[3];
          source -= 4;
 
@@ -128,10 +148,22 @@ static int httpserver_error(struct mg_connection* conn, unsigned code, const cha
          reason = "Not Found";
          break;
 
+      case 400:
+         reason = "Bad Request";
+         break;
+
       case 405:
          reason = "Method Not Allowed";
          break;
 
+      case 409:
+         reason = "Conflict";
+         break;
+
+      case 503:
+         reason = "Service Unavailable";
+         break;
+
       default:
          /* Send unknown codes as 500 */
          code = 500;
@@ -163,6 +195,8 @@ static int httpserver_handle_basic_info(struct mg_connection* conn, void* cbdata
    };
 
    unsigned p, q, r;
+   bool contentless                                = false;
+   bool is_inited                                  = false;
    retro_ctx_api_info_t api;
    retro_ctx_region_info_t region;
    retro_ctx_memory_info_t sram;
@@ -189,7 +223,9 @@ static int httpserver_handle_basic_info(struct mg_connection* conn, void* cbdata
    if (!core_is_game_loaded())
       return httpserver_error(conn, 500, "Game not loaded in %s", __FUNCTION__);
 
-   json_string_encode(core_path, sizeof(core_path), config_get_active_core_path());
+   json_string_encode(core_path, sizeof(core_path), path_get(RARCH_PATH_CORE));
+
+   content_get_status(&contentless, &is_inited);
 
    core_api_version(&api);
    core_get_region(&region);
@@ -262,7 +298,7 @@ static int httpserver_handle_basic_info(struct mg_connection* conn, void* cbdata
       pixel_format,
       system->rotation,
       system->performance_level,
-      content_does_not_need_content() ? "true" : "false",
+      contentless ? "true" : "false",
 #ifdef HAVE_CHEEVOS
       cheevos_get_support_cheevos() ? "true" : "false",
 #endif
@@ -410,7 +446,7 @@ static int httpserver_handle_get_mmaps(struct mg_connection* conn, void* cbdata)
    unsigned id;
    const struct          mg_request_info* req = mg_get_request_info(conn);
    const                          char* comma = "";
-   const struct retro_memory_map* mmaps       = NULL;
+   const rarch_memory_map_t* mmaps            = NULL;
    const struct retro_memory_descriptor* mmap = NULL;
    rarch_system_info_t *system                = runloop_get_system_info();
 
@@ -418,13 +454,14 @@ static int httpserver_handle_get_mmaps(struct mg_connection* conn, void* cbdata)
       return httpserver_error(conn, 405, "Unimplemented method in %s: %s", __FUNCTION__, req->request_method);
 
    mmaps = &system->mmaps;
-   mmap  = mmaps->descriptors;
 
    mg_printf(conn, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n");
    mg_printf(conn, "[");
 
-   for (id = 0; id < mmaps->num_descriptors; id++, mmap++)
+   for (id = 0; id < mmaps->num_descriptors; id++)
    {
+      mmap = &mmaps->descriptors[id].core;
+
       mg_printf(conn,
             "%s{"
             "\"id\":%u,"
@@ -463,7 +500,7 @@ static int httpserver_handle_get_mmap(struct mg_connection* conn, void* cbdata)
    uLong buflen;
    const struct mg_request_info         * req = mg_get_request_info(conn);
    const char                         * comma = "";
-   const struct retro_memory_map* mmaps       = NULL;
+   const rarch_memory_map_t* mmaps            = NULL;
    const struct retro_memory_descriptor* mmap = NULL;
    const char* param                          = NULL;
    Bytef* buffer                              = NULL;
@@ -480,7 +517,7 @@ static int httpserver_handle_get_mmap(struct mg_connection* conn, void* cbdata)
    if (id >= mmaps->num_descriptors)
       return httpserver_error(conn, 404, "Invalid memory map id in %s: %u", __FUNCTION__, id);
 
-   mmap   = mmaps->descriptors + id;
+   mmap   = &mmaps->descriptors[id].core;
    start  = 0;
    length = mmap->len;
 
@@ -504,7 +541,8 @@ static int httpserver_handle_get_mmap(struct mg_connection* conn, void* cbdata)
       length = mmap->len - start;
 
    buflen = compressBound(length);
-   buffer = (Bytef*)malloc(((buflen + 3) / 4) * 5);
+   /* Room for the Z85 text and its terminator. */
+   buffer = (Bytef*)malloc(((buflen + 3) / 4) * 5 + 1);
 
    if (buffer == NULL)
       return httpserver_error(conn, 500, "Out of memory in %s", __FUNCTION__);
@@ -551,6 +589,585 @@ static int httpserver_handle_mmaps(struct mg_connection* conn, void* cbdata)
    return httpserver_handle_get_mmaps(conn, cbdata);
 }
 
+/*============================================================
+MEMORY WATCHES
+============================================================ */
+
+typedef struct
+{
+   /* RETRO_MEMORY_* id, or -1 for memory map descriptor 'id'. */
+   int memory;
+   unsigned id;
+   size_t start;
+   size_t length;
+   /* Where the region lives in the snapshot buffers. */
+   size_t offset;
+} httpserver_watch_region_t;
+
+typedef struct
+{
+   unsigned id;
+   unsigned num_regions;
+   httpserver_watch_region_t regions[MEMORY_WATCH_MAX_REGIONS];
+   size_t size;
+
+   /* Captured at the frame boundary a poll waited for, and
+    * what the client was sent last. */
+   uint8_t *current;
+   uint8_t *last;
+   uint64_t frame;
+
+   bool want;
+   bool busy;
+   bool primed;
+   retro_time_t last_poll;
+} httpserver_watch_t;
+
+static slock_t            *s_watch_lock           = NULL;
+static scond_t            *s_watch_cond           = NULL;
+static httpserver_watch_t *s_watches[MEMORY_WATCH_MAX];
+static unsigned            s_watch_next_id        = 1;
+static volatile bool       s_watch_wanted         = false;
+static volatile bool       s_watch_stopping       = false;
+static uint64_t            s_watch_frame          = 0;
+
+static uint8_t *httpserver_watch_memory(int memory, unsigned id, size_t *size)
+{
+   if (memory < 0)
+   {
+      rarch_system_info_t *system = runloop_get_system_info();
+      const struct retro_memory_descriptor *mmap = NULL;
+
+      if (id >= system->mmaps.num_descriptors)
+      {
+         *size = 0;
+         return NULL;
+      }
+
+      mmap  = &system->mmaps.descriptors[id].core;
+      *size = mmap->len;
+      return (uint8_t*)mmap->ptr;
+   }
+   else
+   {
+      retro_ctx_memory_info_t mem;
+
+      mem.id   = memory;
+      mem.data = NULL;
+      mem.size = 0;
+      core_get_memory(&mem);
+
+      *size = mem.size;
+      return (uint8_t*)mem.data;
+   }
+}
+
+static void httpserver_watch_capture(httpserver_watch_t *watch)
+{
+   unsigned i;
+
+   for (i = 0; i < watch->num_regions; i++)
+   {
+      size_t size                             = 0;
+      size_t avail                            = 0;
+      const httpserver_watch_region_t *region = &watch->regions[i];
+      uint8_t *dst                            = watch->current + region->offset;
+      const uint8_t *src                      = httpserver_watch_memory(
+            region->memory, region->id, &size);
+
+      /* The core may have shrunk or dropped the memory since. */
+      if (src && region->start < size)
+         avail = MIN(size - region->start, region->length);
+
+      if (avail)
+         memcpy(dst, src + region->start, avail);
+      if (avail < region->length)
+         memset(dst + avail, 0, region->length - avail);
+   }
+}
+
+/**
+ * httpserver_frame:
+ *
+ * Called by the runloop at the end of every frame. Captures the
+ * watched memory of every subscription with a poll waiting on it,
+ * so pollers never see memory the core is halfway through writing.
+ **/
+void httpserver_frame(void)
+{
+   unsigned i;
+
+   s_watch_frame++;
+
+   if (!s_watch_wanted)
+      return;
+
+   slock_lock(s_watch_lock);
+
+   for (i = 0; i < MEMORY_WATCH_MAX; i++)
+   {
+      httpserver_watch_t *watch = s_watches[i];
+
+      if (!watch || !watch->want)
+         continue;
+
+      httpserver_watch_capture(watch);
+      watch->frame = s_watch_frame;
+      watch->want  = false;
+   }
+
+   s_watch_wanted = false;
+   scond_broadcast(s_watch_cond);
+   slock_unlock(s_watch_lock);
+}
+
+static void httpserver_watch_free(httpserver_watch_t *watch)
+{
+   free(watch->current);
+   free(watch->last);
+   free(watch);
+}
+
+static void httpserver_write_le32(uint8_t *dst, uint32_t value)
+{
+   dst[0] = (uint8_t)value;
+   dst[1] = (uint8_t)(value >> 8);
+   dst[2] = (uint8_t)(value >> 16);
+   dst[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * httpserver_watch_delta:
+ * @watch                : subscription.
+ * @out                  : output buffer.
+ *
+ * Writes the parts of the captured memory that differ from what the
+ * client has, everything on the first poll. Each run of changed
+ * blocks is a little-endian uint32 region index, offset into the
+ * region and length, followed by the bytes.
+ *
+ * Returns: number of bytes written to @out.
+ **/
+static size_t httpserver_watch_delta(httpserver_watch_t *watch, uint8_t *out)
+{
+   unsigned i;
+   uint8_t *ptr = out;
+
+   for (i = 0; i < watch->num_regions; i++)
+   {
+      size_t pos                              = 0;
+      const httpserver_watch_region_t *region = &watch->regions[i];
+      const uint8_t *current                  = watch->current + region->offset;
+      uint8_t *last                           = watch->last    + region->offset;
+
+      while (pos < region->length)
+      {
+         size_t end;
+         size_t block = MIN(MEMORY_WATCH_BLOCK, region->length - pos);
+
+         if (watch->primed && !memcmp(current + pos, last + pos, block))
+         {
+            pos += block;
+            continue;
+         }
+
+         for (end = pos + block; end < region->length; end += block)
+         {
+            block = MIN(MEMORY_WATCH_BLOCK, region->length - end);
+
+            if (watch->primed && !memcmp(current + end, last + end, block))
+               break;
+         }
+
+         httpserver_write_le32(ptr,     i);
+         httpserver_write_le32(ptr + 4, (uint32_t)pos);
+         httpserver_write_le32(ptr + 8, (uint32_t)(end - pos));
+         memcpy(ptr + 12, current + pos, end - pos);
+         memcpy(last + pos, current + pos, end - pos);
+
+         ptr += 12 + end - pos;
+         pos  = end;
+      }
+   }
+
+   watch->primed = true;
+   return ptr - out;
+}
+
+static bool httpserver_watch_parse_region(httpserver_watch_region_t *region,
+      char *spec)
+{
+   size_t size          = 0;
+   char *end            = NULL;
+   char *start          = strchr(spec, ':');
+
+   if (start)
+      *start++ = '\0';
+
+   if (string_is_equal(spec, "sram"))
+      region->memory = RETRO_MEMORY_SAVE_RAM;
+   else if (string_is_equal(spec, "rtc"))
+      region->memory = RETRO_MEMORY_RTC;
+   else if (string_is_equal(spec, "ram"))
+      region->memory = RETRO_MEMORY_SYSTEM_RAM;
+   else if (string_is_equal(spec, "vram"))
+      region->memory = RETRO_MEMORY_VIDEO_RAM;
+   else
+   {
+      region->memory = -1;
+      region->id     = (unsigned)strtoul(spec, &end, 10);
+
+      if (end == spec || *end)
+         return false;
+   }
+
+   if (!httpserver_watch_memory(region->memory, region->id, &size) || !size)
+      return false;
+
+   region->start  = 0;
+   region->length = size;
+
+   if (start)
+   {
+      region->start = strtoull(start, &end, 0);
+
+      if (*end == ':')
+         region->length = strtoull(end + 1, &end, 0);
+      else
+         region->length = size;
+
+      if (*end)
+         return false;
+   }
+
+   if (region->start >= size)
+      return false;
+
+   if (region->length > size - region->start)
+      region->length = size - region->start;
+
+   return region->length > 0;
+}
+
+static int httpserver_handle_watch_new(struct mg_connection* conn)
+{
+   unsigned i, slot;
+   char regions[1024];
+   char *spec                        = NULL;
+   char *save                        = NULL;
+   const char *comma                 = "";
+   httpserver_watch_t *watch         = NULL;
+   const struct mg_request_info* req = mg_get_request_info(conn);
+   retro_time_t now                  = cpu_features_get_time_usec();
+
+   if (!core_is_game_loaded())
+      return httpserver_error(conn, 500, "Game not loaded in %s", __FUNCTION__);
+
+   if (!req->query_string || mg_get_var(req->query_string,
+            strlen(req->query_string), "regions", regions, sizeof(regions)) <= 0)
+      return httpserver_error(conn, 400, "Missing regions in %s", __FUNCTION__);
+
+   watch = (httpserver_watch_t*)calloc(1, sizeof(*watch));
+
+   if (!watch)
+      return httpserver_error(conn, 500, "Out of memory in %s", __FUNCTION__);
+
+   for (spec = strtok_r(regions, ",", &save); spec;
+         spec = strtok_r(NULL, ",", &save))
+   {
+      httpserver_watch_region_t *region = &watch->regions[watch->num_regions];
+
+      if (watch->num_regions == MEMORY_WATCH_MAX_REGIONS)
+      {
+         httpserver_watch_free(watch);
+         return httpserver_error(conn, 400, "Too many regions in %s", __FUNCTION__);
+      }
+
+      if (!httpserver_watch_parse_region(region, spec))
+      {
+         httpserver_watch_free(watch);
+         return httpserver_error(conn, 400, "Invalid region in %s", __FUNCTION__);
+      }
+
+      region->offset = watch->size;
+      watch->size   += region->length;
+      watch->num_regions++;
+   }
+
+   if (!watch->num_regions || watch->size > MEMORY_WATCH_MAX_SIZE)
+   {
+      httpserver_watch_free(watch);
+      return httpserver_error(conn, 400, "Invalid regions in %s", __FUNCTION__);
+   }
+
+   watch->current   = (uint8_t*)malloc(watch->size);
+   watch->last      = (uint8_t*)malloc(watch->size);
+   watch->last_poll = now;
+
+   if (!watch->current || !watch->last)
+   {
+      httpserver_watch_free(watch);
+      return httpserver_error(conn, 500, "Out of memory in %s", __FUNCTION__);
+   }
+
+   slock_lock(s_watch_lock);
+
+   slot = MEMORY_WATCH_MAX;
+
+   for (i = 0; i < MEMORY_WATCH_MAX; i++)
+   {
+      httpserver_watch_t *other = s_watches[i];
+
+      /* Drop watches whose client went away. */
+      if (other && !other->busy
+            && now - other->last_poll > MEMORY_WATCH_EXPIRE)
+      {
+         httpserver_watch_free(other);
+         s_watches[i] = other = NULL;
+      }
+
+      if (!other && slot == MEMORY_WATCH_MAX)
+         slot = i;
+   }
+
+   if (slot == MEMORY_WATCH_MAX)
+   {
+      slock_unlock(s_watch_lock);
+      httpserver_watch_free(watch);
+      return httpserver_error(conn, 503, "Too many watches in %s", __FUNCTION__);
+   }
+
+   watch->id       = s_watch_next_id++;
+   s_watches[slot] = watch;
+
+   slock_unlock(s_watch_lock);
+
+   mg_printf(conn, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n");
+   mg_printf(conn, "{\"id\":%u,\"size\":" STRING_REP_ULONG ",\"regions\":[",
+         watch->id, watch->size);
+
+   for (i = 0; i < watch->num_regions; i++)
+   {
+      const httpserver_watch_region_t *region = &watch->regions[i];
+
+      mg_printf(conn,
+            "%s{\"start\":" STRING_REP_ULONG ",\"length\":" STRING_REP_ULONG "}",
+            comma, region->start, region->length);
+      comma = ",";
+   }
+
+   mg_printf(conn, "]}");
+   return 1;
+}
+
+static httpserver_watch_t *httpserver_watch_find(unsigned id, unsigned *slot)
+{
+   unsigned i;
+
+   for (i = 0; i < MEMORY_WATCH_MAX; i++)
+   {
+      if (s_watches[i] && s_watches[i]->id == id)
+      {
+         if (slot)
+            *slot = i;
+         return s_watches[i];
+      }
+   }
+
+   return NULL;
+}
+
+static int httpserver_handle_watch_delete(struct mg_connection* conn, unsigned id)
+{
+   unsigned slot;
+   httpserver_watch_t *watch = NULL;
+
+   slock_lock(s_watch_lock);
+
+   watch = httpserver_watch_find(id, &slot);
+
+   if (!watch)
+   {
+      slock_unlock(s_watch_lock);
+      return httpserver_error(conn, 404, "Invalid watch id in %s: %u", __FUNCTION__, id);
+   }
+
+   if (watch->busy)
+   {
+      slock_unlock(s_watch_lock);
+      return httpserver_error(conn, 409, "Watch is being polled in %s: %u", __FUNCTION__, id);
+   }
+
+   s_watches[slot] = NULL;
+   slock_unlock(s_watch_lock);
+
+   httpserver_watch_free(watch);
+
+   mg_printf(conn, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+   return 1;
+}
+
+/* Waits for the next frame boundary and sends the watched memory that
+ * changed since the last poll, raw or deflated. Returns 204 if no frame
+ * ran before the timeout, e.g. while paused. */
+static int httpserver_handle_watch_poll(struct mg_connection* conn, unsigned id)
+{
+   char param[32];
+   retro_time_t deadline;
+   size_t len                        = 0;
+   uint64_t frame                    = 0;
+   uLong zlen                        = 0;
+   int level                         = Z_BEST_SPEED;
+   bool deflate                      = false;
+   bool captured                     = false;
+   unsigned timeout                  = 1000;
+   uint8_t *delta                    = NULL;
+   Bytef *zdata                      = NULL;
+   httpserver_watch_t *watch         = NULL;
+   const struct mg_request_info* req = mg_get_request_info(conn);
+
+   if (req->query_string)
+   {
+      size_t query_len = strlen(req->query_string);
+
+      if (mg_get_var(req->query_string, query_len,
+               "timeout", param, sizeof(param)) > 0)
+         timeout = MIN((unsigned)strtoul(param, NULL, 10),
+               MEMORY_WATCH_MAX_TIMEOUT);
+
+      if (mg_get_var(req->query_string, query_len,
+               "compression", param, sizeof(param)) > 0)
+      {
+         if (string_is_equal(param, "deflate"))
+            deflate = true;
+         else if (!string_is_equal(param, "none"))
+            return httpserver_error(conn, 400, "Unknown compression in %s: %s", __FUNCTION__, param);
+      }
+
+      if (mg_get_var(req->query_string, query_len,
+               "level", param, sizeof(param)) > 0)
+         level = MAX(Z_BEST_SPEED, MIN(atoi(param), Z_BEST_COMPRESSION));
+   }
+
+   slock_lock(s_watch_lock);
+
+   watch = httpserver_watch_find(id, NULL);
+
+   if (!watch)
+   {
+      slock_unlock(s_watch_lock);
+      return httpserver_error(conn, 404, "Invalid watch id in %s: %u", __FUNCTION__, id);
+   }
+
+   if (watch->busy)
+   {
+      slock_unlock(s_watch_lock);
+      return httpserver_error(conn, 409, "Watch is already being polled in %s: %u", __FUNCTION__, id);
+   }
+
+   watch->busy      = true;
+   watch->want      = true;
+   watch->last_poll = cpu_features_get_time_usec();
+   s_watch_wanted   = true;
+   deadline         = watch->last_poll + timeout * 1000;
+
+   while (watch->want && !s_watch_stopping)
+   {
+      retro_time_t left = deadline - cpu_features_get_time_usec();
+
+      if (left <= 0 || !scond_wait_timeout(s_watch_cond, s_watch_lock, left))
+         break;
+   }
+
+   captured    = !watch->want;
+   watch->want = false;
+
+   slock_unlock(s_watch_lock);
+
+   /* The runloop leaves the snapshot alone until the next poll
+    * asks for one, and busy keeps the watch from being freed. */
+   if (captured)
+   {
+      frame = watch->frame;
+      delta = (uint8_t*)malloc(watch->size + 12 *
+            (watch->size / MEMORY_WATCH_BLOCK + 2 * watch->num_regions));
+
+      if (delta)
+      {
+         len = httpserver_watch_delta(watch, delta);
+
+         if (deflate)
+         {
+            zlen  = compressBound(len);
+            zdata = (Bytef*)malloc(zlen);
+
+            if (!zdata || compress2(zdata, &zlen, delta, len, level) != Z_OK)
+            {
+               /* The client must get the whole delta again. */
+               watch->primed = false;
+               free(zdata);
+               zdata = NULL;
+            }
+         }
+      }
+   }
+
+   /* Let go of the watch before responding, the client may
+    * poll again as soon as it has the response. */
+   slock_lock(s_watch_lock);
+   watch->busy = false;
+   slock_unlock(s_watch_lock);
+
+   if (!captured)
+      mg_printf(conn, "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n");
+   else if (!delta)
+      httpserver_error(conn, 500, "Out of memory in %s", __FUNCTION__);
+   else if (deflate && !zdata)
+      httpserver_error(conn, 500, "Error during compression in %s", __FUNCTION__);
+   else
+   {
+      mg_printf(conn,
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "Content-Length: " STRING_REP_ULONG "\r\n"
+            "%s"
+            "X-Frame: " STRING_REP_UINT64 "\r\n"
+            "X-Uncompressed-Length: " STRING_REP_ULONG "\r\n\r\n",
+            deflate ? (size_t)zlen : len,
+            deflate ? "Content-Encoding: deflate\r\n" : "",
+            (unsigned long long)frame,
+            len);
+
+      if (deflate)
+         mg_write(conn, zdata, zlen);
+      else
+         mg_write(conn, delta, len);
+   }
+
+   free(delta);
+   free(zdata);
+   return 1;
+}
+
+static int httpserver_handle_watch(struct mg_connection* conn, void* cbdata)
+{
+   unsigned id;
+   const struct mg_request_info* req = mg_get_request_info(conn);
+
+   if (sscanf(req->request_uri, "/" MEMORY_WATCH "/%u", &id) == 1)
+   {
+      if (!strcmp(req->request_method, "GET"))
+         return httpserver_handle_watch_poll(conn, id);
+
+      if (!strcmp(req->request_method, "DELETE"))
+         return httpserver_handle_watch_delete(conn, id);
+   }
+   else if (!strcmp(req->request_method, "POST"))
+      return httpserver_handle_watch_new(conn);
+
+   return httpserver_error(conn, 405, "Unimplemented method in %s: %s", __FUNCTION__, req->request_method);
+}
+
 /*============================================================
 HTTP SERVER
 ============================================================ */
@@ -567,21 +1184,66 @@ int httpserver_init(unsigned port)
       NULL, NULL
    };
 
+   s_watch_stopping = false;
+   s_watch_lock     = slock_new();
+   s_watch_cond     = scond_new();
+
+   if (!s_watch_lock || !s_watch_cond)
+   {
+      httpserver_destroy();
+      return -1;
+   }
+
    memset(&s_httpserver_callbacks, 0, sizeof(s_httpserver_callbacks));
    s_httpserver_ctx = mg_start(&s_httpserver_callbacks, NULL, options);
 
    if (s_httpserver_ctx == NULL)
+   {
+      httpserver_destroy();
       return -1;
+   }
 
    mg_set_request_handler(s_httpserver_ctx, "/" BASIC_INFO, httpserver_handle_basic_info, NULL);
 
    mg_set_request_handler(s_httpserver_ctx, "/" MEMORY_MAP, httpserver_handle_mmaps, NULL);
    mg_set_request_handler(s_httpserver_ctx, "/" MEMORY_MAP "/", httpserver_handle_mmaps, NULL);
 
+   mg_set_request_handler(s_httpserver_ctx, "/" MEMORY_WATCH, httpserver_handle_watch, NULL);
+   mg_set_request_handler(s_httpserver_ctx, "/" MEMORY_WATCH "/", httpserver_handle_watch, NULL);
+
    return 0;
 }
 
 void httpserver_destroy(void)
 {
-   mg_stop(s_httpserver_ctx);
+   unsigned i;
+
+   /* Wake up pollers, so mg_stop doesn't wait for their timeouts. */
+   if (s_watch_lock)
+   {
+      slock_lock(s_watch_lock);
+      s_watch_stopping = true;
+      scond_broadcast(s_watch_cond);
+      slock_unlock(s_watch_lock);
+   }
+
+   if (s_httpserver_ctx)
+      mg_stop(s_httpserver_ctx);
+   s_httpserver_ctx = NULL;
+
+   for (i = 0; i < MEMORY_WATCH_MAX; i++)
+   {
+      if (s_watches[i])
+         httpserver_watch_free(s_watches[i]);
+      s_watches[i] = NULL;
+   }
+
+   s_watch_wanted = false;
+
+   if (s_watch_cond)
+      scond_free(s_watch_cond);
+   if (s_watch_lock)
+      slock_free(s_watch_lock);
+   s_watch_cond = NULL;
+   s_watch_lock = NULL;
 }
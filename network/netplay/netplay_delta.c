@@ -16,6 +16,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <boolean.h>
@@ -23,6 +24,29 @@
 
 #include "netplay_private.h"
 
+#include "../../core.h"
+
+/* Frame buffer states are XORed against a keyframe and the result is run
+ * length encoded in 32-bit words, as a sequence of:
+ *
+ *    uint32 unchanged; (words to skip)
+ *    uint32 changed;
+ *    uint32[changed] xored;
+ *
+ * Most of a state doesn't change from one frame to the next, so this keeps
+ * the frame buffer small, and any frame is rebuilt with a single pass over
+ * its keyframe however far back a rollback goes. Once a delta has grown
+ * large the state it encodes becomes the new keyframe. Older frames keep
+ * referring to the keyframe they were encoded against until they're
+ * overwritten, so switching keyframes never re-encodes anything. */
+
+static void netplay_delta_release(netplay_t *netplay, struct delta_frame *delta)
+{
+   if (delta->have_state)
+      netplay->keyframe_refs[delta->keyframe]--;
+   delta->have_state = false;
+}
+
 /**
  * netplay_delta_frame_ready
  *
@@ -36,6 +60,7 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
    uint32_t frame)
 {
    void *remember_state;
+   size_t remember_cap;
    if (delta->used)
    {
       if (delta->frame == frame) return true;
@@ -45,11 +70,14 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
          return false;
       }
    }
+   netplay_delta_release(netplay, delta);
    remember_state = delta->state;
+   remember_cap   = delta->state_cap;
    memset(delta, 0, sizeof(struct delta_frame));
    delta->used = true;
    delta->frame = frame;
-   delta->state = remember_state;
+   delta->state = (uint32_t*)remember_state;
+   delta->state_cap = remember_cap;
    return true;
 }
 
@@ -62,5 +90,233 @@ uint32_t netplay_delta_frame_crc(netplay_t *netplay, struct delta_frame *delta)
 {
    if (!netplay->state_size)
       return 0;
-   return encoding_crc32(0L, (const unsigned char*)delta->state, netplay->state_size);
+   return encoding_crc32(0L, (const unsigned char*)
+         netplay_delta_frame_load(netplay, delta), netplay->state_size);
+}
+
+static void netplay_delta_account(netplay_t *netplay, size_t added,
+      size_t removed)
+{
+   netplay->delta_bytes += added;
+   netplay->delta_bytes -= removed;
+   if (netplay->delta_bytes > netplay->delta_bytes_peak)
+      netplay->delta_bytes_peak = netplay->delta_bytes;
+}
+
+static bool netplay_delta_reserve(netplay_t *netplay,
+      struct delta_frame *delta, size_t words)
+{
+   uint32_t *state;
+   size_t cap = delta->state_cap ? delta->state_cap : 64;
+
+   if (words <= delta->state_cap)
+      return true;
+
+   while (cap < words)
+      cap *= 2;
+
+   state = (uint32_t*)realloc(delta->state, cap * sizeof(uint32_t));
+   if (!state)
+      return false;
+
+   netplay_delta_account(netplay, cap * sizeof(uint32_t),
+         delta->state_cap * sizeof(uint32_t));
+   delta->state     = state;
+   delta->state_cap = cap;
+   return true;
+}
+
+static bool netplay_delta_encode(netplay_t *netplay,
+      struct delta_frame *delta, unsigned keyframe, const uint32_t *state)
+{
+   const uint32_t *key = netplay->keyframes[keyframe];
+   size_t words        = netplay->state_words;
+   size_t len          = 0;
+   size_t i            = 0;
+
+   netplay_delta_release(netplay, delta);
+
+   while (i < words)
+   {
+      size_t j, skip, changed;
+      uint32_t *out;
+      size_t start = i;
+
+      while (i < words && key[i] == state[i])
+         i++;
+      if (i == words)
+         break;
+      skip = i - start;
+
+      /* Swallow single unchanged words, a new run costs two */
+      start = i;
+      while (i < words && (key[i] != state[i] ||
+               (i + 1 < words && key[i + 1] != state[i + 1])))
+         i++;
+      changed = i - start;
+
+      if (!netplay_delta_reserve(netplay, delta, len + 2 + changed))
+         return false;
+
+      out    = delta->state + len;
+      out[0] = (uint32_t)skip;
+      out[1] = (uint32_t)changed;
+      for (j = 0; j < changed; j++)
+         out[j + 2] = key[start + j] ^ state[start + j];
+      len   += 2 + changed;
+   }
+
+   delta->state_len  = len;
+   delta->keyframe   = keyframe;
+   delta->have_state = true;
+   netplay->keyframe_refs[keyframe]++;
+
+   /* Give back memory if a delta shrank a lot */
+   if (delta->state_cap > 1024 && delta->state_cap > len * 4)
+   {
+      size_t cap      = len * 2 > 1024 ? len * 2 : 1024;
+      uint32_t *state = (uint32_t*)realloc(delta->state,
+            cap * sizeof(uint32_t));
+
+      if (state)
+      {
+         netplay_delta_account(netplay, cap * sizeof(uint32_t),
+               delta->state_cap * sizeof(uint32_t));
+         delta->state     = state;
+         delta->state_cap = cap;
+      }
+   }
+
+   return true;
+}
+
+static void netplay_delta_decode(netplay_t *netplay,
+      const struct delta_frame *delta, uint32_t *out)
+{
+   const uint32_t *in  = delta->state;
+   const uint32_t *end = in + delta->state_len;
+
+   memcpy(out, netplay->keyframes[delta->keyframe],
+         netplay->state_words * sizeof(uint32_t));
+
+   while (in < end)
+   {
+      uint32_t i;
+      uint32_t changed;
+
+      out     += in[0];
+      changed  = in[1];
+      in      += 2;
+
+      for (i = 0; i < changed; i++)
+         out[i] ^= in[i];
+
+      out += changed;
+      in  += changed;
+   }
+}
+
+/* Makes the scratch state, just stored in 'delta', the keyframe new states
+ * are encoded against, if a keyframe no frame refers to anymore is left. */
+static void netplay_delta_new_keyframe(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   unsigned i;
+   size_t size = netplay->state_words * sizeof(uint32_t);
+
+   for (i = 0; i < NETPLAY_KEYFRAMES; i++)
+      if (i != netplay->keyframe && !netplay->keyframe_refs[i])
+         break;
+   if (i == NETPLAY_KEYFRAMES)
+      return;
+
+   if (!netplay->keyframes[i])
+   {
+      netplay->keyframes[i] = (uint32_t*)malloc(size);
+      if (!netplay->keyframes[i])
+         return;
+      netplay_delta_account(netplay, size, 0);
+   }
+
+   memcpy(netplay->keyframes[i], netplay->state_scratch, size);
+   netplay->keyframe = i;
+   netplay_delta_encode(netplay, delta, i, netplay->state_scratch);
+}
+
+bool netplay_delta_frame_store(netplay_t *netplay, struct delta_frame *delta,
+   const void *state, size_t size)
+{
+   if (!netplay->state_scratch)
+      return false;
+
+   if (state != netplay->state_scratch)
+   {
+      memcpy(netplay->state_scratch, state, size);
+      memset((uint8_t*)netplay->state_scratch + size, 0,
+            netplay->state_words * sizeof(uint32_t) - size);
+   }
+
+   if (!netplay_delta_encode(netplay, delta, netplay->keyframe,
+            netplay->state_scratch))
+      return false;
+
+   if (delta->state_len > netplay->state_words / 16)
+      netplay_delta_new_keyframe(netplay, delta);
+
+   return true;
+}
+
+bool netplay_delta_frame_serialize(netplay_t *netplay, struct delta_frame *delta)
+{
+   retro_ctx_serialize_info_t serial_info;
+
+   if (!netplay->state_scratch)
+      return false;
+
+   /* No need to clear the scratch state first. It only ever holds complete
+    * states, so bytes a core leaves alone stay as they were allocated. */
+   serial_info.data_const = NULL;
+   serial_info.data       = netplay->state_scratch;
+   serial_info.size       = netplay->state_size;
+
+   if (!core_serialize(&serial_info))
+   {
+      netplay_delta_release(netplay, delta);
+      return false;
+   }
+
+   return netplay_delta_frame_store(netplay, delta,
+         netplay->state_scratch, netplay->state_size);
+}
+
+const void *netplay_delta_frame_load(netplay_t *netplay, struct delta_frame *delta)
+{
+   if (!netplay->state_scratch)
+      return NULL;
+
+   if (!delta->have_state)
+      memset(netplay->state_scratch, 0,
+            netplay->state_words * sizeof(uint32_t));
+   else
+      netplay_delta_decode(netplay, delta, netplay->state_scratch);
+   return netplay->state_scratch;
+}
+
+void netplay_delta_log_stats(netplay_t *netplay)
+{
+   size_t full = netplay->state_size * netplay->buffer_size;
+   size_t used = netplay->delta_bytes_peak +
+      netplay->state_words * sizeof(uint32_t);
+
+   if (!netplay->state_size)
+      return;
+
+   RARCH_LOG("[netplay] Frame buffer: %u frames, %u KB peak (%u KB unencoded).\n",
+         (unsigned)netplay->buffer_size, (unsigned)(used / 1024),
+         (unsigned)(full / 1024));
+
+   if (netplay->rollback_count)
+      RARCH_LOG("[netplay] %u rollbacks replayed %u frames, %.3f ms per rollback.\n",
+            netplay->rollback_count, netplay->rollback_frames,
+            netplay->rollback_time / 1000.0 / netplay->rollback_count);
 }
@@ -28,6 +28,7 @@
 
 #include "../../configuration.h"
 #include "../../input/input_driver.h"
+#include "../../performance_counters.h"
 #include "../../runloop.h"
 
 #include "../../tasks/tasks_internal.h"
@@ -111,8 +112,10 @@ static bool netplay_can_poll(netplay_t *netplay)
  */
 static bool get_self_input_state(netplay_t *netplay)
 {
+   static struct retro_perf_counter netplay_send_input = {0};
    uint32_t state[WORDS_PER_INPUT] = {0, 0, 0};
    struct delta_frame *ptr = &netplay->buffer[netplay->self_ptr];
+   bool is_perfcnt_enable  = runloop_ctl(RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL);
    size_t i;
 
    if (!netplay_delta_frame_ready(netplay, ptr, netplay->self_frame_count))
@@ -158,13 +161,32 @@ static bool get_self_input_state(netplay_t *netplay)
    }
 
    /* And send this input to our peers */
+   performance_counter_init(netplay_send_input, "netplay_send_input");
+   performance_counter_start_plus(is_perfcnt_enable, netplay_send_input);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
-         netplay_send_cur_input(netplay, &netplay->connections[i]);
+      if (!connection->active || connection->mode < NETPLAY_CONNECTION_CONNECTED)
+         continue;
+
+      /* Spectators are handed to the relay, which gets their input once */
+      if (netplay->relay && !connection->relay_id &&
+            connection->mode == NETPLAY_CONNECTION_SPECTATING)
+         netplay_relay_attach(netplay, connection);
+
+      if (!connection->relay_id)
+         netplay_send_cur_input(netplay, connection);
+   }
+
+   if (netplay->relay)
+   {
+      netplay_send_cur_input(netplay, &netplay->relay_connection);
+      netplay_relay_flush(netplay);
    }
 
+   performance_counter_stop_plus(is_perfcnt_enable, netplay_send_input);
+
    return true;
 }
 
@@ -687,7 +709,8 @@ static void netplay_flip_users(netplay_t *netplay)
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
+      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
+            !connection->relay_id)
       {
          netplay_command(netplay, connection, NETPLAY_CMD_FLIP_PLAYERS,
             &flip_frame_net, sizeof flip_frame_net, "flip users",
@@ -695,6 +718,10 @@ static void netplay_flip_users(netplay_t *netplay)
       }
    }
 
+   if (netplay->relay)
+      netplay_send_raw_cmd(netplay, &netplay->relay_connection,
+         NETPLAY_CMD_FLIP_PLAYERS, &flip_frame_net, sizeof flip_frame_net);
+
    netplay->flip       ^= true;
    netplay->flip_frame  = flip_frame;
 }
@@ -736,7 +763,8 @@ static void netplay_frontend_paused(netplay_t *netplay, bool paused)
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
+      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
+            !connection->relay_id)
       {
          if (paused)
             netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_PAUSE,
@@ -749,6 +777,17 @@ static void netplay_frontend_paused(netplay_t *netplay, bool paused)
          netplay_send_flush(&connection->send_packet_buffer, connection->fd, true);
       }
    }
+
+   if (netplay->relay)
+   {
+      if (paused)
+         netplay_send_raw_cmd(netplay, &netplay->relay_connection,
+            NETPLAY_CMD_PAUSE, netplay->nick, NETPLAY_NICK_LEN);
+      else
+         netplay_send_raw_cmd(netplay, &netplay->relay_connection,
+            NETPLAY_CMD_RESUME, NULL, 0);
+      netplay_relay_flush(netplay);
+   }
 }
 
 /**
@@ -843,6 +882,9 @@ void netplay_post_frame(netplay_t *netplay)
    netplay_update_unread_ptr(netplay);
    netplay_sync_post_frame(netplay, false);
 
+   netplay_relay_flush(netplay);
+   netplay_relay_reap(netplay);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -938,7 +980,8 @@ void netplay_send_savestate(netplay_t *netplay,
       struct netplay_connection *connection = &netplay->connections[i];
       if (!connection->active ||
           connection->mode < NETPLAY_CONNECTION_CONNECTED ||
-          connection->compression_supported != cx) continue;
+          connection->compression_supported != cx ||
+          connection->relay_id) continue;
 
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
             sizeof(header)) ||
@@ -946,6 +989,15 @@ void netplay_send_savestate(netplay_t *netplay,
             netplay->zbuffer, wn))
          netplay_hangup(netplay, connection);
    }
+
+   /* Relayed spectators share a single copy */
+   if (netplay->relay)
+   {
+      netplay_relay_send(netplay, NETPLAY_RELAY_ALL, NETPLAY_RELAY_NONE, cx,
+         header, sizeof(header));
+      netplay_relay_send(netplay, NETPLAY_RELAY_ALL, NETPLAY_RELAY_NONE, cx,
+         netplay->zbuffer, wn);
+   }
 }
 
 /**
@@ -973,18 +1025,20 @@ void netplay_load_savestate(netplay_t *netplay,
       {
          if (!serial_info)
          {
-            tmp_serial_info.size = netplay->state_size;
-            tmp_serial_info.data = netplay->buffer[netplay->run_ptr].state;
-            if (!core_serialize(&tmp_serial_info))
+            if (!netplay_delta_frame_serialize(netplay,
+                     &netplay->buffer[netplay->run_ptr]))
                return;
-            tmp_serial_info.data_const = tmp_serial_info.data;
+            tmp_serial_info.size       = netplay->state_size;
+            tmp_serial_info.data       = NULL;
+            tmp_serial_info.data_const = netplay->state_scratch;
             serial_info = &tmp_serial_info;
          }
          else
          {
             if (serial_info->size <= netplay->state_size)
             {
-               memcpy(netplay->buffer[netplay->run_ptr].state,
+               netplay_delta_frame_store(netplay,
+                     &netplay->buffer[netplay->run_ptr],
                      serial_info->data_const, serial_info->size);
             }
          }
@@ -1037,12 +1091,17 @@ static void netplay_core_reset(netplay_t *netplay)
    {
       struct netplay_connection *connection = &netplay->connections[i];
       if (!connection->active ||
-            connection->mode < NETPLAY_CONNECTION_CONNECTED) continue;
+            connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+            connection->relay_id) continue;
 
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmd,
                sizeof(cmd)))
          netplay_hangup(netplay, connection);
    }
+
+   if (netplay->relay)
+      netplay_relay_send(netplay, NETPLAY_RELAY_ALL, NETPLAY_RELAY_NONE,
+         NETPLAY_RELAY_ANY_COMPRESSION, cmd, sizeof(cmd));
 }
 
 /**
@@ -1221,6 +1280,12 @@ bool init_netplay(void *direct_host, const char *server, unsigned port)
    {
       if (netplay_data->is_server && !settings->bools.netplay_start_as_spectator)
          netplay_data->self_mode = NETPLAY_CONNECTION_PLAYING;
+      if (netplay_data->is_server && settings->bools.netplay_spectator_relay)
+      {
+         netplay_data->relay = netplay_relay_new(netplay_data);
+         if (!netplay_data->relay)
+            RARCH_WARN("[netplay] Could not start the spectator relay.\n");
+      }
       return true;
    }
 
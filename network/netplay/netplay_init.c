@@ -266,7 +266,6 @@ static bool netplay_init_socket_buffers(netplay_t *netplay)
 
 bool netplay_init_serialization(netplay_t *netplay)
 {
-   unsigned i;
    retro_ctx_size_info_t info;
 
    if (netplay->state_size)
@@ -277,17 +276,20 @@ bool netplay_init_serialization(netplay_t *netplay)
    if (!info.size)
       return false;
 
-   netplay->state_size = info.size;
+   netplay->state_size  = info.size;
+   netplay->state_words = (info.size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
 
-   for (i = 0; i < netplay->buffer_size; i++)
-   {
-      netplay->buffer[i].state = calloc(netplay->state_size, 1);
+   /* Frame buffer states and further keyframes are allocated as needed */
+   netplay->keyframes[0]  = (uint32_t*)calloc(netplay->state_words,
+         sizeof(uint32_t));
+   netplay->state_scratch = (uint32_t*)calloc(netplay->state_words,
+         sizeof(uint32_t));
+   netplay->delta_bytes   = netplay->state_words * sizeof(uint32_t);
 
-      if (!netplay->buffer[i].state)
-      {
-         netplay->quirks |= NETPLAY_QUIRK_NO_SAVESTATES;
-         return false;
-      }
+   if (!netplay->keyframes[0] || !netplay->state_scratch)
+   {
+      netplay->quirks |= NETPLAY_QUIRK_NO_SAVESTATES;
+      return false;
    }
 
    netplay->zbuffer_size = netplay->state_size * 2;
@@ -321,7 +323,7 @@ bool netplay_try_init_serialization(netplay_t *netplay)
 
    /* Check if we can actually save */
    serial_info.data_const = NULL;
-   serial_info.data = netplay->buffer[netplay->run_ptr].state;
+   serial_info.data = netplay->state_scratch;
    serial_info.size = netplay->state_size;
 
    if (!core_serialize(&serial_info))
@@ -501,6 +503,10 @@ void netplay_free(netplay_t *netplay)
 {
    size_t i;
 
+   /* Stop sending to spectators before their sockets are closed */
+   if (netplay->relay)
+      netplay_relay_free(netplay->relay);
+
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
@@ -523,6 +529,8 @@ void netplay_free(netplay_t *netplay)
 
    if (netplay->buffer)
    {
+      netplay_delta_log_stats(netplay);
+
       for (i = 0; i < netplay->buffer_size; i++)
          if (netplay->buffer[i].state)
             free(netplay->buffer[i].state);
@@ -530,6 +538,12 @@ void netplay_free(netplay_t *netplay)
       free(netplay->buffer);
    }
 
+   for (i = 0; i < NETPLAY_KEYFRAMES; i++)
+      if (netplay->keyframes[i])
+         free(netplay->keyframes[i]);
+   if (netplay->state_scratch)
+      free(netplay->state_scratch);
+
    if (netplay->zbuffer)
       free(netplay->zbuffer);
 
@@ -115,6 +115,10 @@ void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection)
    RARCH_LOG("%s\n", dmsg);
    runloop_msg_queue_push(dmsg, 1, 180, false);
 
+   /* The relay thread mustn't be sending to it */
+   if (connection->relay_id)
+      netplay_relay_detach(netplay, connection, false);
+
    socket_close(connection->fd);
    connection->active = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
@@ -171,6 +175,10 @@ static bool send_input_frame(netplay_t *netplay,
 
    if (only)
    {
+      if (only->relay_id)
+         return netplay_relay_send(netplay, only->relay_id, NETPLAY_RELAY_NONE,
+               NETPLAY_RELAY_ANY_COMPRESSION, buffer, sizeof(buffer));
+
       if (!netplay_send(&only->send_packet_buffer, only->fd, buffer, sizeof(buffer)))
       {
          netplay_hangup(netplay, only);
@@ -182,7 +190,7 @@ static bool send_input_frame(netplay_t *netplay,
       for (i = 0; i < netplay->connections_size; i++)
       {
          struct netplay_connection *connection = &netplay->connections[i];
-         if (connection == except) continue;
+         if (connection == except || connection->relay_id) continue;
          if (connection->active &&
              connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
              (connection->mode != NETPLAY_CONNECTION_PLAYING ||
@@ -193,6 +201,12 @@ static bool send_input_frame(netplay_t *netplay,
                netplay_hangup(netplay, connection);
          }
       }
+
+      /* Relayed spectators are never playing */
+      if (netplay->relay)
+         netplay_relay_send(netplay, NETPLAY_RELAY_ALL,
+               except ? except->relay_id : NETPLAY_RELAY_NONE,
+               NETPLAY_RELAY_ANY_COMPRESSION, buffer, sizeof(buffer));
    }
 
    return true;
@@ -276,6 +290,13 @@ bool netplay_send_raw_cmd(netplay_t *netplay,
    cmdbuf[0] = htonl(cmd);
    cmdbuf[1] = htonl(size);
 
+   if (connection->relay_id)
+      return netplay_relay_send(netplay, connection->relay_id,
+               NETPLAY_RELAY_NONE, NETPLAY_RELAY_ANY_COMPRESSION,
+               cmdbuf, sizeof(cmdbuf)) &&
+         (size == 0 || netplay_relay_send(netplay, connection->relay_id,
+               NETPLAY_RELAY_NONE, NETPLAY_RELAY_ANY_COMPRESSION, data, size));
+
    if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmdbuf,
          sizeof(cmdbuf)))
       return false;
@@ -301,7 +322,7 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection == except)
+      if (connection == except || connection->relay_id)
          continue;
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
       {
@@ -309,6 +330,22 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
             netplay_hangup(netplay, connection);
       }
    }
+
+   if (netplay->relay)
+   {
+      uint32_t cmdbuf[2];
+
+      cmdbuf[0] = htonl(cmd);
+      cmdbuf[1] = htonl(size);
+
+      netplay_relay_send(netplay, NETPLAY_RELAY_ALL,
+            except ? except->relay_id : NETPLAY_RELAY_NONE,
+            NETPLAY_RELAY_ANY_COMPRESSION, cmdbuf, sizeof(cmdbuf));
+      if (size > 0)
+         netplay_relay_send(netplay, NETPLAY_RELAY_ALL,
+               except ? except->relay_id : NETPLAY_RELAY_NONE,
+               NETPLAY_RELAY_ANY_COMPRESSION, data, size);
+   }
 }
 
 static bool netplay_cmd_nak(netplay_t *netplay,
@@ -333,10 +370,14 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
    for (i = 0; i < netplay->connections_size; i++)
    {
       if (netplay->connections[i].active &&
-            netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED)
+            netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED &&
+            !netplay->connections[i].relay_id)
          success = netplay_send_raw_cmd(netplay, &netplay->connections[i],
             NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
    }
+   if (netplay->relay)
+      success = netplay_send_raw_cmd(netplay, &netplay->relay_connection,
+         NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
    return success;
 }
 
@@ -734,6 +775,12 @@ static bool netplay_get_cmd(netplay_t *netplay,
          if (connection->mode != NETPLAY_CONNECTION_PLAYING &&
              connection->mode != NETPLAY_CONNECTION_SLAVE)
          {
+            /* Players are sent to directly, after whatever the relay hasn't
+             * sent them yet */
+            if (connection->relay_id &&
+                !netplay_relay_detach(netplay, connection, true))
+               return false;
+
             /* Mark them as playing */
             connection->mode = slave ? NETPLAY_CONNECTION_SLAVE :
                                        NETPLAY_CONNECTION_PLAYING;
@@ -1224,10 +1271,13 @@ static bool netplay_get_cmd(netplay_t *netplay,
                ctrans->decompression_backend->set_in(ctrans->decompression_stream,
                   netplay->zbuffer, cmd_size - 2*sizeof(uint32_t));
                ctrans->decompression_backend->set_out(ctrans->decompression_stream,
-                  (uint8_t*)netplay->buffer[netplay->read_ptr[connection->player]].state,
+                  (uint8_t*)netplay->state_scratch,
                   (unsigned)netplay->state_size);
                ctrans->decompression_backend->trans(ctrans->decompression_stream,
                   true, &rd, &wn, NULL);
+               netplay_delta_frame_store(netplay,
+                  &netplay->buffer[netplay->read_ptr[connection->player]],
+                  netplay->state_scratch, netplay->state_size);
 
                /* Force a rewind to the relevant frame */
                netplay->force_rewind = true;
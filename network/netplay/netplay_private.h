@@ -47,10 +47,18 @@
 #define RETRY_MS                    500
 
 #define NETPLAY_MAX_STALL_FRAMES       60
+#define NETPLAY_KEYFRAMES              4
 #define NETPLAY_FRAME_RUN_TIME_WINDOW  120
 #define NETPLAY_MAX_REQ_STALL_TIME     60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
+/* Spectator relay: Everything a relayed spectator can still be sent before it
+ * is disconnected, and the relay IDs addressing all or none of them */
+#define NETPLAY_RELAY_MAX_BACKLOG      (32*1024*1024)
+#define NETPLAY_RELAY_ALL              0xFFFFFFFF
+#define NETPLAY_RELAY_NONE             0
+#define NETPLAY_RELAY_ANY_COMPRESSION  0xFFFFFFFF
+
 #define PREV_PTR(x) ((x) == 0 ? netplay->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % netplay->buffer_size)
 
@@ -241,8 +249,14 @@ struct delta_frame
    bool used; /* a bit derpy, but this is how we know if the delta's been used at all */
    uint32_t frame;
 
-   /* The serialized state of the core at this frame, before input */
-   void *state;
+   /* The serialized state of the core at this frame, before input, XOR/RLE
+    * encoded against netplay->keyframes[keyframe]. Only valid if have_state
+    * is set. */
+   uint32_t *state;
+   size_t state_len; /* in words */
+   size_t state_cap; /* in words */
+   unsigned keyframe;
+   bool have_state;
 
    /* The CRC-32 of the serialized state if we've calculated it, else 0 */
    uint32_t crc;
@@ -314,6 +328,10 @@ struct netplay_connection
    /* For the server: When was the last time we requested this client to stall?
     * For the client: How many frames of stall do we have left? */
    uint32_t stall_frame;
+
+   /* Server only: If nonzero, this spectator is fed by the relay thread and
+    * everything sent to it goes through the relay */
+   uint32_t relay_id;
 };
 
 /* Compression transcoder */
@@ -347,6 +365,11 @@ struct netplay
    size_t connections_size;
    struct netplay_connection one_connection; /* Client only */
 
+   /* Spectator relay (server only), and a connection standing in for all of
+    * the spectators it serves */
+   struct netplay_relay *relay;
+   struct netplay_connection relay_connection;
+
    /* Bitmap of players with controllers (low bit is player 1) */
    uint32_t connected_players;
 
@@ -420,6 +443,26 @@ struct netplay
    /* Size of savestates */
    size_t state_size;
 
+   /* Savestates in the frame buffer are stored as deltas against one of
+    * these full states, new ones against keyframes[keyframe]. keyframe_refs
+    * counts the frames encoded against each. */
+   uint32_t *keyframes[NETPLAY_KEYFRAMES];
+   size_t keyframe_refs[NETPLAY_KEYFRAMES];
+   unsigned keyframe;
+
+   /* Savestates are serialized into and decoded to here. This and the
+    * keyframes are state_words long. */
+   uint32_t *state_scratch;
+   size_t state_words;
+
+   /* Memory used by the keyframes and encoded states, in bytes */
+   size_t delta_bytes, delta_bytes_peak;
+
+   /* Number of rollbacks, frames replayed by them and their total time */
+   uint32_t rollback_count;
+   uint32_t rollback_frames;
+   retro_time_t rollback_time;
+
    /* Are we replaying old frames? */
    bool is_replay;
 
@@ -594,6 +637,140 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
  */
 uint32_t netplay_delta_frame_crc(netplay_t *netplay, struct delta_frame *delta);
 
+/**
+ * netplay_delta_frame_store
+ * @netplay              : pointer to netplay object
+ * @delta                : frame to store the state in
+ * @state                : serialized state, may be netplay->state_scratch
+ * @size                 : size of the state, at most netplay->state_size
+ *
+ * Encodes a serialized state into the frame buffer.
+ *
+ * Returns: true if the state was stored, false on allocation failure.
+ */
+bool netplay_delta_frame_store(netplay_t *netplay, struct delta_frame *delta,
+   const void *state, size_t size);
+
+/**
+ * netplay_delta_frame_serialize
+ * @netplay              : pointer to netplay object
+ * @delta                : frame to store the state in
+ *
+ * Serializes the core into netplay->state_scratch and stores it in the
+ * frame buffer. The scratch state stays valid until the next call which
+ * serializes or decodes a state.
+ *
+ * Returns: true if the core was serialized and stored, false otherwise.
+ */
+bool netplay_delta_frame_serialize(netplay_t *netplay, struct delta_frame *delta);
+
+/**
+ * netplay_delta_frame_load
+ * @netplay              : pointer to netplay object
+ * @delta                : frame to load the state of
+ *
+ * Decodes the state of this frame into netplay->state_scratch.
+ *
+ * Returns: the decoded state, all zeroes if none was stored, or NULL if
+ * serialization isn't initialized.
+ */
+const void *netplay_delta_frame_load(netplay_t *netplay, struct delta_frame *delta);
+
+/**
+ * netplay_delta_log_stats
+ * @netplay              : pointer to netplay object
+ *
+ * Logs the memory used by the frame buffer states and the cost of rollbacks.
+ */
+void netplay_delta_log_stats(netplay_t *netplay);
+
+
+/***************************************************************
+ * NETPLAY-RELAY.C
+ **************************************************************/
+
+/**
+ * netplay_relay_new
+ * @netplay              : pointer to netplay object
+ *
+ * Starts the spectator relay thread. Spectators are attached to it as they
+ * start spectating, after which a single stream is built for all of them and
+ * the relay thread sends it to each without blocking the main thread.
+ *
+ * Returns: the relay, or NULL if threads aren't available.
+ */
+struct netplay_relay *netplay_relay_new(netplay_t *netplay);
+
+/**
+ * netplay_relay_free
+ * @relay                : the relay
+ *
+ * Stops the relay thread and frees everything not yet sent.
+ */
+void netplay_relay_free(struct netplay_relay *relay);
+
+/**
+ * netplay_relay_attach
+ * @netplay              : pointer to netplay object
+ * @connection           : a spectating connection
+ *
+ * Hands a spectator over to the relay thread, along with whatever is still
+ * unsent in its send buffer.
+ *
+ * Returns: true if successful, false otherwise.
+ */
+bool netplay_relay_attach(netplay_t *netplay,
+      struct netplay_connection *connection);
+
+/**
+ * netplay_relay_detach
+ * @netplay              : pointer to netplay object
+ * @connection           : a relayed connection
+ * @flush                : queue its backlog in its own send buffer
+ *
+ * Takes a spectator back from the relay thread, e.g. when it starts playing
+ * or hangs up.
+ *
+ * Returns: false if the relay already gave up on this connection.
+ */
+bool netplay_relay_detach(netplay_t *netplay,
+      struct netplay_connection *connection, bool flush);
+
+/**
+ * netplay_relay_send
+ * @netplay              : pointer to netplay object
+ * @only                 : relay ID to send to, or NETPLAY_RELAY_ALL
+ * @except               : relay ID to skip, or NETPLAY_RELAY_NONE
+ * @compression          : only send to spectators supporting this
+ *                         compression, or NETPLAY_RELAY_ANY_COMPRESSION
+ * @buf                  : data to send
+ * @len                  : size of the data
+ *
+ * Queue data for relayed spectators. Like netplay_send, nothing is actually
+ * sent until netplay_relay_flush.
+ *
+ * Returns: true if successful, false otherwise.
+ */
+bool netplay_relay_send(netplay_t *netplay, uint32_t only, uint32_t except,
+      uint32_t compression, const void *buf, size_t len);
+
+/**
+ * netplay_relay_flush
+ * @netplay              : pointer to netplay object
+ *
+ * Hand queued data to the relay thread.
+ */
+void netplay_relay_flush(netplay_t *netplay);
+
+/**
+ * netplay_relay_reap
+ * @netplay              : pointer to netplay object
+ *
+ * Hang up the spectators the relay gave up on, because their sockets failed
+ * or they fell more than NETPLAY_RELAY_MAX_BACKLOG bytes behind.
+ */
+void netplay_relay_reap(netplay_t *netplay);
+
 
 /***************************************************************
  * NETPLAY-DISCOVERY.C
@@ -0,0 +1,692 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+#include "netplay_private.h"
+
+#ifdef HAVE_THREADS
+
+/* How long the relay thread waits before retrying a spectator whose socket
+ * was full */
+#define RELAY_RETRY_USEC 2000
+
+/* Everything sent to relayed spectators is appended once to a shared log of
+ * blobs. Each spectator only has a cursor into the log, so the main thread's
+ * work doesn't grow with the number of spectators. Blobs are freed once every
+ * spectator's cursor is past them. The log always keeps its newest blob, so
+ * that there's always somewhere for a cursor to point. */
+struct netplay_relay_blob
+{
+   struct netplay_relay_blob *next;
+
+   /* Order in the log, and stream position of the first byte */
+   uint64_t seq;
+   uint64_t pos;
+
+   /* Who it's for */
+   uint32_t only, except, compression;
+
+   size_t len;
+   /* Data follows */
+};
+
+#define RELAY_BLOB_DATA(blob) ((unsigned char *) ((blob) + 1))
+
+struct netplay_relay_client
+{
+   int fd;
+   uint32_t id;
+   uint32_t compression;
+
+   /* Next byte to send */
+   struct netplay_relay_blob *blob;
+   size_t offset;
+
+   /* Set when the relay gave up on this spectator */
+   bool failed;
+};
+
+struct netplay_relay
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+
+   /* The log, oldest first. Only the relay thread frees blobs, and only the
+    * main thread appends them. */
+   struct netplay_relay_blob *head, *tail;
+   uint64_t end_pos;
+   size_t log_bytes;
+
+   /* Attached spectators. Only changed while the relay thread isn't sending,
+    * so it can send without holding the lock. */
+   struct netplay_relay_client *clients;
+   size_t clients_size, clients_cap;
+
+   /* Set by the relay thread while it's sending, and by the main thread while
+    * it's waiting to change the client list */
+   bool sending;
+   bool hold;
+
+   bool failed;
+   bool quit;
+
+   uint32_t next_id;
+
+   /* Main thread only: the blob being built by netplay_relay_send */
+   struct netplay_relay_blob *stage;
+   size_t stage_cap;
+
+   /* Statistics */
+   uint64_t bytes_sent;
+   size_t log_peak;
+   unsigned served;
+};
+
+static bool relay_blob_wanted(const struct netplay_relay_blob *blob,
+      const struct netplay_relay_client *client)
+{
+   return (blob->only == NETPLAY_RELAY_ALL || blob->only == client->id) &&
+      blob->except != client->id &&
+      (blob->compression == NETPLAY_RELAY_ANY_COMPRESSION ||
+       blob->compression == client->compression);
+}
+
+/* Send as much as possible to this client without blocking. Returns true if
+ * its socket is full. */
+static bool relay_client_send(struct netplay_relay *relay,
+      struct netplay_relay_client *client, struct netplay_relay_blob *tail)
+{
+   for (;;)
+   {
+      struct netplay_relay_blob *blob = client->blob;
+      ssize_t sent;
+
+      if (client->offset >= blob->len || !relay_blob_wanted(blob, client))
+      {
+         /* Blobs before the tail were linked before we started sending */
+         if (blob == tail)
+            return false;
+         client->blob   = blob->next;
+         client->offset = 0;
+         continue;
+      }
+
+      sent = socket_send_all_nonblocking(client->fd,
+            RELAY_BLOB_DATA(blob) + client->offset, blob->len - client->offset, true);
+      if (sent < 0)
+      {
+         client->failed = true;
+         return false;
+      }
+
+      client->offset    += sent;
+      relay->bytes_sent += sent;
+
+      if (client->offset < blob->len)
+         return true;
+   }
+}
+
+/* Give up on spectators too far behind, and free whatever every spectator
+ * has been sent. Must be called with the lock held. */
+static void relay_collect(struct netplay_relay *relay)
+{
+   size_t i;
+   uint64_t min_seq = relay->tail->seq;
+
+   for (i = 0; i < relay->clients_size; i++)
+   {
+      struct netplay_relay_client *client = &relay->clients[i];
+
+      if (client->failed)
+      {
+         relay->failed = true;
+         continue;
+      }
+
+      while (client->blob != relay->tail &&
+             (client->offset >= client->blob->len ||
+              !relay_blob_wanted(client->blob, client)))
+      {
+         client->blob   = client->blob->next;
+         client->offset = 0;
+      }
+
+      if (relay->end_pos - (client->blob->pos + client->offset) >
+            NETPLAY_RELAY_MAX_BACKLOG)
+      {
+         client->failed = true;
+         relay->failed  = true;
+         continue;
+      }
+
+      if (client->blob->seq < min_seq)
+         min_seq = client->blob->seq;
+   }
+
+   while (relay->head != relay->tail && relay->head->seq < min_seq)
+   {
+      struct netplay_relay_blob *blob = relay->head;
+      relay->head       = blob->next;
+      relay->log_bytes -= blob->len;
+      free(blob);
+   }
+}
+
+static void netplay_relay_thread(void *data)
+{
+   struct netplay_relay *relay = (struct netplay_relay*)data;
+
+   slock_lock(relay->lock);
+
+   while (!relay->quit)
+   {
+      size_t i;
+      size_t clients_size;
+      bool blocked = false;
+      struct netplay_relay_blob *tail = NULL;
+
+      if (relay->hold)
+      {
+         scond_wait(relay->cond, relay->lock);
+         continue;
+      }
+
+      tail           = relay->tail;
+      clients_size   = relay->clients_size;
+      relay->sending = true;
+      slock_unlock(relay->lock);
+
+      for (i = 0; i < clients_size; i++)
+      {
+         struct netplay_relay_client *client = &relay->clients[i];
+         if (!client->failed && relay_client_send(relay, client, tail))
+            blocked = true;
+      }
+
+      slock_lock(relay->lock);
+      relay->sending = false;
+      relay_collect(relay);
+      scond_broadcast(relay->cond);
+
+      /* Go again right away if anything was added while we were sending */
+      if (relay->quit || relay->hold || tail != relay->tail)
+         continue;
+
+      if (blocked)
+         scond_wait_timeout(relay->cond, relay->lock, RELAY_RETRY_USEC);
+      else
+         scond_wait(relay->cond, relay->lock);
+   }
+
+   slock_unlock(relay->lock);
+}
+
+/* Stop the relay thread from sending, so the client list can be changed.
+ * Returns with the lock held. */
+static void relay_hold(struct netplay_relay *relay)
+{
+   slock_lock(relay->lock);
+   relay->hold = true;
+   while (relay->sending)
+      scond_wait(relay->cond, relay->lock);
+}
+
+static void relay_release(struct netplay_relay *relay)
+{
+   relay->hold = false;
+   scond_broadcast(relay->cond);
+   slock_unlock(relay->lock);
+}
+
+static struct netplay_relay_client *relay_find_client(
+      struct netplay_relay *relay, uint32_t id)
+{
+   size_t i;
+   for (i = 0; i < relay->clients_size; i++)
+      if (relay->clients[i].id == id)
+         return &relay->clients[i];
+   return NULL;
+}
+
+static void relay_remove_client(struct netplay_relay *relay,
+      struct netplay_relay_client *client)
+{
+   *client = relay->clients[--relay->clients_size];
+}
+
+static struct netplay_relay_blob *relay_blob_new(size_t cap)
+{
+   struct netplay_relay_blob *blob = (struct netplay_relay_blob*)
+      malloc(sizeof(*blob) + cap);
+   if (!blob)
+      return NULL;
+   memset(blob, 0, sizeof(*blob));
+   return blob;
+}
+
+/* Append the staged blob to the log */
+static void relay_commit(struct netplay_relay *relay)
+{
+   struct netplay_relay_blob *blob = relay->stage;
+
+   if (!blob)
+      return;
+   relay->stage     = NULL;
+   relay->stage_cap = 0;
+
+   slock_lock(relay->lock);
+   blob->seq         = relay->tail->seq + 1;
+   blob->pos         = relay->end_pos;
+   relay->end_pos   += blob->len;
+   relay->log_bytes += blob->len;
+   if (relay->log_bytes > relay->log_peak)
+      relay->log_peak = relay->log_bytes;
+   relay->tail->next = blob;
+   relay->tail       = blob;
+   scond_broadcast(relay->cond);
+   slock_unlock(relay->lock);
+}
+
+/**
+ * netplay_relay_new
+ * @netplay              : pointer to netplay object
+ *
+ * Starts the spectator relay thread.
+ *
+ * Returns: the relay, or NULL if threads aren't available.
+ */
+struct netplay_relay *netplay_relay_new(netplay_t *netplay)
+{
+   struct netplay_relay *relay = (struct netplay_relay*)
+      calloc(1, sizeof(*relay));
+   if (!relay)
+      return NULL;
+
+   relay->head = relay->tail = relay_blob_new(0);
+   relay->lock   = slock_new();
+   relay->cond   = scond_new();
+   if (!relay->head || !relay->lock || !relay->cond)
+      goto error;
+
+   relay->thread = sthread_create(netplay_relay_thread, relay);
+   if (!relay->thread)
+      goto error;
+
+   /* Everything sent to this connection goes to every relayed spectator */
+   memset(&netplay->relay_connection, 0, sizeof(netplay->relay_connection));
+   netplay->relay_connection.active   = true;
+   netplay->relay_connection.fd       = -1;
+   netplay->relay_connection.mode     = NETPLAY_CONNECTION_SPECTATING;
+   netplay->relay_connection.relay_id = NETPLAY_RELAY_ALL;
+
+   return relay;
+
+error:
+   if (relay->cond)
+      scond_free(relay->cond);
+   if (relay->lock)
+      slock_free(relay->lock);
+   free(relay->head);
+   free(relay);
+   return NULL;
+}
+
+/**
+ * netplay_relay_free
+ * @relay                : the relay
+ *
+ * Stops the relay thread and frees everything not yet sent.
+ */
+void netplay_relay_free(struct netplay_relay *relay)
+{
+   slock_lock(relay->lock);
+   relay->quit = true;
+   scond_broadcast(relay->cond);
+   slock_unlock(relay->lock);
+   sthread_join(relay->thread);
+
+   RARCH_LOG("[netplay] Relay served %u spectators: %u KB sent, %u KB peak backlog.\n",
+         relay->served, (unsigned)(relay->bytes_sent / 1024),
+         (unsigned)(relay->log_peak / 1024));
+
+   while (relay->head)
+   {
+      struct netplay_relay_blob *blob = relay->head;
+      relay->head = blob->next;
+      free(blob);
+   }
+
+   free(relay->stage);
+   free(relay->clients);
+   scond_free(relay->cond);
+   slock_free(relay->lock);
+   free(relay);
+}
+
+/**
+ * netplay_relay_attach
+ * @netplay              : pointer to netplay object
+ * @connection           : a spectating connection
+ *
+ * Hands a spectator over to the relay thread, along with whatever is still
+ * unsent in its send buffer.
+ *
+ * Returns: true if successful, false otherwise.
+ */
+bool netplay_relay_attach(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   struct netplay_relay *relay    = netplay->relay;
+   struct socket_buffer *sbuf     = &connection->send_packet_buffer;
+   struct netplay_relay_client *client;
+   uint32_t id;
+
+   /* Anything queued so far was sent to this connection directly */
+   relay_commit(relay);
+
+   relay_hold(relay);
+
+   if (relay->clients_size >= relay->clients_cap)
+   {
+      size_t new_cap = relay->clients_cap ? relay->clients_cap * 2 : 16;
+      struct netplay_relay_client *new_clients =
+         (struct netplay_relay_client*)realloc(relay->clients,
+               new_cap * sizeof(*new_clients));
+      if (!new_clients)
+      {
+         relay_release(relay);
+         return false;
+      }
+      relay->clients     = new_clients;
+      relay->clients_cap = new_cap;
+   }
+
+   do
+   {
+      id = ++relay->next_id;
+   } while (id == NETPLAY_RELAY_NONE || id == NETPLAY_RELAY_ALL);
+
+   client              = &relay->clients[relay->clients_size++];
+   client->fd          = connection->fd;
+   client->id          = id;
+   client->compression = connection->compression_supported;
+   client->blob        = relay->tail;
+   client->offset      = relay->tail->len;
+   client->failed      = false;
+   relay->served++;
+
+   relay_release(relay);
+
+   connection->relay_id = id;
+
+   /* The unsent part of its send buffer goes first */
+   if (sbuf->end < sbuf->start)
+   {
+      netplay_relay_send(netplay, id, NETPLAY_RELAY_NONE,
+            NETPLAY_RELAY_ANY_COMPRESSION, sbuf->data + sbuf->start,
+            sbuf->bufsz - sbuf->start);
+      netplay_relay_send(netplay, id, NETPLAY_RELAY_NONE,
+            NETPLAY_RELAY_ANY_COMPRESSION, sbuf->data, sbuf->end);
+   }
+   else if (sbuf->end > sbuf->start)
+      netplay_relay_send(netplay, id, NETPLAY_RELAY_NONE,
+            NETPLAY_RELAY_ANY_COMPRESSION, sbuf->data + sbuf->start,
+            sbuf->end - sbuf->start);
+   sbuf->start = sbuf->end = 0;
+
+   netplay_relay_flush(netplay);
+   return true;
+}
+
+/**
+ * netplay_relay_detach
+ * @netplay              : pointer to netplay object
+ * @connection           : a relayed connection
+ * @flush                : queue its backlog in its own send buffer
+ *
+ * Takes a spectator back from the relay thread.
+ *
+ * Returns: false if the relay already gave up on this connection.
+ */
+bool netplay_relay_detach(netplay_t *netplay,
+      struct netplay_connection *connection, bool flush)
+{
+   struct netplay_relay *relay = netplay->relay;
+   struct netplay_relay_client *client;
+   bool ret = true;
+
+   if (!connection->relay_id)
+      return true;
+
+   relay_commit(relay);
+
+   relay_hold(relay);
+
+   client = relay_find_client(relay, connection->relay_id);
+   if (!client || client->failed)
+      ret = false;
+   else if (flush)
+   {
+      /* Whatever it hasn't been sent yet is now the send buffer's job. This
+       * may block, but only while the spectator's backlog is sent. */
+      struct netplay_relay_blob *blob = client->blob;
+      size_t offset                   = client->offset;
+
+      for (; blob; blob = blob->next, offset = 0)
+      {
+         if (offset >= blob->len || !relay_blob_wanted(blob, client))
+            continue;
+         if (!netplay_send(&connection->send_packet_buffer, connection->fd,
+                  RELAY_BLOB_DATA(blob) + offset, blob->len - offset))
+         {
+            ret = false;
+            break;
+         }
+      }
+   }
+
+   if (client)
+      relay_remove_client(relay, client);
+
+   relay_release(relay);
+
+   connection->relay_id = 0;
+   return ret;
+}
+
+/**
+ * netplay_relay_send
+ * @netplay              : pointer to netplay object
+ * @only                 : relay ID to send to, or NETPLAY_RELAY_ALL
+ * @except               : relay ID to skip, or NETPLAY_RELAY_NONE
+ * @compression          : only send to spectators supporting this
+ *                         compression, or NETPLAY_RELAY_ANY_COMPRESSION
+ * @buf                  : data to send
+ * @len                  : size of the data
+ *
+ * Queue data for relayed spectators.
+ *
+ * Returns: true if successful, false otherwise.
+ */
+bool netplay_relay_send(netplay_t *netplay, uint32_t only, uint32_t except,
+      uint32_t compression, const void *buf, size_t len)
+{
+   struct netplay_relay *relay     = netplay->relay;
+   struct netplay_relay_blob *stage = relay->stage;
+
+   /* Consecutive sends to the same spectators share a blob */
+   if (stage && (stage->only != only || stage->except != except ||
+            stage->compression != compression))
+   {
+      relay_commit(relay);
+      stage = NULL;
+   }
+
+   if (!stage)
+   {
+      size_t cap = len > 4096 ? len : 4096;
+
+      stage = relay_blob_new(cap);
+      if (!stage)
+         return false;
+      stage->only        = only;
+      stage->except      = except;
+      stage->compression = compression;
+      relay->stage       = stage;
+      relay->stage_cap   = cap;
+   }
+   else if (stage->len + len > relay->stage_cap)
+   {
+      size_t cap = relay->stage_cap * 2;
+      struct netplay_relay_blob *new_stage;
+
+      if (cap < stage->len + len)
+         cap = stage->len + len;
+      new_stage = (struct netplay_relay_blob*)realloc(stage,
+            sizeof(*stage) + cap);
+      if (!new_stage)
+         return false;
+      stage            = new_stage;
+      relay->stage     = stage;
+      relay->stage_cap = cap;
+   }
+
+   memcpy(RELAY_BLOB_DATA(stage) + stage->len, buf, len);
+   stage->len += len;
+   return true;
+}
+
+/**
+ * netplay_relay_flush
+ * @netplay              : pointer to netplay object
+ *
+ * Hand queued data to the relay thread.
+ */
+void netplay_relay_flush(netplay_t *netplay)
+{
+   if (netplay->relay)
+      relay_commit(netplay->relay);
+}
+
+/**
+ * netplay_relay_reap
+ * @netplay              : pointer to netplay object
+ *
+ * Hang up the spectators the relay gave up on.
+ */
+void netplay_relay_reap(netplay_t *netplay)
+{
+   size_t i, j;
+   struct netplay_relay *relay = netplay->relay;
+   uint32_t *failed            = NULL;
+   size_t failed_size          = 0;
+
+   if (!relay)
+      return;
+
+   slock_lock(relay->lock);
+   if (!relay->failed)
+   {
+      slock_unlock(relay->lock);
+      return;
+   }
+   slock_unlock(relay->lock);
+
+   relay_hold(relay);
+   failed = (uint32_t*)malloc((relay->clients_size + 1) * sizeof(uint32_t));
+   for (i = 0; failed && i < relay->clients_size; )
+   {
+      if (relay->clients[i].failed)
+      {
+         failed[failed_size++] = relay->clients[i].id;
+         relay_remove_client(relay, &relay->clients[i]);
+      }
+      else
+         i++;
+   }
+   if (failed)
+      relay->failed = false;
+   relay_release(relay);
+
+   for (i = 0; i < failed_size; i++)
+   {
+      for (j = 0; j < netplay->connections_size; j++)
+      {
+         struct netplay_connection *connection = &netplay->connections[j];
+         if (connection->active && connection->relay_id == failed[i])
+         {
+            RARCH_WARN("[netplay] Spectator %s fell behind, disconnecting.\n",
+                  connection->nick);
+            connection->relay_id = 0;
+            netplay_hangup(netplay, connection);
+            break;
+         }
+      }
+   }
+
+   free(failed);
+}
+
+#else
+
+struct netplay_relay *netplay_relay_new(netplay_t *netplay)
+{
+   return NULL;
+}
+
+void netplay_relay_free(struct netplay_relay *relay)
+{
+}
+
+bool netplay_relay_attach(netplay_t *netplay,
+      struct netplay_connection *connection)
+{
+   return false;
+}
+
+bool netplay_relay_detach(netplay_t *netplay,
+      struct netplay_connection *connection, bool flush)
+{
+   return true;
+}
+
+bool netplay_relay_send(netplay_t *netplay, uint32_t only, uint32_t except,
+      uint32_t compression, const void *buf, size_t len)
+{
+   return false;
+}
+
+void netplay_relay_flush(netplay_t *netplay)
+{
+}
+
+void netplay_relay_reap(netplay_t *netplay)
+{
+}
+
+#endif
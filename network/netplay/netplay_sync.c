@@ -26,6 +26,8 @@
 #include "../../autosave.h"
 #include "../../driver.h"
 #include "../../input/input_driver.h"
+#include "../../performance_counters.h"
+#include "../../runloop.h"
 
 #if 0
 #define DEBUG_NONDETERMINISTIC_CORES
@@ -197,32 +199,30 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
 
    if (netplay_delta_frame_ready(netplay, &netplay->buffer[netplay->run_ptr], netplay->run_frame_count))
    {
-      serial_info.data_const = NULL;
-      serial_info.data = netplay->buffer[netplay->run_ptr].state;
-      serial_info.size = netplay->state_size;
-
-      memset(serial_info.data, 0, serial_info.size);
       if ((netplay->quirks & NETPLAY_QUIRK_INITIALIZATION) || netplay->run_frame_count == 0)
       {
          /* Don't serialize until it's safe */
       }
-      else if (!(netplay->quirks & NETPLAY_QUIRK_NO_SAVESTATES) && core_serialize(&serial_info))
+      else if (!(netplay->quirks & NETPLAY_QUIRK_NO_SAVESTATES) &&
+            netplay_delta_frame_serialize(netplay, &netplay->buffer[netplay->run_ptr]))
       {
          if (netplay->force_send_savestate && !netplay->stall && !netplay->remote_paused)
          {
             /* Bring our running frame and input frames into parity so we don't
-             * send old info */
+             * send old info. The scratch state still holds this frame. */
             if (netplay->run_ptr != netplay->self_ptr)
             {
-               memcpy(netplay->buffer[netplay->self_ptr].state,
-                  netplay->buffer[netplay->run_ptr].state,
-                  netplay->state_size);
+               netplay_delta_frame_store(netplay,
+                  &netplay->buffer[netplay->self_ptr],
+                  netplay->state_scratch, netplay->state_size);
                netplay->run_ptr = netplay->self_ptr;
                netplay->run_frame_count = netplay->self_frame_count;
             }
 
             /* Send this along to the other side */
-            serial_info.data_const = netplay->buffer[netplay->run_ptr].state;
+            serial_info.data       = NULL;
+            serial_info.data_const = netplay->state_scratch;
+            serial_info.size       = netplay->state_size;
             netplay_load_savestate(netplay, &serial_info, false);
             netplay->force_send_savestate = false;
          }
@@ -445,6 +445,9 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
         netplay->other_frame_count < netplay->run_frame_count))
    {
       retro_ctx_serialize_info_t serial_info;
+      retro_time_t rollback_start;
+      static struct retro_perf_counter netplay_rollback = {0};
+      bool is_perfcnt_enable = runloop_ctl(RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL);
 
       /* Replay frames. */
       netplay->is_replay = true;
@@ -455,8 +458,13 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          /* Make sure we're initialized before we start loading things */
          netplay_wait_and_init_serialization(netplay);
 
+      performance_counter_init(netplay_rollback, "netplay_rollback");
+      performance_counter_start_plus(is_perfcnt_enable, netplay_rollback);
+      rollback_start = cpu_features_get_time_usec();
+
       serial_info.data       = NULL;
-      serial_info.data_const = netplay->buffer[netplay->replay_ptr].state;
+      serial_info.data_const = netplay_delta_frame_load(netplay,
+            &netplay->buffer[netplay->replay_ptr]);
       serial_info.size       = netplay->state_size;
 
       if (!core_unserialize(&serial_info))
@@ -464,20 +472,20 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
          RARCH_ERR("Netplay savestate loading failed: Prepare for desync!\n");
       }
 
+      netplay->rollback_count++;
+      netplay->rollback_frames += netplay->run_frame_count -
+         netplay->replay_frame_count;
+
       while (netplay->replay_frame_count < netplay->run_frame_count)
       {
          retro_time_t start, tm;
 
          struct delta_frame *ptr = &netplay->buffer[netplay->replay_ptr];
-         serial_info.data       = ptr->state;
-         serial_info.size       = netplay->state_size;
-         serial_info.data_const = NULL;
 
          start = cpu_features_get_time_usec();
 
          /* Remember the current state */
-         memset(serial_info.data, 0, serial_info.size);
-         core_serialize(&serial_info);
+         netplay_delta_frame_serialize(netplay, ptr);
          if (netplay->replay_frame_count < netplay->unread_frame_count)
             netplay_handle_frame_hash(netplay, ptr);
 
@@ -499,9 +507,7 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
             else
                RARCH_LOG("INP  %X %X\n", ptr->self_state[0], ptr->real_input_state[0]);
             ptr = &netplay->buffer[netplay->replay_ptr];
-            serial_info.data = ptr->state;
-            memset(serial_info.data, 0, serial_info.size);
-            core_serialize(&serial_info);
+            netplay_delta_frame_serialize(netplay, ptr);
             RARCH_LOG("POST %u: %X\n", netplay->replay_frame_count-1, netplay_delta_frame_crc(netplay, ptr));
          }
 #endif
@@ -519,6 +525,9 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
       /* Average our time */
       netplay->frame_run_time_avg = netplay->frame_run_time_sum / NETPLAY_FRAME_RUN_TIME_WINDOW;
 
+      netplay->rollback_time += cpu_features_get_time_usec() - rollback_start;
+      performance_counter_stop_plus(is_perfcnt_enable, netplay_rollback);
+
       if (netplay->unread_frame_count < netplay->run_frame_count)
       {
          netplay->other_ptr = netplay->unread_ptr;
@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+
+"""
+Starts a headless netplay host and connects many spectators to it over
+loopback, to see how the host copes with them, with or without the
+spectator relay (netplay_spectator_relay).
+
+Some spectators can be made to stop reading for a while, as a slow
+connection would. Without the relay the host blocks on their sockets;
+with it they are buffered, and catch up once they read again.
+
+Prints the host's frame times and the time its main thread spent sending
+input each frame, then how far each group of spectators got.
+"""
+
+import argparse
+import json
+import os
+import selectors
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+CMD_INPUT = 0x0003
+CMD_NOINPUT = 0x0004
+CMD_NICK = 0x0020
+CMD_INFO = 0x0022
+CMD_SYNC = 0x0023
+CMD_LOAD_SAVESTATE = 0x0042
+
+COMPRESSION_ZLIB = 1
+NICK_LEN = 32
+
+
+class Spectator:
+    def __init__(self, index, port, stall):
+        self.index = index
+        self.stall = stall
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        if stall:
+            # A small window, so that the host notices when it stops reading
+            self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4096)
+        self.sock.connect(("127.0.0.1", port))
+        self.sock.setblocking(False)
+        self.buf = bytearray()
+        self.header = False
+        self.synced = False
+        self.closed = False
+        self.stall_until = 0.0
+        self.frame = 0
+        self.received = 0
+        self.savestates = 0
+
+    def send(self, data):
+        self.sock.setblocking(True)
+        self.sock.sendall(data)
+        self.sock.setblocking(False)
+
+    def read(self):
+        try:
+            data = self.sock.recv(1 << 16)
+        except (BlockingIOError, InterruptedError):
+            return
+        except OSError:
+            data = b""
+        if not data:
+            self.closed = True
+            return
+        self.received += len(data)
+        self.buf += data
+        self.parse()
+
+    def parse(self):
+        if not self.header:
+            if len(self.buf) < 16:
+                return
+            magic, pmagic, _, salt = struct.unpack("!4I", self.buf[:16])
+            del self.buf[:16]
+            if salt:
+                sys.exit("The host wants a password.")
+            nick = ("spectator%d" % self.index).encode()
+            self.send(struct.pack("!4I", magic, pmagic, COMPRESSION_ZLIB, 0) +
+                      struct.pack("!2I", CMD_NICK, NICK_LEN) +
+                      nick.ljust(NICK_LEN, b"\0"))
+            self.header = True
+
+        while len(self.buf) >= 8:
+            cmd, size = struct.unpack("!2I", self.buf[:8])
+            if len(self.buf) < 8 + size:
+                return
+            payload = bytes(self.buf[8:8 + size])
+            del self.buf[:8 + size]
+
+            if cmd == CMD_INFO:
+                # Same core, same content
+                self.send(struct.pack("!2I", cmd, size) + payload)
+            elif cmd == CMD_SYNC:
+                self.frame = struct.unpack("!I", payload[:4])[0]
+                self.synced = True
+                if self.stall:
+                    self.stall_until = time.monotonic() + self.stall
+            elif cmd in (CMD_INPUT, CMD_NOINPUT):
+                self.frame = max(self.frame,
+                                 struct.unpack("!I", payload[:4])[0])
+            elif cmd == CMD_LOAD_SAVESTATE:
+                self.savestates += 1
+
+
+def summarize(name, group):
+    if not group:
+        return
+    frames = [s.frame for s in group]
+    print("%-8s %5d %10d %10d %10d %8d %10.1f" % (
+        name, len(group), min(frames), max(frames),
+        sum(1 for s in group if not s.synced or
+            (s.closed and s.frame < max(frames))),
+        sum(s.savestates for s in group),
+        sum(s.received for s in group) / 1024.0 / len(group)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("core", help="libretro core to host")
+    parser.add_argument("content", nargs="?", help="content to load")
+    parser.add_argument("-r", "--retroarch", default="retroarch")
+    parser.add_argument("-c", "--config", help="base configuration file")
+    parser.add_argument("-n", "--spectators", type=int, default=100)
+    parser.add_argument("-s", "--slow", type=int, default=0,
+                        help="spectators which stop reading for a while")
+    parser.add_argument("-t", "--stall", type=float, default=2.0,
+                        help="seconds the slow spectators stop reading")
+    parser.add_argument("-f", "--frames", type=int, default=3000)
+    parser.add_argument("-p", "--port", type=int, default=55440)
+    parser.add_argument("--relay", action="store_true",
+                        help="enable the spectator relay")
+    args = parser.parse_args()
+
+    tmpdir = tempfile.mkdtemp()
+    report = os.path.join(tmpdir, "report.json")
+    append = os.path.join(tmpdir, "relay.cfg")
+    with open(append, "w") as f:
+        f.write('netplay_ip_port = "%d"\n' % args.port)
+        f.write('netplay_spectator_relay = "%s"\n' %
+                ("true" if args.relay else "false"))
+
+    cmd = [args.retroarch, "-L", args.core]
+    if args.content:
+        cmd.append(args.content)
+    if args.config:
+        cmd += ["--config", args.config]
+    cmd += ["--appendconfig", append, "-H",
+            "--benchmark=%d" % args.frames, "--benchmark-report=" + report]
+    host = subprocess.Popen(cmd, stdout=subprocess.DEVNULL,
+                            stderr=subprocess.DEVNULL)
+
+    spectators = []
+    deadline = time.monotonic() + 10
+    while not spectators:
+        try:
+            spectators.append(Spectator(0, args.port,
+                                        args.stall if args.slow else 0))
+        except ConnectionRefusedError:
+            if time.monotonic() > deadline or host.poll() is not None:
+                sys.exit("Could not connect to the host.")
+            time.sleep(0.05)
+    for i in range(1, args.spectators):
+        spectators.append(Spectator(i, args.port,
+                                    args.stall if i < args.slow else 0))
+
+    sel = selectors.DefaultSelector()
+    for s in spectators:
+        sel.register(s.sock, selectors.EVENT_READ, s)
+
+    start = time.monotonic()
+    stalled = []
+    while True:
+        now = time.monotonic()
+        for s in [s for s in stalled if s.stall_until <= now]:
+            stalled.remove(s)
+            sel.register(s.sock, selectors.EVENT_READ, s)
+        for key, _ in sel.select(0.01) if sel.get_map() else []:
+            s = key.data
+            s.read()
+            if s.closed:
+                sel.unregister(s.sock)
+                s.sock.close()
+            elif s.stall_until > now:
+                # Stop reading, so the host's sends to it back up
+                sel.unregister(s.sock)
+                stalled.append(s)
+        if not sel.get_map() and not stalled:
+            break
+        if not sel.get_map():
+            time.sleep(0.01)
+        if host.poll() is not None and now - start > 60:
+            break
+
+    host.wait()
+
+    print("%-8s %5s %10s %10s %10s %8s %10s" % (
+        "group", "count", "min_frame", "max_frame", "dropped",
+        "states", "avg_kb"))
+    summarize("normal", [s for s in spectators if not s.stall])
+    summarize("slow", [s for s in spectators if s.stall])
+
+    try:
+        with open(report) as f:
+            result = json.load(f)
+    except (OSError, ValueError):
+        sys.exit("The host did not write a benchmark report.")
+
+    send = [c for c in result["perf_counters"]["frontend"]
+            if c["ident"] == "netplay_send_input"]
+    times = result["frame_time_us"]
+    print("host: %d frames, %.2f fps, frame time p50 %.1f us, p99 %.1f us, "
+          "max %.1f us, sending %s us per frame" % (
+              result["frames"], result["fps"], times["p50"], times["p99"],
+              times["max"], "%.1f" % send[0]["avg_us"] if send else "-"))
+
+    os.remove(report)
+    os.remove(append)
+    os.rmdir(tmpdir)
+
+
+if __name__ == "__main__":
+    main()
@@ -436,6 +436,8 @@ check_header XSHM X11/Xlib.h X11/extensions/XShm.h
 check_header PARPORT linux/parport.h
 check_header PARPORT linux/ppdev.h
 
+check_header IO_URING linux/io_uring.h
+
 if [ "$OS" != 'Win32' ]; then
    check_lib STRL "$CLIB" strlcpy
 fi
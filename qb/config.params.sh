@@ -84,6 +84,7 @@ HAVE_PRESERVE_DYLIB=no     # Enable dlclose() for Valgrind support
 HAVE_PARPORT=auto          # Parallel port joypad support
 HAVE_IMAGEVIEWER=yes       # Built-in image viewer support.
 HAVE_MMAP=auto             # MMAP support
+HAVE_IO_URING=auto         # io_uring file I/O (Linux)
 HAVE_QT=no                 # Qt companion support
 HAVE_QT_WRAPPER=no
 HAVE_XSHM=no               # XShm video driver support
@@ -30,6 +30,7 @@
 #include "../configuration.h"
 #include "../driver.h"
 #include "../retroarch.h"
+#include "../performance_counters.h"
 #include "../runloop.h"
 #include "../verbosity.h"
 #include "../msg_hash.h"
@@ -255,7 +256,16 @@ void recording_dump_frame(const void *data, unsigned width,
       ffemu_data.is_dupe = !data;
 
    if (recording_driver && recording_driver->push_video)
+   {
+      static struct retro_perf_counter record_push_video = {0};
+      bool is_perfcnt_enable = runloop_ctl(
+            RUNLOOP_CTL_IS_PERFCNT_ENABLE, NULL);
+
+      performance_counter_init(record_push_video, "record_push_video");
+      performance_counter_start_plus(is_perfcnt_enable, record_push_video);
       recording_driver->push_video(recording_data, &ffemu_data);
+      performance_counter_stop_plus(is_perfcnt_enable, record_push_video);
+   }
 }
 
 bool recording_deinit(void)
@@ -70,6 +70,7 @@
 #include "input/input_config.h"
 #include "msg_hash.h"
 #include "movie.h"
+#include "benchmark.h"
 #include "dirs.h"
 #include "paths.h"
 #include "file_path_special.h"
@@ -121,8 +122,12 @@ enum
    RA_OPT_FEATURES,
    RA_OPT_VERSION,
    RA_OPT_EOF_EXIT,
+   RA_OPT_BSV_CONVERT,
    RA_OPT_LOG_FILE,
-   RA_OPT_MAX_FRAMES
+   RA_OPT_MAX_FRAMES,
+   RA_OPT_BENCHMARK,
+   RA_OPT_BENCHMARK_REPORT,
+   RA_OPT_BENCHMARK_SUITE
 };
 
 static jmp_buf error_sjlj_context;
@@ -331,6 +336,9 @@ static void retroarch_print_help(const char *arg0)
          "the beginning.");
    puts("      --eof-exit        Exit upon reaching the end of the "
          "BSV movie file.");
+   puts("      --bsvconvert=FILE Write the movie played back with -P to "
+         "FILE\n"
+        "                        in the seekable BSV2 format.");
    puts("  -M, --sram-mode=MODE  SRAM handling mode. MODE can be "
          "'noload-nosave',\n"
         "                        'noload-save', 'load-nosave' or "
@@ -372,7 +380,20 @@ static void retroarch_print_help(const char *arg0)
          "Not relevant for all platforms.");
    puts("      --max-frames=NUMBER\n"
         "                        Runs for the specified number of frames, "
-        "then exits.\n");
+        "then exits.");
+   puts("      --benchmark=NUMBER\n"
+        "                        Runs the specified number of frames as fast "
+        "as possible\n"
+        "                        with the null drivers, then prints a JSON "
+        "report.");
+   puts("      --benchmark-report=FILE\n"
+        "                        Writes the benchmark report to FILE "
+        "instead of stdout.");
+   puts("      --benchmark-suite=LIST\n"
+        "                        Also times the comma separated frontend "
+        "subsystems\n"
+        "                        in LIST once the frames have run: input,\n"
+        "                        core_info, menu.\n");
 }
 
 #define FFMPEG_RECORD_ARG "r:"
@@ -401,8 +422,11 @@ static void retroarch_print_help(const char *arg0)
  **/
 static void retroarch_parse_input(int argc, char *argv[])
 {
-   const char *optstring = NULL;
-   bool explicit_menu    = false;
+   const char *optstring             = NULL;
+   const char *benchmark_report_path = NULL;
+   const char *benchmark_suites      = NULL;
+   unsigned benchmark_frames         = 0;
+   bool explicit_menu                = false;
    global_t  *global     = global_get_ptr();
 
    const struct option opts[] = {
@@ -445,7 +469,11 @@ static void retroarch_parse_input(int argc, char *argv[])
       { "features",     0, NULL, RA_OPT_FEATURES },
       { "subsystem",    1, NULL, RA_OPT_SUBSYSTEM },
       { "max-frames",   1, NULL, RA_OPT_MAX_FRAMES },
+      { "benchmark",    1, NULL, RA_OPT_BENCHMARK },
+      { "benchmark-report", 1, NULL, RA_OPT_BENCHMARK_REPORT },
+      { "benchmark-suite", 1, NULL, RA_OPT_BENCHMARK_SUITE },
       { "eof-exit",     0, NULL, RA_OPT_EOF_EXIT },
+      { "bsvconvert",   1, NULL, RA_OPT_BSV_CONVERT },
       { "version",      0, NULL, RA_OPT_VERSION },
 #ifdef HAVE_FILE_LOGGER
       { "log-file",     1, NULL, RA_OPT_LOG_FILE },
@@ -828,6 +856,24 @@ static void retroarch_parse_input(int argc, char *argv[])
             }
             break;
 
+         case RA_OPT_BENCHMARK:
+            benchmark_frames = (unsigned)strtoul(optarg, NULL, 10);
+            if (benchmark_frames == 0)
+            {
+               RARCH_ERR("Wrong format for --benchmark.\n");
+               retroarch_print_help(argv[0]);
+               retroarch_fail(1, "retroarch_parse_input()");
+            }
+            break;
+
+         case RA_OPT_BENCHMARK_REPORT:
+            benchmark_report_path = optarg;
+            break;
+
+         case RA_OPT_BENCHMARK_SUITE:
+            benchmark_suites = optarg;
+            break;
+
          case RA_OPT_SUBSYSTEM:
             path_set(RARCH_PATH_SUBSYSTEM, optarg);
             break;
@@ -840,6 +886,10 @@ static void retroarch_parse_input(int argc, char *argv[])
             bsv_movie_ctl(BSV_MOVIE_CTL_SET_END_EOF, NULL);
             break;
 
+         case RA_OPT_BSV_CONVERT:
+            bsv_movie_set_convert_path(optarg);
+            break;
+
          case RA_OPT_VERSION:
             retroarch_print_version();
             exit(0);
@@ -859,6 +909,10 @@ static void retroarch_parse_input(int argc, char *argv[])
             retroarch_fail(1, "retroarch_parse_input()");
       }
    }
+
+   if (benchmark_frames && !benchmark_init(benchmark_frames,
+            benchmark_report_path, benchmark_suites))
+      retroarch_fail(1, "retroarch_parse_input()");
    
 #ifdef HAVE_GIT_VERSION
    RARCH_LOG("This is RetroArch version %s (Git %s)\n", PACKAGE_VERSION, retroarch_git_version);
@@ -1065,6 +1119,9 @@ bool retroarch_main_init(int argc, char *argv[])
    retroarch_validate_cpu_features();
    config_load();
 
+   if (benchmark_is_enabled())
+      benchmark_override_settings();
+
    runloop_ctl(RUNLOOP_CTL_TASK_INIT, NULL);
 
    retroarch_main_init_media();
@@ -1207,6 +1264,9 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
          runloop_ctl(RUNLOOP_CTL_STATE_FREE,  NULL);
          runloop_ctl(RUNLOOP_CTL_GLOBAL_FREE, NULL);
          runloop_ctl(RUNLOOP_CTL_DATA_DEINIT, NULL);
+#ifdef HAVE_NETWORKING
+         task_http_pool_free();
+#endif
          config_free();
          break;
       case RARCH_CTL_DEINIT:
@@ -23,6 +23,7 @@
 #include <compat/strl.h>
 #include <retro_assert.h>
 #include <file/file_path.h>
+#include <file/nbio.h>
 #include <queues/message_queue.h>
 #include <queues/task_queue.h>
 #include <string/stdstring.h>
@@ -59,6 +60,7 @@
 #include "configuration.h"
 #include "driver.h"
 #include "movie.h"
+#include "benchmark.h"
 #include "dirs.h"
 #include "paths.h"
 #include "retroarch.h"
@@ -66,8 +68,10 @@
 #include "file_path_special.h"
 #include "managers/core_option_manager.h"
 #include "managers/cheat_manager.h"
+#include "managers/cheat_search.h"
 #include "managers/state_manager.h"
 #include "list_special.h"
+#include "performance_counters.h"
 #include "audio/audio_driver.h"
 #include "camera/camera_driver.h"
 #include "record/record_driver.h"
@@ -135,6 +139,19 @@ static bool runloop_missing_bios                           = false;
 static retro_time_t frame_limit_minimum_time               = 0.0;
 static retro_time_t frame_limit_last_time                  = 0.0;
 
+/* Automatic frame delay: rolling samples of the time spent working
+ * on each frame and of the time between frames. */
+#define FRAME_DELAY_SAMPLES_COUNT 64
+
+static retro_time_t frame_delay_work_samples[FRAME_DELAY_SAMPLES_COUNT];
+static retro_time_t frame_delay_interval_samples[FRAME_DELAY_SAMPLES_COUNT];
+static unsigned frame_delay_sample_count                   = 0;
+static retro_time_t frame_delay_last_time                  = 0;
+static retro_time_t frame_delay_backoff                    = 0;
+static unsigned frame_delay_clean_frames                   = 0;
+static unsigned frame_delay_current                        = 0;
+static unsigned frame_delay_missed                         = 0;
+
 global_t *global_get_ptr(void)
 {
    static struct global g_extern;
@@ -214,6 +231,123 @@ void runloop_get_status(bool *is_paused, bool *is_idle,
    *is_perfcnt_enable = runloop_perfcnt_enable;
 }
 
+void runloop_get_frame_delay_status(unsigned *frame_delay, unsigned *missed)
+{
+   *frame_delay = frame_delay_current;
+   *missed      = frame_delay_missed;
+}
+
+static void runloop_frame_delay_reset(void)
+{
+   frame_delay_sample_count = 0;
+   frame_delay_last_time    = 0;
+   frame_delay_backoff      = 0;
+   frame_delay_clean_frames = 0;
+   frame_delay_current      = 0;
+   frame_delay_missed       = 0;
+}
+
+static retro_time_t runloop_frame_delay_percentile(
+      const retro_time_t *samples, unsigned count, unsigned percent)
+{
+   unsigned i, j;
+   retro_time_t sorted[FRAME_DELAY_SAMPLES_COUNT];
+
+   for (i = 0; i < count; i++)
+   {
+      retro_time_t value = samples[i];
+
+      for (j = i; j > 0 && sorted[j - 1] > value; j--)
+         sorted[j] = sorted[j - 1];
+      sorted[j] = value;
+   }
+
+   return sorted[(count - 1) * percent / 100];
+}
+
+/**
+ * runloop_frame_delay_update:
+ * @settings          : pointer to settings.
+ * @frame_start       : time the frame started, before input polling.
+ * @work              : time the frame spent working, leaving out the
+ *                      frame delay and the video driver's frame call.
+ *
+ * Picks the frame delay for the next frame: the median time between
+ * frames, minus the 95th percentile of the work time, minus a safety
+ * margin. A frame that arrives a VSync late counts as a missed
+ * deadline and widens the margin for a while.
+ **/
+static void runloop_frame_delay_update(settings_t *settings,
+      retro_time_t frame_start, retro_time_t work)
+{
+   unsigned count, target, max_delay, index;
+   retro_time_t interval, period, budget;
+   bool missed            = false;
+   retro_time_t last_time = frame_delay_last_time;
+
+   frame_delay_last_time  = frame_start;
+
+   if (!last_time)
+      return;
+
+   interval = frame_start - last_time;
+   count    = MIN(frame_delay_sample_count, FRAME_DELAY_SAMPLES_COUNT);
+
+   if (count >= FRAME_DELAY_SAMPLES_COUNT / 2)
+   {
+      period = runloop_frame_delay_percentile(
+            frame_delay_interval_samples, count, 50);
+
+      /* Pauses, menu time and content loads are not late frames. */
+      if (interval > period * 4)
+         return;
+
+      if (interval > period * 3 / 2)
+      {
+         missed                   = true;
+         frame_delay_missed++;
+         frame_delay_clean_frames = 0;
+         frame_delay_backoff      = MIN(frame_delay_backoff + 1000,
+               period / 2);
+      }
+      else if (++frame_delay_clean_frames >= 600 && frame_delay_backoff)
+      {
+         frame_delay_clean_frames = 0;
+         frame_delay_backoff      = MAX(frame_delay_backoff - 1000, 0);
+      }
+   }
+
+   index = frame_delay_sample_count++ & (FRAME_DELAY_SAMPLES_COUNT - 1);
+   frame_delay_work_samples[index]     = MAX(work, 0);
+   frame_delay_interval_samples[index] = interval;
+
+   count = MIN(frame_delay_sample_count, FRAME_DELAY_SAMPLES_COUNT);
+   if (count < FRAME_DELAY_SAMPLES_COUNT / 2)
+      return;
+
+   period = runloop_frame_delay_percentile(
+         frame_delay_interval_samples, count, 50);
+   budget = period
+      - runloop_frame_delay_percentile(frame_delay_work_samples, count, 95)
+      - period / 10
+      - frame_delay_backoff;
+
+   max_delay = settings->video.frame_delay ? settings->video.frame_delay : 15;
+   target    = budget > 0 ? (unsigned)(budget / 1000) : 0;
+   if (target > max_delay)
+      target = max_delay;
+
+   /* Step up one millisecond at a time, step down at once. */
+   if (target > frame_delay_current)
+      frame_delay_current++;
+   else
+      frame_delay_current = target;
+
+   if (missed)
+      RARCH_LOG("[Video]: Missed a frame deadline, frame delay is now %u ms.\n",
+            frame_delay_current);
+}
+
 bool runloop_msg_queue_pull(const char **ret)
 {
    if (!ret)
@@ -387,6 +521,7 @@ bool runloop_ctl(enum runloop_ctl_state state, void *data)
          runloop_max_frames                = 0;
          break;
       case RUNLOOP_CTL_STATE_FREE:
+         runloop_frame_delay_reset();
          runloop_perfcnt_enable            = false;
          runloop_idle                      = false;
          runloop_paused                    = false;
@@ -502,6 +637,9 @@ bool runloop_ctl(enum runloop_ctl_state state, void *data)
 #else
             bool threaded_enable = false;
 #endif
+            /* Picks the nbio backend before the task thread can */
+            RARCH_LOG("[nbio] Using the %s backend.\n", nbio_get_backend());
+
             task_queue_deinit();
             task_queue_init(threaded_enable, runloop_msg_queue_push);
          }
@@ -1040,6 +1178,20 @@ static enum runloop_state runloop_check_state(
 #define runloop_netplay_pause() ((void)0)
 #endif
 
+/* Run-ahead gets out of the way of features that rely on
+ * every core frame being a real one. */
+static bool runloop_run_ahead_allowed(settings_t *settings)
+{
+   if (!settings->bools.run_ahead_enabled || !settings->run_ahead_frames)
+      return false;
+#ifdef HAVE_NETWORKING
+   if (netplay_driver_ctl(RARCH_NETPLAY_CTL_IS_DATA_INITED, NULL))
+      return false;
+#endif
+   return !bsv_movie_ctl(BSV_MOVIE_CTL_IS_INITED, NULL)
+      && !state_manager_frame_is_reversed();
+}
+
 /**
  * runloop_iterate:
  *
@@ -1057,6 +1209,12 @@ int runloop_iterate(unsigned *sleep_ms)
    static uint64_t last_input                   = 0;
    bool input_driver_is_nonblock                = false;
    settings_t *settings                         = config_get_ptr();
+   retro_perf_tick_t benchmark_start            = benchmark_frame_begin();
+   retro_time_t frame_start                     =
+      settings->bools.video_frame_delay_auto ?
+      cpu_features_get_time_usec() : 0;
+   retro_time_t run_start                       = 0;
+   retro_time_t frame_work                      = 0;
    uint64_t old_input                           = last_input;
 #ifdef HAVE_MENU
    bool menu_is_alive                           = menu_driver_is_alive();
@@ -1152,16 +1310,54 @@ int runloop_iterate(unsigned *sleep_ms)
       input_push_analog_dpad(auto_binds,    dpad_mode);
    }
 
-   if ((settings->video.frame_delay > 0) && !input_driver_is_nonblock)
+   if (frame_start && settings->bools.video_vsync && !input_driver_is_nonblock)
+   {
+      frame_work = cpu_features_get_time_usec() - frame_start;
+      if (frame_delay_current > 0)
+         retro_sleep(frame_delay_current);
+      run_start  = cpu_features_get_time_usec();
+   }
+   else if ((settings->video.frame_delay > 0) && !input_driver_is_nonblock)
       retro_sleep(settings->video.frame_delay);
 
-   core_run();
+   cheat_search_patch_apply();
+
+   if (runloop_run_ahead_allowed(settings))
+   {
+      static struct retro_perf_counter runahead_frame = {0};
+
+      performance_counter_init(runahead_frame, "runahead_frame");
+      performance_counter_start_plus(runloop_perfcnt_enable, runahead_frame);
+      core_run_ahead(settings->run_ahead_frames,
+            settings->bools.run_ahead_secondary_instance);
+      performance_counter_stop_plus(runloop_perfcnt_enable, runahead_frame);
+   }
+   else
+   {
+      static struct retro_perf_counter core_run_frame = {0};
+
+      performance_counter_init(core_run_frame, "core_run");
+      performance_counter_start_plus(runloop_perfcnt_enable, core_run_frame);
+      core_run();
+      performance_counter_stop_plus(runloop_perfcnt_enable, core_run_frame);
+   }
+
+   if (run_start)
+   {
+      frame_work += cpu_features_get_time_usec() - run_start
+         - video_driver_get_frame_present_time();
+      runloop_frame_delay_update(settings, frame_start, frame_work);
+   }
 
 #ifdef HAVE_CHEEVOS
    if (runloop_check_cheevos())
       cheevos_test();
 #endif
 
+#if defined(HAVE_HTTPSERVER) && defined(HAVE_ZLIB)
+   httpserver_frame();
+#endif
+
    for (i = 0; i < settings->input.max_users; i++)
    {
       struct retro_keybind *general_binds = input_config_binds[i];
@@ -1179,6 +1375,9 @@ int runloop_iterate(unsigned *sleep_ms)
 
    autosave_unlock();
 
+   if (benchmark_start)
+      benchmark_frame_end(benchmark_start);
+
    if (!settings->floats.fastforward_ratio)
       return 0;
 
@@ -207,6 +207,8 @@ bool runloop_msg_queue_pull(const char **ret);
 void runloop_get_status(bool *is_paused, bool *is_idle, bool *is_slowmotion,
       bool *is_perfcnt_enable);
 
+void runloop_get_frame_delay_status(unsigned *frame_delay, unsigned *missed);
+
 bool runloop_ctl(enum runloop_ctl_state state, void *data);
 
 rarch_system_info_t *runloop_get_system_info(void);
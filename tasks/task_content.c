@@ -53,6 +53,7 @@
 #include <string/stdstring.h>
 
 #include <retro_miscellaneous.h>
+#include <rhash.h>
 #include <streams/file_stream.h>
 #include <retro_stat.h>
 #include <retro_assert.h>
@@ -132,6 +133,7 @@ static struct string_list *temporary_content                  = NULL;
 static bool _content_is_inited                                = false;
 static bool core_does_not_need_content                        = false;
 static uint32_t content_crc                                   = 0;
+static rhash_multi_t content_hash;
 
 /**
  * content_file_read:
@@ -302,6 +304,20 @@ error:
    return retval;
 }
 
+/* Digests computed while the content is read, on top of the CRC32
+ * used for playlists and netplay */
+static unsigned content_hash_types(void)
+{
+   unsigned types       = RHASH_CRC32;
+#ifdef HAVE_CHEEVOS
+   settings_t *settings = config_get_ptr();
+
+   if (settings && settings->bools.cheevos_enable)
+      types |= RHASH_MD5;
+#endif
+   return types;
+}
+
 /**
  * load_content_into_memory:
  * @path         : buffer of the content file.
@@ -350,7 +366,12 @@ static bool load_content_into_memory(
 
       content_get_crc(&content_crc_ptr);
 
-      *content_crc_ptr = encoding_crc32(0, ret_buf, *length);
+      /* Everything that identifies the content by hash takes it
+       * from this one pass over the buffer. */
+      rhash_multi_init(&content_hash, content_hash_types());
+      rhash_multi_update(&content_hash, ret_buf, (size_t)*length);
+
+      *content_crc_ptr = content_hash.crc32;
 
       RARCH_LOG("CRC32: 0x%x .\n", (unsigned)*content_crc_ptr);
    }
@@ -1573,6 +1594,14 @@ bool content_get_crc(uint32_t **content_crc_ptr)
    return true;
 }
 
+bool content_get_hash(const rhash_multi_t **content_hash_ptr)
+{
+   if (!content_hash_ptr || !content_hash.types)
+      return false;
+   *content_hash_ptr = &content_hash;
+   return true;
+}
+
 bool content_is_inited(void)
 {
    return _content_is_inited;
@@ -1600,6 +1629,7 @@ void content_deinit(void)
 
    temporary_content          = NULL;
    content_crc                = 0;
+   memset(&content_hash, 0, sizeof(content_hash));
    _content_is_inited         = false;
    core_does_not_need_content = false;
 }
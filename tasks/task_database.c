@@ -22,7 +22,7 @@
 #include <string/stdstring.h>
 #include <lists/dir_list.h>
 #include <file/file_path.h>
-#include <encodings/crc32.h>
+#include <rhash.h>
 #include <streams/file_stream.h>
 #include "tasks_internal.h"
 
@@ -48,7 +48,6 @@ typedef struct database_state_handle
    size_t entry_index;
    uint32_t crc;
    uint32_t archive_crc;
-   uint8_t *buf;
    char archive_name[511];
    char serial[4096];
 } database_state_handle_t;
@@ -172,17 +171,17 @@ static int cue_get_serial(database_state_handle_t *db_state,
    return iso_get_serial(db_state, db, track_path, serial);
 }
 
-static bool file_get_crc(database_state_handle_t *db_state,
-      const char *name, uint32_t *crc)
+static bool file_get_crc(const char *name, uint32_t *crc)
 {
-   ssize_t ret;
-   int read_from            = filestream_read_file(
-         name, (void**)&db_state->buf, &ret);
+   rhash_multi_t hash;
 
-   if (read_from != 1 || ret <= 0)
+   /* Streamed, so large content isn't held in memory just for this */
+   rhash_multi_init(&hash, RHASH_CRC32);
+
+   if (!rhash_multi_file(&hash, name) || !hash.size)
       return 0;
 
-   *crc = encoding_crc32(0, db_state->buf, ret);
+   *crc = hash.crc32;
 
    return 1;
 }
@@ -203,7 +202,7 @@ static int task_database_iterate_playlist(
 #ifdef HAVE_COMPRESSION
          database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
          /* first check crc of archive itself */
-         return file_get_crc(db_state, name, &db_state->archive_crc);
+         return file_get_crc(name, &db_state->archive_crc);
 #else
          break;
 #endif
@@ -222,7 +221,7 @@ static int task_database_iterate_playlist(
          break;
       default:
          database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-         return file_get_crc(db_state, name, &db_state->crc);
+         return file_get_crc(name, &db_state->crc);
    }
 
    return 1;
@@ -596,17 +595,6 @@ static int task_database_iterate(
    return 0;
 }
 
-static void task_database_cleanup_state(
-      database_state_handle_t *db_state)
-{
-   if (!db_state)
-      return;
-
-   if (db_state->buf)
-      free(db_state->buf);
-   db_state->buf = NULL;
-}
-
 static void task_database_handler(retro_task_t *task)
 {
    const char *name                 = NULL;
@@ -641,7 +629,6 @@ static void task_database_handler(retro_task_t *task)
          break;
       case DATABASE_STATUS_ITERATE_START:
          name = database_info_get_current_element_name(dbinfo);
-         task_database_cleanup_state(dbstate);
          dbstate->list_index  = 0;
          dbstate->entry_index = 0;
          task_database_iterate_start(dbinfo, name);
@@ -686,9 +673,6 @@ task_finished:
 
    if (db)
    {
-      if (db->state.buf)
-         free(db->state.buf);
-
       if (db->handle)
          database_info_free(db->handle);
       free(db);
@@ -0,0 +1,111 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <lists/dir_list.h>
+#include <lists/string_list.h>
+
+#include "tasks_internal.h"
+#include "../msg_hash.h"
+
+/* Number of directory entries inspected per handler iteration. */
+#define DIR_LIST_TASK_CHUNK 1024
+
+typedef struct dir_list_handle
+{
+   struct dir_list_reader *reader;
+   struct string_list *list;
+} dir_list_handle_t;
+
+static void task_dir_list_handler(retro_task_t *task)
+{
+   int ret                   = -1;
+   dir_list_handle_t *handle = (dir_list_handle_t*)task->state;
+
+   if (!task_get_cancelled(task))
+      ret = dir_list_reader_step(handle->reader, handle->list,
+            DIR_LIST_TASK_CHUNK);
+
+   if (ret == 1)
+      return;
+
+   /* Never hand out a partial listing. */
+   if (ret == -1)
+   {
+      string_list_free(handle->list);
+      handle->list = NULL;
+      task_set_error(task, strdup(
+               msg_hash_to_str(MENU_ENUM_LABEL_VALUE_DIRECTORY_NOT_FOUND)));
+   }
+
+   /* The callback takes ownership of the list. */
+   task_set_data(task, handle->list);
+   task_set_progress(task, 100);
+   task_set_finished(task, true);
+
+   dir_list_reader_free(handle->reader);
+   free(handle);
+   task->state = NULL;
+}
+
+/**
+ * task_push_dir_list:
+ * @reader             : reader of a partially listed directory.
+ * @list               : entries listed so far.
+ * @cb                 : called with the completed listing.
+ * @user_data          : user data passed on to @cb.
+ *
+ * Finishes a directory listing in the background, taking ownership
+ * of @reader and @list. The unsorted list is handed to @cb as its
+ * task data (NULL on error), and has to be freed by it.
+ *
+ * Returns: true (1) if the task was queued, otherwise false (0),
+ * in which case @reader and @list are still owned by the caller.
+ **/
+bool task_push_dir_list(struct dir_list_reader *reader,
+      struct string_list *list,
+      retro_task_callback_t cb, void *user_data)
+{
+   retro_task_t         *task = (retro_task_t*)calloc(1, sizeof(*task));
+   dir_list_handle_t  *handle = (dir_list_handle_t*)calloc(1, sizeof(*handle));
+
+   if (!task || !handle)
+      goto error;
+
+   handle->reader   = reader;
+   handle->list     = list;
+
+   task->state      = handle;
+   task->handler    = task_dir_list_handler;
+   task->callback   = cb;
+   task->user_data  = user_data;
+   task->progress   = -1;
+   task->mute       = true;
+   task->title      = strdup(msg_hash_to_str(MSG_READING_DIRECTORY));
+
+   task_queue_ctl(TASK_QUEUE_CTL_PUSH, task);
+
+   return true;
+
+error:
+   if (handle)
+      free(handle);
+   if (task)
+      free(task);
+
+   return false;
+}
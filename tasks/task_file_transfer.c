@@ -77,7 +77,9 @@ void task_file_load_handler(retro_task_t *task)
             if (nbio && !string_is_empty(nbio->path))
             {
                const char *fullpath  = nbio->path;
-               struct nbio_t *handle = nbio_open(fullpath, NBIO_READ);
+               /* The decoders only read the file, so a mapping
+                * saves copying it where the backend can do that */
+               struct nbio_t *handle = nbio_open(fullpath, NBIO_READ_MAPPED);
 
                if (handle)
                {
@@ -21,6 +21,7 @@
 #include <file/file_path.h>
 #include <file/archive_file.h>
 #include <net/net_compat.h>
+#include <streams/file_stream.h>
 #include <retro_stat.h>
 
 #include "../msg_hash.h"
@@ -54,10 +55,24 @@ typedef struct http_handle
    } connection;
    struct http_t *handle;
    transfer_cb_t  cb;
+   /* Set when the body is streamed to a file. */
+   RFILE *file;
+   char path[PATH_MAX_LENGTH];
    unsigned status;
    bool error;
 } http_handle_t;
 
+/* Keep-alive sockets shared by all HTTP tasks; only
+ * used from the task handler. */
+static struct http_pool_t *task_http_pool = NULL;
+
+static bool task_http_file_sink(void *userdata,
+      const uint8_t *data, size_t len)
+{
+   http_handle_t *http = (http_handle_t*)userdata;
+   return filestream_write(http->file, data, len) == (ssize_t)len;
+}
+
 static int task_http_con_iterate_transfer(http_handle_t *http)
 {
    if (!net_http_connection_iterate(http->connection.handle))
@@ -91,7 +106,11 @@ static int cb_http_conn_default(void *data_, size_t len)
    if (!network_init())
       return -1;
 
-   http->handle = net_http_new(http->connection.handle);
+   if (!task_http_pool)
+      task_http_pool = net_http_pool_new();
+
+   http->handle = net_http_new_pooled(http->connection.handle,
+         task_http_pool);
 
    if (!http->handle)
    {
@@ -100,6 +119,20 @@ static int cb_http_conn_default(void *data_, size_t len)
       return -1;
    }
 
+   if (!string_is_empty(http->path))
+   {
+      http->file = filestream_open(http->path, RFILE_MODE_WRITE, -1);
+
+      if (!http->file)
+      {
+         RARCH_ERR("[http] Could not open '%s' for writing.\n", http->path);
+         http->error = true;
+         return -1;
+      }
+
+      net_http_set_sink(http->handle, task_http_file_sink, http);
+   }
+
    http->cb     = NULL;
 
    return 0;
@@ -175,6 +208,12 @@ task_finished:
       if (tmp && http->cb)
          http->cb(tmp, len);
 
+      if (http->file)
+      {
+         filestream_close(http->file);
+         http->file = NULL;
+      }
+
       if (net_http_error(http->handle) || task_get_cancelled(task))
       {
          tmp = (char*)net_http_data(http->handle, &len, true);
@@ -182,6 +221,10 @@ task_finished:
          if (tmp)
             free(tmp);
 
+         /* Don't leave a partial download behind. */
+         if (!string_is_empty(http->path))
+            remove(http->path);
+
          if (task_get_cancelled(task))
             task_set_error(task, strdup("Task cancelled."));
          else
@@ -235,7 +278,7 @@ static bool task_http_retriever(retro_task_t *task, void *data)
    return true;
 }
 
-static void* task_push_http_transfer_generic(struct http_connection_t *conn, const char *url, bool mute, const char *type,
+static void* task_push_http_transfer_generic(struct http_connection_t *conn, const char *url, const char *path, bool mute, const char *type,
       retro_task_callback_t cb, void *user_data)
 {
    task_finder_data_t find_data;
@@ -274,6 +317,9 @@ static void* task_push_http_transfer_generic(struct http_connection_t *conn, con
 
    strlcpy(http->connection.url, url, sizeof(http->connection.url));
 
+   if (path)
+      strlcpy(http->path, path, sizeof(http->path));
+
    http->status            = HTTP_STATUS_CONNECTION_TRANSFER;
    t                       = (retro_task_t*)calloc(1, sizeof(*t));
 
@@ -312,7 +358,7 @@ void* task_push_http_transfer(const char *url, bool mute, const char *type,
 
    conn = net_http_connection_new(url, "GET", NULL);
 
-   return task_push_http_transfer_generic(conn, url, mute, type, cb, user_data);
+   return task_push_http_transfer_generic(conn, url, NULL, mute, type, cb, user_data);
 }
 
 void* task_push_http_post_transfer(const char *url, const char *post_data, bool mute,
@@ -322,7 +368,30 @@ void* task_push_http_post_transfer(const char *url, const char *post_data, bool
 
    conn = net_http_connection_new(url, "POST", post_data);
 
-   return task_push_http_transfer_generic(conn, url, mute, type, cb, user_data);
+   return task_push_http_transfer_generic(conn, url, NULL, mute, type, cb, user_data);
+}
+
+/**
+ * task_push_http_transfer_file:
+ * @url                  : URL to download.
+ * @path                 : file the body is written to as it arrives.
+ *
+ * Downloads to a file without holding the body in memory. The task
+ * data is a http_transfer_data_t with a NULL data pointer and the
+ * length written; the file is deleted if the download fails.
+ **/
+void* task_push_http_transfer_file(const char *url, const char *path,
+      bool mute, const char *type,
+      retro_task_callback_t cb, void *user_data)
+{
+   struct http_connection_t *conn;
+
+   if (string_is_empty(path))
+      return NULL;
+
+   conn = net_http_connection_new(url, "GET", NULL);
+
+   return task_push_http_transfer_generic(conn, url, path, mute, type, cb, user_data);
 }
 
 task_retriever_info_t *http_task_get_transfer_list(void)
@@ -338,3 +407,9 @@ task_retriever_info_t *http_task_get_transfer_list(void)
    task_queue_ctl(TASK_QUEUE_CTL_RETRIEVE, &retrieve_data);
    return retrieve_data.list;
 }
+
+void task_http_pool_free(void)
+{
+   net_http_pool_free(task_http_pool);
+   task_http_pool = NULL;
+}
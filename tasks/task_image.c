@@ -13,20 +13,38 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 
 #include <file/nbio.h>
+#include <file/file_path.h>
 #include <formats/image.h>
+#ifdef HAVE_RJPEG
+#include <formats/rjpeg.h>
+#endif
 #include <compat/strl.h>
 #include <retro_assert.h>
 #include <retro_miscellaneous.h>
+#include <retro_stat.h>
+#include <lists/dir_list.h>
 #include <lists/string_list.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
 #include <rhash.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "../configuration.h"
 #include "../gfx/video_driver.h"
 #include "../file_path_special.h"
+#include "../performance_counters.h"
+#include "../runloop.h"
 #include "../verbosity.h"
 
 #include "tasks_internal.h"
@@ -54,8 +72,402 @@ struct nbio_image_handle
    unsigned pos_increment;
    int processing_final_state;
    enum image_status_enum status;
+
+   /* Thumbnails only */
+   unsigned max_width;
+   unsigned max_height;
+   bool cache_checked;
+   int64_t src_mtime;
+   int32_t src_size;
+   uint64_t cache_key;
+   uint64_t cache_size;
+   char cache_dir[PATH_MAX_LENGTH];
+   char cache_path[PATH_MAX_LENGTH];
+   struct nbio_t *cache_handle;
 };
 
+#define THUMBNAIL_CACHE_MAGIC    0x43485452 /* "RTHC" */
+#define THUMBNAIL_CACHE_VERSION  1
+#define THUMBNAIL_CACHE_EXT      "rthumb"
+#define THUMBNAIL_CACHE_DIR      ".cache"
+#define THUMBNAIL_CACHE_MAX_DIM  8192
+
+/* On-disk thumbnail cache entry. The header is followed by the
+ * source image path and, at the next 16 byte boundary, the
+ * downscaled pixels exactly as they get handed to the video driver. */
+struct thumbnail_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t width;
+   uint32_t height;
+   uint32_t supports_rgba;
+   uint32_t path_len;
+   int64_t  src_mtime;
+   int64_t  src_size;
+};
+
+struct thumbnail_cache_entry
+{
+   uint64_t key;
+   uint32_t size;
+   int64_t  last_used;
+};
+
+/* In-memory LRU index of the cache directory, sorted by key.
+ * Built from the file times on first use. It is only accessed from
+ * image task handlers, the lock guards against the menu freeing it. */
+static struct
+{
+   struct thumbnail_cache_entry *entries;
+   size_t count;
+   size_t capacity;
+   uint64_t total_size;
+   bool init;
+   char dir[PATH_MAX_LENGTH];
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+} thumbnail_cache;
+
+static uint64_t thumbnail_cache_key(const char *path,
+      unsigned max_width, unsigned max_height)
+{
+   /* FNV-1a */
+   uint64_t hash = 0xcbf29ce484222325ULL;
+   uint32_t dims[2];
+   size_t i;
+
+   dims[0] = max_width;
+   dims[1] = max_height;
+
+   for (; *path; path++)
+      hash = (hash ^ (uint8_t)*path) * 0x100000001b3ULL;
+   for (i = 0; i < sizeof(dims); i++)
+      hash = (hash ^ ((const uint8_t*)dims)[i]) * 0x100000001b3ULL;
+
+   return hash;
+}
+
+static void thumbnail_cache_entry_path(char *s, size_t len,
+      const char *dir, uint64_t key)
+{
+   char name[32];
+
+   snprintf(name, sizeof(name), "%08x%08x." THUMBNAIL_CACHE_EXT,
+         (unsigned)(key >> 32), (unsigned)(key & 0xffffffff));
+   fill_pathname_join(s, dir, name, len);
+}
+
+static int thumbnail_cache_entry_cmp(const void *a, const void *b)
+{
+   const struct thumbnail_cache_entry *x =
+      (const struct thumbnail_cache_entry*)a;
+   const struct thumbnail_cache_entry *y =
+      (const struct thumbnail_cache_entry*)b;
+
+   if (x->key != y->key)
+      return x->key < y->key ? -1 : 1;
+   return 0;
+}
+
+static int thumbnail_cache_entry_age_cmp(const void *a, const void *b)
+{
+   const struct thumbnail_cache_entry *x =
+      (const struct thumbnail_cache_entry*)a;
+   const struct thumbnail_cache_entry *y =
+      (const struct thumbnail_cache_entry*)b;
+
+   if (x->last_used != y->last_used)
+      return x->last_used < y->last_used ? -1 : 1;
+   return 0;
+}
+
+static size_t thumbnail_cache_find(uint64_t key, bool *found)
+{
+   size_t lo = 0;
+   size_t hi = thumbnail_cache.count;
+
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (thumbnail_cache.entries[mid].key < key)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   *found = lo < thumbnail_cache.count
+      && thumbnail_cache.entries[lo].key == key;
+   return lo;
+}
+
+static bool thumbnail_cache_reserve(size_t count)
+{
+   struct thumbnail_cache_entry *entries = NULL;
+   size_t capacity = thumbnail_cache.capacity ?
+      thumbnail_cache.capacity : 64;
+
+   if (count <= thumbnail_cache.capacity)
+      return true;
+
+   while (capacity < count)
+      capacity *= 2;
+
+   entries = (struct thumbnail_cache_entry*)realloc(
+         thumbnail_cache.entries, capacity * sizeof(*entries));
+   if (!entries)
+      return false;
+
+   thumbnail_cache.entries  = entries;
+   thumbnail_cache.capacity = capacity;
+   return true;
+}
+
+static void thumbnail_cache_index_reset(void)
+{
+   free(thumbnail_cache.entries);
+   thumbnail_cache.entries    = NULL;
+   thumbnail_cache.count      = 0;
+   thumbnail_cache.capacity   = 0;
+   thumbnail_cache.total_size = 0;
+   thumbnail_cache.init       = false;
+   thumbnail_cache.dir[0]     = '\0';
+}
+
+static void thumbnail_cache_index_init(const char *dir)
+{
+   size_t i;
+   struct string_list *list = NULL;
+
+   if (thumbnail_cache.init && string_is_equal(thumbnail_cache.dir, dir))
+      return;
+
+   thumbnail_cache_index_reset();
+   strlcpy(thumbnail_cache.dir, dir, sizeof(thumbnail_cache.dir));
+   thumbnail_cache.init = true;
+
+   list = dir_list_new(dir, THUMBNAIL_CACHE_EXT,
+         false, false, false, false);
+
+   if (!list)
+      return;
+
+   if (!thumbnail_cache_reserve(list->size))
+   {
+      string_list_free(list);
+      return;
+   }
+
+   for (i = 0; i < list->size; i++)
+   {
+      unsigned hi, lo;
+      int64_t mtime                       = 0;
+      const char *path                    = list->elems[i].data;
+      struct thumbnail_cache_entry *entry =
+         &thumbnail_cache.entries[thumbnail_cache.count];
+
+      if (sscanf(path_basename(path), "%8x%8x", &hi, &lo) != 2)
+         continue;
+
+      path_get_mtime(path, &mtime);
+
+      entry->key       = ((uint64_t)hi << 32) | lo;
+      entry->size      = (uint32_t)path_get_size(path);
+      entry->last_used = mtime;
+
+      thumbnail_cache.total_size += entry->size;
+      thumbnail_cache.count++;
+   }
+
+   string_list_free(list);
+
+   qsort(thumbnail_cache.entries, thumbnail_cache.count,
+         sizeof(*thumbnail_cache.entries), thumbnail_cache_entry_cmp);
+}
+
+static void thumbnail_cache_touch(uint64_t key, uint32_t size)
+{
+   bool found = false;
+   size_t pos = thumbnail_cache_find(key, &found);
+
+   if (!found)
+   {
+      if (!thumbnail_cache_reserve(thumbnail_cache.count + 1))
+         return;
+
+      memmove(&thumbnail_cache.entries[pos + 1],
+            &thumbnail_cache.entries[pos],
+            (thumbnail_cache.count - pos) * sizeof(*thumbnail_cache.entries));
+      thumbnail_cache.entries[pos].key  = key;
+      thumbnail_cache.entries[pos].size = 0;
+      thumbnail_cache.count++;
+   }
+
+   thumbnail_cache.total_size -= thumbnail_cache.entries[pos].size;
+   thumbnail_cache.total_size += size;
+
+   thumbnail_cache.entries[pos].size      = size;
+   thumbnail_cache.entries[pos].last_used = (int64_t)time(NULL);
+}
+
+static void thumbnail_cache_evict(uint64_t limit)
+{
+   size_t i, count;
+   uint64_t target;
+   struct thumbnail_cache_entry *by_age = NULL;
+
+   if (thumbnail_cache.total_size <= limit)
+      return;
+
+   /* Trim a bit below the limit, so the next few
+    * stores don't have to go through this again */
+   target = limit - limit / 8;
+   count  = thumbnail_cache.count;
+   by_age = (struct thumbnail_cache_entry*)
+      malloc(count * sizeof(*by_age));
+
+   if (!by_age)
+      return;
+
+   memcpy(by_age, thumbnail_cache.entries, count * sizeof(*by_age));
+   qsort(by_age, count, sizeof(*by_age), thumbnail_cache_entry_age_cmp);
+
+   for (i = 0; i < count && thumbnail_cache.total_size > target; i++)
+   {
+      bool found = false;
+      char path[PATH_MAX_LENGTH];
+      size_t pos = thumbnail_cache_find(by_age[i].key, &found);
+
+      if (!found)
+         continue;
+
+      path[0] = '\0';
+
+      thumbnail_cache_entry_path(path, sizeof(path),
+            thumbnail_cache.dir, by_age[i].key);
+      remove(path);
+
+      thumbnail_cache.total_size -= thumbnail_cache.entries[pos].size;
+      memmove(&thumbnail_cache.entries[pos],
+            &thumbnail_cache.entries[pos + 1],
+            (thumbnail_cache.count - pos - 1) * sizeof(*by_age));
+      thumbnail_cache.count--;
+   }
+
+   free(by_age);
+}
+
+/* Checks the cache entry behind image->cache_handle (mapped, where
+ * nbio can) and returns an image whose pixels point straight into it.
+ * They stay valid until the handle is freed. */
+static struct texture_image *thumbnail_cache_load(
+      struct nbio_image_handle *image, const char *src_path)
+{
+   size_t len                                = 0;
+   size_t path_len                           = strlen(src_path);
+   size_t pixels_offset                      =
+      (sizeof(struct thumbnail_cache_header) + path_len + 15) & ~(size_t)15;
+   struct texture_image *ti                  = NULL;
+   const uint8_t *data                       = (const uint8_t*)
+      nbio_get_ptr(image->cache_handle, &len);
+   const struct thumbnail_cache_header *header =
+      (const struct thumbnail_cache_header*)data;
+
+   if (!data || len < pixels_offset)
+      return NULL;
+
+   if (     header->magic     != THUMBNAIL_CACHE_MAGIC
+         || header->version   != THUMBNAIL_CACHE_VERSION
+         || header->path_len  != path_len
+         || header->src_mtime != image->src_mtime
+         || header->src_size  != image->src_size
+         || header->width  == 0 || header->width  > THUMBNAIL_CACHE_MAX_DIM
+         || header->height == 0 || header->height > THUMBNAIL_CACHE_MAX_DIM)
+      return NULL;
+
+   if (len < pixels_offset
+         + header->width * header->height * sizeof(uint32_t))
+      return NULL;
+
+   /* Guard against hash collisions */
+   if (memcmp(data + sizeof(*header), src_path, path_len) != 0)
+      return NULL;
+
+   ti = (struct texture_image*)calloc(1, sizeof(*ti));
+
+   if (!ti)
+      return NULL;
+
+   ti->pixels        = (uint32_t*)(data + pixels_offset);
+   ti->width         = header->width;
+   ti->height        = header->height;
+   ti->supports_rgba = header->supports_rgba != 0;
+
+   return ti;
+}
+
+static bool thumbnail_cache_store(struct nbio_image_handle *image,
+      const char *src_path)
+{
+   struct thumbnail_cache_header header;
+   char tmp_path[PATH_MAX_LENGTH];
+   static const uint8_t padding[16] = {0};
+   size_t path_len    = strlen(src_path);
+   size_t header_len  = sizeof(header) + path_len;
+   size_t padding_len = ((header_len + 15) & ~(size_t)15) - header_len;
+   size_t pixels_size = image->ti.width * image->ti.height
+      * sizeof(uint32_t);
+   RFILE *file        = NULL;
+   bool ret           = false;
+
+   if (!path_is_directory(image->cache_dir)
+         && !path_mkdir(image->cache_dir))
+      return false;
+
+   header.magic         = THUMBNAIL_CACHE_MAGIC;
+   header.version       = THUMBNAIL_CACHE_VERSION;
+   header.width         = image->ti.width;
+   header.height        = image->ti.height;
+   header.supports_rgba = image->ti.supports_rgba;
+   header.path_len      = (uint32_t)path_len;
+   header.src_mtime     = image->src_mtime;
+   header.src_size      = image->src_size;
+
+   /* Write to a temporary file and move it into place, so a
+    * crash can never leave a truncated entry behind */
+   strlcpy(tmp_path, image->cache_path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   file = filestream_open(tmp_path, RFILE_MODE_WRITE, -1);
+
+   if (!file)
+      return false;
+
+   ret = filestream_write(file, &header, sizeof(header))
+         == (ssize_t)sizeof(header)
+      && filestream_write(file, src_path, path_len)
+         == (ssize_t)path_len
+      && filestream_write(file, padding, padding_len)
+         == (ssize_t)padding_len
+      && filestream_write(file, image->ti.pixels, pixels_size)
+         == (ssize_t)pixels_size;
+
+   filestream_close(file);
+
+   if (ret)
+      ret = path_replace_file(tmp_path, image->cache_path);
+
+   if (!ret)
+   {
+      remove(tmp_path);
+      return false;
+   }
+
+   return true;
+}
+
 static int cb_image_menu_upload_generic(void *data, size_t len)
 {
    unsigned r_shift, g_shift, b_shift, a_shift;
@@ -224,6 +636,33 @@ static void task_image_load_free_internal(nbio_handle_t *nbio)
    image->cb                     = NULL;
 }
 
+#ifdef HAVE_RJPEG
+/* Has the JPEG decoder shrink thumbnails while decoding, by the
+ * largest factor that still leaves them at least as large as the
+ * target size. The final downscale then only has little left to do. */
+static void task_image_set_jpeg_scale(struct nbio_image_handle *image,
+      size_t len)
+{
+   unsigned denom  = 8;
+   unsigned width  = 0;
+   unsigned height = 0;
+
+   if (!rjpeg_get_size((rjpeg_t*)image->handle, len, &width, &height))
+      return;
+
+   for (; denom > 1; denom /= 2)
+   {
+      if (     (!image->max_width
+               || (width  + denom - 1) / denom >= image->max_width)
+            && (!image->max_height
+               || (height + denom - 1) / denom >= image->max_height))
+         break;
+   }
+
+   rjpeg_set_scale((rjpeg_t*)image->handle, denom);
+}
+#endif
+
 static int cb_nbio_generic(nbio_handle_t *nbio, size_t *len)
 {
    void      *ptr                  = NULL;
@@ -239,6 +678,12 @@ static int cb_nbio_generic(nbio_handle_t *nbio, size_t *len)
 
    image_transfer_set_buffer_ptr(image->handle, nbio->image_type, ptr);
 
+#ifdef HAVE_RJPEG
+   if (     nbio->image_type == IMAGE_TYPE_JPEG
+         && (image->max_width || image->max_height))
+      task_image_set_jpeg_scale(image, *len);
+#endif
+
    image->size                     = *len;
    image->pos_increment            = (*len / 2) ? ((unsigned)(*len / 2)) : 1;
    image->processing_pos_increment = (*len / 4) ?
@@ -325,7 +770,32 @@ bool task_image_load_handler(retro_task_t *task)
          && (image && image->is_finished )
          && (!task_get_cancelled(task)))
    {
-      void *data = malloc(sizeof(image->ti));
+      void *data = NULL;
+
+      if (image->max_width || image->max_height)
+      {
+         image_texture_downscale(&image->ti,
+               image->max_width, image->max_height);
+
+         if (!string_is_empty(image->cache_path))
+         {
+#ifdef HAVE_THREADS
+            slock_lock(thumbnail_cache.lock);
+#endif
+            thumbnail_cache_index_init(image->cache_dir);
+            if (thumbnail_cache_store(image, nbio->path))
+            {
+               thumbnail_cache_touch(image->cache_key,
+                     (uint32_t)path_get_size(image->cache_path));
+               thumbnail_cache_evict(image->cache_size);
+            }
+#ifdef HAVE_THREADS
+            slock_unlock(thumbnail_cache.lock);
+#endif
+         }
+      }
+
+      data = malloc(sizeof(image->ti));
 
       if (data)
          memcpy(data, &image->ti, sizeof(image->ti));
@@ -338,7 +808,8 @@ bool task_image_load_handler(retro_task_t *task)
    return true;
 }
 
-bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *user_data)
+static retro_task_t *task_image_load_new(const char *fullpath,
+      retro_task_callback_t cb, void *user_data)
 {
    nbio_handle_t             *nbio   = NULL;
    struct nbio_image_handle   *image = NULL;
@@ -375,9 +846,7 @@ bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *
    t->callback  = cb;
    t->user_data = user_data;
 
-   task_queue_ctl(TASK_QUEUE_CTL_PUSH, t);
-
-   return true;
+   return t;
 
 error:
    task_image_load_free(t);
@@ -389,7 +858,173 @@ error_msg:
    RARCH_ERR("[image load] Failed to open '%s': %s.\n",
          fullpath, strerror(errno));
 
-   return false;
+   return NULL;
+}
+
+bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *user_data)
+{
+   retro_task_t *t = task_image_load_new(fullpath, cb, user_data);
+
+   if (!t)
+      return false;
+
+   task_queue_ctl(TASK_QUEUE_CTL_PUSH, t);
+
+   return true;
+}
+
+static void task_thumbnail_load_handler(retro_task_t *task)
+{
+   static struct retro_perf_counter thumbnail_cache_hit = {0};
+   nbio_handle_t            *nbio  = (nbio_handle_t*)task->state;
+   struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+   bool is_paused                  = false;
+   bool is_idle                    = false;
+   bool is_slowmotion              = false;
+   bool is_perfcnt_enable          = false;
+
+   runloop_get_status(&is_paused, &is_idle, &is_slowmotion,
+         &is_perfcnt_enable);
+
+   if (image && !image->cache_checked)
+   {
+      image->cache_checked = true;
+
+      if (     path_get_mtime(nbio->path, &image->src_mtime)
+            && (image->src_size = path_get_size(nbio->path)) >= 0
+            && !string_is_empty(image->cache_path))
+      {
+         performance_counter_init(thumbnail_cache_hit, "thumbnail_cache_hit");
+         performance_counter_start_plus(is_perfcnt_enable, thumbnail_cache_hit);
+
+         image->cache_handle = nbio_open(image->cache_path, NBIO_READ_MAPPED);
+
+         if (image->cache_handle)
+            nbio_begin_read(image->cache_handle);
+      }
+      else
+         image->cache_path[0] = '\0';
+   }
+
+   if (image && image->cache_handle)
+   {
+      struct texture_image *ti = NULL;
+
+      /* Only still going if the entry could not be mapped */
+      if (!nbio_iterate(image->cache_handle))
+         return;
+
+      ti = thumbnail_cache_load(image, nbio->path);
+
+      if (ti)
+      {
+         performance_counter_stop_plus(is_perfcnt_enable, thumbnail_cache_hit);
+
+#ifdef HAVE_THREADS
+         slock_lock(thumbnail_cache.lock);
+#endif
+         thumbnail_cache_index_init(image->cache_dir);
+         thumbnail_cache_touch(image->cache_key,
+               (uint32_t)path_get_size(image->cache_path));
+#ifdef HAVE_THREADS
+         slock_unlock(thumbnail_cache.lock);
+#endif
+
+         task_set_data(task, ti);
+         task_set_finished(task, true);
+         return;
+      }
+
+      nbio_free(image->cache_handle);
+      image->cache_handle = NULL;
+   }
+
+   task_file_load_handler(task);
+}
+
+static void task_thumbnail_load_free(retro_task_t *task)
+{
+   nbio_handle_t            *nbio  = (nbio_handle_t*)task->state;
+   struct nbio_image_handle *image = nbio ?
+      (struct nbio_image_handle*)nbio->data : NULL;
+   struct texture_image     *ti    = (struct texture_image*)task->task_data;
+
+   if (ti)
+   {
+      /* The pixels of a cache hit belong to the mapped entry */
+      if (!image || !image->cache_handle)
+         image_texture_free(ti);
+      free(ti);
+      task->task_data = NULL;
+   }
+
+   if (image && image->cache_handle)
+   {
+      nbio_free(image->cache_handle);
+      image->cache_handle = NULL;
+   }
+
+   task_image_load_free(task);
+}
+
+bool task_push_thumbnail_load(const char *fullpath,
+      unsigned max_width, unsigned max_height,
+      retro_task_callback_t cb, void *user_data)
+{
+   nbio_handle_t              *nbio = NULL;
+   struct nbio_image_handle  *image = NULL;
+   settings_t             *settings = config_get_ptr();
+   retro_task_t                  *t = task_image_load_new(fullpath,
+         cb, user_data);
+
+   if (!t)
+      return false;
+
+   nbio              = (nbio_handle_t*)t->state;
+   image             = (struct nbio_image_handle*)nbio->data;
+   image->max_width  = max_width;
+   image->max_height = max_height;
+
+   if (     settings->menu.thumbnail_cache_size
+         && !string_is_empty(settings->directory.thumbnails))
+   {
+#ifdef HAVE_THREADS
+      if (!thumbnail_cache.lock)
+         thumbnail_cache.lock = slock_new();
+      if (thumbnail_cache.lock)
+#endif
+      {
+         fill_pathname_join(image->cache_dir, settings->directory.thumbnails,
+               THUMBNAIL_CACHE_DIR, sizeof(image->cache_dir));
+         image->cache_key  = thumbnail_cache_key(fullpath,
+               max_width, max_height);
+         image->cache_size = (uint64_t)settings->menu.thumbnail_cache_size
+            * 1024 * 1024;
+         thumbnail_cache_entry_path(image->cache_path,
+               sizeof(image->cache_path), image->cache_dir, image->cache_key);
+      }
+   }
+
+   t->handler = task_thumbnail_load_handler;
+   t->cleanup = task_thumbnail_load_free;
+
+   task_queue_ctl(TASK_QUEUE_CTL_PUSH, t);
+
+   return true;
+}
+
+void task_thumbnail_cache_free(void)
+{
+#ifdef HAVE_THREADS
+   if (!thumbnail_cache.lock)
+      return;
+
+   slock_lock(thumbnail_cache.lock);
+#endif
+   thumbnail_cache_index_reset();
+#ifdef HAVE_THREADS
+   slock_unlock(thumbnail_cache.lock);
+#endif
 }
 
 void task_image_load_free(retro_task_t *task)
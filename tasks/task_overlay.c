@@ -23,6 +23,11 @@
 #include <lists/string_list.h>
 #include <string/stdstring.h>
 #include <rhash.h>
+#include <features/features_cpu.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "tasks_internal.h"
 
@@ -32,6 +37,19 @@
 #include "../configuration.h"
 #include "../verbosity.h"
 
+/* Upper bound on the threads decoding desc images */
+#define OVERLAY_IMAGE_WORKERS_MAX 4
+
+#ifdef HAVE_THREADS
+typedef struct
+{
+   char *path;
+   struct texture_image image;
+   bool loaded;
+   bool done;
+} overlay_image_job_t;
+#endif
+
 typedef struct
 {
    enum overlay_status state;
@@ -44,7 +62,22 @@ typedef struct
    struct overlay *overlays;
    struct overlay *active;
    size_t resolve_pos;
-
+   retro_time_t start_time;
+
+#ifdef HAVE_THREADS
+   /* Desc images, in the order they are consumed in, decoded
+    * ahead by the workers. Jobs up to job_next are taken,
+    * those up to job_pos consumed. */
+   overlay_image_job_t *jobs;
+   unsigned jobs_size;
+   unsigned job_next;
+   unsigned job_pos;
+   bool jobs_cancel;
+   sthread_t *workers[OVERLAY_IMAGE_WORKERS_MAX];
+   unsigned workers_size;
+   slock_t *jobs_lock;
+   scond_t *jobs_cond;
+#endif
 } overlay_loader_t;
 
 static void task_overlay_image_done(struct overlay *overlay)
@@ -55,7 +88,195 @@ static void task_overlay_image_done(struct overlay *overlay)
    overlay->pos_increment = (overlay->size / 2) ? ((unsigned)(overlay->size / 2)) : 8;
 }
 
-static void task_overlay_load_desc_image(
+#ifdef HAVE_THREADS
+static void task_overlay_image_worker(void *data)
+{
+   overlay_loader_t *loader = (overlay_loader_t*)data;
+
+   for (;;)
+   {
+      overlay_image_job_t *job = NULL;
+
+      slock_lock(loader->jobs_lock);
+      if (!loader->jobs_cancel && loader->job_next < loader->jobs_size)
+         job = &loader->jobs[loader->job_next++];
+      slock_unlock(loader->jobs_lock);
+
+      if (!job)
+         break;
+
+      if (job->path)
+         job->loaded = image_texture_load(&job->image, job->path);
+
+      slock_lock(loader->jobs_lock);
+      job->done = true;
+      scond_broadcast(loader->jobs_cond);
+      slock_unlock(loader->jobs_lock);
+   }
+}
+
+static void task_overlay_stop_image_workers(overlay_loader_t *loader)
+{
+   unsigned i;
+
+   if (!loader->jobs)
+      return;
+
+   slock_lock(loader->jobs_lock);
+   loader->jobs_cancel = true;
+   slock_unlock(loader->jobs_lock);
+
+   for (i = 0; i < loader->workers_size; i++)
+      sthread_join(loader->workers[i]);
+
+   for (i = 0; i < loader->jobs_size; i++)
+   {
+      if (loader->jobs[i].loaded)
+         image_texture_free(&loader->jobs[i].image);
+      free(loader->jobs[i].path);
+   }
+
+   scond_free(loader->jobs_cond);
+   slock_free(loader->jobs_lock);
+   free(loader->jobs);
+
+   loader->jobs         = NULL;
+   loader->jobs_size    = 0;
+   loader->workers_size = 0;
+}
+
+/**
+ * task_overlay_start_image_workers:
+ * @loader                : Overlay loader handle.
+ *
+ * Looks up the images of every desc of every overlay, and
+ * starts threads decoding them while the task goes on.
+ * The task falls back to decoding them itself if the
+ * threads can't be started.
+ **/
+static void task_overlay_start_image_workers(overlay_loader_t *loader)
+{
+   unsigned i, j, workers;
+   unsigned job          = 0;
+   unsigned jobs_size    = 0;
+   bool supports_rgba    = video_driver_supports_rgba();
+
+   for (i = 0; i < loader->size; i++)
+      jobs_size += (unsigned)loader->overlays[i].size;
+
+   workers = cpu_features_get_core_amount();
+   if (workers > OVERLAY_IMAGE_WORKERS_MAX)
+      workers = OVERLAY_IMAGE_WORKERS_MAX;
+   if (workers > jobs_size)
+      workers = jobs_size;
+
+   /* With a single core, a worker only adds thread switches */
+   if (workers < 2)
+      return;
+
+   loader->jobs = (overlay_image_job_t*)
+      calloc(jobs_size, sizeof(*loader->jobs));
+
+   if (!loader->jobs)
+      return;
+
+   loader->jobs_size = jobs_size;
+
+   for (i = 0; i < loader->size; i++)
+   {
+      for (j = 0; j < loader->overlays[i].size; j++, job++)
+      {
+         char overlay_desc_image_key[64];
+         char image_path[PATH_MAX_LENGTH];
+
+         overlay_desc_image_key[0] = image_path[0] = '\0';
+
+         loader->jobs[job].image.supports_rgba = supports_rgba;
+
+         snprintf(overlay_desc_image_key, sizeof(overlay_desc_image_key),
+               "overlay%u_desc%u_overlay", i, j);
+
+         if (config_get_path(loader->conf, overlay_desc_image_key,
+                  image_path, sizeof(image_path)))
+         {
+            char path[PATH_MAX_LENGTH];
+
+            path[0] = '\0';
+
+            fill_pathname_resolve_relative(path, loader->overlay_path,
+                  image_path, sizeof(path));
+
+            loader->jobs[job].path = strdup(path);
+         }
+      }
+   }
+
+   loader->jobs_lock = slock_new();
+   loader->jobs_cond = scond_new();
+
+   if (loader->jobs_lock && loader->jobs_cond)
+   {
+      for (i = 0; i < workers; i++)
+      {
+         loader->workers[loader->workers_size] =
+            sthread_create(task_overlay_image_worker, loader);
+         if (!loader->workers[loader->workers_size])
+            break;
+         loader->workers_size++;
+      }
+   }
+
+   if (!loader->workers_size)
+   {
+      if (loader->jobs_lock)
+         slock_free(loader->jobs_lock);
+      if (loader->jobs_cond)
+         scond_free(loader->jobs_cond);
+      for (i = 0; i < loader->jobs_size; i++)
+         free(loader->jobs[i].path);
+      free(loader->jobs);
+      loader->jobs      = NULL;
+      loader->jobs_size = 0;
+   }
+}
+
+/**
+ * task_overlay_take_desc_image:
+ * @loader                : Overlay loader handle.
+ * @image                 : Filled with the decoded image, if any.
+ * @loaded                : Set if the image could be decoded.
+ *
+ * Takes the next desc image from the workers. On the task
+ * thread this waits for it; on the main thread it returns
+ * straight away if it isn't ready yet.
+ *
+ * Returns: true (1) if the job was done, otherwise false (0).
+ **/
+static bool task_overlay_take_desc_image(overlay_loader_t *loader,
+      struct texture_image *image, bool *loaded)
+{
+   bool done;
+   overlay_image_job_t *job = &loader->jobs[loader->job_pos];
+
+   slock_lock(loader->jobs_lock);
+   if (task_queue_is_threaded())
+      while (!job->done)
+         scond_wait(loader->jobs_cond, loader->jobs_lock);
+   done = job->done;
+   slock_unlock(loader->jobs_lock);
+
+   if (!done)
+      return false;
+
+   *loaded     = job->loaded;
+   *image      = job->image;
+   job->loaded = false;
+   loader->job_pos++;
+   return true;
+}
+#endif
+
+static bool task_overlay_load_desc_image(
       overlay_loader_t *loader,
       struct overlay_desc *desc,
       struct overlay *input_overlay,
@@ -68,6 +289,27 @@ static void task_overlay_load_desc_image(
    overlay_desc_image_key[0]        = '\0';
    image_path[0]                    = '\0';
 
+#ifdef HAVE_THREADS
+   if (loader->jobs)
+   {
+      struct texture_image image_tex;
+      bool loaded = false;
+
+      if (!task_overlay_take_desc_image(loader, &image_tex, &loaded))
+         return false;
+
+      if (loaded)
+      {
+         input_overlay->load_images[input_overlay->load_images_size++] = image_tex;
+         desc->image       = image_tex;
+         desc->image_index = input_overlay->load_images_size - 1;
+      }
+
+      input_overlay->pos ++;
+      return true;
+   }
+#endif
+
    snprintf(overlay_desc_image_key, sizeof(overlay_desc_image_key),
          "overlay%u_desc%u_overlay", ol_idx, desc_idx);
 
@@ -93,6 +335,7 @@ static void task_overlay_load_desc_image(
    }
 
    input_overlay->pos ++;
+   return true;
 }
 
 static bool task_overlay_load_desc(
@@ -425,9 +668,11 @@ static void task_overlay_deferred_loading(retro_task_t *task)
          {
             if (overlay->pos < overlay->size)
             {
-               task_overlay_load_desc_image(loader,
-                     &overlay->descs[overlay->pos], overlay,
-                     loader->pos, (unsigned)overlay->pos);
+               /* Not decoded yet, try again at the next iteration */
+               if (!task_overlay_load_desc_image(loader,
+                        &overlay->descs[overlay->pos], overlay,
+                        loader->pos, (unsigned)overlay->pos))
+                  break;
             }
             else
             {
@@ -466,6 +711,15 @@ static void task_overlay_deferred_loading(retro_task_t *task)
          }
          break;
       case OVERLAY_IMAGE_TRANSFER_DESC_DONE:
+         if (!input_overlay_build_index(overlay))
+         {
+            RARCH_ERR("[Overlay]: Failed to index overlay #%u.\n",
+                  loader->pos);
+            task_set_cancelled(task, true);
+            loader->state   = OVERLAY_STATUS_DEFERRED_ERROR;
+            break;
+         }
+
          if (loader->pos == 0)
             task_overlay_resolve_iterate(task);
 
@@ -501,6 +755,9 @@ static void task_overlay_deferred_load(retro_task_t *task)
       {
          loader->pos   = 0;
          loader->state = OVERLAY_STATUS_DEFERRED_LOADING;
+#ifdef HAVE_THREADS
+         task_overlay_start_image_workers(loader);
+#endif
          break;
       }
 
@@ -653,6 +910,10 @@ static void task_overlay_free(retro_task_t *task)
    overlay_loader_t *loader  = (overlay_loader_t*)task->state;
    struct overlay *overlay   = &loader->overlays[loader->pos];
 
+#ifdef HAVE_THREADS
+   task_overlay_stop_image_workers(loader);
+#endif
+
    if (loader->overlay_path)
       free(loader->overlay_path);
 
@@ -715,6 +976,10 @@ static void task_overlay_handler(retro_task_t *task)
       data->overlay_opacity = settings->floats.input_overlay_opacity;
       data->overlay_scale   = settings->floats.input_overlay_scale;
 
+      RARCH_LOG("[Overlay]: Loaded %u overlays in %.1f ms.\n",
+            loader->size,
+            (cpu_features_get_time_usec() - loader->start_time) / 1000.0);
+
       task_set_data(task, data);
    }
 }
@@ -774,6 +1039,7 @@ static bool task_push_overlay_load(const char *overlay_path,
    loader->conf             = conf;
    loader->state            = OVERLAY_STATUS_DEFERRED_LOAD;
    loader->pos_increment    = (loader->size / 4) ? (loader->size / 4) : 4;
+   loader->start_time       = cpu_features_get_time_usec();
 
    t                        = (retro_task_t*)calloc(1, sizeof(*t));
 
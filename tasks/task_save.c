@@ -21,15 +21,23 @@
 
 #ifdef _WIN32
 #include <direct.h>
+#ifndef _XBOX
+#include <io.h>
+#endif
 #else
 #include <unistd.h>
 #endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#endif
 #include <errno.h>
 
 #include <compat/strl.h>
 #include <retro_assert.h>
+#include <retro_endianness.h>
 #include <lists/string_list.h>
 #include <streams/file_stream.h>
+#include <streams/trans_stream.h>
 #include <rthreads/rthreads.h>
 #include <file/file_path.h>
 #include <retro_miscellaneous.h>
@@ -53,6 +61,21 @@
 
 #define SAVE_STATE_CHUNK 4096
 
+/* Granularity at which autosave tracks and writes SRAM changes */
+#define AUTOSAVE_BLOCK_SIZE 4096
+
+/* Compressed savestates start with a small header followed by
+ * independently compressed chunks, each prefixed by its size, so
+ * they can be produced and consumed one chunk per task iteration.
+ * A chunk that does not shrink is stored as-is and flagged. */
+#define SAVE_STATE_COMPRESSED_MAGIC       0x5A545352 /* "RSTZ" */
+#define SAVE_STATE_COMPRESSED_VERSION     1
+#define SAVE_STATE_COMPRESSED_CODEC_LZ4   1
+#define SAVE_STATE_COMPRESSED_HEADER_SIZE 24
+#define SAVE_STATE_COMPRESSED_CHUNK       (256 * 1024)
+#define SAVE_STATE_COMPRESSED_MAX_CHUNK   (16 * 1024 * 1024)
+#define SAVE_STATE_COMPRESSED_STORED      0x80000000
+
 static struct string_list *task_save_files = NULL;
 
 struct ram_type
@@ -92,6 +115,10 @@ typedef struct
    bool mute;
    int state_slot;
    bool thumbnail_enable;
+   bool compress;
+   uint32_t chunk_size;
+   uint8_t *chunk_buf;
+   void *stream;
 } save_task_state_t;
 
 typedef save_task_state_t load_task_data_t;
@@ -128,10 +155,175 @@ struct autosave
    const char *path;
    size_t bufsize;
    unsigned interval;
+
+   uint8_t *dirty;
+   size_t num_blocks;
+   bool atomic_write;
+   bool fsync;
+
+   unsigned saves;
+   uint64_t bytes_written;
 };
 
 static struct autosave_st autosave_state;
 
+/**
+ * autosave_sync:
+ * @file            : file to flush to disk
+ *
+ * Flush @file and, where the platform supports it, wait for the
+ * data to reach the storage device.
+ *
+ * Returns: 0 on success.
+ **/
+static int autosave_sync(RFILE *file)
+{
+   if (filestream_flush(file) != 0)
+      return -1;
+#if defined(_WIN32) && !defined(_XBOX)
+   return _commit(filestream_get_fd(file));
+#elif defined(__unix__) || defined(__APPLE__)
+   return fsync(filestream_get_fd(file));
+#else
+   return 0;
+#endif
+}
+
+/**
+ * autosave_sync_dir:
+ * @path            : file whose parent directory should be synced
+ *
+ * Make a rename into the directory of @path durable.
+ **/
+static void autosave_sync_dir(const char *path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+   int fd;
+   char dir[PATH_MAX_LENGTH];
+
+   dir[0] = '\0';
+
+   fill_pathname_basedir(dir, path, sizeof(dir));
+
+   fd = open(dir, O_RDONLY);
+   if (fd < 0)
+      return;
+   fsync(fd);
+   close(fd);
+#endif
+}
+
+/**
+ * autosave_write_blocks:
+ * @save            : pointer to autosave object
+ *
+ * Patch the dirty blocks into the existing SRAM file in place.
+ *
+ * Returns: number of bytes written, or -1 if the file is missing,
+ * has a different size or could not be written.
+ **/
+static ssize_t autosave_write_blocks(autosave_t *save)
+{
+   size_t i;
+   ssize_t written = 0;
+   RFILE *file     = filestream_open(save->path,
+         RFILE_MODE_READ_WRITE | RFILE_HINT_UNBUFFERED, -1);
+
+   if (!file)
+      return -1;
+
+   if (filestream_get_size(file) != (long long int)save->bufsize)
+      goto error;
+
+   for (i = 0; i < save->num_blocks; )
+   {
+      size_t start, offset, len;
+
+      if (!save->dirty[i])
+      {
+         i++;
+         continue;
+      }
+
+      /* Coalesce runs of dirty blocks into one write */
+      for (start = i; i < save->num_blocks && save->dirty[i]; i++);
+
+      offset = start * AUTOSAVE_BLOCK_SIZE;
+      len    = MIN(i * AUTOSAVE_BLOCK_SIZE, save->bufsize) - offset;
+
+      if (filestream_seek(file, offset, SEEK_SET) != 0)
+         goto error;
+      if (filestream_write(file, (const uint8_t*)save->buffer + offset, len)
+            != (ssize_t)len)
+         goto error;
+
+      written += len;
+   }
+
+   if (save->fsync && autosave_sync(file) != 0)
+      goto error;
+
+   if (filestream_close(file) != 0)
+      return -1;
+
+   return written;
+
+error:
+   filestream_close(file);
+   return -1;
+}
+
+/**
+ * autosave_write_file:
+ * @save            : pointer to autosave object
+ *
+ * Write the whole SRAM image. With atomic writes enabled, the data
+ * goes to a temporary file which then replaces the old one, so a
+ * crash never leaves a partially written save behind.
+ *
+ * Returns: number of bytes written, or -1 on failure.
+ **/
+static ssize_t autosave_write_file(autosave_t *save)
+{
+   RFILE *file;
+   bool failed = false;
+   char tmp_path[PATH_MAX_LENGTH];
+   const char *path = save->path;
+
+   tmp_path[0] = '\0';
+
+   if (save->atomic_write)
+   {
+      strlcpy(tmp_path, save->path, sizeof(tmp_path));
+      strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+      path = tmp_path;
+   }
+
+   file = filestream_open(path, RFILE_MODE_WRITE, -1);
+
+   if (!file)
+      return -1;
+
+   failed |= filestream_write(file, save->buffer, save->bufsize)
+      != (ssize_t)save->bufsize;
+   failed |= save->fsync ? autosave_sync(file) != 0
+      : filestream_flush(file) != 0;
+   failed |= filestream_close(file) != 0;
+
+   if (save->atomic_write)
+   {
+      if (!failed)
+         failed = !path_replace_file(tmp_path, save->path);
+
+      if (failed)
+         remove(tmp_path);
+      else if (save->fsync)
+         autosave_sync_dir(save->path);
+   }
+
+   return failed ? -1 : (ssize_t)save->bufsize;
+}
+
 /**
  * autosave_thread:
  * @data            : pointer to autosave object
@@ -145,40 +337,60 @@ static void autosave_thread(void *data)
 
    while (!save->quit)
    {
-      bool differ;
+      size_t i;
+      size_t dirty = 0;
 
+      /* Only copy the blocks that changed since the last autosave.
+       * A block stays dirty until it was written successfully. */
       slock_lock(save->lock);
-      differ = memcmp(save->buffer, save->retro_buffer,
-            save->bufsize) != 0;
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
+      for (i = 0; i < save->num_blocks; i++)
+      {
+         size_t offset = i * AUTOSAVE_BLOCK_SIZE;
+         size_t len    = MIN(AUTOSAVE_BLOCK_SIZE, save->bufsize - offset);
+         uint8_t *dst  = (uint8_t*)save->buffer + offset;
+         const uint8_t *src = (const uint8_t*)save->retro_buffer + offset;
+
+         if (memcmp(dst, src, len) != 0)
+         {
+            memcpy(dst, src, len);
+            save->dirty[i] = 1;
+         }
+
+         if (save->dirty[i])
+            dirty++;
+      }
       slock_unlock(save->lock);
 
-      if (differ)
+      if (dirty)
       {
-         /* Should probably deal with this more elegantly. */
-         RFILE *file = filestream_open(save->path, RFILE_MODE_WRITE, -1);
+         ssize_t written = -1;
 
-         if (file)
+         /* Avoid spamming down stderr ... */
+         if (first_log)
          {
-            bool failed = false;
-
-            /* Avoid spamming down stderr ... */
-            if (first_log)
-            {
-               RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
-                     save->path, save->interval);
-               first_log = false;
-            }
-            else
-               RARCH_LOG("SRAM changed ... autosaving ...\n");
-
-            failed |= filestream_write(file, save->buffer, save->bufsize)
-               != save->bufsize;
-            failed |= filestream_flush(file) != 0;
-            failed |= filestream_close(file) != 0;
-            if (failed)
-               RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
+            RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n",
+                  save->path, save->interval);
+            first_log = false;
+         }
+
+         if (!save->atomic_write)
+            written = autosave_write_blocks(save);
+
+         /* Missing or resized file, or atomic writes requested */
+         if (written < 0)
+            written = autosave_write_file(save);
+
+         if (written < 0)
+            RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
+         else
+         {
+            memset(save->dirty, 0, save->num_blocks);
+            save->saves++;
+            save->bytes_written += written;
+
+            RARCH_LOG("SRAM changed ... autosaved %u of %u blocks, %u bytes written.\n",
+                  (unsigned)dirty, (unsigned)save->num_blocks,
+                  (unsigned)written);
          }
       }
 
@@ -208,6 +420,7 @@ static autosave_t *autosave_new(const char *path,
       const void *data, size_t size,
       unsigned interval)
 {
+   settings_t *settings = config_get_ptr();
    autosave_t *handle   = (autosave_t*)calloc(1, sizeof(*handle));
    if (!handle)
       goto error;
@@ -217,8 +430,12 @@ static autosave_t *autosave_new(const char *path,
    handle->path         = path;
    handle->buffer       = malloc(size);
    handle->retro_buffer = data;
+   handle->num_blocks   = (size + AUTOSAVE_BLOCK_SIZE - 1) / AUTOSAVE_BLOCK_SIZE;
+   handle->dirty        = (uint8_t*)calloc(handle->num_blocks, 1);
+   handle->atomic_write = settings->bools.autosave_atomic_write;
+   handle->fsync        = settings->bools.autosave_fsync;
 
-   if (!handle->buffer)
+   if (!handle->buffer || !handle->dirty)
       goto error;
 
    memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
@@ -233,7 +450,11 @@ static autosave_t *autosave_new(const char *path,
 
 error:
    if (handle)
+   {
+      free(handle->buffer);
+      free(handle->dirty);
       free(handle);
+   }
    return NULL;
 }
 
@@ -251,6 +472,11 @@ static void autosave_free(autosave_t *handle)
    scond_signal(handle->cond);
    sthread_join(handle->thread);
 
+   if (handle->saves)
+      RARCH_LOG("Autosave of \"%s\": %u saves, %llu bytes written in total.\n",
+            handle->path, handle->saves,
+            (unsigned long long)handle->bytes_written);
+
    slock_free(handle->lock);
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
@@ -258,6 +484,10 @@ static void autosave_free(autosave_t *handle)
    if (handle->buffer)
       free(handle->buffer);
    handle->buffer = NULL;
+
+   if (handle->dirty)
+      free(handle->dirty);
+   handle->dirty  = NULL;
 }
 
 
@@ -502,6 +732,213 @@ static void undo_save_state_cb(void *task_data,
    }
 }
 
+static void save_state_store32le(uint8_t *buf, uint32_t val)
+{
+   val = swap_if_big32(val);
+   memcpy(buf, &val, sizeof(val));
+}
+
+static uint32_t save_state_load32le(const uint8_t *buf)
+{
+   uint32_t val;
+   memcpy(&val, buf, sizeof(val));
+   return swap_if_big32(val);
+}
+
+/**
+ * task_save_state_free_stream:
+ * @state   : the state associated with the task
+ * @backend : backend the stream was created with
+ *
+ * Release the transcoding stream and chunk buffer used for
+ * compressed savestates.
+ **/
+static void task_save_state_free_stream(save_task_state_t *state,
+      const struct trans_stream_backend *backend)
+{
+   if (state->stream)
+      backend->stream_free(state->stream);
+   if (state->chunk_buf)
+      free(state->chunk_buf);
+   state->stream    = NULL;
+   state->chunk_buf = NULL;
+}
+
+/**
+ * task_save_write_compressed:
+ * @state     : the state associated with the save task
+ * @remaining : number of uncompressed bytes to consume
+ *
+ * Compress the next chunk of the save state and append it to the
+ * file. The container header is written before the first chunk.
+ *
+ * Returns: number of uncompressed bytes consumed, or -1 on failure.
+ **/
+static ssize_t task_save_write_compressed(save_task_state_t *state,
+      ssize_t remaining)
+{
+   uint8_t prefix[4];
+   uint32_t rd                    = 0;
+   uint32_t wn                    = 0;
+   uint32_t header                = 0;
+   const uint8_t *in              = (const uint8_t*)state->data + state->written;
+   const uint8_t *out             = NULL;
+   const struct trans_stream_backend *backend =
+      trans_stream_get_lz4_compress_backend();
+
+   if (!state->stream)
+   {
+      uint8_t buf[SAVE_STATE_COMPRESSED_HEADER_SIZE];
+      uint64_t size    = swap_if_big64((uint64_t)state->size);
+
+      state->stream    = backend->stream_new();
+      state->chunk_buf = (uint8_t*)malloc(
+            TRANS_STREAM_LZ4_BOUND(SAVE_STATE_COMPRESSED_CHUNK));
+
+      if (!state->stream || !state->chunk_buf)
+         return -1;
+
+      save_state_store32le(buf,      SAVE_STATE_COMPRESSED_MAGIC);
+      save_state_store32le(buf + 4,  SAVE_STATE_COMPRESSED_VERSION);
+      save_state_store32le(buf + 8,  SAVE_STATE_COMPRESSED_CODEC_LZ4);
+      save_state_store32le(buf + 12, SAVE_STATE_COMPRESSED_CHUNK);
+      memcpy(buf + 16, &size, sizeof(size));
+
+      if (filestream_write(state->file, buf, sizeof(buf)) != sizeof(buf))
+         return -1;
+   }
+
+   backend->set_in(state->stream, in, (uint32_t)remaining);
+   backend->set_out(state->stream, state->chunk_buf,
+         TRANS_STREAM_LZ4_BOUND(SAVE_STATE_COMPRESSED_CHUNK));
+
+   if (backend->trans(state->stream, true, &rd, &wn, NULL)
+         && (ssize_t)wn < remaining)
+   {
+      header = wn;
+      out    = state->chunk_buf;
+   }
+   else
+   {
+      /* Incompressible, store it as-is */
+      wn     = (uint32_t)remaining;
+      header = wn | SAVE_STATE_COMPRESSED_STORED;
+      out    = in;
+   }
+
+   save_state_store32le(prefix, header);
+
+   if (filestream_write(state->file, prefix, sizeof(prefix)) != sizeof(prefix)
+         || filestream_write(state->file, out, wn) != (ssize_t)wn)
+      return -1;
+
+   return remaining;
+}
+
+/**
+ * task_load_read_compressed_header:
+ * @state : the state associated with the load task
+ *
+ * Check whether the opened file is a compressed savestate. If it
+ * is, the uncompressed size and chunk size are taken from the header
+ * and the file is left positioned at the first chunk.
+ *
+ * Returns: true if the file is a compressed savestate.
+ **/
+static bool task_load_read_compressed_header(save_task_state_t *state)
+{
+   uint8_t buf[SAVE_STATE_COMPRESSED_HEADER_SIZE];
+   uint64_t size;
+   uint32_t chunk_size;
+
+   if (state->size < SAVE_STATE_COMPRESSED_HEADER_SIZE)
+      return false;
+
+   if (filestream_read(state->file, buf, sizeof(buf)) != sizeof(buf))
+      return false;
+
+   if (     save_state_load32le(buf)     != SAVE_STATE_COMPRESSED_MAGIC
+         || save_state_load32le(buf + 4) != SAVE_STATE_COMPRESSED_VERSION
+         || save_state_load32le(buf + 8) != SAVE_STATE_COMPRESSED_CODEC_LZ4)
+      return false;
+
+   chunk_size = save_state_load32le(buf + 12);
+   memcpy(&size, buf + 16, sizeof(size));
+   size       = swap_if_big64(size);
+
+   if (!chunk_size || chunk_size > SAVE_STATE_COMPRESSED_MAX_CHUNK)
+      return false;
+
+   if ((ssize_t)size < 0 || (uint64_t)(size_t)size != size)
+      return false;
+
+   state->size       = (ssize_t)size;
+   state->chunk_size = chunk_size;
+
+   return true;
+}
+
+/**
+ * task_load_read_compressed:
+ * @state     : the state associated with the load task
+ * @remaining : number of uncompressed bytes expected from this chunk
+ *
+ * Read the next chunk of a compressed savestate and decompress it
+ * into the state buffer.
+ *
+ * Returns: number of uncompressed bytes produced, or -1 on failure.
+ **/
+static ssize_t task_load_read_compressed(save_task_state_t *state,
+      ssize_t remaining)
+{
+   uint8_t prefix[4];
+   uint32_t header, len;
+   uint32_t rd                    = 0;
+   uint32_t wn                    = 0;
+   uint8_t *out                   = (uint8_t*)state->data + state->bytes_read;
+   const struct trans_stream_backend *backend =
+      trans_stream_get_lz4_decompress_backend();
+
+   if (filestream_read(state->file, prefix, sizeof(prefix)) != sizeof(prefix))
+      return -1;
+
+   header = save_state_load32le(prefix);
+   len    = header & ~SAVE_STATE_COMPRESSED_STORED;
+
+   if (header & SAVE_STATE_COMPRESSED_STORED)
+   {
+      if ((ssize_t)len != remaining
+            || filestream_read(state->file, out, len) != (ssize_t)len)
+         return -1;
+      return remaining;
+   }
+
+   if (len > TRANS_STREAM_LZ4_BOUND(state->chunk_size))
+      return -1;
+
+   if (!state->stream)
+   {
+      state->stream    = backend->stream_new();
+      state->chunk_buf = (uint8_t*)malloc(
+            TRANS_STREAM_LZ4_BOUND(state->chunk_size));
+
+      if (!state->stream || !state->chunk_buf)
+         return -1;
+   }
+
+   if (filestream_read(state->file, state->chunk_buf, len) != (ssize_t)len)
+      return -1;
+
+   backend->set_in(state->stream, state->chunk_buf, len);
+   backend->set_out(state->stream, out, (uint32_t)remaining);
+
+   if (!backend->trans(state->stream, true, &rd, &wn, NULL)
+         || (ssize_t)wn != remaining)
+      return -1;
+
+   return remaining;
+}
+
 /**
  * task_save_handler_finished:
  * @task : the task to finish
@@ -518,6 +955,9 @@ static void task_save_handler_finished(retro_task_t *task,
 
    filestream_close(state->file);
 
+   task_save_state_free_stream(state,
+         trans_stream_get_lz4_compress_backend());
+
    if (!task_get_error(task) && task_get_cancelled(task))
       task_set_error(task, strdup("Task canceled"));
 
@@ -557,9 +997,18 @@ static void task_save_handler(retro_task_t *task)
          return;
    }
 
-   remaining       = MIN(state->size - state->written, SAVE_STATE_CHUNK);
-   written         = (int)filestream_write(state->file,
-         (uint8_t*)state->data + state->written, remaining);
+   if (state->compress)
+   {
+      remaining    = MIN(state->size - state->written,
+            SAVE_STATE_COMPRESSED_CHUNK);
+      written      = (int)task_save_write_compressed(state, remaining);
+   }
+   else
+   {
+      remaining    = MIN(state->size - state->written, SAVE_STATE_CHUNK);
+      written      = (int)filestream_write(state->file,
+            (uint8_t*)state->data + state->written, remaining);
+   }
 
    state->written += written;
 
@@ -640,6 +1089,7 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t size)
    state->size       = size;
    state->undo_save  = true;
    state->state_slot = settings->ints.state_slot;
+   state->compress   = settings->bools.savestate_file_compression;
 
    task->type        = TASK_TYPE_BLOCKING;
    task->state       = state;
@@ -692,6 +1142,9 @@ static void task_load_handler_finished(retro_task_t *task,
    if (state->file)
       filestream_close(state->file);
 
+   task_save_state_free_stream(state,
+         trans_stream_get_lz4_decompress_backend());
+
    if (!task_get_error(task) && task_get_cancelled(task))
       task_set_error(task, strdup("Task canceled"));
 
@@ -731,15 +1184,29 @@ static void task_load_handler(retro_task_t *task)
 
       filestream_rewind(state->file);
 
+      /* Raw savestates are read as they are */
+      state->compress = task_load_read_compressed_header(state);
+      if (!state->compress)
+         filestream_rewind(state->file);
+
       state->data = malloc(state->size + 1);
 
       if (!state->data)
          goto error;
    }
 
-   remaining          = MIN(state->size - state->bytes_read, SAVE_STATE_CHUNK);
-   bytes_read         = filestream_read(state->file,
-         (uint8_t*)state->data + state->bytes_read, remaining);
+   if (state->compress)
+   {
+      remaining       = MIN(state->size - state->bytes_read,
+            (ssize_t)state->chunk_size);
+      bytes_read      = task_load_read_compressed(state, remaining);
+   }
+   else
+   {
+      remaining       = MIN(state->size - state->bytes_read, SAVE_STATE_CHUNK);
+      bytes_read      = filestream_read(state->file,
+            (uint8_t*)state->data + state->bytes_read, remaining);
+   }
    state->bytes_read += bytes_read;
 
    if (state->size > 0)
@@ -998,6 +1465,7 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
    state->mute             = autosave; /* don't show OSD messages if we are auto-saving */
    state->thumbnail_enable = settings->bools.savestate_thumbnail_enable;
    state->state_slot       = settings->ints.state_slot;
+   state->compress         = settings->bools.savestate_file_compression;
 
    task->type              = TASK_TYPE_BLOCKING;
    task->state             = state;
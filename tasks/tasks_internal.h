@@ -89,8 +89,16 @@ void *task_push_http_transfer(const char *url, bool mute, const char *type,
 void *task_push_http_post_transfer(const char *url, const char *post_data, bool mute, const char *type,
       retro_task_callback_t cb, void *userdata);
 
+void *task_push_http_transfer_file(const char *url, const char *path,
+      bool mute, const char *type,
+      retro_task_callback_t cb, void *userdata);
+
 task_retriever_info_t *http_task_get_transfer_list(void);
 
+/* Closes the keep-alive connections of the HTTP tasks.
+ * Only to be called once no HTTP task can run anymore. */
+void task_http_pool_free(void);
+
 bool task_push_wifi_scan(void);
 
 bool task_push_netplay_lan_scan(void);
@@ -102,9 +110,39 @@ bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port);
 
 #endif
 
+struct dir_list_reader;
+struct string_list;
+
+bool task_push_dir_list(struct dir_list_reader *reader,
+      struct string_list *list,
+      retro_task_callback_t cb, void *user_data);
+
 bool task_push_image_load(const char *fullpath,
       retro_task_callback_t cb, void *userdata);
 
+/**
+ * task_push_thumbnail_load:
+ * @fullpath           : Image to load.
+ * @max_width          : Maximum width of the result, or 0.
+ * @max_height         : Maximum height of the result, or 0.
+ * @cb                 : Callback, gets handed a struct texture_image.
+ * @userdata           : User data passed to @cb.
+ *
+ * Like task_push_image_load(), but shrinks the image to fit in
+ * @max_width x @max_height. The result is kept in the thumbnail
+ * cache, so loading it again only has to map the small copy.
+ *
+ * Unlike with task_push_image_load(), the image handed to @cb
+ * still belongs to the task, and is only valid during the call.
+ *
+ * Returns: true if the task was queued, otherwise false.
+ **/
+bool task_push_thumbnail_load(const char *fullpath,
+      unsigned max_width, unsigned max_height,
+      retro_task_callback_t cb, void *userdata);
+
+void task_thumbnail_cache_free(void);
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,
@@ -0,0 +1,151 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Times the cheat search passes over synthetic memory, with and
+ * without SIMD. The search is built in, so that its region code
+ * can be driven directly. */
+
+#include <stdio.h>
+
+#include <features/features_cpu.h>
+
+#include "../../managers/cheat_search.c"
+
+/* What the search needs from the rest of RetroArch */
+void RARCH_LOG(const char *fmt, ...)
+{
+}
+
+bool bsv_movie_ctl(enum bsv_ctl_state state, void *data)
+{
+   return false;
+}
+
+bool core_get_memory(retro_ctx_memory_info_t *info)
+{
+   return false;
+}
+
+rarch_system_info_t *runloop_get_system_info(void)
+{
+   return NULL;
+}
+
+/* Runs one pass over a synthetic region, returns its duration */
+static retro_time_t bench_pass(cheat_search_region_t *region,
+      unsigned width, enum cheat_search_op op, bool previous,
+      uint32_t value, bool simd, size_t *count)
+{
+   struct cheat_search_cmp cmp;
+   retro_time_t start;
+
+   cheat_search_cmp_init(&cmp, op, value, width);
+   cmp.big_endian = region->search_big_endian;
+
+   start  = cpu_features_get_time_usec();
+   *count = cheat_search_region_filter(region, &cmp, previous, simd);
+   return cpu_features_get_time_usec() - start;
+}
+
+int main(int argc, char **argv)
+{
+   unsigned width, endian, pass;
+   size_t i;
+   unsigned megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 16;
+   size_t size        = (size_t)(megabytes ? megabytes : 1) << 20;
+   uint8_t *mem       = (uint8_t*)malloc(size);
+   uint32_t seed      = 0x12345678;
+   size_t mismatches  = 0;
+
+   if (!mem)
+      return 1;
+
+   /* Mostly small values, as game memory tends to be */
+   for (i = 0; i < size; i++)
+   {
+      seed   = seed * 1103515245 + 12345;
+      mem[i] = (seed >> 16) & ((seed >> 28) ? 0x07 : 0xff);
+   }
+
+   for (width = 1; width <= 4; width *= 2)
+   {
+      for (endian = 0; endian < 2; endian++)
+      {
+         size_t counts[2][3];
+
+         for (pass = 0; pass < 2; pass++)
+         {
+            cheat_search_region_t region;
+            retro_time_t elapsed[3];
+            bool simd = pass == 1;
+
+#ifndef CHEAT_SEARCH_SIMD
+            if (simd)
+            {
+               memcpy(counts[1], counts[0], sizeof(counts[0]));
+               continue;
+            }
+#endif
+
+            memset(&region, 0, sizeof(region));
+            region.data              = mem;
+            region.size              = size;
+            region.search_big_endian = endian == 1;
+
+            if (!cheat_search_region_start(&region, width))
+            {
+               free(mem);
+               return 1;
+            }
+
+            /* Change one value in a thousand */
+            for (i = 0; i < size; i += 997)
+               mem[i]++;
+
+            /* Unchanged over everything, then two constant compares
+             * over what's left */
+            elapsed[0] = bench_pass(&region, width,
+                  CHEAT_SEARCH_EQ, true, 0, simd, &counts[pass][0]);
+            elapsed[1] = bench_pass(&region, width,
+                  CHEAT_SEARCH_LE, false, 0x0505, simd, &counts[pass][1]);
+            elapsed[2] = bench_pass(&region, width,
+                  CHEAT_SEARCH_EQ, false, 3, simd, &counts[pass][2]);
+
+            for (i = 0; i < size; i += 997)
+               mem[i]--;
+
+            cheat_search_region_free(&region);
+
+            printf("%2u-bit %s %s: unchanged %7.1f MB/s, "
+                  "<= %7.1f MB/s, == %7.1f MB/s, %u candidates left\n",
+                  width * 8, endian ? "BE" : "LE",
+                  simd ? "SIMD  " : "scalar",
+                  size / (elapsed[0] + 1.0),
+                  size / (elapsed[1] + 1.0),
+                  size / (elapsed[2] + 1.0),
+                  (unsigned)counts[pass][2]);
+         }
+
+         for (i = 0; i < 3; i++)
+            mismatches += counts[0][i] != counts[1][i];
+      }
+   }
+
+   printf("%u passes differ between scalar and SIMD searches\n",
+         (unsigned)mismatches);
+
+   free(mem);
+   return mismatches ? 1 : 0;
+}
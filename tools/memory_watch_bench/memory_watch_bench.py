@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+
+"""
+Compares reading core memory through the HTTP server's /memoryMap/<id>
+resource with polling a /memoryWatch subscription. Meant to be run against
+watch_core.so, whose first 4 KB of RAM is all one value unless a copy was
+taken while the core was writing it.
+
+License: Public domain
+"""
+
+import argparse
+import http.client
+import json
+import os
+import struct
+import sys
+import time
+import zlib
+
+if sys.version_info < (3, 0, 0):
+    sys.stderr.write("You need python 3.0 or later to run this script\n")
+    exit(1)
+
+Z85 = ("0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+       ".-:+=^!/*?&<>()[]{}@%$#")
+Z85_DECODE = {c: i for i, c in enumerate(Z85)}
+
+
+def z85_decode(s):
+    out = bytearray()
+    for i in range(0, len(s) - len(s) % 5, 5):
+        value = 0
+        for c in s[i:i + 5]:
+            value = value * 85 + Z85_DECODE[c]
+        out += struct.pack(">I", value)
+    return bytes(out)
+
+
+def is_torn(mem):
+    words = struct.unpack("<1024I", mem[:4096])
+    return len(set(words)) != 1
+
+
+class Server:
+    def __init__(self, host, port, pid):
+        self.host = host
+        self.port = port
+        self.pid = pid
+
+    def request(self, method, path):
+        conn = http.client.HTTPConnection(self.host, self.port)
+        conn.request(method, path)
+        response = conn.getresponse()
+        data = response.read()
+        conn.close()
+        return response, data
+
+    def cpu_time(self):
+        """CPU seconds used by the RetroArch process so far, or None."""
+        if not self.pid:
+            return None
+        with open("/proc/%d/stat" % self.pid) as f:
+            fields = f.read().rsplit(")", 1)[1].split()
+        return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def cpu_percent(server, start_cpu, elapsed):
+    if start_cpu is None:
+        return "n/a"
+    return "%.0f%%" % (100 * (server.cpu_time() - start_cpu) / elapsed)
+
+
+def bench_memory_map(server, duration):
+    count = torn = total = 0
+    start_cpu = server.cpu_time()
+    start = time.time()
+
+    while time.time() - start < duration:
+        response, data = server.request("GET", "/memoryMap/0")
+        info = json.loads(data)
+        mem = zlib.decompress(
+            z85_decode(info["data"])[:info["compressedLength"]])
+        count += 1
+        total += len(data)
+        torn += is_torn(mem)
+
+    elapsed = time.time() - start
+    print("%-36s %6.0f req/s   %5d torn  %8.0f bytes/req  CPU %s" % (
+        "/memoryMap/0 (deflate 9 + Z85)", count / elapsed, torn,
+        total / count, cpu_percent(server, start_cpu, elapsed)))
+
+
+def bench_watch(server, duration, query):
+    response, data = server.request("POST", "/memoryWatch?regions=ram")
+    if response.status != 200:
+        sys.exit("Could not create a watch: %d %s" % (response.status, data))
+
+    info = json.loads(data)
+    mem = bytearray(info["size"])
+    count = torn = total = 0
+    frames = set()
+    start_cpu = server.cpu_time()
+    start = time.time()
+
+    while time.time() - start < duration:
+        response, data = server.request(
+            "GET", "/memoryWatch/%d?%s" % (info["id"], query))
+        if response.status == 204:
+            continue
+
+        total += len(data)
+        if response.getheader("Content-Encoding") == "deflate":
+            data = zlib.decompress(data)
+
+        pos = 0
+        while pos < len(data):
+            region, offset, length = struct.unpack_from("<III", data, pos)
+            mem[offset:offset + length] = data[pos + 12:pos + 12 + length]
+            pos += 12 + length
+
+        count += 1
+        torn += is_torn(mem)
+        frames.add(int(response.getheader("X-Frame")))
+
+    elapsed = time.time() - start
+    server.request("DELETE", "/memoryWatch/%d" % info["id"])
+    print("%-36s %6.0f polls/s %5d torn  %8.0f bytes/poll CPU %s, %d frames" % (
+        "watch " + query, count / elapsed, torn, total / count,
+        cpu_percent(server, start_cpu, elapsed), len(frames)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8888)
+    parser.add_argument("--pid", type=int, default=0,
+                        help="RetroArch process, to report its CPU use")
+    parser.add_argument("--duration", type=float, default=5.0,
+                        help="seconds per run")
+    args = parser.parse_args()
+
+    server = Server(args.host, args.port, args.pid)
+    bench_memory_map(server, args.duration)
+    bench_watch(server, args.duration, "compression=none")
+    bench_watch(server, args.duration, "compression=deflate&level=1")
+
+
+if __name__ == "__main__":
+    main()
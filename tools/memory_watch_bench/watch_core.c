@@ -0,0 +1,168 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* A core with 64 KB of RAM for memory_watch_bench.py. Every frame
+ * it writes the frame number to each word of the first 4 KB, in two
+ * halves with a sleep in between, so that a copy taken while the
+ * core runs shows up as torn. It also changes 16 random bytes of
+ * the rest. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libretro.h>
+
+#define WATCH_CORE_RAM_SIZE 65536
+#define WATCH_CORE_WORDS    1024
+#define WATCH_CORE_WIDTH    320
+#define WATCH_CORE_HEIGHT   240
+
+static retro_video_refresh_t video_cb;
+static retro_input_poll_t input_poll_cb;
+static retro_environment_t environ_cb;
+
+static uint8_t ram[WATCH_CORE_RAM_SIZE];
+static uint16_t frame_buf[WATCH_CORE_WIDTH * WATCH_CORE_HEIGHT];
+static uint32_t frame_count;
+static uint32_t seed = 1;
+
+static void watch_core_sleep(void)
+{
+   struct timespec ts = { 0, 2000000 };
+   nanosleep(&ts, NULL);
+}
+
+void retro_set_environment(retro_environment_t cb)
+{
+   bool no_game = true;
+
+   environ_cb = cb;
+   cb(RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME, &no_game);
+}
+
+void retro_set_video_refresh(retro_video_refresh_t cb) { video_cb = cb; }
+void retro_set_audio_sample(retro_audio_sample_t cb) { }
+void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) { }
+void retro_set_input_poll(retro_input_poll_t cb) { input_poll_cb = cb; }
+void retro_set_input_state(retro_input_state_t cb) { }
+
+void retro_init(void) { }
+void retro_deinit(void) { }
+
+unsigned retro_api_version(void)
+{
+   return RETRO_API_VERSION;
+}
+
+void retro_get_system_info(struct retro_system_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->library_name     = "watch_core";
+   info->library_version  = "1";
+   info->valid_extensions = "bin";
+}
+
+void retro_get_system_av_info(struct retro_system_av_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->geometry.base_width  = WATCH_CORE_WIDTH;
+   info->geometry.base_height = WATCH_CORE_HEIGHT;
+   info->geometry.max_width   = WATCH_CORE_WIDTH;
+   info->geometry.max_height  = WATCH_CORE_HEIGHT;
+   info->timing.fps           = 60.0;
+   info->timing.sample_rate   = 44100.0;
+}
+
+void retro_set_controller_port_device(unsigned port, unsigned device) { }
+void retro_reset(void) { }
+
+void retro_run(void)
+{
+   unsigned i;
+   uint32_t *words = (uint32_t*)ram;
+
+   input_poll_cb();
+   frame_count++;
+
+   for (i = 0; i < WATCH_CORE_WORDS / 2; i++)
+      words[i] = frame_count;
+   watch_core_sleep();
+   for (; i < WATCH_CORE_WORDS; i++)
+      words[i] = frame_count;
+
+   for (i = 0; i < 16; i++)
+   {
+      size_t offset;
+
+      seed   = seed * 1103515245 + 12345;
+      offset = WATCH_CORE_WORDS * 4 + (seed >> 8)
+         % (WATCH_CORE_RAM_SIZE - WATCH_CORE_WORDS * 4);
+      ram[offset] = (uint8_t)(seed >> 24);
+   }
+   watch_core_sleep();
+
+   video_cb(frame_buf, WATCH_CORE_WIDTH, WATCH_CORE_HEIGHT,
+         WATCH_CORE_WIDTH * sizeof(*frame_buf));
+}
+
+size_t retro_serialize_size(void) { return 0; }
+bool retro_serialize(void *data, size_t size) { return false; }
+bool retro_unserialize(const void *data, size_t size) { return false; }
+void retro_cheat_reset(void) { }
+void retro_cheat_set(unsigned index, bool enabled, const char *code) { }
+
+bool retro_load_game(const struct retro_game_info *game)
+{
+   static struct retro_memory_descriptor desc;
+   static struct retro_memory_map map;
+   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
+
+   environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt);
+
+   memset(&desc, 0, sizeof(desc));
+   desc.ptr            = ram;
+   desc.len            = WATCH_CORE_RAM_SIZE;
+   desc.addrspace      = "RAM";
+   map.descriptors     = &desc;
+   map.num_descriptors = 1;
+   environ_cb(RETRO_ENVIRONMENT_SET_MEMORY_MAPS, &map);
+
+   return true;
+}
+
+bool retro_load_game_special(unsigned type,
+      const struct retro_game_info *info, size_t num)
+{
+   return false;
+}
+
+void retro_unload_game(void) { }
+
+unsigned retro_get_region(void)
+{
+   return RETRO_REGION_NTSC;
+}
+
+void *retro_get_memory_data(unsigned id)
+{
+   return id == RETRO_MEMORY_SYSTEM_RAM ? ram : NULL;
+}
+
+size_t retro_get_memory_size(unsigned id)
+{
+   return id == RETRO_MEMORY_SYSTEM_RAM ? WATCH_CORE_RAM_SIZE : 0;
+}
@@ -0,0 +1,249 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Times overlay hit-testing on a synthetic keyboard overlay with
+ * several pointers, through the grid index and against every desc.
+ * The overlay code is built in, so that its polling can be driven
+ * directly. */
+
+#include <stdio.h>
+
+#include <features/features_cpu.h>
+
+#include "../../input/input_overlay.c"
+
+/* What the overlay code needs from the rest of RetroArch */
+const input_driver_t *current_input = NULL;
+void *current_input_data            = NULL;
+
+void RARCH_ERR(const char *fmt, ...)
+{
+}
+
+void image_texture_free(struct texture_image *img)
+{
+}
+
+void input_keyboard_event(bool down, unsigned code, uint32_t character,
+      uint16_t mod, unsigned device)
+{
+}
+
+void *video_driver_get_ptr(bool force_nonthreaded_data)
+{
+   return NULL;
+}
+
+bool video_driver_overlay_interface(
+      const video_overlay_interface_t **iface)
+{
+   return false;
+}
+
+static uint32_t bench_hash(uint32_t hash,
+      const input_overlay_state_t *state)
+{
+   unsigned i;
+
+   hash = hash * 31 + (uint32_t)state->buttons;
+   hash = hash * 31 + (uint32_t)(state->buttons >> 32);
+
+   for (i = 0; i < ARRAY_SIZE(state->keys); i++)
+      hash = hash * 31 + state->keys[i];
+   for (i = 0; i < 4; i++)
+      hash = hash * 31 + (uint16_t)state->analog[i];
+
+   return hash;
+}
+
+/* Two analog sticks at the bottom, keys in a grid twice
+ * as wide as high over the top 60% of the screen. */
+static void bench_build_overlay(struct overlay *active, unsigned descs)
+{
+   unsigned i, cols, rows;
+
+   active->size  = descs;
+   active->mod_w = 1.0f;
+   active->mod_h = 1.0f;
+
+   for (i = 0; i < 2; i++)
+   {
+      struct overlay_desc *desc = &active->descs[i];
+
+      desc->type                = i ? OVERLAY_TYPE_ANALOG_RIGHT
+         : OVERLAY_TYPE_ANALOG_LEFT;
+      desc->hitbox              = OVERLAY_HITBOX_RADIAL;
+      desc->x                   = i ? 0.85f : 0.15f;
+      desc->y                   = 0.8f;
+      desc->range_x             = 0.12f;
+      desc->range_y             = 0.15f;
+      desc->range_mod           = 2.0f;
+      desc->analog_saturate_pct = 0.8f;
+   }
+
+   rows = (unsigned)ceil(sqrt((descs - 2) / 2.0));
+   cols = (descs - 2 + rows - 1) / rows;
+
+   for (i = 2; i < descs; i++)
+   {
+      struct overlay_desc *desc = &active->descs[i];
+      unsigned key              = i - 2;
+
+      desc->hitbox              = OVERLAY_HITBOX_RECT;
+      desc->x                   = (key % cols + 0.5f) / cols;
+      desc->y                   = (key / cols + 0.5f) * 0.6f / rows;
+      desc->range_x             = 0.5f / cols;
+      desc->range_y             = 0.3f / rows;
+      desc->range_mod           = (key % 3) ? 1.0f : 1.5f;
+
+      if (key % 5)
+      {
+         desc->type             = OVERLAY_TYPE_KEYBOARD;
+         desc->key_mask         = RETROK_a + key % 26;
+      }
+      else
+      {
+         desc->type             = OVERLAY_TYPE_BUTTONS;
+         desc->key_mask         = UINT64_C(1) << (key % 16);
+      }
+   }
+
+   /* Hitboxes are tested as if the keys with a range_mod were
+    * held down, to check that the grid accounts for them. */
+   for (i = 0; i < descs; i++)
+   {
+      struct overlay_desc *desc = &active->descs[i];
+      float mod                 = (i % 3) ? 1.0f : desc->range_mod;
+
+      desc->range_x_mod         = desc->range_x * mod;
+      desc->range_y_mod         = desc->range_y * mod;
+   }
+}
+
+int main(int argc, char **argv)
+{
+   unsigned i, k, p;
+   struct overlay active;
+   input_overlay_t ol;
+   unsigned *grid_cells             = NULL;
+   unsigned descs                   = argc > 1
+      ? strtoul(argv[1], NULL, 10) : 200;
+   unsigned polls                   = argc > 2
+      ? strtoul(argv[2], NULL, 10) : 200000;
+   unsigned differ                  = 0;
+   static const unsigned pointers[] = { 1, 4, 10 };
+
+   if (descs < 3)
+      descs = 3;
+   if (!polls)
+      polls = 1;
+
+   memset(&active, 0, sizeof(active));
+   memset(&ol, 0, sizeof(ol));
+
+   active.descs = (struct overlay_desc*)calloc(descs, sizeof(*active.descs));
+   ol.pressed   = (unsigned*)malloc(descs * sizeof(unsigned));
+
+   if (!active.descs || !ol.pressed)
+      goto end;
+
+   bench_build_overlay(&active, descs);
+
+   if (!input_overlay_build_index(&active))
+      goto end;
+
+   ol.active = &active;
+   ol.enable = true;
+
+   printf("%u descs in a %ux%u grid, %u cell entries\n",
+         descs, active.grid.cols, active.grid.rows,
+         active.grid.cells[active.grid.cols * active.grid.rows]);
+
+   grid_cells = active.grid.cells;
+
+   for (k = 0; k < ARRAY_SIZE(pointers); k++)
+   {
+      uint32_t hash[2];
+      retro_time_t elapsed[2];
+      unsigned pass;
+
+      for (pass = 0; pass < 2; pass++)
+      {
+         retro_time_t start;
+         uint32_t seed      = 12345;
+
+         /* The second pass tests every desc */
+         active.grid.cells  = pass ? NULL : grid_cells;
+         hash[pass]         = 0;
+         start              = cpu_features_get_time_usec();
+
+         for (i = 0; i < polls; i++)
+         {
+            input_overlay_state_t state;
+
+            memset(&state, 0, sizeof(state));
+
+            for (p = 0; p < pointers[k]; p++)
+            {
+               unsigned j;
+               int16_t x, y;
+               input_overlay_state_t polled;
+
+               seed = seed * 1103515245 + 12345;
+               x    = (int16_t)((seed >> 16) % 0xffff - 0x7fff);
+               seed = seed * 1103515245 + 12345;
+               y    = (int16_t)((seed >> 16) % 0xffff - 0x7fff);
+
+               memset(&polled, 0, sizeof(polled));
+               input_overlay_poll(&ol, &polled, x, y);
+
+               state.buttons |= polled.buttons;
+               for (j = 0; j < ARRAY_SIZE(state.keys); j++)
+                  state.keys[j] |= polled.keys[j];
+               for (j = 0; j < 4; j++)
+                  if (polled.analog[j])
+                     state.analog[j] = polled.analog[j];
+            }
+
+            for (p = 0; p < ol.pressed_size; p++)
+               active.descs[ol.pressed[p]].updated = false;
+            ol.pressed_size = 0;
+
+            hash[pass] = bench_hash(hash[pass], &state);
+         }
+
+         elapsed[pass] = cpu_features_get_time_usec() - start;
+      }
+
+      printf("%2u pointers, %u polls: grid %6.1f ns/poll, "
+            "all descs %6.1f ns/poll, %s\n",
+            pointers[k], polls,
+            elapsed[0] * 1000.0 / polls, elapsed[1] * 1000.0 / polls,
+            hash[0] == hash[1] ? "results match" : "RESULTS DIFFER");
+
+      differ += hash[0] != hash[1];
+   }
+
+   active.grid.cells = grid_cells;
+
+end:
+   /* Not input_overlay_free_overlay(), which also drops overlay_ptr */
+   free(active.grid.cells);
+   free(active.grid.descs);
+   free(active.movable);
+   free(active.descs);
+   free(ol.pressed);
+   return differ ? 1 : 0;
+}